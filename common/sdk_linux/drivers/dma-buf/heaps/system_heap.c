@@ -10,16 +10,21 @@
  *    Andrew F. Davis <afd@ti.com>
  */
 
+#include <linux/debugfs.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-heap.h>
 #include <linux/err.h>
 #include <linux/highmem.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #include "page_pool.h"
 #include "deferred-free-helper.h"
@@ -62,6 +67,39 @@ static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 struct dmabuf_page_pool *pools[NUM_ORDERS];
 
+/*
+ * The low marks of the pools follow the pages of each order allocated in a
+ * period: they grow to the demand of a busy period at once and decay by
+ * 1/SYSTEM_HEAP_MARK_DECAY in each quiet one. The worker zeroes the freed
+ * pages and prefills the pools up to the low marks, the shrinker leaves the
+ * low marks alone. All the low marks together take at most
+ * 1/(1 << SYSTEM_HEAP_MARK_SHIFT) of the memory.
+ */
+#define SYSTEM_HEAP_POOL_PERIOD_MS 1000
+#define SYSTEM_HEAP_MARK_DECAY 8
+#define SYSTEM_HEAP_MARK_SHIFT 4
+#define PREFILL_GFP(gfp) (((gfp) | __GFP_NOWARN | __GFP_NORETRY) & ~__GFP_DIRECT_RECLAIM)
+
+struct system_heap_pool_info {
+    struct list_head dirty; /* freed pages waiting for the zeroing */
+    int dirty_count;
+    atomic_long_t demand; /* pages allocated in the period */
+    atomic64_t hit;
+    atomic64_t dirty_hit; /* freed pages zeroed by the allocation */
+    atomic64_t miss;
+    atomic64_t prefill;
+    atomic64_t hit_ns;
+    atomic64_t miss_ns;
+    atomic64_t max_ns;
+};
+
+static struct system_heap_pool_info pool_info[NUM_ORDERS];
+static DEFINE_SPINLOCK(pool_dirty_lock);
+static struct workqueue_struct *pool_wq;
+static void system_heap_pool_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(pool_work, system_heap_pool_work);
+static unsigned long pool_period_end;
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
     struct sg_table *new_table;
@@ -317,23 +355,41 @@ static void system_heap_vunmap(struct dma_buf *dmabuf, void *vaddr)
     mutex_unlock(&buffer->lock);
 }
 
-static int system_heap_zero_buffer(struct system_heap_buffer *buffer)
+static void system_heap_zero_page(struct page *page)
 {
-    struct sg_table *sgt = &buffer->sg_table;
-    struct sg_page_iter piter;
-    struct page *p;
-    void *vaddr;
-    int ret = 0;
+    int i;
 
-    for_each_sgtable_page(sgt, &piter, 0)
-    {
-        p = sg_page_iter_page(&piter);
-        vaddr = kmap_atomic(p);
-        memset(vaddr, 0, PAGE_SIZE);
-        kunmap_atomic(vaddr);
+    for (i = 0; i < (1 << compound_order(page)); i++) {
+        clear_highpage(page + i);
+    }
+}
+
+static int system_heap_order_index(struct page *page)
+{
+    int i;
+
+    for (i = 0; i < NUM_ORDERS - 1; i++) {
+        if (compound_order(page) == orders[i]) {
+            break;
+        }
     }
+    return i;
+}
+
+static struct page *system_heap_take_dirty(int index)
+{
+    struct system_heap_pool_info *info = &pool_info[index];
+    struct page *page;
 
-    return ret;
+    spin_lock(&pool_dirty_lock);
+    page = list_first_entry_or_null(&info->dirty, struct page, lru);
+    if (page) {
+        list_del(&page->lru);
+        info->dirty_count--;
+    }
+    spin_unlock(&pool_dirty_lock);
+
+    return page;
 }
 
 static void system_heap_buf_free(struct deferred_freelist_item *item, enum df_reason reason)
@@ -341,34 +397,31 @@ static void system_heap_buf_free(struct deferred_freelist_item *item, enum df_re
     struct system_heap_buffer *buffer;
     struct sg_table *table;
     struct scatterlist *sg;
-    int i, j;
+    int i;
 
     buffer = container_of(item, struct system_heap_buffer, deferred_free);
-    /* Zero the buffer pages before adding back to the pool */
-    if (reason == DF_NORMAL) {
-        if (system_heap_zero_buffer(buffer)) {
-            reason = DF_UNDER_PRESSURE; // On failure, just free
-        }
-    }
-
     table = &buffer->sg_table;
     for_each_sg(table->sgl, sg, table->nents, i)
     {
         struct page *page = sg_page(sg);
+        struct system_heap_pool_info *info = &pool_info[system_heap_order_index(page)];
 
         if (reason == DF_UNDER_PRESSURE) {
             __free_pages(page, compound_order(page));
-        } else {
-            for (j = 0; j < NUM_ORDERS; j++) {
-                if (compound_order(page) == orders[j]) {
-                    break;
-                }
-            }
-            dmabuf_page_pool_free(pools[j], page);
+            continue;
         }
+        /* The pages are zeroed by the pool worker before adding back to the pool */
+        spin_lock(&pool_dirty_lock);
+        list_add_tail(&page->lru, &info->dirty);
+        info->dirty_count++;
+        spin_unlock(&pool_dirty_lock);
     }
     sg_free_table(table);
     kfree(buffer);
+
+    if (reason == DF_NORMAL) {
+        mod_delayed_work(pool_wq, &pool_work, 0);
+    }
 }
 
 static void system_heap_dma_buf_release(struct dma_buf *dmabuf)
@@ -392,6 +445,51 @@ static const struct dma_buf_ops system_heap_buf_ops = {
     .release = system_heap_dma_buf_release,
 };
 
+static void system_heap_pool_stat(struct system_heap_pool_info *info, atomic64_t *count, atomic64_t *total_ns,
+                                  u64 start)
+{
+    s64 ns = ktime_get_ns() - start;
+    s64 max_ns = atomic64_read(&info->max_ns);
+    s64 old;
+
+    atomic64_inc(count);
+    atomic64_add(ns, total_ns);
+    while (ns > max_ns) {
+        old = atomic64_cmpxchg(&info->max_ns, max_ns, ns);
+        if (old == max_ns) {
+            break;
+        }
+        max_ns = old;
+    }
+}
+
+static struct page *system_heap_pool_alloc(int index)
+{
+    struct system_heap_pool_info *info = &pool_info[index];
+    u64 start = ktime_get_ns();
+    struct page *page;
+
+    page = dmabuf_page_pool_fetch(pools[index]);
+    if (page) {
+        system_heap_pool_stat(info, &info->hit, &info->hit_ns, start);
+        return page;
+    }
+
+    /* Zeroing a freed page here is cheaper than the compaction of the buddy allocator */
+    page = system_heap_take_dirty(index);
+    if (page) {
+        system_heap_zero_page(page);
+        system_heap_pool_stat(info, &info->dirty_hit, &info->hit_ns, start);
+        return page;
+    }
+
+    page = dmabuf_page_pool_alloc(pools[index]);
+    if (page) {
+        system_heap_pool_stat(info, &info->miss, &info->miss_ns, start);
+    }
+    return page;
+}
+
 static struct page *alloc_largest_available(unsigned long size, unsigned int max_order)
 {
     struct page *page;
@@ -404,10 +502,11 @@ static struct page *alloc_largest_available(unsigned long size, unsigned int max
         if (max_order < orders[i]) {
             continue;
         }
-        page = dmabuf_page_pool_alloc(pools[i]);
+        page = system_heap_pool_alloc(i);
         if (!page) {
             continue;
         }
+        atomic_long_inc(&pool_info[i].demand);
         return page;
     }
     return NULL;
@@ -496,6 +595,9 @@ static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap, unsigned l
         dma_unmap_sgtable(dma_heap_get_dev(heap), table, DMA_BIDIRECTIONAL, 0);
     }
 
+    /* Refill the pools taken by the allocation */
+    mod_delayed_work(pool_wq, &pool_work, 0);
+
     return dmabuf;
 
 free_pages:
@@ -528,11 +630,110 @@ static long system_get_pool_size(struct dma_heap *heap)
     pool = pools;
     for (i = 0; i < NUM_ORDERS; i++, pool++) {
         num_pages += ((*pool)->count[POOL_LOWPAGE] + (*pool)->count[POOL_HIGHPAGE]) << (*pool)->order;
+        num_pages += READ_ONCE(pool_info[i].dirty_count) << (*pool)->order;
     }
 
     return num_pages << PAGE_SHIFT;
 }
 
+static void system_heap_zero_dirty(int index)
+{
+    struct page *page;
+
+    while ((page = system_heap_take_dirty(index))) {
+        system_heap_zero_page(page);
+        dmabuf_page_pool_free(pools[index], page);
+        cond_resched();
+    }
+}
+
+static void system_heap_update_marks(void)
+{
+    unsigned long budget = totalram_pages() >> SYSTEM_HEAP_MARK_SHIFT;
+    long demand, mark;
+    int i;
+
+    for (i = 0; i < NUM_ORDERS; i++) {
+        demand = atomic_long_xchg(&pool_info[i].demand, 0);
+        mark = READ_ONCE(pools[i]->low_mark);
+        if (demand >= mark) {
+            mark = demand;
+        } else {
+            mark -= DIV_ROUND_UP(mark - demand, SYSTEM_HEAP_MARK_DECAY);
+        }
+        mark = min_t(long, mark, budget >> orders[i]);
+        budget -= mark << orders[i];
+        WRITE_ONCE(pools[i]->low_mark, mark);
+    }
+}
+
+static void system_heap_prefill(int index)
+{
+    struct dmabuf_page_pool *pool = pools[index];
+    struct page *page;
+
+    while (pool->count[POOL_LOWPAGE] + pool->count[POOL_HIGHPAGE] < READ_ONCE(pool->low_mark)) {
+        /* Leave the reclaim and the compaction to kswapd */
+        page = alloc_pages(PREFILL_GFP(pool->gfp_mask), pool->order);
+        if (!page) {
+            break;
+        }
+        dmabuf_page_pool_free(pool, page);
+        atomic64_inc(&pool_info[index].prefill);
+        cond_resched();
+    }
+}
+
+static void system_heap_pool_work(struct work_struct *work)
+{
+    bool active = false;
+    int i;
+
+    for (i = 0; i < NUM_ORDERS; i++) {
+        system_heap_zero_dirty(i);
+    }
+
+    if (time_after_eq(jiffies, pool_period_end)) {
+        system_heap_update_marks();
+        pool_period_end = jiffies + msecs_to_jiffies(SYSTEM_HEAP_POOL_PERIOD_MS);
+    }
+
+    for (i = 0; i < NUM_ORDERS; i++) {
+        system_heap_prefill(i);
+        active |= READ_ONCE(pools[i]->low_mark) || atomic_long_read(&pool_info[i].demand);
+    }
+
+    /* Keep updating the marks until they decay to zero */
+    if (active) {
+        queue_delayed_work(pool_wq, &pool_work, max_t(long, pool_period_end - jiffies, 1));
+    }
+}
+
+static int system_heap_pool_show(struct seq_file *s, void *unused)
+{
+    struct system_heap_pool_info *info;
+    struct dmabuf_page_pool *pool;
+    s64 hit, miss;
+    int i;
+
+    seq_printf(s, "%5s %8s %8s %8s %10s %10s %10s %10s %10s %10s %10s\n", "order", "pool", "dirty", "mark", "hit",
+               "dirty_hit", "miss", "prefill", "hit_ns", "miss_ns", "max_ns");
+    for (i = 0; i < NUM_ORDERS; i++) {
+        info = &pool_info[i];
+        pool = pools[i];
+        hit = atomic64_read(&info->hit) + atomic64_read(&info->dirty_hit);
+        miss = atomic64_read(&info->miss);
+        seq_printf(s, "%5u %8d %8d %8d %10lld %10lld %10lld %10lld %10lld %10lld %10lld\n", orders[i],
+                   pool->count[POOL_LOWPAGE] + pool->count[POOL_HIGHPAGE], READ_ONCE(info->dirty_count),
+                   READ_ONCE(pool->low_mark), atomic64_read(&info->hit), atomic64_read(&info->dirty_hit), miss,
+                   atomic64_read(&info->prefill), hit ? div64_s64(atomic64_read(&info->hit_ns), hit) : 0,
+                   miss ? div64_s64(atomic64_read(&info->miss_ns), miss) : 0, atomic64_read(&info->max_ns));
+    }
+
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(system_heap_pool);
+
 static const struct dma_heap_ops system_heap_ops = {
     .allocate = system_heap_allocate,
     .get_pool_size = system_get_pool_size,
@@ -559,9 +760,17 @@ static struct dma_heap_ops system_uncached_heap_ops = {
 static int system_heap_create(void)
 {
     struct dma_heap_export_info exp_info;
+    struct dentry *dir;
     int i;
 
+    pool_wq = alloc_workqueue("system_heap_pool", WQ_UNBOUND | WQ_FREEZABLE, 1);
+    if (!pool_wq) {
+        return -ENOMEM;
+    }
+
     for (i = 0; i < NUM_ORDERS; i++) {
+        INIT_LIST_HEAD(&pool_info[i].dirty);
+
         pools[i] = dmabuf_page_pool_create(order_flags[i], orders[i]);
 
         if (!pools[i]) {
@@ -571,10 +780,14 @@ static int system_heap_create(void)
             for (j = 0; j < i; j++) {
                 dmabuf_page_pool_destroy(pools[j]);
             }
+            destroy_workqueue(pool_wq);
             return -ENOMEM;
         }
     }
 
+    dir = debugfs_create_dir("system_heap", NULL);
+    debugfs_create_file("pool", 0444, dir, NULL, &system_heap_pool_fops);
+
     exp_info.name = "system";
     exp_info.ops = &system_heap_ops;
     exp_info.priv = NULL;
@@ -16,6 +16,7 @@
 #ifndef HDI_MPP_H
 #define HDI_MPP_H
 
+#include <pthread.h>
 #include "codec_type.h"
 #include "hdi_mpp_ext_param_keys.h"
 #include "hdi_mpp_mpi.h"
@@ -93,6 +94,53 @@ typedef struct {
     RKHdiCodecMimeSetup codecMime;
 } RKHdiEncodeSetup;
 
+#define RK_HDI_MAX_OUTPUT_SLOTS 24
+#define RK_HDI_BUFFER_QUEUE_SIZE 8
+#define RK_HDI_ENC_FRAME_BUF_NUM 2
+
+typedef enum {
+    OUTPUT_OWNED_BY_DECODER = 0,
+    OUTPUT_OWNED_BY_CLIENT,
+} RKHdiOutputOwner;
+
+/*
+ * The output buffer queued by the client. In the external mode it is committed to the frame group and
+ * the decoder writes the frame into it directly, the decoded frame is held until the client queues the
+ * buffer again. Otherwise the frame is copied into the buffer queued first.
+ */
+typedef struct {
+    int32_t fd;
+    intptr_t buf;
+    uint32_t sequence;
+    int32_t stride;
+    int32_t height;
+    int32_t size;
+    CodecBuffer *codecBuffer;
+    MppFrame frame;
+    RKHdiOutputOwner owner;
+    RK_U32 committed;
+} RKHdiOutputSlot;
+
+/*
+ * The buffers queued by the client and not taken by the workers yet, the buffers are the copies made
+ * when they are queued.
+ */
+typedef struct {
+    CodecBuffer *buffers[RK_HDI_BUFFER_QUEUE_SIZE];
+    RK_U32 head;
+    RK_U32 count;
+} RKHdiBufferQueue;
+
+/*
+ * The frame being encoded. The input imported as the frame buffer is returned to the client when the
+ * frame is encoded, the output with the packet of its own buffer is written by the encoder in place.
+ */
+typedef struct {
+    CodecBuffer *input;
+    CodecBuffer *output;
+    MppPacket packet;
+} RKHdiEncodeTask;
+
 typedef struct {
     MppCtx ctx;
     RKMppApi *mppApi;
@@ -109,6 +157,33 @@ typedef struct {
     MppApi *mpi;
 
     MppBufferGroup frmGrp;
+    MppBufferMode frmGrpMode;
+    RKHdiOutputSlot outputSlots[RK_HDI_MAX_OUTPUT_SLOTS];
+    RK_U32 outputSlotCount;
+    RK_U32 extOutput;
+    size_t extBufSize;
+    RK_S32 directFrames;
+    RK_S32 copyFrames;
+    uint32_t outputSequence;
+
+    // the input worker feeds the queued buffers to mpp, the output worker delivers the frames or packets
+    pthread_mutex_t lock;
+    pthread_cond_t inputCond;
+    pthread_cond_t outputCond;
+    pthread_t inputThread;
+    pthread_t outputThread;
+    RK_U32 workerRunning;
+    RK_U32 workerExit;
+    RKHdiBufferQueue inputQueue;
+    RKHdiBufferQueue outputQueue;
+    RK_U32 encInFlight;
+    RK_U32 encFrameIndex;
+    RK_U32 encDoneIndex;
+    RKHdiEncodeTask encTasks[RK_HDI_ENC_FRAME_BUF_NUM];
+    RK_S32 directInputs;
+    RK_S32 copyInputs;
+    RK_S32 directOutputs;
+    RK_S32 copyOutputs;
     MppPacket packet;
     size_t packetSize;
     MppFrame frame;
@@ -117,7 +192,7 @@ typedef struct {
     RK_S32 frameNum;
     size_t maxUsage;
 
-    MppBuffer frmBuf;
+    MppBuffer frmBufs[RK_HDI_ENC_FRAME_BUF_NUM];
     size_t headerSize;
     size_t frameSize;
     MppBuffer pktBuf;
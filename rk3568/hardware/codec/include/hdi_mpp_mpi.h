@@ -79,6 +79,7 @@ typedef MPP_RET (*hdiMppEncCfgInit)(MppEncCfg *);
 typedef MPP_RET (*hdiMppEncCfgDeinit)(MppEncCfg);
 typedef MPP_RET (*hdiMppEncCfgSetS32)(MppEncCfg, const char *, RK_S32);
 typedef MPP_RET (*hdiMppEncCfgSetU32)(MppEncCfg, const char *, RK_U32);
+typedef MPP_RET (*hdiMppEncCfgSetPtr)(MppEncCfg, const char *, void *);
 typedef MPP_RET (*hdiMppEncRefCfgInit)(MppEncRefCfg *);
 typedef MPP_RET (*hdiMppEncRefCfgDeinit)(MppEncRefCfg *);
 typedef MPP_RET (*hdiMppEncGenRefCfg)(MppEncRefCfg, RK_U32);
@@ -95,6 +96,7 @@ typedef MPP_RET (*hdiMppBufferWriteWithCaller)(MppBuffer, size_t, void *, size_t
 typedef void *(*hdiMppBufferGetPtrWithCaller)(MppBuffer, const char *);
 typedef size_t (*hdiMppBufferGetSizeWithCaller)(MppBuffer, const char *);
 typedef MPP_RET (*hdiMppBufferImportWithTag)(MppBufferGroup, MppBufferInfo *, MppBuffer *, const char *, const char *);
+typedef int (*hdiMppBufferGetIndexWithCaller)(MppBuffer, const char *);
 typedef size_t (*hdiMppBufferGroupUsage)(MppBufferGroup);
 typedef MPP_RET (*hdiMppBufferPutWithCaller)(MppBuffer, const char *);
 // mpp task api
@@ -166,6 +168,7 @@ typedef struct {
     hdiMppEncCfgDeinit HdiMppEncCfgDeinit;
     hdiMppEncCfgSetS32 HdiMppEncCfgSetS32;
     hdiMppEncCfgSetU32 HdiMppEncCfgSetU32;
+    hdiMppEncCfgSetPtr HdiMppEncCfgSetPtr;
     hdiMppEncRefCfgInit HdiMppEncRefCfgInit;
     hdiMppEncRefCfgDeinit HdiMppEncRefCfgDeinit;
     hdiMppEncGenRefCfg HdiMppEncGenRefCfg;
@@ -181,6 +184,7 @@ typedef struct {
     hdiMppBufferWriteWithCaller HdiMppBufferWriteWithCaller;
     hdiMppBufferGetPtrWithCaller HdiMppBufferGetPtrWithCaller;
     hdiMppBufferGetSizeWithCaller HdiMppBufferGetSizeWithCaller;
+    hdiMppBufferGetIndexWithCaller HdiMppBufferGetIndexWithCaller;
     hdiMppBufferGroupUsage HdiMppBufferGroupUsage;
     hdiMppBufferPutWithCaller HdiMppBufferPutWithCaller;
     // mpp task api
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2023 Shenzhen Kaihong DID Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <cinttypes>
+#include <codec_jpeg_vdi.h>
+#include <cstdio>
+#include <display_type.h>
+#include <dlfcn.h>
+#include <fstream>
+#include <hdf_base.h>
+#include <iterator>
+#include <securec.h>
+#include <vector>
+#include "codec_jpeg_dec_hwi.h"
+#include "codec_jpeg_helper.h"
+#include "idisplay_buffer_vdi.h"
+#include "v1_0/display_buffer_type.h"
+
+/*
+ * Decode the jpeg files given on the command line on the hardware, first one image at a time through
+ * DoJpegDecode and then all of them in one DoJpegDecodeBatch, and print the time of both. It is run on
+ * the board with the images of a gallery to see the gain of the images in flight.
+ */
+extern "C" ICodecJpegHwi *GetCodecJpegHwi();
+
+namespace OHOS {
+namespace VDI {
+namespace JPEG {
+using namespace OHOS::HDI::Display::Buffer::V1_0;
+namespace {
+const char *DISPLAY_BUFFER_LIB = "libdisplay_buffer_vdi_impl.z.so";
+const uint32_t ROUNDS = 10;
+const uint32_t ALIGN = 16;
+
+using CreateDisplayBufferVdi = IDisplayBufferVdi *(*)(void);
+using DestroyDisplayBufferVdi = void (*)(IDisplayBufferVdi *);
+
+struct Image {
+    CodecJpegDecInfo decInfo;
+    BufferHandle *buffer = nullptr;
+    BufferHandle *outBuffer = nullptr;
+};
+
+uint32_t AlignUp(uint32_t val, uint32_t align)
+{
+    return (val + align - 1) & (~(align - 1));
+}
+
+bool ReadFile(const char *path, std::vector<int8_t> &data)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        printf("can not open %s\n", path);
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !data.empty();
+}
+
+bool LoadImage(const char *path, ICodecJpegHwi *hwi, IDisplayBufferVdi *displayVdi, Image &image)
+{
+    std::vector<int8_t> data;
+    if (!ReadFile(path, data)) {
+        return false;
+    }
+    CodecJpegHelper helper;
+    size_t dataPos = 0;
+    size_t dataLen = 0;
+    if (!helper.DessambleJpeg(data.data(), data.size(), image.decInfo, dataPos, dataLen)) {
+        printf("%s is not a baseline jpeg\n", path);
+        return false;
+    }
+    // the decoder reads the whole jpeg from the input buffer
+    if (hwi->AllocateInBuffer(&image.buffer, static_cast<uint32_t>(data.size())) != HDF_SUCCESS) {
+        printf("alloc the input of %s failed\n", path);
+        return false;
+    }
+    auto addr = displayVdi->Mmap(*image.buffer);
+    if (addr == nullptr) {
+        printf("map the input of %s failed\n", path);
+        return false;
+    }
+    auto ret = memcpy_s(addr, static_cast<size_t>(image.buffer->size), data.data(), data.size());
+    displayVdi->FlushCache(*image.buffer);
+    displayVdi->Unmap(*image.buffer);
+    if (ret != EOK) {
+        printf("fill the input of %s failed\n", path);
+        return false;
+    }
+
+    AllocInfo alloc = {.width = AlignUp(image.decInfo.imageWidth, ALIGN),
+                       .height = AlignUp(image.decInfo.imageHeight, ALIGN),
+                       .usage = HBM_USE_CPU_READ | HBM_USE_MEM_DMA,
+                       .format = PIXEL_FMT_YCRCB_420_SP};
+    if (displayVdi->AllocMem(alloc, image.outBuffer) != HDF_SUCCESS) {
+        printf("alloc the output of %s failed\n", path);
+        return false;
+    }
+    return true;
+}
+
+void FreeImage(ICodecJpegHwi *hwi, IDisplayBufferVdi *displayVdi, Image &image)
+{
+    if (image.buffer != nullptr) {
+        hwi->FreeInBuffer(image.buffer);
+        image.buffer = nullptr;
+    }
+    if (image.outBuffer != nullptr) {
+        displayVdi->FreeMem(*image.outBuffer);
+        image.outBuffer = nullptr;
+    }
+}
+
+int64_t GetNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Run(ICodecJpegHwi *hwi, ICodecJpegDecHwi *decHwi, std::vector<Image> &images)
+{
+    uint32_t failed = 0;
+    int64_t beginUs = GetNowUs();
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        for (auto &image : images) {
+            failed += (hwi->DoJpegDecode(image.buffer, image.outBuffer, &image.decInfo) != HDF_SUCCESS) ? 1 : 0;
+        }
+    }
+    int64_t oneByOneUs = GetNowUs() - beginUs;
+    printf("one by one: %zu images x %u rounds %" PRId64 " us, %u failed\n", images.size(), ROUNDS, oneByOneUs,
+        failed);
+
+    std::vector<CodecJpegDecJob> jobs;
+    for (auto &image : images) {
+        jobs.push_back({image.buffer, image.outBuffer, &image.decInfo, HDF_FAILURE});
+    }
+    failed = 0;
+    beginUs = GetNowUs();
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        if (decHwi->DoJpegDecodeBatch(jobs.data(), static_cast<uint32_t>(jobs.size())) != HDF_SUCCESS) {
+            printf("the batch decode failed in round %u\n", round);
+            return;
+        }
+        for (const auto &job : jobs) {
+            failed += (job.result != HDF_SUCCESS) ? 1 : 0;
+        }
+    }
+    int64_t batchUs = GetNowUs() - beginUs;
+    printf("batch:      %zu images x %u rounds %" PRId64 " us, %u failed\n", images.size(), ROUNDS, batchUs, failed);
+}
+}  // namespace
+}  // namespace JPEG
+}  // namespace VDI
+}  // namespace OHOS
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) { // 3: the program and at least two images, so more than one image is in flight
+        printf("usage: %s <jpeg> <jpeg> [<jpeg> ...]\n", argv[0]);
+        return -1;
+    }
+    using namespace OHOS::VDI::JPEG;
+    ICodecJpegHwi *hwi = GetCodecJpegHwi();
+    ICodecJpegDecHwi *decHwi = GetCodecJpegDecHwi();
+    void *libHandle = dlopen(DISPLAY_BUFFER_LIB, RTLD_LAZY);
+    if (libHandle == nullptr) {
+        printf("can not open %s\n", DISPLAY_BUFFER_LIB);
+        return -1;
+    }
+    auto displayVdiCreate = reinterpret_cast<CreateDisplayBufferVdi>(dlsym(libHandle, "CreateDisplayBufferVdi"));
+    IDisplayBufferVdi *displayVdi = (displayVdiCreate != nullptr) ? displayVdiCreate() : nullptr;
+    if (displayVdi == nullptr || hwi->JpegInit() != HDF_SUCCESS) {
+        printf("init failed\n");
+        dlclose(libHandle);
+        return -1;
+    }
+
+    std::vector<Image> images(static_cast<size_t>(argc - 1));
+    bool loaded = true;
+    for (int i = 1; i < argc && loaded; i++) {
+        loaded = LoadImage(argv[i], hwi, displayVdi, images[i - 1]);
+    }
+    if (loaded) {
+        Run(hwi, decHwi, images);
+    }
+    for (auto &image : images) {
+        FreeImage(hwi, displayVdi, image);
+    }
+    hwi->JpegDeInit();
+    auto displayVdiDestroy = reinterpret_cast<DestroyDisplayBufferVdi>(dlsym(libHandle, "DestroyDisplayBufferVdi"));
+    if (displayVdiDestroy != nullptr) {
+        displayVdiDestroy(displayVdi);
+    }
+    dlclose(libHandle);
+    return loaded ? 0 : -1;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2023 Shenzhen Kaihong DID Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CODEC_JPEG_DEC_HWI_H
+#define CODEC_JPEG_DEC_HWI_H
+#include <stdint.h>
+#include <codec_jpeg_vdi.h>
+#include "buffer_handle.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// an image of DoJpegDecodeBatch, buffer holds the whole jpeg like for DoJpegDecode of ICodecJpegHwi
+struct CodecJpegDecJob {
+    BufferHandle *buffer;
+    BufferHandle *outBuffer;
+    const struct CodecJpegDecInfo *decInfo;
+    // the result of the decode of this image
+    int32_t result;
+};
+
+/*
+ * The decoder of the jpeg hardware for the compressed data put into a buffer of AllocateInBuffer with room
+ * before it, it is used after JpegInit of ICodecJpegHwi. The headers of decInfo are written into the room
+ * before dataPos and an EOI after the data, so the compressed data is read by the hardware where it is.
+ * The room needed is at most 4096 bytes before the data and 2 bytes after it.
+ */
+typedef struct ICodecJpegDecHwi {
+    int32_t (*DoJpegDecodeInPlace)(BufferHandle *buffer, BufferHandle *outBuffer,
+        const struct CodecJpegDecInfo *decInfo, uint32_t dataPos, uint32_t dataLen);
+    /*
+     * Decode count images on one decoder with up to 4 of them queued to the hardware at a time, the result
+     * of each image is put into its job. It fails only when the decoder can not be used at all.
+     */
+    int32_t (*DoJpegDecodeBatch)(struct CodecJpegDecJob *jobs, uint32_t count);
+} ICodecJpegDecHwi;
+
+ICodecJpegDecHwi *GetCodecJpegDecHwi(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif  // CODEC_JPEG_DEC_HWI_H
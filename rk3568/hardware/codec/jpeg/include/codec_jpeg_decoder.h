@@ -16,10 +16,29 @@
 #define HDI_JPEG_DECODER_H
 #include <cinttypes>
 #include <codec_jpeg_vdi.h>
+#include <deque>
+#include <vector>
 #include "hdi_mpp_mpi.h"
 namespace OHOS {
 namespace VDI {
 namespace JPEG {
+// the images in flight on a decoder, it is the number of the tasks of the input port of mpp
+constexpr uint32_t JPEG_DEC_MAX_INFLIGHT = 4;
+
+struct CodecJpegDecodeJob {
+    BufferHandle *buffer;
+    BufferHandle *outBuffer;
+    const struct CodecJpegDecInfo *decInfo;
+    // the jpeg assembled in place in buffer, such as by CodecJpegHelper::JpegAssembleInPlace, 0 length for
+    // the jpeg of the whole buffer
+    uint32_t dataOffset;
+    uint32_t dataLen;
+};
+
+/*
+ * The decoder keeps its mpp context from the first image on, so it is reused for the next images
+ * without the setup of mpp. A decoder is used by one thread at a time.
+ */
 class CodecJpegDecoder {
 public:
     explicit CodecJpegDecoder(RKMppApi *mppApi);
@@ -28,11 +47,28 @@ public:
 
     int32_t DeCode(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegDecInfo &decInfo);
 
+    // decode the jobs with up to JPEG_DEC_MAX_INFLIGHT images queued to the hardware, the result of
+    // each job is put into results
+    int32_t DeCodeBatch(const std::vector<CodecJpegDecodeJob> &jobs, std::vector<int32_t> &results);
+
+    // the context is not usable any more after an error of the task queue of mpp
+    bool IsBroken() const
+    {
+        return broken_;
+    }
+
 private:
+    struct DecodeSlot {
+        MppPacket packet;
+        MppFrame frame;
+    };
+
     void Destory();
 
     void ResetMppBuffer();
 
+    void ResetSlot(DecodeSlot &slot);
+
     bool PrePare(bool isDecoder = true);
 
     inline uint32_t AlignUp(uint32_t val, uint32_t align)
@@ -40,13 +76,15 @@ private:
         return (val + align - 1) & (~(align - 1));
     }
 
-    MPP_RET SendData(const struct CodecJpegDecInfo &decInfo, BufferHandle* buffer, BufferHandle *outHandle);
+    MPP_RET SendData(const CodecJpegDecodeJob &job, DecodeSlot &slot);
+
+    MPP_RET MppTaskProcess(DecodeSlot &slot);
 
-    MPP_RET MppTaskProcess();
+    MPP_RET GetFrame(DecodeSlot &slot);
 
-    MPP_RET GetFrame();
+    void ReceiveOldest(std::vector<int32_t> &results);
 
-    void DumpOutFile();
+    void DumpOutFile(MppFrame frame);
 
     void DumpInFile(MppBuffer pktBuf);
 
@@ -60,8 +98,11 @@ private:
     MppApi *mpi_;
     RKMppApi *mppApi_;
     MppBufferGroup memGroup_;
-    MppPacket packet_;
-    MppFrame frame_;
+    DecodeSlot slots_[JPEG_DEC_MAX_INFLIGHT];
+    // the jobs queued to mpp in order, with the slots they use
+    std::deque<std::pair<size_t, uint32_t>> inFlight_;
+    uint32_t sent_;
+    bool broken_;
 };
 }  // namespace JPEG
 }  // namespace VDI
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2023 Shenzhen Kaihong DID Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CODEC_JPEG_ENC_HWI_H
+#define CODEC_JPEG_ENC_HWI_H
+#include <stdint.h>
+#include "buffer_handle.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CodecJpegEncInfo {
+    uint32_t imageWidth;
+    uint32_t imageHeight;
+    // 1 ~ 99, used when the quant tables are not given
+    uint32_t quality;
+    // the quant tables of luma and chroma with 64 entries in the natural order, or NULL
+    const uint8_t *lumaQuantTbl;
+    const uint8_t *chromaQuantTbl;
+    // the MCUs between the restart markers, 0 for no restart marker
+    uint32_t restartInterval;
+};
+
+/*
+ * The encoder of the jpeg hardware, it is used after JpegInit of ICodecJpegHwi and shares the
+ * AllocateInBuffer/FreeInBuffer of it. The stride of buffer is in bytes.
+ */
+typedef struct ICodecJpegEncHwi {
+    int32_t (*DoJpegEncode)(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegEncInfo *encInfo,
+        uint32_t *outLen);
+} ICodecJpegEncHwi;
+
+ICodecJpegEncHwi *GetCodecJpegEncHwi(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif  // CODEC_JPEG_ENC_HWI_H
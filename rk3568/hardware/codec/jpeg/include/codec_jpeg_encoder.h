@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023 Shenzhen Kaihong DID Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HDI_JPEG_ENCODER_H
+#define HDI_JPEG_ENCODER_H
+#include <cinttypes>
+#include <codec_jpeg_vdi.h>
+#include "codec_jpeg_enc_hwi.h"
+#include "hdi_mpp_mpi.h"
+namespace OHOS {
+namespace VDI {
+namespace JPEG {
+constexpr uint32_t JPEG_QTABLE_SIZE = 64;
+
+/*
+ * The encoder keeps its mpp context and config from the first image on, the config is sent to mpp
+ * again only when the image or the quality changes. An encoder is used by one thread at a time.
+ */
+class CodecJpegEncoder {
+public:
+    explicit CodecJpegEncoder(RKMppApi *mppApi);
+
+    ~CodecJpegEncoder();
+
+    // encode the image of buffer into outBuffer, both of them are dma-bufs read and written by the hardware
+    int32_t EnCode(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegEncInfo &encInfo,
+        uint32_t &outLen);
+
+    // the context is not usable any more after an error of mpp
+    bool IsBroken() const
+    {
+        return broken_;
+    }
+
+private:
+    void Destory();
+
+    bool PrePare();
+
+    bool SetFormat(int32_t format);
+
+    bool SetConfig(BufferHandle *buffer, const struct CodecJpegEncInfo &encInfo);
+
+    MppBuffer ImportBuffer(BufferHandle *buffer, const char *caller);
+
+    MPP_RET SendFrame(BufferHandle *buffer, MppPacket packet);
+
+    MPP_RET GetPacket(MppPacket packet, uint32_t &outLen);
+
+private:
+    uint32_t width_;
+    uint32_t height_;
+    uint32_t horStride_;
+    uint32_t verStride_;
+    uint32_t quality_;
+    MppFrameFormat format_;
+    uint8_t lumaQuantTbl_[JPEG_QTABLE_SIZE];
+    uint8_t chromaQuantTbl_[JPEG_QTABLE_SIZE];
+    bool customQuantTbl_;
+    MppCtx mppCtx_;
+    MppApi *mpi_;
+    RKMppApi *mppApi_;
+    MppEncCfg cfg_;
+    bool configured_;
+    bool broken_;
+};
+}  // namespace JPEG
+}  // namespace VDI
+}  // namespace OHOS
+#endif  // HDI_JPEG_ENCODER_H
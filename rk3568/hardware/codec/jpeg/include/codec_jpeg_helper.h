@@ -15,14 +15,14 @@
 #ifndef CODEC_JPEG_HELPER_H
 #define CODEC_JPEG_HELPER_H
 #include <cinttypes>
+#include <cstddef>
 #include <codec_jpeg_vdi.h>
-#include <memory>
 namespace OHOS {
 namespace VDI {
 namespace JPEG {
 class CodecJpegHelper {
 public:
-    enum JpegMarker : int16_t {
+    enum JpegMarker : uint16_t {
         SOF0 = 0xffc0,
         DHT = 0xffc4,
         SOI = 0xffd8,
@@ -32,17 +32,36 @@ public:
         DRI = 0xffdd,
         UNKNOWN = 0xffff
     };
+    // the headers of a baseline jpeg with four quant tables and four huffman tables of each class
+    static constexpr size_t JPEG_HEADER_MAX_LEN = 4096;
+
     explicit CodecJpegHelper() = default;
 
     ~CodecJpegHelper() = default;
 
     int32_t JpegAssemble(const struct CodecJpegDecInfo &decInfo, int8_t *buffer, int32_t fd);
 
+    // the length of the headers from SOI to SOS assembled for decInfo, -1 if they are too large
+    int32_t GetJpegHeaderLen(const struct CodecJpegDecInfo &decInfo);
+
+    // assemble the headers from SOI to SOS into buffer, return the length of them
+    int32_t JpegAssembleHeader(const struct CodecJpegDecInfo &decInfo, int8_t *buffer, size_t bufferLen);
+
+    /*
+     * Assemble the jpeg around the compressed data at dataPos of buffer without moving the data, the
+     * headers are written right before it and the EOI right after it. Return the position of the SOI.
+     */
+    int32_t JpegAssembleInPlace(const struct CodecJpegDecInfo &decInfo, int8_t *buffer, size_t bufferLen,
+        size_t dataPos, size_t dataLen);
+
+    // parse the headers into decInfo in one pass, the compressed data is left in place at dataPos of buffer
     bool DessambleJpeg(int8_t *buffer, size_t bufferLen, struct CodecJpegDecInfo &decInfo,
-        std::unique_ptr<int8_t[]> &compressBuffer, int32_t &comBufLen);
+        size_t &dataPos, size_t &dataLen);
 
 private:
-    int32_t FindMarker(int8_t *start);
+    int32_t JpegHeaderAssemble(const struct CodecJpegDecInfo &decInfo, int8_t *buffer);
+
+    int32_t FindScanEnd(int8_t *buffer, size_t bufferLen, size_t pos);
 
     int32_t JpegDqtAssemble(const struct CodecJpegDecInfo &decInfo, int8_t *buffer, int32_t curPos);
 
@@ -63,8 +82,6 @@ private:
 
     int32_t DessambleSos(int8_t *buffer, struct CodecJpegDecInfo &decInfo);
 
-    int32_t DessambleCompressData(int8_t *buffer, std::unique_ptr<int8_t[]> &compressBuffer, int32_t &comBufLen);
-
     int32_t DessambleDqt(int8_t *buffer, struct CodecJpegDecInfo &decInfo);
 
     int32_t DessambleDht(int8_t *buffer, struct CodecJpegDecInfo &decInfo);
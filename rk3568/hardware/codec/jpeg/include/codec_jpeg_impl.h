@@ -16,6 +16,11 @@
 #define HDI_JPEG_IMPL_H
 #include <cinttypes>
 #include <codec_jpeg_vdi.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "codec_jpeg_decoder.h"
+#include "codec_jpeg_encoder.h"
 #include "hdi_mpp_mpi.h"
 #include "idisplay_buffer_vdi.h"
 #include "v1_0/display_buffer_type.h"
@@ -23,6 +28,10 @@ namespace OHOS {
 namespace VDI {
 namespace JPEG {
 using namespace OHOS::HDI::Display::Buffer::V1_0;
+// the idle decoders and encoders kept for the next images
+constexpr size_t JPEG_DEC_POOL_SIZE = 4;
+constexpr size_t JPEG_ENC_POOL_SIZE = 2;
+
 class CodecJpegImpl {
 public:
     explicit CodecJpegImpl();
@@ -39,7 +48,25 @@ public:
 
     int32_t DeCode(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegDecInfo &decInfo);
 
+    // decode the images pipelined on one decoder, the result of each job is put into results
+    int32_t DeCodeBatch(const std::vector<CodecJpegDecodeJob> &jobs, std::vector<int32_t> &results);
+
+    // decode the compressed data at dataPos of buffer with the headers assembled in the room before it
+    int32_t DeCodeInPlace(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegDecInfo &decInfo,
+        uint32_t dataPos, uint32_t dataLen);
+
+    int32_t EnCode(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegEncInfo &encInfo,
+        uint32_t &outLen);
+
 private:
+    std::unique_ptr<CodecJpegDecoder> AcquireDecoder();
+
+    void ReleaseDecoder(std::unique_ptr<CodecJpegDecoder> decoder);
+
+    std::unique_ptr<CodecJpegEncoder> AcquireEncoder();
+
+    void ReleaseEncoder(std::unique_ptr<CodecJpegEncoder> encoder);
+
     inline uint32_t AlignUp(uint32_t val, uint32_t align)
     {
         return (val + align - 1) & (~(align - 1));
@@ -48,6 +75,11 @@ private:
     static RKMppApi *mppApi_;
     static IDisplayBufferVdi* displayVdi_;
     static intptr_t libHandle_;
+    std::mutex decoderLock_;
+    // the decoders with their mpp contexts set up, reused across the calls
+    std::vector<std::unique_ptr<CodecJpegDecoder>> idleDecoders_;
+    std::mutex encoderLock_;
+    std::vector<std::unique_ptr<CodecJpegEncoder>> idleEncoders_;
 };
 }  // namespace JPEG
 }  // namespace VDI
@@ -29,7 +29,7 @@ namespace VDI {
 namespace JPEG {
 CodecJpegDecoder::CodecJpegDecoder(RKMppApi *mppApi)
     : width_(0), height_(0), format_(MPP_FMT_YUV420SP), mppCtx_(nullptr), mpi_(nullptr), mppApi_(mppApi),
-      memGroup_(nullptr), packet_(nullptr), frame_(nullptr)
+      memGroup_(nullptr), slots_(), sent_(0), broken_(false)
 {}
 
 CodecJpegDecoder::~CodecJpegDecoder()
@@ -58,35 +58,84 @@ void CodecJpegDecoder::Destory()
 
 int32_t CodecJpegDecoder::DeCode(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegDecInfo &decInfo)
 {
-    CODEC_LOGI("enter");
+    std::vector<CodecJpegDecodeJob> jobs = {{buffer, outBuffer, &decInfo, 0, 0}};
+    std::vector<int32_t> results;
+    auto ret = DeCodeBatch(jobs, results);
+    return (ret != HDF_SUCCESS) ? ret : results[0];
+}
 
-    if (!PrePare()) {
+int32_t CodecJpegDecoder::DeCodeBatch(const std::vector<CodecJpegDecodeJob> &jobs, std::vector<int32_t> &results)
+{
+    CODEC_LOGI("enter, jobs %{public}zu", jobs.size());
+    results.assign(jobs.size(), HDF_FAILURE);
+    if (broken_ || !PrePare()) {
         CODEC_LOGE("PrePare failed");
         return HDF_FAILURE;
     }
-    if (!SetFormat(outBuffer->format)) {
-        CODEC_LOGE("format %{public}d set error", outBuffer->format);
-        return HDF_ERR_INVALID_PARAM;
-    }
 
-    width_ = decInfo.imageWidth;
-    height_ = decInfo.imageHeight;
-    if (SendData(decInfo, buffer, outBuffer) != MPP_OK) {
-        CODEC_LOGE("Send data error");
-        return HDF_FAILURE;
+    int32_t format = -1;
+    for (size_t i = 0; i < jobs.size() && !broken_; i++) {
+        const CodecJpegDecodeJob &job = jobs[i];
+        if (job.buffer == nullptr || job.outBuffer == nullptr || job.decInfo == nullptr) {
+            results[i] = HDF_ERR_INVALID_PARAM;
+            continue;
+        }
+        // the output format is set on the context, the images in flight are drained before it changes
+        bool formatChanged = (job.outBuffer->format != format);
+        while (!inFlight_.empty() && (formatChanged || inFlight_.size() >= JPEG_DEC_MAX_INFLIGHT)) {
+            ReceiveOldest(results);
+        }
+        if (broken_) {
+            break;
+        }
+        if (formatChanged) {
+            format = -1;
+            if (!SetFormat(job.outBuffer->format)) {
+                CODEC_LOGE("format %{public}d set error", job.outBuffer->format);
+                results[i] = HDF_ERR_INVALID_PARAM;
+                continue;
+            }
+            format = job.outBuffer->format;
+        }
+
+        width_ = job.decInfo->imageWidth;
+        height_ = job.decInfo->imageHeight;
+        uint32_t slot = sent_ % JPEG_DEC_MAX_INFLIGHT;
+        if (SendData(job, slots_[slot]) != MPP_OK) {
+            CODEC_LOGE("Send data error");
+            ResetSlot(slots_[slot]);
+            continue;
+        }
+        // the slots are used in the order of the jobs sent, so a slot is free again when it is reused
+        sent_++;
+        inFlight_.emplace_back(i, slot);
+    }
+    while (!inFlight_.empty()) {
+        ReceiveOldest(results);
     }
+    ResetMppBuffer();
+    CODEC_LOGI("jpeg decode end.");
+    return broken_ ? HDF_FAILURE : HDF_SUCCESS;
+}
 
-    if (GetFrame() != MPP_OK) {
+void CodecJpegDecoder::ReceiveOldest(std::vector<int32_t> &results)
+{
+    size_t index = inFlight_.front().first;
+    DecodeSlot &slot = slots_[inFlight_.front().second];
+    inFlight_.pop_front();
+    if (!broken_ && GetFrame(slot) == MPP_OK) {
+        DumpOutFile(slot.frame);
+        results[index] = HDF_SUCCESS;
+    } else {
         CODEC_LOGE("Recv frame error");
-        return HDF_FAILURE;
     }
-    DumpOutFile();
-    CODEC_LOGI("jpeg decode end.");
-    return HDF_SUCCESS;
+    ResetSlot(slot);
 }
 
-MPP_RET CodecJpegDecoder::SendData(const struct CodecJpegDecInfo &decInfo, BufferHandle* buffer, BufferHandle *outHandle)
+MPP_RET CodecJpegDecoder::SendData(const CodecJpegDecodeJob &job, DecodeSlot &slot)
 {
+    BufferHandle *buffer = job.buffer;
+    BufferHandle *outHandle = job.outBuffer;
     CODEC_LOGI("enter");
     MppBuffer pktBuf = nullptr;
     MppBuffer frmBuf = nullptr;
@@ -100,7 +149,7 @@ MPP_RET CodecJpegDecoder::SendData(const struct CodecJpegDecInfo &decInfo, Buffe
             frmBuf = nullptr;
         }
     });
-    ResetMppBuffer();
+    ResetSlot(slot);
     MppBufferInfo info;
     memset(&info, 0, sizeof(MppBufferInfo));
     info.type = MPP_BUFFER_TYPE_DRM;
@@ -111,11 +160,22 @@ MPP_RET CodecJpegDecoder::SendData(const struct CodecJpegDecInfo &decInfo, Buffe
         CODEC_LOGE("import input packet error %{public}d", ret);
         return ret;
     }
-    mppApi_->HdiMppPacketInitWithBuffer(&packet_, pktBuf); // input
+    mppApi_->HdiMppPacketInitWithBuffer(&slot.packet, pktBuf); // input
+    if (job.dataLen != 0) {
+        if (job.dataOffset > static_cast<uint32_t>(buffer->size) ||
+            job.dataLen > static_cast<uint32_t>(buffer->size) - job.dataOffset) {
+            CODEC_LOGE("jpeg at %{public}u len %{public}u is out of the buffer", job.dataOffset, job.dataLen);
+            return MPP_NOK;
+        }
+        // the hardware reads the jpeg in place from the offset of the dma-buf
+        auto pos = static_cast<uint8_t *>(mppApi_->HdiMppPacketGetPos(slot.packet)) + job.dataOffset;
+        mppApi_->HdiMppPacketSetPos(slot.packet, pos);
+        mppApi_->HdiMppPacketSetLength(slot.packet, job.dataLen);
+    }
    
     DumpInFile(pktBuf);
-    // init frame_
-    mppApi_->HdiMppFrameInit(&frame_);
+    // init the frame of the slot
+    mppApi_->HdiMppFrameInit(&slot.frame);
 #ifndef USE_RGA
     MppBufferInfo outputCommit;
     memset_s(&outputCommit, sizeof(outputCommit), 0, sizeof(outputCommit));
@@ -131,36 +191,40 @@ MPP_RET CodecJpegDecoder::SendData(const struct CodecJpegDecInfo &decInfo, Buffe
         CODEC_LOGE(" mpp buffer import/get  error %{public}d", ret);
         return ret;
     }
-    mppApi_->HdiMppFrameSetBuffer(frame_, frmBuf);
-    ret = MppTaskProcess();
+    mppApi_->HdiMppFrameSetBuffer(slot.frame, frmBuf);
+    ret = MppTaskProcess(slot);
     return ret;
 }
 
-MPP_RET CodecJpegDecoder::MppTaskProcess()
+MPP_RET CodecJpegDecoder::MppTaskProcess(DecodeSlot &slot)
 {
     MppTask task = nullptr;
     /* start queue input task */
     auto ret = mpi_->poll(mppCtx_, MPP_PORT_INPUT, MPP_POLL_BLOCK);
     if (MPP_OK != ret) {
         CODEC_LOGE("poll input error %{public}d", ret);
+        broken_ = true;
         return ret;
     }
     /* input queue */
     ret = mpi_->dequeue(mppCtx_, MPP_PORT_INPUT, &task);
     if (MPP_OK != ret) {
         CODEC_LOGE("dequeue input error %{public}d", ret);
+        broken_ = true;
         return ret;
     }
-    mppApi_->HdiMppTaskMetaSetPacket(task, KEY_INPUT_PACKET, packet_);
-    mppApi_->HdiMppTaskMetaSetFrame(task, KEY_OUTPUT_FRAME, frame_);
+    mppApi_->HdiMppTaskMetaSetPacket(task, KEY_INPUT_PACKET, slot.packet);
+    mppApi_->HdiMppTaskMetaSetFrame(task, KEY_OUTPUT_FRAME, slot.frame);
     /* input queue */
     ret = mpi_->enqueue(mppCtx_, MPP_PORT_INPUT, task);
     if (ret != MPP_OK) {
         CODEC_LOGE("enqueue input error %{public}d", ret);
+        broken_ = true;
     }
     return ret;
 }
-MPP_RET CodecJpegDecoder::GetFrame()
+
+MPP_RET CodecJpegDecoder::GetFrame(DecodeSlot &slot)
 {
     CODEC_LOGI("enter.");
     MppTask task = nullptr;
@@ -168,6 +232,7 @@ MPP_RET CodecJpegDecoder::GetFrame()
     MPP_RET ret = mpi_->poll(mppCtx_, MPP_PORT_OUTPUT, MPP_POLL_BLOCK);
     if (ret != MPP_OK) {
         CODEC_LOGE("poll output error %{public}d", ret);
+        broken_ = true;
         return ret;
     }
 
@@ -175,14 +240,24 @@ MPP_RET CodecJpegDecoder::GetFrame()
     ret = mpi_->dequeue(mppCtx_, MPP_PORT_OUTPUT, &task);
     if (ret != MPP_OK) {
         CODEC_LOGE("dequeue output error %{public}d", ret);
+        broken_ = true;
         return ret;
     }
 
     MppFrame frameOut = NULL;
     mppApi_->HdiMppTaskMetaGetFrame(task, KEY_OUTPUT_FRAME, &frameOut);
-    if (frameOut != frame_) {
-        CODEC_LOGE("frameOut is not match with frame_ %{public}d", ret);
-        mppApi_->HdiMppFrameDeinit(&frameOut);
+    /* output queue, the task is given back before the frame is checked to keep the context usable */
+    ret = mpi_->enqueue(mppCtx_, MPP_PORT_OUTPUT, task);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("enqueue output error %{public}d", ret);
+        broken_ = true;
+        return ret;
+    }
+
+    // the frames are output in the order of the packets
+    if (frameOut != slot.frame) {
+        CODEC_LOGE("frameOut is not match with the frame of the slot");
+        broken_ = true;
         return MPP_NOK;
     }
     auto err = mppApi_->HdiMppFrameGetErrinfo(frameOut) | mppApi_->HdiMppFrameGetDiscard(frameOut);
@@ -191,20 +266,13 @@ MPP_RET CodecJpegDecoder::GetFrame()
         return MPP_NOK;
     }
 
-    /* output queue */
-    ret = mpi_->enqueue(mppCtx_, MPP_PORT_OUTPUT, task);
-    if (ret != MPP_OK) {
-        CODEC_LOGE("enqueue output error %{public}d", ret);
-        return ret;
-    }
-
     return MPP_OK;
 }
 
-void CodecJpegDecoder::DumpOutFile()
+void CodecJpegDecoder::DumpOutFile(MppFrame frame)
 {
 #ifdef DUMP_FILE
-    MppBuffer buf = mppApi_->HdiMppFrameGetBuffer(frame_);
+    MppBuffer buf = mppApi_->HdiMppFrameGetBuffer(frame);
     auto size = mppApi_->HdiMppBufferGetSizeWithCaller(buf, __func__);
     auto ptr = mppApi_->HdiMppBufferGetPtrWithCaller(buf, __func__);
     std::ofstream out("/data/out.raw", std::ios::trunc | std::ios::binary);
@@ -266,28 +334,42 @@ bool CodecJpegDecoder::SetFormat(int32_t format)
     }
     return ret;
 }
+void CodecJpegDecoder::ResetSlot(DecodeSlot &slot)
+{
+    if (slot.packet != nullptr) {
+        mppApi_->HdiMppPacketDeinit(&slot.packet);
+        slot.packet = nullptr;
+    }
+    if (slot.frame != nullptr) {
+        mppApi_->HdiMppFrameDeinit(&slot.frame);
+        slot.frame = nullptr;
+    }
+}
+
 void CodecJpegDecoder::ResetMppBuffer()
 {
     if (memGroup_) {
         mppApi_->HdiMppBufferGroupClear(memGroup_);
     }
-    if (packet_ != nullptr) {
-        mppApi_->HdiMppPacketDeinit(&packet_);
-        packet_ = nullptr;
-    }
-    if (frame_ != nullptr) {
-        mppApi_->HdiMppFrameDeinit(&frame_);
-        frame_ = nullptr;
+    for (auto &slot : slots_) {
+        ResetSlot(slot);
     }
 }
 
 bool CodecJpegDecoder::PrePare(bool isDecoder)
 {
+    // the context is set up for the first image only
+    if (mppCtx_ != nullptr) {
+        return true;
+    }
     MPP_RET ret = mppApi_->HdiMppCreate(&mppCtx_, &mpi_);
     if (ret != MPP_OK) {
         CODEC_LOGE("HdiMppCreate error %{public}d", ret);
+        mppCtx_ = nullptr;
         return false;
     }
+    // a context failed to set up is not prepared again
+    broken_ = true;
     ret = mppApi_->HdiMppInit(mppCtx_, isDecoder ? MPP_CTX_DEC : MPP_CTX_ENC, MPP_VIDEO_CodingMJPEG);
     if (ret != MPP_OK) {
         CODEC_LOGE("HdiMppInit error %{public}d", ret);
@@ -306,6 +388,7 @@ bool CodecJpegDecoder::PrePare(bool isDecoder)
     }
     mppApi_->HdiMppBufferGroupGet(&memGroup_, MPP_BUFFER_TYPE_DRM, MPP_BUFFER_INTERNAL, nullptr, __func__);
     mppApi_->HdiMppBufferGroupLimitConfig(memGroup_, 0, 24);  // 24:buffer group limit
+    broken_ = false;
     return true;
 }
 }  // namespace JPEG
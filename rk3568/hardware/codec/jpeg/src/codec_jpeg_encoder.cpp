@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2023 Shenzhen Kaihong DID Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "codec_jpeg_encoder.h"
+#include <cstring>
+#include <display_type.h>
+#include <hdf_base.h>
+#include <securec.h>
+#include "codec_log_wrapper.h"
+#include "codec_scope_guard.h"
+namespace OHOS {
+namespace VDI {
+namespace JPEG {
+constexpr uint32_t JPEG_QUALITY_MIN = 1;
+constexpr uint32_t JPEG_QUALITY_MAX = 99;
+
+CodecJpegEncoder::CodecJpegEncoder(RKMppApi *mppApi)
+    : width_(0), height_(0), horStride_(0), verStride_(0), quality_(0), format_(MPP_FMT_YUV420SP),
+      lumaQuantTbl_(), chromaQuantTbl_(), customQuantTbl_(false), mppCtx_(nullptr), mpi_(nullptr),
+      mppApi_(mppApi), cfg_(nullptr), configured_(false), broken_(false)
+{}
+
+CodecJpegEncoder::~CodecJpegEncoder()
+{
+    CODEC_LOGI("enter");
+    Destory();
+}
+
+void CodecJpegEncoder::Destory()
+{
+    if (cfg_) {
+        mppApi_->HdiMppEncCfgDeinit(cfg_);
+        cfg_ = nullptr;
+    }
+    if (mppCtx_) {
+        mppApi_->HdiMppDestroy(mppCtx_);
+        mppCtx_ = nullptr;
+    }
+    mpi_ = nullptr;
+    mppApi_ = nullptr;
+}
+
+int32_t CodecJpegEncoder::EnCode(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegEncInfo &encInfo,
+    uint32_t &outLen)
+{
+    CODEC_LOGI("enter");
+    outLen = 0;
+    if (buffer == nullptr || outBuffer == nullptr) {
+        CODEC_LOGE("buffer is nullptr or outBuffer is nullptr.");
+        return HDF_ERR_INVALID_PARAM;
+    }
+    // the restart interval is not configurable in the jpeg encoder of mpp
+    if (encInfo.restartInterval != 0) {
+        CODEC_LOGE("restart interval %{public}u is not supported", encInfo.restartInterval);
+        return HDF_ERR_NOT_SUPPORT;
+    }
+    if (broken_ || !PrePare()) {
+        CODEC_LOGE("PrePare failed");
+        return HDF_FAILURE;
+    }
+    if (!SetConfig(buffer, encInfo)) {
+        CODEC_LOGE("set config error");
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    // the encoder writes the stream into the output buffer in place
+    MppBuffer pktBuf = ImportBuffer(outBuffer, __func__);
+    if (pktBuf == nullptr) {
+        return HDF_FAILURE;
+    }
+    MppPacket packet = nullptr;
+    mppApi_->HdiMppPacketInitWithBuffer(&packet, pktBuf);
+    mppApi_->HdiMppBufferPutWithCaller(pktBuf, __func__);
+    OHOS::CodecScopeGuard scope([&] {
+        if (packet) {
+            mppApi_->HdiMppPacketDeinit(&packet);
+            packet = nullptr;
+        }
+    });
+    // NOTE: It is important to clear output packet length!!
+    mppApi_->HdiMppPacketSetLength(packet, 0);
+
+    if (SendFrame(buffer, packet) != MPP_OK) {
+        CODEC_LOGE("Send frame error");
+        return HDF_FAILURE;
+    }
+    if (GetPacket(packet, outLen) != MPP_OK) {
+        CODEC_LOGE("Recv packet error");
+        return HDF_FAILURE;
+    }
+    CODEC_LOGI("jpeg encode end, len %{public}u.", outLen);
+    return HDF_SUCCESS;
+}
+
+MppBuffer CodecJpegEncoder::ImportBuffer(BufferHandle *buffer, const char *caller)
+{
+    MppBufferInfo info;
+    memset_s(&info, sizeof(info), 0, sizeof(info));
+    info.type = MPP_BUFFER_TYPE_DRM;
+    info.fd = buffer->fd;
+    info.size = buffer->size;
+    MppBuffer mppBuffer = nullptr;
+    auto ret = mppApi_->HdiMppBufferImportWithTag(nullptr, &info, &mppBuffer, MODULE_TAG, caller);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("import buffer fd %{public}d error %{public}d", buffer->fd, ret);
+        return nullptr;
+    }
+    return mppBuffer;
+}
+
+MPP_RET CodecJpegEncoder::SendFrame(BufferHandle *buffer, MppPacket packet)
+{
+    MppBuffer frmBuf = ImportBuffer(buffer, __func__);
+    if (frmBuf == nullptr) {
+        return MPP_NOK;
+    }
+    MppFrame frame = nullptr;
+    mppApi_->HdiMppFrameInit(&frame);
+    OHOS::CodecScopeGuard scope([&] {
+        mppApi_->HdiMppFrameDeinit(&frame);
+    });
+    mppApi_->HdiMppFrameSetWidth(frame, width_);
+    mppApi_->HdiMppFrameSetHeight(frame, height_);
+    mppApi_->HdiMppFrameSetHorStride(frame, horStride_);
+    mppApi_->HdiMppFrameSetVerStride(frame, verStride_);
+    mppApi_->HdiMppFrameSetFormat(frame, format_);
+    mppApi_->HdiMppFrameSetBuffer(frame, frmBuf);
+    mppApi_->HdiMppBufferPutWithCaller(frmBuf, __func__);
+    mppApi_->HdiMppMetaSetPacket(mppApi_->HdiMppFrameGetMeta(frame), KEY_OUTPUT_PACKET, packet);
+
+    auto ret = mpi_->encode_put_frame(mppCtx_, frame);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("put frame error %{public}d", ret);
+        broken_ = true;
+    }
+    return ret;
+}
+
+MPP_RET CodecJpegEncoder::GetPacket(MppPacket packet, uint32_t &outLen)
+{
+    MppPacket packetOut = nullptr;
+    /* wait here until the packet of the frame is encoded */
+    auto ret = mpi_->encode_get_packet(mppCtx_, &packetOut);
+    if (ret != MPP_OK || packetOut == nullptr) {
+        CODEC_LOGE("get packet error %{public}d", ret);
+        broken_ = true;
+        return MPP_NOK;
+    }
+    if (packetOut != packet) {
+        CODEC_LOGE("packetOut is not match with the output packet");
+        mppApi_->HdiMppPacketDeinit(&packetOut);
+        broken_ = true;
+        return MPP_NOK;
+    }
+    outLen = static_cast<uint32_t>(mppApi_->HdiMppPacketGetLength(packetOut));
+    return (outLen != 0) ? MPP_OK : MPP_NOK;
+}
+
+bool CodecJpegEncoder::SetFormat(int32_t format)
+{
+    bool ret = true;
+    switch (format) {
+        case PIXEL_FMT_YCBCR_420_SP:
+            format_ = MPP_FMT_YUV420SP;
+            break;
+        case PIXEL_FMT_YCRCB_420_SP:
+            format_ = MPP_FMT_YUV420SP_VU;
+            break;
+        case PIXEL_FMT_YCBCR_420_P:
+            format_ = MPP_FMT_YUV420P;
+            break;
+        case PIXEL_FMT_RGBA_8888:
+            format_ = MPP_FMT_RGBA8888;
+            break;
+        case PIXEL_FMT_BGRA_8888:
+            format_ = MPP_FMT_BGRA8888;
+            break;
+        default:
+            CODEC_LOGE("unsupport pixformat %{public}d", format);
+            ret = false;
+            break;
+    }
+    return ret;
+}
+
+bool CodecJpegEncoder::SetConfig(BufferHandle *buffer, const struct CodecJpegEncInfo &encInfo)
+{
+    MppFrameFormat format = format_;
+    if (!SetFormat(buffer->format)) {
+        return false;
+    }
+    bool customQuantTbl = (encInfo.lumaQuantTbl != nullptr && encInfo.chromaQuantTbl != nullptr);
+    if (!customQuantTbl && (encInfo.quality < JPEG_QUALITY_MIN || encInfo.quality > JPEG_QUALITY_MAX)) {
+        CODEC_LOGE("invalid quality %{public}u", encInfo.quality);
+        format_ = format;
+        return false;
+    }
+    // the stride of the handle is in bytes, which is the hor_stride of both yuv and rgb in mpp
+    uint32_t horStride = static_cast<uint32_t>(buffer->stride);
+    uint32_t verStride = static_cast<uint32_t>(buffer->height);
+    // the hardware reads the whole frame of the strides from the buffer
+    uint64_t frameSize = static_cast<uint64_t>(horStride) * verStride;
+    if (format_ == MPP_FMT_YUV420SP || format_ == MPP_FMT_YUV420SP_VU || format_ == MPP_FMT_YUV420P) {
+        frameSize = frameSize * 3 / 2; // 3, 2: the chroma planes of yuv420
+    }
+    if (buffer->stride <= 0 || buffer->height <= 0 || buffer->size <= 0 || encInfo.imageWidth == 0 ||
+        encInfo.imageHeight == 0 || encInfo.imageHeight > verStride ||
+        frameSize > static_cast<uint64_t>(buffer->size)) {
+        CODEC_LOGE("buffer stride %{public}d height %{public}d size %{public}d does not hold image %{public}u x "
+            "%{public}u", buffer->stride, buffer->height, buffer->size, encInfo.imageWidth, encInfo.imageHeight);
+        format_ = format;
+        return false;
+    }
+    bool changed = !configured_ || format != format_ || width_ != encInfo.imageWidth ||
+        height_ != encInfo.imageHeight || horStride_ != horStride || verStride_ != verStride ||
+        customQuantTbl_ != customQuantTbl;
+    if (customQuantTbl) {
+        changed = changed || memcmp(lumaQuantTbl_, encInfo.lumaQuantTbl, JPEG_QTABLE_SIZE) != 0 ||
+            memcmp(chromaQuantTbl_, encInfo.chromaQuantTbl, JPEG_QTABLE_SIZE) != 0;
+    } else {
+        changed = changed || quality_ != encInfo.quality;
+    }
+    if (!changed) {
+        return true;
+    }
+
+    width_ = encInfo.imageWidth;
+    height_ = encInfo.imageHeight;
+    horStride_ = horStride;
+    verStride_ = verStride;
+    quality_ = encInfo.quality;
+    customQuantTbl_ = customQuantTbl;
+    configured_ = false;
+    mppApi_->HdiMppEncCfgSetS32(cfg_, "prep:width", width_);
+    mppApi_->HdiMppEncCfgSetS32(cfg_, "prep:height", height_);
+    mppApi_->HdiMppEncCfgSetS32(cfg_, "prep:hor_stride", horStride_);
+    mppApi_->HdiMppEncCfgSetS32(cfg_, "prep:ver_stride", verStride_);
+    mppApi_->HdiMppEncCfgSetS32(cfg_, "prep:format", format_);
+    mppApi_->HdiMppEncCfgSetS32(cfg_, "rc:mode", MPP_ENC_RC_MODE_FIXQP);
+    if (customQuantTbl) {
+        // the tables are kept by the encoder, mpp reads them when the config is set
+        memcpy_s(lumaQuantTbl_, sizeof(lumaQuantTbl_), encInfo.lumaQuantTbl, JPEG_QTABLE_SIZE);
+        memcpy_s(chromaQuantTbl_, sizeof(chromaQuantTbl_), encInfo.chromaQuantTbl, JPEG_QTABLE_SIZE);
+        mppApi_->HdiMppEncCfgSetPtr(cfg_, "jpeg:qtable_y", lumaQuantTbl_);
+        mppApi_->HdiMppEncCfgSetPtr(cfg_, "jpeg:qtable_u", chromaQuantTbl_);
+        mppApi_->HdiMppEncCfgSetPtr(cfg_, "jpeg:qtable_v", chromaQuantTbl_);
+    } else {
+        mppApi_->HdiMppEncCfgSetPtr(cfg_, "jpeg:qtable_y", nullptr);
+        mppApi_->HdiMppEncCfgSetPtr(cfg_, "jpeg:qtable_u", nullptr);
+        mppApi_->HdiMppEncCfgSetPtr(cfg_, "jpeg:qtable_v", nullptr);
+        mppApi_->HdiMppEncCfgSetS32(cfg_, "jpeg:q_factor", quality_);
+        mppApi_->HdiMppEncCfgSetS32(cfg_, "jpeg:qf_max", quality_);
+        mppApi_->HdiMppEncCfgSetS32(cfg_, "jpeg:qf_min", quality_);
+    }
+    auto ret = mpi_->control(mppCtx_, MPP_ENC_SET_CFG, cfg_);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("set enc cfg error %{public}d", ret);
+        return false;
+    }
+    configured_ = true;
+    return true;
+}
+
+bool CodecJpegEncoder::PrePare()
+{
+    // the context is set up for the first image only
+    if (mppCtx_ != nullptr) {
+        return true;
+    }
+    MPP_RET ret = mppApi_->HdiMppCreate(&mppCtx_, &mpi_);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("HdiMppCreate error %{public}d", ret);
+        mppCtx_ = nullptr;
+        return false;
+    }
+    // a context failed to set up is not prepared again
+    broken_ = true;
+    ret = mppApi_->HdiMppInit(mppCtx_, MPP_CTX_ENC, MPP_VIDEO_CodingMJPEG);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("HdiMppInit error %{public}d", ret);
+        return false;
+    }
+    MppPollType timeout = MPP_POLL_BLOCK;
+    ret = mpi_->control(mppCtx_, MPP_SET_OUTPUT_TIMEOUT, &timeout);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("set output timeout error %{public}d", ret);
+        return false;
+    }
+    ret = mpi_->control(mppCtx_, MPP_SET_INPUT_TIMEOUT, &timeout);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("set input timeout error %{public}d", ret);
+        return false;
+    }
+    ret = mppApi_->HdiMppEncCfgInit(&cfg_);
+    if (ret != MPP_OK) {
+        CODEC_LOGE("HdiMppEncCfgInit error %{public}d", ret);
+        cfg_ = nullptr;
+        return false;
+    }
+    mppApi_->HdiMppEncCfgSetS32(cfg_, "codec:type", MPP_VIDEO_CodingMJPEG);
+    broken_ = false;
+    return true;
+}
+}  // namespace JPEG
+}  // namespace VDI
+}  // namespace OHOS
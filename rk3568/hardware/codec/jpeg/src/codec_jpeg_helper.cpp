@@ -26,6 +26,95 @@ namespace JPEG {
 int32_t CodecJpegHelper::JpegAssemble(const struct CodecJpegDecInfo &decInfo, int8_t *buffer, int32_t fd)
 {
     CODEC_LOGD("enter");
+    int32_t curPos = JpegHeaderAssemble(decInfo, buffer);
+    if (curPos < 0) {
+        return -1;
+    }
+    // DATA
+    curPos = JpegDataAssemble(buffer, curPos, fd);
+    if (curPos < 0) {
+        CODEC_LOGE("assemble CompressedData error");
+        return -1;
+    }
+    // EOI
+    curPos = PutInt16(buffer, curPos, 0xffd9);
+    if (curPos < 0) {
+        CODEC_LOGE("assemble EOI error");
+        return -1;
+    }
+    return curPos;
+}
+
+int32_t CodecJpegHelper::GetJpegHeaderLen(const struct CodecJpegDecInfo &decInfo)
+{
+    size_t len = 2;  // 2: SOI
+    // DQT
+    len += 4;  // 4: marker and len
+    for (auto &table : decInfo.quantTbl) {
+        if (!table.tableFlag) {
+            break;
+        }
+        len += 1 + table.quantVal.size() * 2;  // 1: precision and tableid, 2: 16bits value
+    }
+    // DHT of dc and ac
+    for (auto tables : {&decInfo.dcHuffTbl, &decInfo.acHuffTbl}) {
+        len += 4;  // 4: marker and len
+        for (auto &table : *tables) {
+            if (!table.tableFlag) {
+                break;
+            }
+            len += 1 + table.bits.size() + table.huffVal.size();  // 1: type and tableid
+        }
+    }
+    // DRI
+    if (decInfo.restartInterval > 0) {
+        len += 6;  // 6: marker, len and interval
+    }
+    // SOF and SOS
+    len += 10 + decInfo.compInfo.size() * 3;  // 10: marker, len, precision, size and components, 3: component
+    len += 8 + decInfo.compInfo.size() * 2;  // 8: marker, len, components and 0x003F00, 2: component
+    if (len > JPEG_HEADER_MAX_LEN) {
+        CODEC_LOGE("header len %{public}zu is too large", len);
+        return -1;
+    }
+    return static_cast<int32_t>(len);
+}
+
+int32_t CodecJpegHelper::JpegAssembleHeader(const struct CodecJpegDecInfo &decInfo, int8_t *buffer, size_t bufferLen)
+{
+    int32_t headerLen = GetJpegHeaderLen(decInfo);
+    if (headerLen < 0 || static_cast<size_t>(headerLen) > bufferLen) {
+        CODEC_LOGE("header len %{public}d, buffer len %{public}zu", headerLen, bufferLen);
+        return -1;
+    }
+    return JpegHeaderAssemble(decInfo, buffer);
+}
+
+int32_t CodecJpegHelper::JpegAssembleInPlace(const struct CodecJpegDecInfo &decInfo, int8_t *buffer, size_t bufferLen,
+    size_t dataPos, size_t dataLen)
+{
+    CODEC_LOGD("enter. dataPos = %{public}zu, dataLen = %{public}zu", dataPos, dataLen);
+    int32_t headerLen = GetJpegHeaderLen(decInfo);
+    // the headers go into the room before the data, the EOI after it
+    if (headerLen < 0 || static_cast<size_t>(headerLen) > dataPos || dataPos > bufferLen ||
+        dataLen > bufferLen - dataPos || bufferLen - dataPos - dataLen < 2) {  // 2: EOI
+        CODEC_LOGE("no room for the headers, header len %{public}d, buffer len %{public}zu", headerLen, bufferLen);
+        return -1;
+    }
+    int32_t start = static_cast<int32_t>(dataPos) - headerLen;
+    if (JpegHeaderAssemble(decInfo, buffer + start) != headerLen) {
+        CODEC_LOGE("assemble header error");
+        return -1;
+    }
+    if (PutInt16(buffer, static_cast<int32_t>(dataPos + dataLen), 0xffd9) < 0) {
+        CODEC_LOGE("assemble EOI error");
+        return -1;
+    }
+    return start;
+}
+
+int32_t CodecJpegHelper::JpegHeaderAssemble(const struct CodecJpegDecInfo &decInfo, int8_t *buffer)
+{
     int32_t curPos = 0;
     // SOI
     curPos = PutInt16(buffer, curPos, 0xffd8);
@@ -66,71 +155,120 @@ int32_t CodecJpegHelper::JpegAssemble(const struct CodecJpegDecInfo &decInfo, in
         CODEC_LOGE("assemble SOS error");
         return -1;
     }
-    // DATA
-    curPos = JpegDataAssemble(buffer, curPos, fd);
-    if (curPos < 0) {
-        CODEC_LOGE("assemble CompressedData error");
-        return -1;
-    }
-    // EOI
-    curPos = PutInt16(buffer, curPos, 0xffd9);
-    if (curPos < 0) {
-        CODEC_LOGE("assemble EOI error");
-        return -1;
-    }
     return curPos;
 }
 
 bool CodecJpegHelper::DessambleJpeg(int8_t *buffer, size_t bufferLen, struct CodecJpegDecInfo &decInfo,
-    std::unique_ptr<int8_t[]> &compressBuffer, int32_t &comBufLen)
+    size_t &dataPos, size_t &dataLen)
 {
     CODEC_LOGD("enter");
-    int8_t *start = buffer;
-    const int8_t *end = buffer + bufferLen;
-    while (start < end) {
-        JpegMarker marker = (JpegMarker)FindMarker(start);
-        start += 2;  // 2: marker len
+    dataPos = 0;
+    dataLen = 0;
+    size_t pos = 0;
+    while (pos < bufferLen) {
+        if (GetInt8(buffer + pos) != 0xff) {
+            CODEC_LOGE("no marker at %{public}zu", pos);
+            return false;
+        }
+        // a marker may be preceded by the fill bytes of 0xff
+        while (pos < bufferLen && GetInt8(buffer + pos) == 0xff) {
+            pos++;
+        }
+        if (pos >= bufferLen) {
+            break;
+        }
+        int32_t marker = 0xff00 | GetInt8(buffer + pos);
+        pos++;
+        if (marker == SOI) {
+            continue;
+        }
+        if (marker == EOI) {
+            return dataLen > 0;
+        }
+        // the other markers are followed by the len of the segment, the len field included
+        if (bufferLen - pos < 2) {  // 2: len field
+            break;
+        }
+        int8_t *segment = buffer + pos;
+        size_t len = static_cast<size_t>(GetInt16(segment));
+        if (len < 2 || len > bufferLen - pos) {  // 2: len field
+            CODEC_LOGE("marker[%{public}x] len %{public}zu is out of the buffer", marker, len);
+            return false;
+        }
+        int32_t ret = static_cast<int32_t>(len);
         switch (marker) {
-            case SOI:
-            case EOI:
-                break;
             case SOF0:
-                start += DessambleSof(start, decInfo);
+                ret = DessambleSof(segment, decInfo);
                 break;
             case DHT:
-                start += DessambleDht(start, decInfo);
+                ret = DessambleDht(segment, decInfo);
                 break;
-            case SOS: {
-                start += DessambleSos(start, decInfo);
-                // compressed data start
-                auto len = DessambleCompressData(start, compressBuffer, comBufLen);
-                if (len < 0) {
-                    CODEC_LOGE("copy compressed data error");
-                    return false;
-                }
-                start += len;
-                break;
-            }
-
             case DQT:
-                start += DessambleDqt(start, decInfo);
+                ret = DessambleDqt(segment, decInfo);
                 break;
-            case DRI: {
-                start += 2;  // 2: marker len
-                decInfo.restartInterval = GetInt16(start);
-                start += 2;  // 2: interval len
+            case DRI:
+                decInfo.restartInterval = (len >= 4) ? GetInt16(segment + 2) : 0;  // 4: len and interval
                 break;
+            case SOS: {
+                if (dataLen > 0) {
+                    CODEC_LOGE("only one scan is supported");
+                    return false;
+                }
+                ret = DessambleSos(segment, decInfo);
+                if (ret < 0) {
+                    break;
+                }
+                // the compressed data follows the header of the scan until the next marker
+                int32_t end = FindScanEnd(buffer, bufferLen, pos + len);
+                if (end < 0) {
+                    CODEC_LOGE("no end of the compressed data");
+                    return false;
+                }
+                dataPos = pos + len;
+                dataLen = static_cast<size_t>(end) - dataPos;
+                pos = static_cast<size_t>(end);
+                continue;
             }
-            default: {
-                short len = GetInt16(start);
-                start += len;
-                CODEC_LOGW("skip marker[%{public}x], len[%{public}d]", marker, len);
+            default:
+                CODEC_LOGW("skip marker[%{public}x], len[%{public}zu]", marker, len);
                 break;
-            }
         }
+        if (ret < 0) {
+            CODEC_LOGE("dessamble marker[%{public}x] error", marker);
+            return false;
+        }
+        pos += len;
     }
-    return true;
+    CODEC_LOGE("no EOI");
+    return false;
 }
+
+int32_t CodecJpegHelper::FindScanEnd(int8_t *buffer, size_t bufferLen, size_t pos)
+{
+    while (pos < bufferLen) {
+        auto found = static_cast<int8_t *>(memchr(buffer + pos, 0xff, bufferLen - pos));
+        if (found == nullptr || static_cast<size_t>(found - buffer) + 1 >= bufferLen) {
+            return -1;
+        }
+        size_t markerPos = static_cast<size_t>(found - buffer);
+        // skip the fill bytes of 0xff
+        pos = markerPos + 1;
+        while (pos < bufferLen && GetInt8(buffer + pos) == 0xff) {
+            pos++;
+        }
+        if (pos >= bufferLen) {
+            return -1;
+        }
+        int32_t next = GetInt8(buffer + pos);
+        // the stuffed 0xff00 and the restart markers are part of the compressed data
+        if (next != 0x00 && (next < 0xd0 || next > 0xd7)) {  // 0xd0 ~ 0xd7: RST0 ~ RST7
+            return static_cast<int32_t>(markerPos);
+        }
+        pos++;
+    }
+    return -1;
+}
+
 int32_t CodecJpegHelper::JpegDqtAssemble(const struct CodecJpegDecInfo &decInfo, int8_t *buffer, int32_t curPos)
 {
     CODEC_LOGD("enter. curPos = %{public}d, quantTbl.size= %{public}zu", curPos, decInfo.quantTbl.size());
@@ -414,6 +552,10 @@ int32_t CodecJpegHelper::DessambleSof(int8_t *buffer, struct CodecJpegDecInfo &d
 
     decInfo.numComponents = GetInt8(buffer);
     buffer++;
+    if (len < static_cast<int32_t>(decInfo.numComponents) * 3 + 8) {  // 3: component len, 8: header len
+        CODEC_LOGE("SOF len %{public}d is too short for %{public}u components", len, decInfo.numComponents);
+        return -1;
+    }
 
 #ifdef JPEG_DEBUG
     CODEC_LOGD("image width[%{public}d],height[%{public}d],components[%{public}d]", decInfo.imageWidth,
@@ -449,6 +591,11 @@ int32_t CodecJpegHelper::DessambleSos(int8_t *buffer, struct CodecJpegDecInfo &d
 
     int32_t components = GetInt8(buffer);
     buffer++;
+    // the components are declared by the SOF before
+    if (components > static_cast<int32_t>(decInfo.compInfo.size()) || len < components * 2 + 6) {  // 2, 6: lens
+        CODEC_LOGE("SOS components %{public}d is invalid", components);
+        return -1;
+    }
 
     for (int32_t i = 0; i < components; i++) {
         decInfo.compInfo[i].infoFlag = true;
@@ -469,35 +616,6 @@ int32_t CodecJpegHelper::DessambleSos(int8_t *buffer, struct CodecJpegDecInfo &d
     buffer += 3;  // skip 0x003F00
     return len;
 }
-int32_t CodecJpegHelper::DessambleCompressData(
-    int8_t *buffer, std::unique_ptr<int8_t[]> &compressBuffer, int32_t &comBufLen)
-{
-    int8_t *dataStart = buffer;
-    int32_t v = 0xff;
-    do {
-        v = GetInt8(buffer);
-        buffer++;
-        if (v != 0xff) {
-            continue;
-        }
-        v = GetInt8(buffer);
-        buffer++;
-        if (v != 0xd9) {
-            continue;
-        }
-        buffer -= 2;  // 2: marker len
-        break;
-    } while (1);
-    comBufLen = (int32_t)(buffer - dataStart);
-    compressBuffer = std::make_unique<int8_t[]>(comBufLen);
-    auto ret = memcpy_s(compressBuffer.get(), comBufLen, dataStart, comBufLen);
-    if (ret != EOK) {
-        CODEC_LOGE("copy compressed data error, dataLen %{public}d, ret %{public}d", comBufLen, ret);
-        compressBuffer = nullptr;
-        return ret;
-    }
-    return comBufLen;
-}
 int32_t CodecJpegHelper::DessambleDqt(int8_t *buffer, struct CodecJpegDecInfo &decInfo)
 {
     CODEC_LOGD("dessamble DQT");
@@ -514,6 +632,10 @@ int32_t CodecJpegHelper::DessambleDqt(int8_t *buffer, struct CodecJpegDecInfo &d
         if (((data >> 4) & 0x0f) == 1) {  // 4: low 4 bits, 1: for 16 bits
             dqtbufferSize *= 2;           // 2: 16bits has double size
         }
+        if ((buffer - bufferOri) + dqtbufferSize > len) {
+            CODEC_LOGE("DQT len %{public}d is too short", len);
+            return -1;
+        }
         CodecJpegQuantTable table;
         table.tableFlag = true;
 #ifdef JPEG_DEBUG
@@ -540,6 +662,10 @@ int32_t CodecJpegHelper::DessambleDht(int8_t *buffer, struct CodecJpegDecInfo &d
         int32_t tableId = data & 0x000f;
         (void)tableId;
         int32_t acOrDc = (data >> 4) & 0x0f;  // 0:DC, 1:AC, 4: ac/dc data offset
+        if ((buffer - bufferOri) + 16 > len) {  // 16: Data size
+            CODEC_LOGE("DHT len %{public}d is too short", len);
+            return -1;
+        }
         CodecJpegHuffTable table;
         table.tableFlag = true;
         int32_t num = 0;
@@ -552,6 +678,10 @@ int32_t CodecJpegHelper::DessambleDht(int8_t *buffer, struct CodecJpegDecInfo &d
 #ifdef JPEG_DEBUG
         CODEC_LOGD("tableid[%{public}d], acOrDc[%{public}d], num[%{public}d]", tableId, acOrDc, num);
 #endif
+        if ((buffer - bufferOri) + num > len) {
+            CODEC_LOGE("DHT len %{public}d is too short for %{public}d values", len, num);
+            return -1;
+        }
         // val
         for (int32_t i = 0; i < num; i++) {
             table.huffVal.push_back(*buffer++);
@@ -565,12 +695,6 @@ int32_t CodecJpegHelper::DessambleDht(int8_t *buffer, struct CodecJpegDecInfo &d
     return len;
 }
 
-int32_t CodecJpegHelper::FindMarker(int8_t *start)
-{
-    int32_t marker = GetInt16(start);
-    return marker;
-}
-
 int32_t CodecJpegHelper::PutInt16(int8_t *buffer, int32_t curPos, int16_t value)
 {
     int8_t data[] = {value >> 8, value & 0xFF};
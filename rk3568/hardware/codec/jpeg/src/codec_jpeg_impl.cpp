@@ -23,6 +23,7 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include "codec_jpeg_decoder.h"
+#include "codec_jpeg_helper.h"
 #include "codec_log_wrapper.h"
 namespace OHOS {
 namespace VDI {
@@ -79,6 +80,12 @@ int32_t CodecJpegImpl::Init()
 void CodecJpegImpl::DeInit()
 {
     CODEC_LOGI("enter");
+    {
+        std::lock_guard<std::mutex> lock(decoderLock_);
+        idleDecoders_.clear();
+    }
+    std::lock_guard<std::mutex> lock(encoderLock_);
+    idleEncoders_.clear();
 }
 
 int32_t CodecJpegImpl::AllocateBuffer(BufferHandle **buffer, uint32_t size)
@@ -121,15 +128,139 @@ int32_t CodecJpegImpl::DeCode(BufferHandle *buffer, BufferHandle *outBuffer, con
         return HDF_ERR_INVALID_PARAM;
     }
 
-    CodecJpegDecoder decoder(mppApi_);
-    auto ret = decoder.DeCode(buffer, outBuffer, decInfo);
+    auto decoder = AcquireDecoder();
+    auto ret = decoder->DeCode(buffer, outBuffer, decInfo);
+    if (ret != HDF_SUCCESS) {
+        CODEC_LOGE("decode failed, ret %{public}d", ret);
+    }
+    ReleaseDecoder(std::move(decoder));
+
+    return ret;
+}
+
+int32_t CodecJpegImpl::DeCodeBatch(const std::vector<CodecJpegDecodeJob> &jobs, std::vector<int32_t> &results)
+{
+    if (mppApi_ == nullptr) {
+        CODEC_LOGE("mppApi_ is nullptr, please Init first!");
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    auto decoder = AcquireDecoder();
+    auto ret = decoder->DeCodeBatch(jobs, results);
     if (ret != HDF_SUCCESS) {
+        CODEC_LOGE("decode batch failed, ret %{public}d", ret);
+    }
+    ReleaseDecoder(std::move(decoder));
+
+    return ret;
+}
+
+int32_t CodecJpegImpl::DeCodeInPlace(BufferHandle *buffer, BufferHandle *outBuffer,
+    const struct CodecJpegDecInfo &decInfo, uint32_t dataPos, uint32_t dataLen)
+{
+    if (buffer == nullptr || outBuffer == nullptr) {
+        CODEC_LOGE("buffer is nullptr or outBuffer is nullptr.");
+        return HDF_ERR_INVALID_PARAM;
+    }
+    if (mppApi_ == nullptr || displayVdi_ == nullptr) {
+        CODEC_LOGE("mppApi_ or displayVdi_ is nullptr, please Init first!");
+        return HDF_ERR_INVALID_PARAM;
+    }
+    auto addr = static_cast<int8_t *>(displayVdi_->Mmap(*buffer));
+    if (addr == nullptr) {
+        CODEC_LOGE("mmap input buffer error");
+        return HDF_FAILURE;
+    }
+    CodecJpegHelper jpegHelper;
+    int32_t start = jpegHelper.JpegAssembleInPlace(decInfo, addr, static_cast<size_t>(buffer->size), dataPos, dataLen);
+    // the headers and the EOI are written by the cpu, the hardware reads them from memory
+    if (start >= 0) {
+        displayVdi_->FlushCache(*buffer);
+    }
+    displayVdi_->Unmap(*buffer);
+    if (start < 0) {
+        CODEC_LOGE("assemble jpeg in place error, data at %{public}u len %{public}u", dataPos, dataLen);
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    uint32_t jpegLen = dataPos + dataLen + 2 - static_cast<uint32_t>(start);  // 2: EOI
+    std::vector<CodecJpegDecodeJob> jobs = {{buffer, outBuffer, &decInfo, static_cast<uint32_t>(start), jpegLen}};
+    std::vector<int32_t> results;
+    auto ret = DeCodeBatch(jobs, results);
+    return (ret != HDF_SUCCESS) ? ret : results[0];
+}
+
+int32_t CodecJpegImpl::EnCode(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegEncInfo &encInfo,
+    uint32_t &outLen)
+{
+    if (buffer == nullptr || outBuffer == nullptr) {
+        CODEC_LOGE("buffer is nullptr or outBuffer is nullptr.");
+        return HDF_ERR_INVALID_PARAM;
+    }
+    if (mppApi_ == nullptr) {
         CODEC_LOGE("mppApi_ is nullptr, please Init first!");
+        return HDF_ERR_INVALID_PARAM;
     }
 
+    auto encoder = AcquireEncoder();
+    auto ret = encoder->EnCode(buffer, outBuffer, encInfo, outLen);
+    if (ret != HDF_SUCCESS) {
+        CODEC_LOGE("encode failed, ret %{public}d", ret);
+    }
+    ReleaseEncoder(std::move(encoder));
+
     return ret;
 }
+
+std::unique_ptr<CodecJpegDecoder> CodecJpegImpl::AcquireDecoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(decoderLock_);
+        if (!idleDecoders_.empty()) {
+            auto decoder = std::move(idleDecoders_.back());
+            idleDecoders_.pop_back();
+            return decoder;
+        }
+    }
+    // the context of a new decoder is set up by its first image
+    return std::make_unique<CodecJpegDecoder>(mppApi_);
+}
+
+void CodecJpegImpl::ReleaseDecoder(std::unique_ptr<CodecJpegDecoder> decoder)
+{
+    if (decoder->IsBroken()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(decoderLock_);
+    if (idleDecoders_.size() < JPEG_DEC_POOL_SIZE) {
+        idleDecoders_.push_back(std::move(decoder));
+    }
+}
+
+std::unique_ptr<CodecJpegEncoder> CodecJpegImpl::AcquireEncoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(encoderLock_);
+        if (!idleEncoders_.empty()) {
+            auto encoder = std::move(idleEncoders_.back());
+            idleEncoders_.pop_back();
+            return encoder;
+        }
+    }
+    // the context of a new encoder is set up by its first image
+    return std::make_unique<CodecJpegEncoder>(mppApi_);
+}
+
+void CodecJpegImpl::ReleaseEncoder(std::unique_ptr<CodecJpegEncoder> encoder)
+{
+    if (encoder->IsBroken()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(encoderLock_);
+    if (idleEncoders_.size() < JPEG_ENC_POOL_SIZE) {
+        idleEncoders_.push_back(std::move(encoder));
+    }
+}
 }  // namespace JPEG
 }  // namespace VDI
 }  // namespace OHOS
-
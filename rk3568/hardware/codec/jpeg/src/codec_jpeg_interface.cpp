@@ -16,6 +16,9 @@
 #include <hdf_base.h>
 #include <hdf_log.h>
 #include <memory>
+#include <vector>
+#include "codec_jpeg_dec_hwi.h"
+#include "codec_jpeg_enc_hwi.h"
 #include "codec_jpeg_impl.h"
 #include "codec_log_wrapper.h"
 using namespace OHOS::VDI::JPEG;
@@ -72,6 +75,63 @@ static int32_t DoJpegDecode(BufferHandle *buffer, BufferHandle *outBuffer, const
     return g_JpegImpl->DeCode(buffer, outBuffer, *decInfo);
 }
 
+static int32_t DoJpegDecodeInPlace(BufferHandle *buffer, BufferHandle *outBuffer,
+    const struct CodecJpegDecInfo *decInfo, uint32_t dataPos, uint32_t dataLen)
+{
+    CODEC_LOGI("enter.");
+    if (g_JpegImpl == nullptr) {
+        CODEC_LOGE("jpeg decoder is not init.");
+        return HDF_ERR_NOPERM;
+    }
+    if (decInfo == nullptr) {
+        CODEC_LOGE("decInfo is null.");
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    return g_JpegImpl->DeCodeInPlace(buffer, outBuffer, *decInfo, dataPos, dataLen);
+}
+
+static int32_t DoJpegDecodeBatch(struct CodecJpegDecJob *jobs, uint32_t count)
+{
+    CODEC_LOGI("enter, count %{public}u.", count);
+    if (g_JpegImpl == nullptr) {
+        CODEC_LOGE("jpeg decoder is not init.");
+        return HDF_ERR_NOPERM;
+    }
+    if (jobs == nullptr || count == 0) {
+        CODEC_LOGE("jobs is null or empty.");
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    std::vector<CodecJpegDecodeJob> decodeJobs;
+    decodeJobs.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        decodeJobs.push_back({jobs[i].buffer, jobs[i].outBuffer, jobs[i].decInfo, 0, 0});
+    }
+    std::vector<int32_t> results;
+    auto ret = g_JpegImpl->DeCodeBatch(decodeJobs, results);
+    for (uint32_t i = 0; i < count; i++) {
+        jobs[i].result = (i < results.size()) ? results[i] : HDF_FAILURE;
+    }
+    return ret;
+}
+
+static int32_t DoJpegEncode(BufferHandle *buffer, BufferHandle *outBuffer, const struct CodecJpegEncInfo *encInfo,
+    uint32_t *outLen)
+{
+    CODEC_LOGI("enter.");
+    if (g_JpegImpl == nullptr) {
+        CODEC_LOGE("jpeg encoder is not init.");
+        return HDF_ERR_NOPERM;
+    }
+    if (encInfo == nullptr || outLen == nullptr) {
+        CODEC_LOGE("encInfo or outLen is null.");
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    return g_JpegImpl->EnCode(buffer, outBuffer, *encInfo, *outLen);
+}
+
 static ICodecJpegHwi g_jpegHwi = {.JpegInit = JpegInit,
                                   .JpegDeInit = JpegDeInit,
                                   .AllocateInBuffer = AllocateBuffer,
@@ -82,3 +142,18 @@ extern "C" ICodecJpegHwi *GetCodecJpegHwi()
 {
     return &g_jpegHwi;
 }
+
+static ICodecJpegEncHwi g_jpegEncHwi = {.DoJpegEncode = DoJpegEncode};
+
+extern "C" ICodecJpegEncHwi *GetCodecJpegEncHwi()
+{
+    return &g_jpegEncHwi;
+}
+
+static ICodecJpegDecHwi g_jpegDecHwi = {.DoJpegDecodeInPlace = DoJpegDecodeInPlace,
+                                        .DoJpegDecodeBatch = DoJpegDecodeBatch};
+
+extern "C" ICodecJpegDecHwi *GetCodecJpegDecHwi()
+{
+    return &g_jpegDecHwi;
+}
@@ -15,9 +15,11 @@
 
 #include "hdi_mpp.h"
 #include <dlfcn.h>
+#include <errno.h>
 #include <hdf_base.h>
 #include <hdf_log.h>
 #include <securec.h>
+#include <time.h>
 #include "hdi_mpp_component_manager.h"
 #include "hdi_mpp_config.h"
 #include "im2d.h"
@@ -27,9 +29,20 @@
 
 #define HDF_LOG_TAG codec_hdi_mpp
 #define BITWISE_LEFT_SHIFT_WITH_ONE     (1 << 20)
-#define SLEEP_INTERVAL_MICROSECONDS     1000
+#define WORKER_POLL_TIMEOUT_MS          100
+#define WORKER_RETRY_TIMEOUT_MS         10
+#define MS_PER_SECOND                   1000
+#define NS_PER_MS                       1000000
+#define NS_PER_SECOND                   1000000000
 #define BUFFER_GROUP_LIMIT_NUM          24
 #define FRAME_STRIDE_ALIGNMENT          16
+// the frame being decoded, the frame being shown and the frame queued for display
+#define DECODE_OUTPUT_MARGIN            3
+
+static int32_t StartWorkers(RKHdiBaseComponent* component);
+static void StopWorkers(RKHdiBaseComponent* component);
+static void ReturnQueuedInputs(RKHdiBaseComponent* component);
+static void ClearBufferQueue(RKHdiBufferQueue *queue);
 
 static void InitComponentSetup(RKHdiBaseComponent *component)
 {
@@ -41,6 +54,18 @@ static void InitComponentSetup(RKHdiBaseComponent *component)
     SetDefaultGopMode(&component->setup);
 }
 
+static void InitComponentWorker(RKHdiBaseComponent *component)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    // the timed waits are not affected by the change of the wall clock
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&component->lock, NULL);
+    pthread_cond_init(&component->inputCond, &attr);
+    pthread_cond_init(&component->outputCond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
 static RKHdiBaseComponent* CreateMppComponent(MppCtxType ctxType, MppCodingType codingType)
 {
     RKHdiBaseComponent* component = (RKHdiBaseComponent *)malloc(sizeof(RKHdiBaseComponent));
@@ -73,6 +98,7 @@ static RKHdiBaseComponent* CreateMppComponent(MppCtxType ctxType, MppCodingType
         free(component);
         return NULL;
     }
+    InitComponentWorker(component);
 
     return component;
 }
@@ -83,6 +109,9 @@ static void DestroyMppComponent(RKHdiBaseComponent *component)
         HDF_LOGE("%{public}s: component is NULL", __func__);
     }
     DeinitMppConfig(component);
+    pthread_cond_destroy(&component->inputCond);
+    pthread_cond_destroy(&component->outputCond);
+    pthread_mutex_destroy(&component->lock);
     ReleaseMppApi(component->mppApi);
     component->mppApi = NULL;
     free(component);
@@ -214,13 +243,17 @@ int32_t CodecCreate(const char* name, CODEC_HANDLETYPE *handle)
         HDF_LOGE("%{public}s: AddToMppComponentManager failed!", __func__);
         return HDF_FAILURE;
     }
-    if (component->ctxType == MPP_CTX_ENC) {
-        MppPollType timeout = MPP_POLL_BLOCK;
-        ret = component->mpi->control(ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
-        if (ret != MPP_OK) {
-            HDF_LOGE("%{public}s: mpi control set output timeout failed ret %{public}d", __func__, ret);
-            return HDF_FAILURE;
-        }
+    // the workers wait in mpp, the timeout lets them check the exit
+    MppPollType timeout = (MppPollType)WORKER_POLL_TIMEOUT_MS;
+    ret = component->mpi->control(ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
+    if (ret != MPP_OK) {
+        HDF_LOGE("%{public}s: mpi control set output timeout failed ret %{public}d", __func__, ret);
+        return HDF_FAILURE;
+    }
+    ret = component->mpi->control(ctx, MPP_SET_INPUT_TIMEOUT, &timeout);
+    if (ret != MPP_OK) {
+        HDF_LOGE("%{public}s: mpi control set input timeout failed ret %{public}d", __func__, ret);
+        return HDF_FAILURE;
     }
 
     ret = component->mppApi->HdiMppInit(ctx, ctxType, codingType);
@@ -232,6 +265,33 @@ int32_t CodecCreate(const char* name, CODEC_HANDLETYPE *handle)
     return HDF_SUCCESS;
 }
 
+static void ReleaseOutputSlots(RKHdiBaseComponent *component)
+{
+    for (RK_U32 i = 0; i < component->outputSlotCount; i++) {
+        RKHdiOutputSlot *slot = &component->outputSlots[i];
+        if (slot->frame != NULL) {
+            component->mppApi->HdiMppFrameDeinit(&slot->frame);
+            slot->frame = NULL;
+        }
+        free(slot->codecBuffer);
+        slot->codecBuffer = NULL;
+    }
+    component->outputSlotCount = 0;
+    component->extOutput = 0;
+}
+
+static void ReleaseEncodeTasks(RKHdiBaseComponent* component)
+{
+    for (int32_t i = 0; i < RK_HDI_ENC_FRAME_BUF_NUM; i++) {
+        RKHdiEncodeTask *task = &component->encTasks[i];
+        free(task->input);
+        free(task->output);
+        task->input = NULL;
+        task->output = NULL;
+        task->packet = NULL;
+    }
+}
+
 int32_t CodecDestroy(CODEC_HANDLETYPE handle)
 {
     MPP_RET ret = MPP_OK;
@@ -244,6 +304,10 @@ int32_t CodecDestroy(CODEC_HANDLETYPE handle)
     }
 
     RKMppApi *mppApi = component->mppApi;
+    StopWorkers(component);
+    ClearBufferQueue(&component->inputQueue);
+    ClearBufferQueue(&component->outputQueue);
+    ReleaseEncodeTasks(component);
     if (component->packet != NULL) {
         mppApi->HdiMppPacketDeinit(&component->packet);
         component->packet = NULL;
@@ -254,9 +318,12 @@ int32_t CodecDestroy(CODEC_HANDLETYPE handle)
         component->frame = NULL;
     }
 
-    if (component->frmBuf != NULL) {
-        mppApi->HdiMppBufferPutWithCaller(component->frmBuf, __func__);
-        component->frmBuf = NULL;
+    ReleaseOutputSlots(component);
+    for (int32_t i = 0; i < RK_HDI_ENC_FRAME_BUF_NUM; i++) {
+        if (component->frmBufs[i] != NULL) {
+            mppApi->HdiMppBufferPutWithCaller(component->frmBufs[i], __func__);
+            component->frmBufs[i] = NULL;
+        }
     }
 
     if (component->pktBuf != NULL) {
@@ -274,8 +341,14 @@ int32_t CodecDestroy(CODEC_HANDLETYPE handle)
             component->frameCount, component->frameErr);
         HDF_LOGI("%{public}s: dec max memory %{public}.2f MB", __func__,
             component->maxUsage / (float)BITWISE_LEFT_SHIFT_WITH_ONE);
+        HDF_LOGI("%{public}s: dec direct output frames : %{public}d, copied frames : %{public}d", __func__,
+            component->directFrames, component->copyFrames);
     } else if (component->ctxType == MPP_CTX_ENC) {
         HDF_LOGI("%{public}s: enc frame count : %{public}d", __func__, component->frameCount);
+        HDF_LOGI("%{public}s: enc direct input : %{public}d, copied input : %{public}d", __func__,
+            component->directInputs, component->copyInputs);
+        HDF_LOGI("%{public}s: enc direct output : %{public}d, copied output : %{public}d", __func__,
+            component->directOutputs, component->copyOutputs);
     } else {
         HDF_LOGE("%{public}s: CtxType undefined!", __func__);
     }
@@ -502,7 +575,10 @@ int32_t CodecStart(CODEC_HANDLETYPE handle)
     } else if (component->ctxType == MPP_CTX_DEC) {
         ret = SetDecCfg(component);
     }
-    return ret;
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+    return StartWorkers(component);
 }
 
 int32_t CodecStop(CODEC_HANDLETYPE handle)
@@ -513,6 +589,8 @@ int32_t CodecStop(CODEC_HANDLETYPE handle)
         HDF_LOGE("%{public}s: component is NULL", __func__);
         return HDF_FAILURE;
     }
+    StopWorkers(component);
+    ReturnQueuedInputs(component);
     return HDF_SUCCESS;
 }
 
@@ -525,10 +603,16 @@ int32_t CodecFlush(CODEC_HANDLETYPE handle, DirectionType directType)
         HDF_LOGE("%{public}s: component is NULL", __func__);
         return HDF_FAILURE;
     }
+    pthread_mutex_lock(&component->lock);
+    RK_U32 workerRunning = component->workerRunning;
+    pthread_mutex_unlock(&component->lock);
     switch (directType) {
         case INPUT_TYPE:
         case OUTPUT_TYPE:
         case ALL_TYPE:
+            // mpp is reset with no worker in it, the inputs not decoded yet are returned
+            StopWorkers(component);
+            ReturnQueuedInputs(component);
             ret = component->mpi->reset(ctx);
             if (ret != 0) {
                 HDF_LOGE("%{public}s: reset failed", __func__);
@@ -548,9 +632,170 @@ int32_t CodecFlush(CODEC_HANDLETYPE handle, DirectionType directType)
         component->pCallbacks->OnEvent(userData, event, length, eventData);
     }
 
+    if (workerRunning != 0) {
+        return StartWorkers(component);
+    }
     return HDF_SUCCESS;
 }
 
+static CodecBuffer *DupCodecBuffer(const CodecBuffer *buffer)
+{
+    size_t size = sizeof(CodecBuffer) + buffer->bufferCnt * sizeof(CodecBufferInfo);
+    CodecBuffer *dup = (CodecBuffer *)malloc(size);
+    if (dup == NULL) {
+        HDF_LOGE("%{public}s: malloc failed!", __func__);
+        return NULL;
+    }
+    int32_t ret = memcpy_s(dup, size, buffer, size);
+    if (ret != EOK) {
+        HDF_LOGE("%{public}s: copy buffer failed, error code: %{public}d", __func__, ret);
+        free(dup);
+        return NULL;
+    }
+    return dup;
+}
+
+static RK_U32 PushBufferQueue(RKHdiBufferQueue *queue, CodecBuffer *buffer)
+{
+    if (queue->count >= RK_HDI_BUFFER_QUEUE_SIZE) {
+        return 0;
+    }
+    queue->buffers[(queue->head + queue->count) % RK_HDI_BUFFER_QUEUE_SIZE] = buffer;
+    queue->count++;
+    return 1;
+}
+
+static CodecBuffer *PopBufferQueue(RKHdiBufferQueue *queue)
+{
+    if (queue->count == 0) {
+        return NULL;
+    }
+    CodecBuffer *buffer = queue->buffers[queue->head];
+    queue->head = (queue->head + 1) % RK_HDI_BUFFER_QUEUE_SIZE;
+    queue->count--;
+    return buffer;
+}
+
+static void ClearBufferQueue(RKHdiBufferQueue *queue)
+{
+    CodecBuffer *buffer = NULL;
+    while ((buffer = PopBufferQueue(queue)) != NULL) {
+        free(buffer);
+    }
+}
+
+static void GetDeadline(uint32_t timeoutMs, struct timespec *deadline)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeoutMs / MS_PER_SECOND;
+    deadline->tv_nsec += (long)(timeoutMs % MS_PER_SECOND) * NS_PER_MS;
+    if (deadline->tv_nsec >= NS_PER_SECOND) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= NS_PER_SECOND;
+    }
+}
+
+static RK_U32 IsWorkerExit(RKHdiBaseComponent *component)
+{
+    pthread_mutex_lock(&component->lock);
+    RK_U32 workerExit = component->workerExit;
+    pthread_mutex_unlock(&component->lock);
+    return workerExit;
+}
+
+static void NotifyWorker(RKHdiBaseComponent *component, pthread_cond_t *cond)
+{
+    pthread_mutex_lock(&component->lock);
+    pthread_cond_broadcast(cond);
+    pthread_mutex_unlock(&component->lock);
+}
+
+// wait until the other worker notifies, the workers exit or the time is out
+static void WaitWorker(RKHdiBaseComponent *component, pthread_cond_t *cond, uint32_t timeoutMs)
+{
+    struct timespec deadline;
+    GetDeadline(timeoutMs, &deadline);
+    pthread_mutex_lock(&component->lock);
+    if (component->workerExit == 0) {
+        pthread_cond_timedwait(cond, &component->lock, &deadline);
+    }
+    pthread_mutex_unlock(&component->lock);
+}
+
+/*
+ * Queue the copies of the buffers to the workers, the output is NULL for the decoder which takes the
+ * output buffers from the slots. Wait up to timeoutMs when the queues are full.
+ */
+static int32_t QueueWorkerBuffers(RKHdiBaseComponent *component, const CodecBuffer *input,
+    const CodecBuffer *output, uint32_t timeoutMs)
+{
+    CodecBuffer *inputBuffer = DupCodecBuffer(input);
+    CodecBuffer *outputBuffer = (output != NULL) ? DupCodecBuffer(output) : NULL;
+    if ((inputBuffer == NULL) || ((output != NULL) && (outputBuffer == NULL))) {
+        free(inputBuffer);
+        free(outputBuffer);
+        return HDF_ERR_MALLOC_FAIL;
+    }
+
+    int32_t ret = HDF_SUCCESS;
+    struct timespec deadline;
+    GetDeadline(timeoutMs, &deadline);
+    pthread_mutex_lock(&component->lock);
+    while (component->workerRunning != 0) {
+        if ((component->inputQueue.count < RK_HDI_BUFFER_QUEUE_SIZE) &&
+            ((outputBuffer == NULL) || (component->outputQueue.count < RK_HDI_BUFFER_QUEUE_SIZE))) {
+            break;
+        }
+        if (pthread_cond_timedwait(&component->inputCond, &component->lock, &deadline) == ETIMEDOUT) {
+            ret = HDF_ERR_TIMEOUT;
+            break;
+        }
+    }
+    if (component->workerRunning == 0) {
+        ret = HDF_FAILURE;
+    }
+    if (ret == HDF_SUCCESS) {
+        PushBufferQueue(&component->inputQueue, inputBuffer);
+        pthread_cond_broadcast(&component->inputCond);
+        if (outputBuffer != NULL) {
+            PushBufferQueue(&component->outputQueue, outputBuffer);
+            pthread_cond_broadcast(&component->outputCond);
+        }
+    }
+    pthread_mutex_unlock(&component->lock);
+
+    if (ret != HDF_SUCCESS) {
+        HDF_LOGE("%{public}s: queue buffer failed, ret %{public}d", __func__, ret);
+        free(inputBuffer);
+        free(outputBuffer);
+    }
+    return ret;
+}
+
+// take the input buffer queued first, return NULL when the workers exit
+static CodecBuffer *TakeInputBuffer(RKHdiBaseComponent *component)
+{
+    CodecBuffer *buffer = NULL;
+    pthread_mutex_lock(&component->lock);
+    while ((component->workerExit == 0) && (component->inputQueue.count == 0)) {
+        pthread_cond_wait(&component->inputCond, &component->lock);
+    }
+    if (component->workerExit == 0) {
+        buffer = PopBufferQueue(&component->inputQueue);
+        pthread_cond_broadcast(&component->inputCond);
+    }
+    pthread_mutex_unlock(&component->lock);
+    return buffer;
+}
+
+static void ReturnInputBuffer(RKHdiBaseComponent *component, CodecBuffer *buffer)
+{
+    UINTPTR userData = (UINTPTR)component->ctx;
+    int32_t acquireFd = 1;
+    component->pCallbacks->InputBufferAvailable(userData, buffer, &acquireFd);
+    free(buffer);
+}
+
 int32_t DecodeInitPacket(RKHdiBaseComponent* component, MppPacket *pPacket, CodecBuffer *inputData, RK_U32 pkt_eos)
 {
     MPP_RET ret = MPP_OK;
@@ -575,55 +820,176 @@ int32_t DecodeInitPacket(RKHdiBaseComponent* component, MppPacket *pPacket, Code
     return HDF_SUCCESS;
 }
 
-MPP_RET DecodeGetFrame(RKHdiBaseComponent* component, MppCtx ctx, MppFrame *frame)
+
+static RK_U32 IsOutputSlotMatched(const RKHdiOutputSlot *slot, RK_U32 horStride, RK_U32 verStride, RK_U32 bufSize)
 {
-    MppApi *mpi = component->mpi;
-    MPP_RET ret = MPP_OK;
-    RK_S32 retryTimes = 10;
-    while (true) {
-        ret = mpi->decode_get_frame(ctx, frame);
-        if (ret != MPP_ERR_TIMEOUT) {
-            break;
+    // the chroma plane of the frame follows the luma plane of hor_stride * ver_stride
+    return (slot->fd >= 0) && (slot->stride == (int32_t)horStride) && (slot->height == (int32_t)verStride) &&
+        (slot->size >= (int32_t)bufSize);
+}
+
+// the most frames referenced by the decoder of the codec
+static RK_U32 GetDecodeRefFrames(MppCodingType codingType)
+{
+    switch (codingType) {
+        case MPP_VIDEO_CodingAVC:
+        case MPP_VIDEO_CodingHEVC:
+            return 16; // 16: the max dpb size of h.264 and h.265
+        case MPP_VIDEO_CodingVP9:
+            return 8; // 8: the reference frame slots of vp9
+        case MPP_VIDEO_CodingVP8:
+            return 3; // 3: the last, golden and altref frames of vp8
+        case MPP_VIDEO_CodingMJPEG:
+            return 0;
+        default:
+            return 2; // 2: the forward and backward reference of mpeg2, mpeg4 and h.263
+    }
+}
+
+static RK_U32 CanDecodeToOutput(RKHdiBaseComponent *component, MppFrame frame)
+{
+    RKMppApi *mppApi = component->mppApi;
+    MppFrameFormat fmt = mppApi->HdiMppFrameGetFormat(frame);
+    RK_U32 horStride = mppApi->HdiMppFrameGetHorStride(frame);
+    RK_U32 verStride = mppApi->HdiMppFrameGetVerStride(frame);
+    RK_U32 bufSize = mppApi->HdiMppFrameGetBufferSize(frame);
+
+    if ((component->setup.fmt != PIXEL_FMT_YCBCR_420_SP) || MPP_FRAME_FMT_IS_FBC(fmt) ||
+        ((fmt & MPP_FRAME_FMT_MASK) != MPP_FMT_YUV420SP) || (component->outputSlotCount == 0)) {
+        return 0;
+    }
+    for (RK_U32 i = 0; i < component->outputSlotCount; i++) {
+        if (!IsOutputSlotMatched(&component->outputSlots[i], horStride, verStride, bufSize)) {
+            HDF_LOGI("%{public}s: output buffer stride %{public}d height %{public}d size %{public}d not match",
+                __func__, component->outputSlots[i].stride, component->outputSlots[i].height,
+                component->outputSlots[i].size);
+            return 0;
         }
-        if (retryTimes > 0) {
-            retryTimes--;
-            usleep(SLEEP_INTERVAL_MICROSECONDS);
-        } else {
-            HDF_LOGE("%{public}s: decode_get_frame failed too much time", __func__);
-            break;
+    }
+    /*
+     * Only the buffers queued before the info change are committed now, the decoder stalls for the rest of
+     * them until the client queues them again, so the committed ones hold the references and the margin.
+     */
+    RK_U32 committable = 0;
+    for (RK_U32 i = 0; i < component->outputSlotCount; i++) {
+        if (component->outputSlots[i].owner == OUTPUT_OWNED_BY_DECODER) {
+            committable++;
         }
     }
-    return ret;
+    RK_U32 required = GetDecodeRefFrames(component->codingType) + DECODE_OUTPUT_MARGIN;
+    if (committable < required) {
+        HDF_LOGI("%{public}s: %{public}d output buffers queued, %{public}d required", __func__, committable,
+            required);
+        return 0;
+    }
+    return 1;
 }
 
-int32_t HandleDecodeFrameInfoChange(RKHdiBaseComponent* component, MppFrame frame, MppCtx ctx)
+static void CommitOutputSlot(RKHdiBaseComponent *component, RK_U32 index)
 {
-    MPP_RET ret = MPP_OK;
-    RKMppApi *mppApi = component->mppApi;
-    MppApi *mpi = component->mpi;
-    RK_U32 width = mppApi->HdiMppFrameGetWidth(frame);
-    RK_U32 height = mppApi->HdiMppFrameGetHeight(frame);
-    RK_U32 hor_stride = mppApi->HdiMppFrameGetHorStride(frame);
-    RK_U32 ver_stride = mppApi->HdiMppFrameGetVerStride(frame);
-    RK_U32 buf_size = mppApi->HdiMppFrameGetBufferSize(frame);
+    RKHdiOutputSlot *slot = &component->outputSlots[index];
+    MppBufferInfo info;
+    int32_t err = memset_s(&info, sizeof(info), 0, sizeof(info));
+    if (err != EOK) {
+        HDF_LOGE("%{public}s: memset_s info failed, error code: %{public}d", __func__, err);
+        return;
+    }
+    info.type = MPP_BUFFER_TYPE_DRM;
+    info.fd = slot->fd;
+    info.size = component->extBufSize;
+    // the index tells which output buffer the decoded frame is in
+    info.index = (int)index;
+    MPP_RET ret = component->mppApi->HdiMppBufferImportWithTag(component->frmGrp, &info, NULL, NULL, __func__);
+    if (ret != MPP_OK) {
+        HDF_LOGE("%{public}s: commit output buffer fd %{public}d failed ret %{public}d", __func__, slot->fd, ret);
+        return;
+    }
+    slot->committed = 1;
+}
 
-    component->setup.width = width;
-    component->setup.height = height;
-    CheckSetupStride(component);
+static RK_U32 IsOutputSlotOf(const RKHdiOutputSlot *slot, const CodecBuffer *outInfo)
+{
+    if (outInfo->buffer[0].type == BUFFER_TYPE_HANDLE) {
+        BufferHandle *bufferHandle = (BufferHandle *)outInfo->buffer[0].buf;
+        return (slot->fd >= 0) && (slot->fd == bufferHandle->fd);
+    }
+    return (slot->fd < 0) && (slot->buf == outInfo->buffer[0].buf);
+}
 
-    HDF_LOGI("%{public}s: decode_get_frame get info changed found", __func__);
-    HDF_LOGI("%{public}s: decoder require buffer w:h [%{public}d:%{public}d]", __func__, width, height);
-    HDF_LOGI("%{public}s: decoder require stride [%{public}d:%{public}d]", __func__, hor_stride, ver_stride);
-    HDF_LOGI("%{public}s: decoder require buf_size %{public}d", __func__, buf_size);
+static void QueueOutputBuffer(RKHdiBaseComponent *component, CodecBuffer *outInfo)
+{
+    if ((outInfo == NULL) || (outInfo->bufferCnt == 0) || (outInfo->buffer[0].buf == 0)) {
+        return;
+    }
+    CodecBuffer *codecBuffer = DupCodecBuffer(outInfo);
+    if (codecBuffer == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&component->lock);
+    RK_U32 index = 0;
+    while ((index < component->outputSlotCount) && !IsOutputSlotOf(&component->outputSlots[index], outInfo)) {
+        index++;
+    }
+    if (index == component->outputSlotCount) {
+        if (component->outputSlotCount >= RK_HDI_MAX_OUTPUT_SLOTS) {
+            pthread_mutex_unlock(&component->lock);
+            HDF_LOGE("%{public}s: too many output buffers", __func__);
+            free(codecBuffer);
+            return;
+        }
+        component->outputSlotCount++;
+        RKHdiOutputSlot *slot = &component->outputSlots[index];
+        slot->fd = -1;
+        if (outInfo->buffer[0].type == BUFFER_TYPE_HANDLE) {
+            BufferHandle *bufferHandle = (BufferHandle *)outInfo->buffer[0].buf;
+            slot->fd = bufferHandle->fd;
+            slot->stride = bufferHandle->stride;
+            slot->height = bufferHandle->height;
+            slot->size = bufferHandle->size;
+        }
+        slot->codecBuffer = NULL;
+        slot->frame = NULL;
+        slot->committed = 0;
+    }
+    RKHdiOutputSlot *slot = &component->outputSlots[index];
+    free(slot->codecBuffer);
+    slot->codecBuffer = codecBuffer;
+    slot->buf = outInfo->buffer[0].buf;
+    slot->owner = OUTPUT_OWNED_BY_DECODER;
+    slot->sequence = component->outputSequence++;
+    // the client returns the buffer, the decoder can write it again
+    MppFrame frame = slot->frame;
+    slot->frame = NULL;
+    if ((component->extOutput != 0) && (slot->committed == 0)) {
+        if (IsOutputSlotMatched(slot, component->horStride, component->verStride, component->extBufSize)) {
+            CommitOutputSlot(component, index);
+        }
+    }
+    pthread_cond_broadcast(&component->outputCond);
+    pthread_mutex_unlock(&component->lock);
+
+    if (frame != NULL) {
+        component->mppApi->HdiMppFrameDeinit(&frame);
+    }
+}
 
+static int32_t SetupDecodeBufferGroup(RKHdiBaseComponent* component, MppCtx ctx, MppBufferMode mode)
+{
+    MPP_RET ret = MPP_OK;
+    RKMppApi *mppApi = component->mppApi;
+    if ((component->frmGrp != NULL) && (component->frmGrpMode != mode)) {
+        mppApi->HdiMppBufferGroupPut(component->frmGrp);
+        component->frmGrp = NULL;
+    }
     if (component->frmGrp == NULL) {
-        ret = mppApi->HdiMppBufferGroupGet(&component->frmGrp,
-            MPP_BUFFER_TYPE_DRM, MPP_BUFFER_INTERNAL, NULL, __func__);
+        ret = mppApi->HdiMppBufferGroupGet(&component->frmGrp, MPP_BUFFER_TYPE_DRM, mode, NULL, __func__);
         if (ret != MPP_OK) {
             HDF_LOGE("%{public}s: get mpp buffer group failed ret %{public}d", __func__, ret);
             return HDF_FAILURE;
         }
-        ret = mpi->control(ctx, MPP_DEC_SET_EXT_BUF_GROUP, component->frmGrp);
+        component->frmGrpMode = mode;
+        ret = component->mpi->control(ctx, MPP_DEC_SET_EXT_BUF_GROUP, component->frmGrp);
         if (ret != MPP_OK) {
             HDF_LOGE("%{public}s: set buffer group failed ret %{public}d", __func__, ret);
             return HDF_FAILURE;
@@ -635,12 +1001,85 @@ int32_t HandleDecodeFrameInfoChange(RKHdiBaseComponent* component, MppFrame fram
             return HDF_FAILURE;
         }
     }
-    
-    ret = mppApi->HdiMppBufferGroupLimitConfig(component->frmGrp, buf_size, BUFFER_GROUP_LIMIT_NUM);
+    return HDF_SUCCESS;
+}
+
+// called with the lock held, the output buffers are queued by the client at the same time
+static int32_t SetupDecodeOutput(RKHdiBaseComponent* component, MppFrame frame, MppCtx ctx)
+{
+    RKMppApi *mppApi = component->mppApi;
+    RK_U32 buf_size = mppApi->HdiMppFrameGetBufferSize(frame);
+
+    // the decoder writes into the output buffers when their layout is the same as the frame
+    RK_U32 extOutput = CanDecodeToOutput(component, frame);
+    if (SetupDecodeBufferGroup(component, ctx, (extOutput != 0) ? MPP_BUFFER_EXTERNAL : MPP_BUFFER_INTERNAL) !=
+        HDF_SUCCESS) {
+        return HDF_FAILURE;
+    }
+    component->extOutput = extOutput;
+    component->extBufSize = buf_size;
+    component->horStride = (RK_S32)mppApi->HdiMppFrameGetHorStride(frame);
+    component->verStride = (RK_S32)mppApi->HdiMppFrameGetVerStride(frame);
+    for (RK_U32 i = 0; i < component->outputSlotCount; i++) {
+        component->outputSlots[i].committed = 0;
+    }
+
+    if (extOutput != 0) {
+        // the buffers still held by the client are committed when they are queued again
+        RK_U32 committed = 0;
+        for (RK_U32 i = 0; i < component->outputSlotCount; i++) {
+            if (component->outputSlots[i].owner == OUTPUT_OWNED_BY_DECODER) {
+                CommitOutputSlot(component, i);
+                committed += component->outputSlots[i].committed;
+            }
+        }
+        if (committed >= GetDecodeRefFrames(component->codingType) + DECODE_OUTPUT_MARGIN) {
+            HDF_LOGI("%{public}s: decode to %{public}d output buffers directly", __func__, committed);
+            return HDF_SUCCESS;
+        }
+        HDF_LOGE("%{public}s: only %{public}d output buffers committed, copy to them instead", __func__, committed);
+        component->extOutput = 0;
+        for (RK_U32 i = 0; i < component->outputSlotCount; i++) {
+            component->outputSlots[i].committed = 0;
+        }
+        if (SetupDecodeBufferGroup(component, ctx, MPP_BUFFER_INTERNAL) != HDF_SUCCESS) {
+            return HDF_FAILURE;
+        }
+    }
+    MPP_RET ret = mppApi->HdiMppBufferGroupLimitConfig(component->frmGrp, buf_size, BUFFER_GROUP_LIMIT_NUM);
     if (ret != MPP_OK) {
         HDF_LOGE("%{public}s: limit buffer group failed ret %{public}d", __func__, ret);
         return HDF_FAILURE;
     }
+    return HDF_SUCCESS;
+}
+
+int32_t HandleDecodeFrameInfoChange(RKHdiBaseComponent* component, MppFrame frame, MppCtx ctx)
+{
+    MPP_RET ret = MPP_OK;
+    RKMppApi *mppApi = component->mppApi;
+    MppApi *mpi = component->mpi;
+    RK_U32 width = mppApi->HdiMppFrameGetWidth(frame);
+    RK_U32 height = mppApi->HdiMppFrameGetHeight(frame);
+    RK_U32 hor_stride = mppApi->HdiMppFrameGetHorStride(frame);
+    RK_U32 ver_stride = mppApi->HdiMppFrameGetVerStride(frame);
+    RK_U32 buf_size = mppApi->HdiMppFrameGetBufferSize(frame);
+
+    component->setup.width = width;
+    component->setup.height = height;
+    CheckSetupStride(component);
+
+    HDF_LOGI("%{public}s: decode_get_frame get info changed found", __func__);
+    HDF_LOGI("%{public}s: decoder require buffer w:h [%{public}d:%{public}d]", __func__, width, height);
+    HDF_LOGI("%{public}s: decoder require stride [%{public}d:%{public}d]", __func__, hor_stride, ver_stride);
+    HDF_LOGI("%{public}s: decoder require buf_size %{public}d", __func__, buf_size);
+
+    pthread_mutex_lock(&component->lock);
+    int32_t err = SetupDecodeOutput(component, frame, ctx);
+    pthread_mutex_unlock(&component->lock);
+    if (err != HDF_SUCCESS) {
+        return HDF_FAILURE;
+    }
     ret = mpi->control(ctx, MPP_DEC_SET_INFO_CHANGE_READY, NULL);
     if (ret != MPP_OK) {
         HDF_LOGE("%{public}s: info change ready failed ret %{public}d", __func__, ret);
@@ -649,14 +1088,14 @@ int32_t HandleDecodeFrameInfoChange(RKHdiBaseComponent* component, MppFrame fram
     return HDF_SUCCESS;
 }
 
-static IM_STATUS PutDecodeFrameToOutput(RKHdiBaseComponent* component, MppFrame frame, CodecBuffer *outInfo)
+static IM_STATUS PutDecodeFrameToOutput(RKHdiBaseComponent* component, MppFrame frame, RKHdiOutputSlot *slot)
 {
     RKMppApi *mppApi = component->mppApi;
     MppBuffer mppBuffer = mppApi->HdiMppFrameGetBuffer(frame);
     rga_buffer_t src;
     rga_buffer_t dst;
     im_rect rect;
-    
+
     int32_t err = memset_s(&src, sizeof(src), 0, sizeof(src));
     if (err != EOK) {
         HDF_LOGE("%{public}s: memset_s src failed, error code: %{public}d", __func__, err);
@@ -667,10 +1106,6 @@ static IM_STATUS PutDecodeFrameToOutput(RKHdiBaseComponent* component, MppFrame
         HDF_LOGE("%{public}s: memset_s dst failed, error code: %{public}d", __func__, err);
         return IM_STATUS_FAILED;
     }
-    if (outInfo->buffer[0].buf == 0) {
-        HDF_LOGE("%{public}s: output buf invalid", __func__);
-        return IM_STATUS_INVALID_PARAM;
-    }
 
     src.fd = mppApi->HdiMppBufferGetFdWithCaller(mppBuffer, __func__);
     src.width    = mppApi->HdiMppFrameGetWidth(frame);
@@ -679,11 +1114,10 @@ static IM_STATUS PutDecodeFrameToOutput(RKHdiBaseComponent* component, MppFrame
     src.hstride  = mppApi->HdiMppFrameGetVerStride(frame);
     src.format   = RK_FORMAT_YCbCr_420_SP;
 
-    if (outInfo->buffer[0].type == BUFFER_TYPE_HANDLE) {
-        BufferHandle *bufferHandle = (BufferHandle *)outInfo->buffer[0].buf;
-        dst.fd = bufferHandle->fd;
+    if (slot->fd >= 0) {
+        dst.fd = slot->fd;
     } else {
-        dst.vir_addr = (void *)outInfo->buffer[0].buf;
+        dst.vir_addr = (void *)slot->buf;
     }
     dst.width    = src.width;
     dst.height   = src.height;
@@ -698,28 +1132,96 @@ static IM_STATUS PutDecodeFrameToOutput(RKHdiBaseComponent* component, MppFrame
     return imcrop(src, dst, rect);
 }
 
-void HandleDecodeFrameOutput(RKHdiBaseComponent* component, MppFrame frame, int32_t frm_eos, CodecBuffer *outInfo)
+// take the output buffer the frame is decoded in, the frame is held until the buffer is queued again
+static RKHdiOutputSlot *TakeDecodeFrameSlot(RKHdiBaseComponent* component, MppFrame frame)
+{
+    RKMppApi *mppApi = component->mppApi;
+    MppBuffer mppBuffer = mppApi->HdiMppFrameGetBuffer(frame);
+    int index = mppApi->HdiMppBufferGetIndexWithCaller(mppBuffer, __func__);
+    RKHdiOutputSlot *slot = NULL;
+
+    pthread_mutex_lock(&component->lock);
+    if ((index >= 0) && ((RK_U32)index < component->outputSlotCount)) {
+        slot = &component->outputSlots[index];
+        if ((slot->committed != 0) && (slot->owner == OUTPUT_OWNED_BY_DECODER)) {
+            slot->frame = frame;
+            slot->owner = OUTPUT_OWNED_BY_CLIENT;
+        } else {
+            slot = NULL;
+        }
+    }
+    pthread_mutex_unlock(&component->lock);
+    return slot;
+}
+
+// take the output buffer queued first to copy the frame into, return NULL when the workers exit
+static RKHdiOutputSlot *TakeOutputSlot(RKHdiBaseComponent* component)
+{
+    RKHdiOutputSlot *slot = NULL;
+    pthread_mutex_lock(&component->lock);
+    while (component->workerExit == 0) {
+        for (RK_U32 i = 0; i < component->outputSlotCount; i++) {
+            RKHdiOutputSlot *candidate = &component->outputSlots[i];
+            if ((candidate->owner == OUTPUT_OWNED_BY_DECODER) &&
+                ((slot == NULL) || ((int32_t)(candidate->sequence - slot->sequence) < 0))) {
+                slot = candidate;
+            }
+        }
+        if (slot != NULL) {
+            slot->owner = OUTPUT_OWNED_BY_CLIENT;
+            break;
+        }
+        pthread_cond_wait(&component->outputCond, &component->lock);
+    }
+    pthread_mutex_unlock(&component->lock);
+    return slot;
+}
+
+/*
+ * Return 1 if the frame is held by the output buffer it is decoded in, the frame is released when the
+ * client queues the buffer again.
+ */
+RK_U32 HandleDecodeFrameOutput(RKHdiBaseComponent* component, MppFrame frame, int32_t frm_eos)
 {
     RKMppApi *mppApi = component->mppApi;
     RK_U32 err_info = mppApi->HdiMppFrameGetErrinfo(frame);
     RK_U32 discard = mppApi->HdiMppFrameGetDiscard(frame);
+    MppBuffer mppBuffer = mppApi->HdiMppFrameGetBuffer(frame);
+    RKHdiOutputSlot *slot = NULL;
+    RK_U32 held = 0;
     component->frameCount++;
-    
+
     if ((err_info | discard) != 0) {
         component->frameErr++;
         HDF_LOGE("%{public}s: bad output data, err_info: %{public}d", __func__, err_info);
-        return;
-    }
-    if (outInfo == NULL || outInfo->bufferCnt == 0) {
-        HDF_LOGE("%{public}s: outInfo param invalid!", __func__);
-        return;
-    }
-    // have output data
-    IM_STATUS ret = PutDecodeFrameToOutput(component, frame, outInfo);
-    if (ret != IM_STATUS_SUCCESS) {
-        HDF_LOGE("%{public}s: copy decode output data failed, error code: %{public}d", __func__, ret);
+        return 0;
+    }
+    if ((component->extOutput != 0) && (mppBuffer != NULL)) {
+        slot = TakeDecodeFrameSlot(component, frame);
+        if (slot == NULL) {
+            // the buffers of the client may be written by the decoder, the frame can not be copied to them
+            component->frameErr++;
+            HDF_LOGE("%{public}s: the frame is not in an output buffer", __func__);
+            return 0;
+        }
+        component->directFrames++;
+        held = 1;
+    } else {
+        // the empty eos frame only tells the end of the stream
+        slot = TakeOutputSlot(component);
+        if (slot == NULL) {
+            return 0;
+        }
+        if (mppBuffer != NULL) {
+            IM_STATUS ret = PutDecodeFrameToOutput(component, frame, slot);
+            if (ret != IM_STATUS_SUCCESS) {
+                HDF_LOGE("%{public}s: copy decode output data failed, error code: %{public}d", __func__, ret);
+            }
+            component->copyFrames++;
+        }
     }
 
+    CodecBuffer *outInfo = slot->codecBuffer;
     if (frm_eos != 0) {
         outInfo->flag |= STREAM_FLAG_EOS;
         HDF_LOGI("%{public}s: dec reach STREAM_FLAG_EOS, frame count : %{public}d, error count : %{public}d",
@@ -728,10 +1230,10 @@ void HandleDecodeFrameOutput(RKHdiBaseComponent* component, MppFrame frame, int3
     UINTPTR userData = (UINTPTR)component->ctx;
     int32_t acquireFd = 1;
     component->pCallbacks->OutputBufferAvailable(userData, outInfo, &acquireFd);
+    return held;
 }
 
-int32_t HandleDecodedFrame(RKHdiBaseComponent* component, MppFrame frame, MppCtx ctx,
-    int32_t frm_eos, CodecBuffer *outInfo)
+int32_t HandleDecodedFrame(RKHdiBaseComponent* component, MppFrame frame, MppCtx ctx, int32_t frm_eos)
 {
     RKMppApi *mppApi = component->mppApi;
     if (frame) {
@@ -741,10 +1243,12 @@ int32_t HandleDecodedFrame(RKHdiBaseComponent* component, MppFrame frame, MppCtx
                 mppApi->HdiMppFrameDeinit(&frame);
                 return HDF_FAILURE;
             }
-        } else {
-            HandleDecodeFrameOutput(component, frame, frm_eos, outInfo);
+        } else if (HandleDecodeFrameOutput(component, frame, frm_eos) != 0) {
+            frame = NULL;
+        }
+        if (frame != NULL) {
+            mppApi->HdiMppFrameDeinit(&frame);
         }
-        mppApi->HdiMppFrameDeinit(&frame);
     }
 
     // try get runtime frame memory usage
@@ -756,100 +1260,84 @@ int32_t HandleDecodedFrame(RKHdiBaseComponent* component, MppFrame frame, MppCtx
     return HDF_SUCCESS;
 }
 
-RK_U32 CodecDecodeGetFrameLoop(RKHdiBaseComponent* component, MppCtx ctx, RK_U32 pkt_done,
-    RK_U32 pkt_eos, CodecBuffer *outInfo)
+static void DecodePutPacket(RKHdiBaseComponent* component, CodecBuffer *inputData)
 {
     MPP_RET ret = MPP_OK;
     RKMppApi *mppApi = component->mppApi;
-    RK_U32 frm_eos = 0;
-    MppFrame frame = NULL;
+    MppPacket packet = NULL;
+    RK_U32 pkt_eos = (inputData->flag == STREAM_FLAG_EOS) ? 1 : 0;
 
-    do {
-        RK_S32 get_frm = 0;
-        ret = DecodeGetFrame(component, ctx, &frame);
-        if (ret != MPP_OK) {
-            HDF_LOGE("%{public}s: decode_get_frame failed, ret:%{public}d", __func__, ret);
-            break;
-        }
-        if (frame) {
-            frm_eos = mppApi->HdiMppFrameGetEos(frame);
-            get_frm = 1;
-            if (HandleDecodedFrame(component, frame, ctx, frm_eos, outInfo) != HDF_SUCCESS) {
-                break;
-            }
-        }
-        if (pkt_eos != 0 && pkt_done != 0 && frm_eos == 0) {
-            usleep(SLEEP_INTERVAL_MICROSECONDS);
-            continue;
-        }
-        if (frm_eos) {
+    if (DecodeInitPacket(component, &packet, inputData, pkt_eos) != HDF_SUCCESS) {
+        HDF_LOGE("%{public}s: Init packet failed!", __func__);
+        return;
+    }
+    while (IsWorkerExit(component) == 0) {
+        // the packet is copied by mpp, the input buffer can be returned once it is put
+        ret = component->mpi->decode_put_packet(component->ctx, packet);
+        if ((ret != MPP_ERR_BUFFER_FULL) && (ret != MPP_ERR_TIMEOUT)) {
             break;
         }
+        // the decoder is full, wait for the output worker to take a frame
+        WaitWorker(component, &component->inputCond, WORKER_RETRY_TIMEOUT_MS);
+    }
+    if (ret != MPP_OK) {
+        HDF_LOGE("%{public}s: decode_put_packet failed, ret:%{public}d", __func__, ret);
+    }
+    mppApi->HdiMppPacketDeinit(&packet);
+}
 
-        if ((component->frameNum > 0 && (component->frameCount >= component->frameNum)) ||
-            ((component->frameNum == 0) && frm_eos != 0)) {
-            break;
+static void *DecodeInputWorker(void *arg)
+{
+    RKHdiBaseComponent* component = (RKHdiBaseComponent *)arg;
+    CodecBuffer *inputData = NULL;
+    while ((inputData = TakeInputBuffer(component)) != NULL) {
+        DecodePutPacket(component, inputData);
+        ReturnInputBuffer(component, inputData);
+    }
+    return NULL;
+}
+
+static void *DecodeOutputWorker(void *arg)
+{
+    RKHdiBaseComponent* component = (RKHdiBaseComponent *)arg;
+    RKMppApi *mppApi = component->mppApi;
+    while (IsWorkerExit(component) == 0) {
+        MppFrame frame = NULL;
+        // wait in mpp for the frame up to the poll timeout
+        MPP_RET ret = component->mpi->decode_get_frame(component->ctx, &frame);
+        if ((ret != MPP_OK) && (ret != MPP_ERR_TIMEOUT)) {
+            HDF_LOGE("%{public}s: decode_get_frame failed, ret:%{public}d", __func__, ret);
+            WaitWorker(component, &component->outputCond, WORKER_RETRY_TIMEOUT_MS);
+            continue;
         }
-        if (get_frm) {
+        if (frame == NULL) {
             continue;
         }
-        break;
-    } while (1);
-
-    return frm_eos;
+        RK_U32 frm_eos = mppApi->HdiMppFrameGetEos(frame);
+        HandleDecodedFrame(component, frame, component->ctx, frm_eos);
+        NotifyWorker(component, &component->inputCond);
+    }
+    return NULL;
 }
 
 int32_t CodecDecode(CODEC_HANDLETYPE handle, CodecBuffer* inputData, CodecBuffer* outInfo, uint32_t timeoutMs)
 {
-    MPP_RET ret = MPP_OK;
-    MppCtx ctx = handle;
-    RK_U32 loop_end = 0;
-    RK_U32 frm_eos;
-    RK_U32 pkt_done = 0;
-    RK_U32 pkt_eos = (inputData->flag == STREAM_FLAG_EOS) ? 1 : 0;
-
+    if (inputData == NULL || inputData->bufferCnt == 0) {
+        HDF_LOGE("%{public}s: inputData param invalid!", __func__);
+        return HDF_FAILURE;
+    }
     RKHdiBaseComponent* component = FindInMppComponentManager(handle);
     if (component == NULL) {
         HDF_LOGE("%{public}s: component is NULL", __func__);
         return HDF_FAILURE;
     }
-    MppApi *mpi = component->mpi;
-    MppPacket packet = component->packet;
-
-    if (DecodeInitPacket(component, &packet, inputData, pkt_eos) != HDF_SUCCESS) {
-        HDF_LOGE("%{public}s: Init packet failed!", __func__);
-        return HDF_FAILURE;
-    }
 
-    do {
-        if (!pkt_done) {
-            ret = mpi->decode_put_packet(ctx, packet);
-            if (MPP_OK == ret) {
-                pkt_done = 1;
-            }
-        }
-
-        frm_eos = CodecDecodeGetFrameLoop(component, ctx, pkt_done, pkt_eos, outInfo);
-        if ((component->frameNum > 0 && (component->frameCount >= component->frameNum)) ||
-            ((component->frameNum == 0) && frm_eos != 0)) {
-            loop_end = 1;
-            break;
-        }
-        if (pkt_done) {
-            break;
-        }
-        usleep(SLEEP_INTERVAL_MICROSECONDS);
-    } while (1);
-    UINTPTR userData = (UINTPTR)component->ctx;
-    int32_t acquireFd = 1;
-    component->pCallbacks->InputBufferAvailable(userData, inputData, &acquireFd);
-
-    if (loop_end != 1) {
-        return HDF_FAILURE;
-    }
-    return HDF_SUCCESS;
+    // the buffers are returned by the callbacks when the workers are done with them
+    QueueOutputBuffer(component, outInfo);
+    return QueueWorkerBuffers(component, inputData, NULL, timeoutMs);
 }
 
+
 static IM_STATUS GetEncodeFrameFromInput(RKHdiBaseComponent* component, MppFrame frame,
     MppBuffer mppBuffer, CodecBuffer *inputInfo)
 {
@@ -899,7 +1387,100 @@ static IM_STATUS GetEncodeFrameFromInput(RKHdiBaseComponent* component, MppFrame
     return imcrop(src, dst, rect);
 }
 
-int32_t EncodeInitFrame(RKHdiBaseComponent* component, MppFrame *pFrame, RK_U32 frm_eos, CodecBuffer *inputData)
+static uint32_t GetEncodeInputSize(RKHdiBaseComponent* component)
+{
+    uint32_t lumaSize = (uint32_t)component->horStride * (uint32_t)component->verStride;
+    switch (component->fmt & MPP_FRAME_FMT_MASK) {
+        case MPP_FMT_YUV420SP:
+        case MPP_FMT_YUV420SP_VU:
+        case MPP_FMT_YUV420P:
+            return lumaSize * 3 / 2; // 3 / 2: the chroma planes are half of the luma plane
+        case MPP_FMT_YUV422SP:
+        case MPP_FMT_YUV422SP_VU:
+        case MPP_FMT_YUV422P:
+            return lumaSize * 2; // 2: the chroma planes are as large as the luma plane
+        default:
+            // the stride of the packed formats is in bytes
+            return lumaSize;
+    }
+}
+
+/*
+ * The encoder reads the input directly when it is a dma-buf with the format and the layout of the
+ * frame, the planes are at hor_stride * ver_stride.
+ */
+static MppBuffer ImportEncodeInput(RKHdiBaseComponent* component, const CodecBuffer *inputData)
+{
+    if ((inputData->buffer[0].type != BUFFER_TYPE_HANDLE) || (inputData->buffer[0].buf == 0)) {
+        return NULL;
+    }
+    BufferHandle *bufferHandle = (BufferHandle *)inputData->buffer[0].buf;
+    uint32_t size = GetEncodeInputSize(component);
+    if ((bufferHandle->format != component->setup.fmt) || (bufferHandle->stride != component->horStride) ||
+        (bufferHandle->height != component->verStride) || (bufferHandle->size < (int32_t)size)) {
+        return NULL;
+    }
+
+    MppBufferInfo info;
+    int32_t err = memset_s(&info, sizeof(info), 0, sizeof(info));
+    if (err != EOK) {
+        HDF_LOGE("%{public}s: memset_s info failed, error code: %{public}d", __func__, err);
+        return NULL;
+    }
+    info.type = MPP_BUFFER_TYPE_DRM;
+    info.fd = bufferHandle->fd;
+    info.size = size;
+    MppBuffer buffer = NULL;
+    MPP_RET ret = component->mppApi->HdiMppBufferImportWithTag(NULL, &info, &buffer, NULL, __func__);
+    if (ret != MPP_OK) {
+        HDF_LOGE("%{public}s: import input fd %{public}d failed ret %{public}d", __func__, info.fd, ret);
+        return NULL;
+    }
+    return buffer;
+}
+
+// the encoder writes the packet into the output buffer when it is a dma-buf as large as the packet buffer
+static MppPacket InitEncodeOutputPacket(RKHdiBaseComponent* component, const CodecBuffer *outInfo)
+{
+    if ((outInfo == NULL) || (outInfo->buffer[0].type != BUFFER_TYPE_HANDLE) || (outInfo->buffer[0].buf == 0)) {
+        return NULL;
+    }
+    BufferHandle *bufferHandle = (BufferHandle *)outInfo->buffer[0].buf;
+    if (bufferHandle->size < (int32_t)component->frameSize) {
+        return NULL;
+    }
+
+    RKMppApi *mppApi = component->mppApi;
+    MppBufferInfo info;
+    int32_t err = memset_s(&info, sizeof(info), 0, sizeof(info));
+    if (err != EOK) {
+        HDF_LOGE("%{public}s: memset_s info failed, error code: %{public}d", __func__, err);
+        return NULL;
+    }
+    info.type = MPP_BUFFER_TYPE_DRM;
+    info.fd = bufferHandle->fd;
+    info.size = (size_t)bufferHandle->size;
+    MppBuffer buffer = NULL;
+    MPP_RET ret = mppApi->HdiMppBufferImportWithTag(NULL, &info, &buffer, NULL, __func__);
+    if (ret != MPP_OK) {
+        HDF_LOGE("%{public}s: import output fd %{public}d failed ret %{public}d", __func__, info.fd, ret);
+        return NULL;
+    }
+    MppPacket packet = NULL;
+    // the packet holds the buffer
+    ret = mppApi->HdiMppPacketInitWithBuffer(&packet, buffer);
+    mppApi->HdiMppBufferPutWithCaller(buffer, __func__);
+    if (ret != MPP_OK) {
+        HDF_LOGE("%{public}s: init output packet failed ret %{public}d", __func__, ret);
+        return NULL;
+    }
+    // NOTE: It is important to clear output packet length!!
+    mppApi->HdiMppPacketSetLength(packet, 0);
+    return packet;
+}
+
+int32_t EncodeInitFrame(RKHdiBaseComponent* component, MppFrame *pFrame, RK_U32 frm_eos, CodecBuffer *inputData,
+    MppBuffer frmBuf)
 {
     MPP_RET ret = MPP_OK;
     RKMppApi *mppApi = component->mppApi;
@@ -919,31 +1500,39 @@ int32_t EncodeInitFrame(RKHdiBaseComponent* component, MppFrame *pFrame, RK_U32
     mppApi->HdiMppFrameSetFormat(*pFrame, component->fmt);
     mppApi->HdiMppFrameSetEos(*pFrame, frm_eos);
 
-    IM_STATUS status = GetEncodeFrameFromInput(component, *pFrame, component->frmBuf, inputData);
+    if (frmBuf == NULL) {
+        // the frame is encoded from the imported input, the buffer is set by the caller
+        return HDF_SUCCESS;
+    }
+    IM_STATUS status = GetEncodeFrameFromInput(component, *pFrame, frmBuf, inputData);
     if (status == IM_STATUS_SUCCESS) {
-        mppApi->HdiMppFrameSetBuffer(*pFrame, component->frmBuf);
+        mppApi->HdiMppFrameSetBuffer(*pFrame, frmBuf);
     } else {
-        mppApi->HdiMppFrameDeinit(&pFrame);
-        HDF_LOGE("%{public}s: copy encode input data failed, error code: %{public}d", __func__, ret);
+        mppApi->HdiMppFrameDeinit(pFrame);
+        HDF_LOGE("%{public}s: copy encode input data failed, error code: %{public}d", __func__, status);
         return HDF_FAILURE;
     }
 
     return HDF_SUCCESS;
 }
 
-int32_t HandleEncodedPacket(RKHdiBaseComponent* component, MppPacket packet, RK_U32 pkt_eos, CodecBuffer *outInfo)
+int32_t HandleEncodedPacket(RKHdiBaseComponent* component, MppPacket packet, RK_U32 inPlace, CodecBuffer *outInfo)
 {
     RKMppApi *mppApi = component->mppApi;
     void *ptr   = mppApi->HdiMppPacketGetPos(packet);
     size_t len  = mppApi->HdiMppPacketGetLength(packet);
-    pkt_eos = mppApi->HdiMppPacketGetEos(packet);
+    RK_U32 pkt_eos = mppApi->HdiMppPacketGetEos(packet);
 
     // call back have out data
     UINTPTR userData = (UINTPTR)component->ctx;
     int32_t acquireFd = 1;
     uint8_t *outBuffer = (uint8_t *)outInfo->buffer[0].buf;
     uint32_t outBufferSize = outInfo->buffer[0].capacity;
-    if (outBuffer != NULL && outBufferSize != 0 && ptr != NULL && len != 0) {
+    if (inPlace != 0) {
+        // the packet is written into the output buffer by the encoder
+        outInfo->buffer[0].length = len;
+        component->directOutputs++;
+    } else if (outBuffer != NULL && outBufferSize != 0 && ptr != NULL && len != 0) {
         int32_t ret = memcpy_s(outBuffer, outBufferSize, ptr, len);
         if (ret == EOK) {
             outInfo->buffer[0].length = len;
@@ -951,6 +1540,7 @@ int32_t HandleEncodedPacket(RKHdiBaseComponent* component, MppPacket packet, RK_
             HDF_LOGE("%{public}s: copy output data failed, error code: %{public}d", __func__, ret);
             HDF_LOGE("%{public}s: dst bufferSize:%{public}d, src data len: %{public}d", __func__, outBufferSize, len);
         }
+        component->copyOutputs++;
     } else {
         HDF_LOGE("%{public}s: output data not copy, buffer incorrect!", __func__);
     }
@@ -964,98 +1554,309 @@ int32_t HandleEncodedPacket(RKHdiBaseComponent* component, MppPacket packet, RK_
     return HDF_SUCCESS;
 }
 
-RK_U32 CodecEncodeGetPacketLoop(RKHdiBaseComponent* component, MppCtx ctx, CodecBuffer *outInfo)
+// take the task of the next frame, return NULL when the workers exit
+static RKHdiEncodeTask *TakeEncodeTask(RKHdiBaseComponent* component)
+{
+    RKHdiEncodeTask *task = NULL;
+    pthread_mutex_lock(&component->lock);
+    // the packets are output in the order of the frames, the oldest task is free when it is encoded
+    while ((component->workerExit == 0) && (component->encInFlight >= RK_HDI_ENC_FRAME_BUF_NUM)) {
+        pthread_cond_wait(&component->inputCond, &component->lock);
+    }
+    if (component->workerExit == 0) {
+        task = &component->encTasks[component->encFrameIndex % RK_HDI_ENC_FRAME_BUF_NUM];
+    }
+    pthread_mutex_unlock(&component->lock);
+    return task;
+}
+
+static void FinishEncodeFrame(RKHdiBaseComponent* component, RK_U32 eoi)
+{
+    CodecBuffer *inputData = NULL;
+    pthread_mutex_lock(&component->lock);
+    component->frameCount += eoi;
+    if ((eoi != 0) && (component->encInFlight > 0)) {
+        RKHdiEncodeTask *task = &component->encTasks[component->encDoneIndex % RK_HDI_ENC_FRAME_BUF_NUM];
+        inputData = task->input;
+        task->input = NULL;
+        task->packet = NULL;
+        component->encDoneIndex++;
+        component->encInFlight--;
+    }
+    pthread_cond_broadcast(&component->inputCond);
+    pthread_mutex_unlock(&component->lock);
+    // the imported input is not read by the encoder any more
+    if (inputData != NULL) {
+        ReturnInputBuffer(component, inputData);
+    }
+}
+
+static MPP_RET EncodePutFrameToMpp(RKHdiBaseComponent* component, MppFrame frame)
+{
+    MPP_RET ret = MPP_NOK;
+    while (IsWorkerExit(component) == 0) {
+        ret = component->mpi->encode_put_frame(component->ctx, frame);
+        if ((ret != MPP_ERR_BUFFER_FULL) && (ret != MPP_ERR_TIMEOUT)) {
+            break;
+        }
+        // the encoder is full, wait for the output worker to take a packet
+        WaitWorker(component, &component->inputCond, WORKER_RETRY_TIMEOUT_MS);
+    }
+    return ret;
+}
+
+/*
+ * Put the frame of the input into mpp with the task, return 1 if the input is held by the task until
+ * the frame is encoded.
+ */
+static RK_U32 EncodePutFrame(RKHdiBaseComponent* component, RKHdiEncodeTask *task, CodecBuffer *inputData)
 {
-    MPP_RET ret = MPP_OK;
-    MppApi *mpi = component->mpi;
     RKMppApi *mppApi = component->mppApi;
-    MppPacket packet = component->packet;
-    RK_U32 eoi = 1;
-    RK_U32 pkt_eos = 0;
+    MppFrame frame = NULL;
+    RK_U32 frm_eos = (inputData->flag == STREAM_FLAG_EOS) ? 1 : 0;
+    MppBuffer input = ImportEncodeInput(component, inputData);
+    MppBuffer frmBuf = (input != NULL) ? NULL : component->frmBufs[task - component->encTasks];
 
-    do {
-        ret = mpi->encode_get_packet(ctx, &packet);
-        if (ret != MPP_OK) {
-            HDF_LOGE("%{public}s: mpp encode get packet failed", __func__);
-            return HDF_FAILURE;
+    if (EncodeInitFrame(component, &frame, frm_eos, inputData, frmBuf) != HDF_SUCCESS) {
+        if (input != NULL) {
+            mppApi->HdiMppBufferPutWithCaller(input, __func__);
         }
+        return 0;
+    }
+    if (input != NULL) {
+        // the frame holds the imported buffer until it is encoded
+        mppApi->HdiMppFrameSetBuffer(frame, input);
+        mppApi->HdiMppBufferPutWithCaller(input, __func__);
+    }
 
-        if (packet) {
-            pkt_eos = mppApi->HdiMppPacketGetEos(packet);
-            HandleEncodedPacket(component, packet, pkt_eos, outInfo);
+    pthread_mutex_lock(&component->lock);
+    CodecBuffer *outInfo = PopBufferQueue(&component->outputQueue);
+    pthread_mutex_unlock(&component->lock);
+    MppPacket packet = InitEncodeOutputPacket(component, outInfo);
+    if (packet != NULL) {
+        mppApi->HdiMppMetaSetPacket(mppApi->HdiMppFrameGetMeta(frame), KEY_OUTPUT_PACKET, packet);
+    }
 
-            /* for low delay partition encoding */
-            if (mppApi->HdiMppPacketIsPartition(packet)) {
-                eoi = mppApi->HdiMppPacketIsEoi(packet);
-            }
+    // the task is seen by the output worker once the frame is put
+    pthread_mutex_lock(&component->lock);
+    task->input = (input != NULL) ? inputData : NULL;
+    task->output = outInfo;
+    task->packet = packet;
+    component->encFrameIndex++;
+    component->encInFlight++;
+    pthread_mutex_unlock(&component->lock);
 
-            mppApi->HdiMppPacketDeinit(&packet);
-            component->frameCount += eoi;
+    MPP_RET ret = EncodePutFrameToMpp(component, frame);
+    mppApi->HdiMppFrameDeinit(&frame);
+    if (ret == MPP_OK) {
+        if (input != NULL) {
+            component->directInputs++;
+        } else {
+            component->copyInputs++;
+        }
+        return (input != NULL) ? 1 : 0;
+    }
 
-            if (pkt_eos != 0) {
-                HDF_LOGI("%{public}s: find eos packet", __func__);
-                break;
-            }
+    HDF_LOGE("%{public}s: mpp encode put frame failed, ret:%{public}d", __func__, ret);
+    // no packet is output for the frame, the task is free again
+    pthread_mutex_lock(&component->lock);
+    task->input = NULL;
+    task->output = NULL;
+    task->packet = NULL;
+    component->encFrameIndex--;
+    component->encInFlight--;
+    if ((outInfo != NULL) && (PushBufferQueue(&component->outputQueue, outInfo) == 0)) {
+        free(outInfo);
+    }
+    pthread_mutex_unlock(&component->lock);
+    if (packet != NULL) {
+        mppApi->HdiMppPacketDeinit(&packet);
+    }
+    return 0;
+}
+
+static void *EncodeInputWorker(void *arg)
+{
+    RKHdiBaseComponent* component = (RKHdiBaseComponent *)arg;
+    CodecBuffer *inputData = NULL;
+    while ((inputData = TakeInputBuffer(component)) != NULL) {
+        RKHdiEncodeTask *task = TakeEncodeTask(component);
+        // the copied input is returned at once
+        if ((task == NULL) || (EncodePutFrame(component, task, inputData) == 0)) {
+            ReturnInputBuffer(component, inputData);
         }
-    } while (!eoi);
+    }
+    return NULL;
+}
 
-    return pkt_eos;
+// take the output buffer queued first, return NULL when the workers exit
+static CodecBuffer *TakeOutputBuffer(RKHdiBaseComponent* component)
+{
+    CodecBuffer *buffer = NULL;
+    pthread_mutex_lock(&component->lock);
+    while ((component->workerExit == 0) && (component->outputQueue.count == 0)) {
+        pthread_cond_wait(&component->outputCond, &component->lock);
+    }
+    if (component->workerExit == 0) {
+        buffer = PopBufferQueue(&component->outputQueue);
+        pthread_cond_broadcast(&component->inputCond);
+    }
+    pthread_mutex_unlock(&component->lock);
+    return buffer;
 }
 
-int32_t CodecEncode(CODEC_HANDLETYPE handle, CodecBuffer *inputData, CodecBuffer *outInfo, uint32_t timeoutMs)
+// take the output buffer paired with the frame being encoded, or the one queued first
+static CodecBuffer *TakeEncodeOutput(RKHdiBaseComponent* component, MppPacket packet, RK_U32 *inPlace)
 {
-    MPP_RET ret = MPP_OK;
-    MppFrame frame = NULL;
-    MppCtx ctx = handle;
-    RK_U32 pkt_eos = 0;
-    RK_U32 loop_end = 0;
-    RK_U32 frm_eos = 0;
-    UINTPTR userData = NULL;
-    int32_t acquireFd = 1;
+    CodecBuffer *outInfo = NULL;
+    pthread_mutex_lock(&component->lock);
+    if (component->encInFlight > 0) {
+        RKHdiEncodeTask *task = &component->encTasks[component->encDoneIndex % RK_HDI_ENC_FRAME_BUF_NUM];
+        outInfo = task->output;
+        task->output = NULL;
+        *inPlace = ((outInfo != NULL) && (packet == task->packet)) ? 1 : 0;
+    }
+    pthread_mutex_unlock(&component->lock);
+    return (outInfo != NULL) ? outInfo : TakeOutputBuffer(component);
+}
 
+static void *EncodeOutputWorker(void *arg)
+{
+    RKHdiBaseComponent* component = (RKHdiBaseComponent *)arg;
+    RKMppApi *mppApi = component->mppApi;
+    while (IsWorkerExit(component) == 0) {
+        MppPacket packet = NULL;
+        // wait in mpp for the packet up to the poll timeout
+        MPP_RET ret = component->mpi->encode_get_packet(component->ctx, &packet);
+        if ((ret != MPP_OK) && (ret != MPP_ERR_TIMEOUT)) {
+            HDF_LOGE("%{public}s: mpp encode get packet failed, ret:%{public}d", __func__, ret);
+            WaitWorker(component, &component->outputCond, WORKER_RETRY_TIMEOUT_MS);
+            continue;
+        }
+        if (packet == NULL) {
+            continue;
+        }
+        RK_U32 pkt_eos = mppApi->HdiMppPacketGetEos(packet);
+        /* for low delay partition encoding */
+        RK_U32 eoi = mppApi->HdiMppPacketIsPartition(packet) ? mppApi->HdiMppPacketIsEoi(packet) : 1;
+        RK_U32 inPlace = 0;
+        CodecBuffer *outInfo = TakeEncodeOutput(component, packet, &inPlace);
+        if (outInfo != NULL) {
+            HandleEncodedPacket(component, packet, inPlace, outInfo);
+            free(outInfo);
+        }
+        mppApi->HdiMppPacketDeinit(&packet);
+        FinishEncodeFrame(component, eoi);
+        if (pkt_eos != 0) {
+            HDF_LOGI("%{public}s: find eos packet", __func__);
+        }
+    }
+    return NULL;
+}
+
+int32_t CodecEncode(CODEC_HANDLETYPE handle, CodecBuffer *inputData, CodecBuffer *outInfo, uint32_t timeoutMs)
+{
     if (inputData == NULL || inputData->bufferCnt == 0) {
         HDF_LOGE("%{public}s: inputData param invalid!", __func__);
         return HDF_FAILURE;
     }
-    frm_eos = (inputData->flag == STREAM_FLAG_EOS) ? 1 : 0;
-
+    if (outInfo == NULL || outInfo->bufferCnt == 0) {
+        HDF_LOGE("%{public}s: outInfo param invalid!", __func__);
+        return HDF_FAILURE;
+    }
     RKHdiBaseComponent* component = FindInMppComponentManager(handle);
     if (component == NULL) {
         HDF_LOGE("%{public}s: component is NULL", __func__);
         return HDF_FAILURE;
     }
-    MppApi *mpi = component->mpi;
-    RKMppApi *mppApi = component->mppApi;
 
-    if (EncodeInitFrame(component, &frame, frm_eos, inputData) != HDF_SUCCESS) {
-        return HDF_FAILURE;
-    }
+    // the buffers are returned by the callbacks when the workers are done with them
+    return QueueWorkerBuffers(component, inputData, outInfo, timeoutMs);
+}
 
-    ret = mpi->encode_put_frame(ctx, frame);
-    if (ret != MPP_OK) {
-        HDF_LOGE("%{public}s: mpp encode put frame failed", __func__);
-        mppApi->HdiMppFrameDeinit(&frame);
-        return HDF_FAILURE;
+static int32_t StartWorkers(RKHdiBaseComponent* component)
+{
+    void *(*inputWorker)(void *) = DecodeInputWorker;
+    void *(*outputWorker)(void *) = DecodeOutputWorker;
+    if (component->ctxType == MPP_CTX_ENC) {
+        inputWorker = EncodeInputWorker;
+        outputWorker = EncodeOutputWorker;
     }
-    mppApi->HdiMppFrameDeinit(&frame);
-    pkt_eos = CodecEncodeGetPacketLoop(component, ctx, outInfo);
 
-    userData = (UINTPTR)component->ctx;
-    component->pCallbacks->InputBufferAvailable(userData, inputData, &acquireFd);
-    if (component->frameNum > 0 && component->frameCount >= component->frameNum) {
-        loop_end = 1;
+    pthread_mutex_lock(&component->lock);
+    if (component->workerRunning != 0) {
+        pthread_mutex_unlock(&component->lock);
+        return HDF_SUCCESS;
     }
+    component->workerExit = 0;
+    component->encDoneIndex = component->encFrameIndex;
+    component->encInFlight = 0;
+    pthread_mutex_unlock(&component->lock);
 
-    if (frm_eos != 0 && pkt_eos != 0) {
-        loop_end = 1;
+    if (pthread_create(&component->inputThread, NULL, inputWorker, component) != 0) {
+        HDF_LOGE("%{public}s: create input worker failed", __func__);
+        return HDF_FAILURE;
     }
-
-    if (loop_end != 1) {
+    if (pthread_create(&component->outputThread, NULL, outputWorker, component) != 0) {
+        HDF_LOGE("%{public}s: create output worker failed", __func__);
+        pthread_mutex_lock(&component->lock);
+        component->workerExit = 1;
+        pthread_cond_broadcast(&component->inputCond);
+        pthread_mutex_unlock(&component->lock);
+        pthread_join(component->inputThread, NULL);
         return HDF_FAILURE;
     }
+    pthread_setname_np(component->inputThread, (component->ctxType == MPP_CTX_ENC) ? "hdi_enc_in" : "hdi_dec_in");
+    pthread_setname_np(component->outputThread, (component->ctxType == MPP_CTX_ENC) ? "hdi_enc_out" : "hdi_dec_out");
+
+    pthread_mutex_lock(&component->lock);
+    component->workerRunning = 1;
+    pthread_mutex_unlock(&component->lock);
     return HDF_SUCCESS;
 }
 
+static void StopWorkers(RKHdiBaseComponent* component)
+{
+    pthread_mutex_lock(&component->lock);
+    if (component->workerRunning == 0) {
+        pthread_mutex_unlock(&component->lock);
+        return;
+    }
+    component->workerRunning = 0;
+    component->workerExit = 1;
+    pthread_cond_broadcast(&component->inputCond);
+    pthread_cond_broadcast(&component->outputCond);
+    pthread_mutex_unlock(&component->lock);
+
+    // the workers waiting in mpp return in the poll timeout
+    pthread_join(component->inputThread, NULL);
+    pthread_join(component->outputThread, NULL);
+}
+
+/*
+ * Return the input buffers not taken by the stopped workers to the client, with the inputs held by the
+ * frames not encoded. The outputs of these frames are queued again for the frames after the restart.
+ */
+static void ReturnQueuedInputs(RKHdiBaseComponent* component)
+{
+    CodecBuffer *inputData = NULL;
+    while ((inputData = PopBufferQueue(&component->inputQueue)) != NULL) {
+        ReturnInputBuffer(component, inputData);
+    }
+    for (int32_t i = 0; i < RK_HDI_ENC_FRAME_BUF_NUM; i++) {
+        RKHdiEncodeTask *task = &component->encTasks[i];
+        if (task->input != NULL) {
+            ReturnInputBuffer(component, task->input);
+            task->input = NULL;
+        }
+        if ((task->output != NULL) && (PushBufferQueue(&component->outputQueue, task->output) == 0)) {
+            free(task->output);
+        }
+        task->output = NULL;
+        task->packet = NULL;
+    }
+}
+
 int32_t CodecEncodeHeader(CODEC_HANDLETYPE handle, CodecBuffer outInfo, uint32_t timeoutMs)
 {
     MPP_RET ret = MPP_OK;
@@ -395,11 +395,14 @@ static int32_t GetMppBuffers(RKHdiBaseComponent *pBaseComponent)
         return HDF_FAILURE;
     }
 
-    ret = mppApi->HdiMppBufferGetWithTag(pBaseComponent->frmGrp, &pBaseComponent->frmBuf,
-        pBaseComponent->frameSize + pBaseComponent->headerSize, MODULE_TAG, __func__);
-    if (ret != MPP_OK) {
-        HDF_LOGE("%{public}s: failed to get buffer for input frame ret %{public}d", __func__, ret);
-        return HDF_FAILURE;
+    // the frames being encoded are in the different buffers
+    for (int32_t i = 0; i < RK_HDI_ENC_FRAME_BUF_NUM; i++) {
+        ret = mppApi->HdiMppBufferGetWithTag(pBaseComponent->frmGrp, &pBaseComponent->frmBufs[i],
+            pBaseComponent->frameSize + pBaseComponent->headerSize, MODULE_TAG, __func__);
+        if (ret != MPP_OK) {
+            HDF_LOGE("%{public}s: failed to get buffer for input frame ret %{public}d", __func__, ret);
+            return HDF_FAILURE;
+        }
     }
 
     ret = mppApi->HdiMppBufferGetWithTag(pBaseComponent->frmGrp, &pBaseComponent->pktBuf,
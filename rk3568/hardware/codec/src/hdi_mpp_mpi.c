@@ -84,6 +84,7 @@ RKMppApi *GetConfigApi(RKMppApi *pMppApi)
     pMppApi->HdiMppEncCfgDeinit = (hdiMppEncCfgDeinit)dlsym(mLibHandle, "mpp_enc_cfg_deinit");
     pMppApi->HdiMppEncCfgSetS32 = (hdiMppEncCfgSetS32)dlsym(mLibHandle, "mpp_enc_cfg_set_s32");
     pMppApi->HdiMppEncCfgSetU32 = (hdiMppEncCfgSetU32)dlsym(mLibHandle, "mpp_enc_cfg_set_u32");
+    pMppApi->HdiMppEncCfgSetPtr = (hdiMppEncCfgSetPtr)dlsym(mLibHandle, "mpp_enc_cfg_set_ptr");
     pMppApi->HdiMppEncRefCfgInit = (hdiMppEncRefCfgInit)dlsym(mLibHandle, "mpp_enc_ref_cfg_init");
     pMppApi->HdiMppEncRefCfgDeinit = (hdiMppEncRefCfgDeinit)dlsym(mLibHandle, "mpp_enc_ref_cfg_deinit");
     pMppApi->HdiMppEncGenRefCfg = (hdiMppEncGenRefCfg)dlsym(mLibHandle, "mpi_enc_gen_ref_cfg");
@@ -109,6 +110,8 @@ RKMppApi *GetBufferGroupApi(RKMppApi *pMppApi)
         (hdiMppBufferGetPtrWithCaller)dlsym(mLibHandle, "mpp_buffer_get_ptr_with_caller");
     pMppApi->HdiMppBufferGetSizeWithCaller =
         (hdiMppBufferGetSizeWithCaller)dlsym(mLibHandle, "mpp_buffer_get_size_with_caller");
+    pMppApi->HdiMppBufferGetIndexWithCaller =
+        (hdiMppBufferGetIndexWithCaller)dlsym(mLibHandle, "mpp_buffer_get_index_with_caller");
     pMppApi->HdiMppBufferGroupUsage = (hdiMppBufferGroupUsage)dlsym(mLibHandle, "mpp_buffer_group_usage");
     pMppApi->HdiMppBufferPutWithCaller = (hdiMppBufferPutWithCaller)dlsym(mLibHandle, "mpp_buffer_put_with_caller");
     return pMppApi;
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include "drm_atomic_builder.h"
+#include "fake_libdrm.h"
+#include "hdi_perf_counter.h"
+
+/*
+ * A micro-benchmark of DrmAtomicBuilder and DrmAtomicState on the host. The properties a frame of the composition
+ * sets are built and committed against the fake libdrm, and the heap allocations, the ioctls and the properties
+ * sent to the kernel are counted per frame for the scenes below.
+ * It does not run HdiSession, DrmDisplay or HdiDrmComposition, so the layer preparation, the plane assignment,
+ * the vblank and the fences are not measured. The state drop of a mode set or a hotplug is only a Clear().
+ */
+namespace {
+std::atomic<uint64_t> g_allocCount {0};
+std::atomic<uint64_t> g_allocBytes {0};
+
+void *CountedAlloc(size_t size)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    void *ptr = malloc((size == 0) ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+} // namespace
+
+void *operator new(size_t size)
+{
+    return CountedAlloc(size);
+}
+
+void *operator new[](size_t size)
+{
+    return CountedAlloc(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept
+{
+    (void)size;
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t size) noexcept
+{
+    (void)size;
+    free(ptr);
+}
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+namespace {
+const int FAKE_DRM_FD = 3;
+const uint32_t CRTC_ID = 60;
+const uint32_t CONNECTOR_ID = 70;
+const uint32_t PLANE_ID_BASE = 100;
+const uint32_t PROP_ID_BASE = 1000;
+const uint32_t PLANE_PROP_COUNT = 16;
+const uint32_t FRAMES = 3000;
+const uint32_t MODE_SWITCH_FRAMES = 60;
+const uint32_t FAILED_COMMIT_FRAMES = 100;
+const uint32_t DISPLAY_WIDTH = 1920;
+const uint32_t DISPLAY_HEIGHT = 1080;
+
+enum PlaneProp {
+    PLANE_CRTC_X = 0,
+    PLANE_CRTC_Y,
+    PLANE_CRTC_W,
+    PLANE_CRTC_H,
+    PLANE_SRC_X,
+    PLANE_SRC_Y,
+    PLANE_SRC_W,
+    PLANE_SRC_H,
+    PLANE_ZPOS,
+    PLANE_ROTATION,
+    PLANE_ALPHA,
+    PLANE_FB_ID,
+    PLANE_IN_FENCE_FD,
+    PLANE_CRTC_ID,
+};
+
+struct Scene {
+    const char *name;
+    uint32_t layers;
+    // the layers move every frame, like a scrolling or an animation
+    bool moving;
+    // the cached state is cleared every 60 frames, like a mode set, a dpms change or a hotplug does
+    bool modeSwitch;
+    // a commit fails now and then, the state is kept as it was
+    bool failedCommit;
+};
+
+struct SceneResult {
+    uint64_t allocs = 0;
+    uint64_t allocBytes = 0;
+    uint64_t ioctls = 0;
+    uint64_t props = 0;
+    int64_t cpuNs = 0;
+};
+
+uint32_t GetPlanePropId(uint32_t plane, PlaneProp prop)
+{
+    return PROP_ID_BASE + plane * PLANE_PROP_COUNT + prop;
+}
+
+// the properties HdiDrmComposition::ApplyPlane sets for a layer on a plane, keep it in step with ApplyPlane
+void AddLayer(DrmAtomicBuilder &builder, uint32_t plane, uint32_t frame, bool moving)
+{
+    uint32_t planeId = PLANE_ID_BASE + plane;
+    uint32_t offset = moving ? (frame % DISPLAY_HEIGHT) : 0;
+    uint32_t width = DISPLAY_WIDTH / 2; // 2: the layers are half of the display
+    uint32_t height = DISPLAY_HEIGHT / 2; // 2: the layers are half of the display
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_CRTC_X), plane * 16); // 16: the layers are cascaded
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_CRTC_Y), offset / 2); // 2: half of the offset
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_CRTC_W), width);
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_CRTC_H), height);
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_SRC_X), 0);
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_SRC_Y), static_cast<uint64_t>(offset) << 16); // 16
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_SRC_W), static_cast<uint64_t>(width) << 16); // 16
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_SRC_H), static_cast<uint64_t>(height) << 16); // 16
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_ZPOS), plane);
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_ROTATION), 1);
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_ALPHA), 0xffff); // 0xffff: opaque
+    // three buffers are flipped through by the producer
+    builder.AddVolatileProperty(planeId, GetPlanePropId(plane, PLANE_FB_ID), 200 + (frame % 3)); // 200, 3
+    builder.AddVolatileProperty(planeId, GetPlanePropId(plane, PLANE_IN_FENCE_FD), 10 + plane); // 10: the fds
+    builder.AddProperty(planeId, GetPlanePropId(plane, PLANE_CRTC_ID), CRTC_ID);
+}
+
+SceneResult RunScene(const Scene &scene)
+{
+    auto state = std::make_shared<DrmAtomicState>();
+    FakeDrmStats &drmStats = FakeDrmStats::GetInstance();
+    drmStats.Reset();
+    SceneResult result;
+    for (uint32_t frame = 0; frame < FRAMES; frame++) {
+        if (scene.modeSwitch && ((frame % MODE_SWITCH_FRAMES) == 0)) {
+            state->Clear();
+        }
+        drmStats.failNextCommit = scene.failedCommit && ((frame % FAILED_COMMIT_FRAMES) == 0);
+        uint64_t allocs = g_allocCount.load(std::memory_order_relaxed);
+        uint64_t allocBytes = g_allocBytes.load(std::memory_order_relaxed);
+        int64_t cpuStart = HdiPerfStats::GetThreadCpuNs();
+        {
+            // the composition makes a builder for every frame
+            DrmAtomicBuilder builder(state);
+            builder.AddProperty(CONNECTOR_ID, PROP_ID_BASE - 1, CRTC_ID);
+            builder.AddProperty(CRTC_ID, PROP_ID_BASE - 2, 1); // 2: the ACTIVE of the crtc
+            for (uint32_t plane = 0; plane < scene.layers; plane++) {
+                AddLayer(builder, plane, frame, scene.moving);
+            }
+            builder.AddVolatileProperty(CRTC_ID, PROP_ID_BASE - 3, 0); // 3: the OUT_FENCE_PTR of the crtc
+            (void)builder.Commit(FAKE_DRM_FD, DRM_MODE_ATOMIC_NONBLOCK);
+        }
+        result.cpuNs += HdiPerfStats::GetThreadCpuNs() - cpuStart;
+        result.allocs += g_allocCount.load(std::memory_order_relaxed) - allocs;
+        result.allocBytes += g_allocBytes.load(std::memory_order_relaxed) - allocBytes;
+    }
+    result.ioctls = drmStats.ioctls;
+    result.props = drmStats.commitProps;
+    return result;
+}
+} // namespace
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
+
+int main()
+{
+    using namespace OHOS::HDI::DISPLAY;
+    const Scene scenes[] = {
+        { "static 1 layer", 1, false, false, false },
+        { "static 4 layers", 4, false, false, false },
+        { "static 8 layers", 8, false, false, false },
+        { "moving 4 layers", 4, true, false, false },
+        { "state drop 4 layers", 4, false, true, false },
+        { "failed commit 4 layers", 4, false, false, true },
+    };
+    printf("%-24s %12s %12s %12s %12s %12s\n", "scene", "allocs/frm", "bytes/frm", "ioctls/frm", "props/frm",
+        "cpu ns/frm");
+    for (const auto &scene : scenes) {
+        SceneResult result = RunScene(scene);
+        printf("%-24s %12.2f %12.1f %12.2f %12.2f %12" PRId64 "\n", scene.name,
+            static_cast<double>(result.allocs) / FRAMES, static_cast<double>(result.allocBytes) / FRAMES,
+            static_cast<double>(result.ioctls) / FRAMES, static_cast<double>(result.props) / FRAMES,
+            result.cpuNs / static_cast<int64_t>(FRAMES));
+    }
+    return 0;
+}
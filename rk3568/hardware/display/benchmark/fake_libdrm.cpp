@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fake_libdrm.h"
+#include <cerrno>
+#include <cstdlib>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+/*
+ * The atomic calls of libdrm for the benchmark on the host, the request keeps the properties in a growing array
+ * like libdrm does and the commit only counts them, no ioctl is made.
+ */
+struct _drmModeAtomicReq {
+    uint32_t cursor;
+    uint32_t sizeItems;
+    uint32_t *objIds;
+};
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+FakeDrmStats &FakeDrmStats::GetInstance()
+{
+    static FakeDrmStats instance;
+    return instance;
+}
+
+void FakeDrmStats::Reset()
+{
+    ioctls = 0;
+    commitProps = 0;
+    failNextCommit = false;
+}
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
+
+using OHOS::HDI::DISPLAY::FakeDrmStats;
+
+drmModeAtomicReqPtr drmModeAtomicAlloc(void)
+{
+    return static_cast<drmModeAtomicReqPtr>(calloc(1, sizeof(drmModeAtomicReq)));
+}
+
+void drmModeAtomicFree(drmModeAtomicReqPtr req)
+{
+    if (req == nullptr) {
+        return;
+    }
+    free(req->objIds);
+    free(req);
+}
+
+int drmModeAtomicAddProperty(drmModeAtomicReqPtr req, uint32_t object_id, uint32_t property_id, uint64_t value)
+{
+    (void)property_id;
+    (void)value;
+    if (req == nullptr) {
+        return -EINVAL;
+    }
+    if (req->cursor == req->sizeItems) {
+        // 16: the items libdrm grows the request by
+        uint32_t size = req->sizeItems + 16;
+        auto objIds = static_cast<uint32_t *>(realloc(req->objIds, size * sizeof(uint32_t)));
+        if (objIds == nullptr) {
+            return -ENOMEM;
+        }
+        req->objIds = objIds;
+        req->sizeItems = size;
+    }
+    req->objIds[req->cursor++] = object_id;
+    return static_cast<int>(req->cursor);
+}
+
+int drmModeAtomicCommit(int fd, drmModeAtomicReqPtr req, uint32_t flags, void *user_data)
+{
+    (void)fd;
+    (void)flags;
+    (void)user_data;
+    FakeDrmStats &stats = FakeDrmStats::GetInstance();
+    stats.ioctls++;
+    if (stats.failNextCommit) {
+        stats.failNextCommit = false;
+        return -EINVAL;
+    }
+    stats.commitProps += (req != nullptr) ? req->cursor : 0;
+    return 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_LIBDRM_H
+#define FAKE_LIBDRM_H
+#include <cstdint>
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+// what the fake libdrm saw, the benchmark reads it per frame
+struct FakeDrmStats {
+    static FakeDrmStats &GetInstance();
+    void Reset();
+    uint64_t ioctls = 0;
+    uint64_t commitProps = 0;
+    bool failNextCommit = false;
+};
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
+#endif // FAKE_LIBDRM_H
@@ -17,6 +17,7 @@
 #include <hdf_base.h>
 #include "display_log.h"
 #include "hdf_log.h"
+#include "hdi_damage_tracker.h"
 
 namespace OHOS {
 namespace HDI {
@@ -301,9 +302,17 @@ int32_t DisplayComposerVdiImpl::SetLayerTransformMode(uint32_t devId, uint32_t l
 
 int32_t DisplayComposerVdiImpl::SetLayerDirtyRegion(uint32_t devId, uint32_t layerId, const std::vector<IRect>& rects)
 {
+    if (rects.empty()) {
+        // no dirty information, the whole layer is treated as dirty
+        return HDF_SUCCESS;
+    }
+    IRect region = rects[0];
+    for (auto &rect : rects) {
+        region = UnionRect(region, rect);
+    }
     std::lock_guard<std::mutex> lock(mMutex);
     int32_t ec = HdiSession::GetInstance().CallLayerFunction(devId, layerId, &HdiLayer::SetLayerDirtyRegion,
-        const_cast<IRect*>(rects.data()));
+        &region);
     DISPLAY_CHK_RETURN(ec != DISPLAY_SUCCESS, HDF_FAILURE, DISPLAY_LOGE("failed, ec=%{public}d", ec));
     return HDF_SUCCESS;
 }
@@ -356,8 +365,8 @@ int32_t DisplayComposerVdiImpl::SetLayerColor(uint32_t devId, uint32_t layerId,
 
 int32_t GetDumpInfo(std::string& result)
 {
-    DISPLAY_LOGI("%s is not supported", __func__);
-    return HDF_ERR_NOT_SUPPORT;
+    HdiSession::GetInstance().Dump(result);
+    return HDF_SUCCESS;
 }
 
 int32_t UpdateConfig(std::string& result)
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "drm_atomic_builder.h"
+#include <cerrno>
+#include <cinttypes>
+#include <sstream>
+#include "display_log.h"
+#include "hdi_device_common.h"
+#include "hdi_perf_counter.h"
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+bool DrmAtomicState::IsCommitted(uint32_t objId, uint32_t propId, uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto iter = mValues.find(GetKey(objId, propId));
+    return (iter != mValues.end()) && (iter->second == value);
+}
+
+void DrmAtomicState::Update(const std::vector<DrmAtomicProperty> &props)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto &prop : props) {
+        if (prop.cached) {
+            mValues[GetKey(prop.objId, prop.propId)] = prop.value;
+        } else {
+            // the property is not known after the commit, it is emitted again next time
+            mValues.erase(GetKey(prop.objId, prop.propId));
+        }
+    }
+}
+
+void DrmAtomicState::Clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mValues.clear();
+}
+
+void DrmAtomicState::Dump(std::string &result)
+{
+    std::ostringstream oss;
+    oss << "atomic: commits " << mCommits << " tests " << mTests << " failures " << mFailures << " props emitted " <<
+        mEmitted << " skipped " << mSkipped << "\n";
+    result += oss.str();
+}
+
+void DrmAtomicBuilder::Add(uint32_t objId, uint32_t propId, uint64_t value, bool cached)
+{
+    DISPLAY_CHK_RETURN_NOT_VALUE((propId == 0), DISPLAY_LOGE("the property of object %{public}d is invalid", objId));
+    // the later value of the same property wins
+    for (auto &prop : mPending) {
+        if ((prop.objId == objId) && (prop.propId == propId)) {
+            prop.value = value;
+            prop.cached = cached;
+            return;
+        }
+    }
+    mPending.push_back({ objId, propId, value, cached });
+}
+
+void DrmAtomicBuilder::AddProperty(uint32_t objId, uint32_t propId, uint64_t value)
+{
+    Add(objId, propId, value, true);
+}
+
+void DrmAtomicBuilder::AddVolatileProperty(uint32_t objId, uint32_t propId, uint64_t value)
+{
+    Add(objId, propId, value, false);
+}
+
+int32_t DrmAtomicBuilder::DoCommit(int drmFd, uint32_t flags, void *userData,
+    std::vector<DrmAtomicProperty> &emitted)
+{
+    drmModeAtomicReqPtr pset = drmModeAtomicAlloc();
+    DISPLAY_CHK_RETURN((pset == nullptr), DISPLAY_NULL_PTR,
+        DISPLAY_LOGE("drm atomic alloc failed errno %{public}d", errno));
+    AtomicReqPtr atomicReqPtr = AtomicReqPtr(pset);
+    HdiPerfStats::GetInstance().Count(PERF_ATOMIC_ALLOC);
+    uint64_t skipped = 0;
+    for (auto &prop : mPending) {
+        // the kernel already has the value, the object is not touched by this commit
+        if (prop.cached && mState->IsCommitted(prop.objId, prop.propId, prop.value)) {
+            skipped++;
+            continue;
+        }
+        int ret = drmModeAtomicAddProperty(pset, prop.objId, prop.propId, prop.value);
+        DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE,
+            DISPLAY_LOGE("add the property %{public}d of object %{public}d failed errno %{public}d", prop.propId,
+            prop.objId, errno));
+        emitted.push_back(prop);
+    }
+    DISPLAY_LOGD("commit flags 0x%{public}x emitted %{public}zu skipped %{public}" PRIu64, flags, emitted.size(),
+        skipped);
+    if ((flags & DRM_MODE_ATOMIC_TEST_ONLY) == 0) {
+        mState->mEmitted += emitted.size();
+        mState->mSkipped += skipped;
+    }
+    if (emitted.empty()) {
+        return DISPLAY_SUCCESS;
+    }
+    bool testOnly = (flags & DRM_MODE_ATOMIC_TEST_ONLY) != 0;
+    HdiPerfStats::GetInstance().Count(testOnly ? PERF_ATOMIC_TEST : PERF_ATOMIC_COMMIT);
+    int ret = drmModeAtomicCommit(drmFd, pset, flags, userData);
+    DISPLAY_CHK_RETURN((ret != 0), DISPLAY_FAILURE,
+        DISPLAY_LOGE("drmModeAtomicCommit flags 0x%{public}x failed %{public}d errno %{public}d", flags, ret, errno));
+    return DISPLAY_SUCCESS;
+}
+
+int32_t DrmAtomicBuilder::Test(int drmFd, uint32_t flags)
+{
+    std::vector<DrmAtomicProperty> emitted;
+    // the nonblock flag does not matter for the check
+    flags = (flags | DRM_MODE_ATOMIC_TEST_ONLY) & ~static_cast<uint32_t>(DRM_MODE_ATOMIC_NONBLOCK);
+    mState->mTests++;
+    return DoCommit(drmFd, flags, nullptr, emitted);
+}
+
+int32_t DrmAtomicBuilder::Commit(int drmFd, uint32_t flags, void *userData)
+{
+    std::vector<DrmAtomicProperty> emitted;
+    mState->mCommits++;
+    int32_t ret = DoCommit(drmFd, flags, userData, emitted);
+    if (ret == DISPLAY_SUCCESS) {
+        mState->Update(emitted);
+    } else {
+        // the kernel state is not changed by a failed atomic commit
+        mState->mFailures++;
+    }
+    mPending.clear();
+    return ret;
+}
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DRM_ATOMIC_BUILDER_H
+#define DRM_ATOMIC_BUILDER_H
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+class AtomicReqPtr {
+public:
+    explicit AtomicReqPtr(drmModeAtomicReqPtr ptr) : mPtr(ptr) {}
+    virtual ~AtomicReqPtr()
+    {
+        if (mPtr != nullptr)
+            drmModeAtomicFree(mPtr);
+    }
+    drmModeAtomicReqPtr Get() const
+    {
+        return mPtr;
+    }
+
+private:
+    drmModeAtomicReqPtr mPtr;
+};
+
+struct DrmAtomicProperty {
+    uint32_t objId;
+    uint32_t propId;
+    uint64_t value;
+    // the value is kept by the kernel after the commit, the fences are not
+    bool cached;
+};
+
+/*
+ * The last committed value of every object and property pair of the drm device.
+ * It is shared by all crtcs because a plane can move between them.
+ */
+class DrmAtomicState {
+public:
+    bool IsCommitted(uint32_t objId, uint32_t propId, uint64_t value);
+    void Update(const std::vector<DrmAtomicProperty> &props);
+    void Clear();
+    void Dump(std::string &result);
+
+    std::atomic<uint64_t> mEmitted {0};
+    std::atomic<uint64_t> mSkipped {0};
+    std::atomic<uint64_t> mCommits {0};
+    std::atomic<uint64_t> mTests {0};
+    std::atomic<uint64_t> mFailures {0};
+
+private:
+    static uint64_t GetKey(uint32_t objId, uint32_t propId)
+    {
+        return (static_cast<uint64_t>(objId) << 32) | propId; // 32: the object id is in the high word
+    }
+    std::mutex mMutex;
+    std::unordered_map<uint64_t, uint64_t> mValues;
+};
+
+/*
+ * Collects the properties of one atomic commit and only emits the ones which differ from the
+ * committed state, the committed state is updated after the commit succeeds.
+ */
+class DrmAtomicBuilder {
+public:
+    explicit DrmAtomicBuilder(const std::shared_ptr<DrmAtomicState> &state) : mState(state) {}
+    virtual ~DrmAtomicBuilder() {}
+    void AddProperty(uint32_t objId, uint32_t propId, uint64_t value);
+    // the property is always emitted, such as IN_FENCE_FD, OUT_FENCE_PTR and the FB_ID which may be reused
+    void AddVolatileProperty(uint32_t objId, uint32_t propId, uint64_t value);
+    // check the pending properties with DRM_MODE_ATOMIC_TEST_ONLY, the pending properties are kept
+    int32_t Test(int drmFd, uint32_t flags);
+    // commit the pending properties, the pending properties are cleared
+    int32_t Commit(int drmFd, uint32_t flags, void *userData = nullptr);
+    void Clear()
+    {
+        mPending.clear();
+    }
+    size_t GetPendingCount() const
+    {
+        return mPending.size();
+    }
+
+private:
+    void Add(uint32_t objId, uint32_t propId, uint64_t value, bool cached);
+    int32_t DoCommit(int drmFd, uint32_t flags, void *userData, std::vector<DrmAtomicProperty> &emitted);
+    std::shared_ptr<DrmAtomicState> mState;
+    std::vector<DrmAtomicProperty> mPending;
+};
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
+
+#endif // DRM_ATOMIC_BUILDER_H
@@ -19,8 +19,10 @@
 #include <cinttypes>
 #include <securec.h>
 #include "display_log.h"
+#include "drm_atomic_builder.h"
 #include "drm_device.h"
 #include "drm_vsync_worker.h"
+#include "hdi_perf_counter.h"
 
 namespace OHOS {
 namespace HDI {
@@ -85,6 +87,7 @@ int32_t DrmConnector::Init(DrmDevice &drmDevice)
     DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("can not get mode prop id"));
     mPropDpmsId = prop.propId;
     mDpmsState = prop.value;
+    mAtomicState = drmDevice.GetAtomicState();
     DISPLAY_LOGD("dpms state : %{public}" PRIu64 "", mDpmsState);
     // find the crtcid
     ret = drmDevice.GetConnectorProperty(*this, PROP_CRTCID, prop);
@@ -291,6 +294,7 @@ bool DrmConnector::HandleHotplug(IdMapPtr<DrmEncoder> &encoders,
     drmModeAtomicReq *pset = drmModeAtomicAlloc();
     DISPLAY_CHK_RETURN((pset == nullptr), DISPLAY_NULL_PTR,
         DISPLAY_LOGE("drm atomic alloc failed errno %{public}d", errno));
+    HdiPerfStats::GetInstance().Count(PERF_ATOMIC_ALLOC);
 
     drmModeConnectorPtr c = drmModeGetConnector(drmFd, mId);
     DISPLAY_CHK_RETURN((c == nullptr), false, DISPLAY_LOGE("can not get connector"));
@@ -304,7 +308,8 @@ bool DrmConnector::HandleHotplug(IdMapPtr<DrmEncoder> &encoders,
         }
         DISPLAY_LOGD("get crtc id %{public}d ", crtc_id);
 
-        DrmVsyncWorker::GetInstance().EnableVsync(plugIn);
+        DrmVsyncWorker::GetInstance().EnableVsync(crtc->GetPipe(), plugIn);
+        HdiPerfStats::GetInstance().Count(PERF_BLOB_CREATE);
         drmModeCreatePropertyBlob(drmFd, &c->modes[0],
             sizeof(c->modes[0]), &blob_id);
         ret = drmModeAtomicAddProperty(pset, crtc->GetId(), crtc->GetActivePropId(), (int)plugIn);
@@ -313,6 +318,7 @@ bool DrmConnector::HandleHotplug(IdMapPtr<DrmEncoder> &encoders,
         DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE,
             DISPLAY_LOGE("can not add the crtc id prop %{public}d", errno));
 
+        HdiPerfStats::GetInstance().Count(PERF_ATOMIC_COMMIT);
         ret = drmModeAtomicCommit(drmFd, pset, DRM_MODE_ATOMIC_ALLOW_MODESET, nullptr);
         DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE,
             DISPLAY_LOGE("can not add the crtc id prop %{public}d", errno));
@@ -346,6 +352,10 @@ int32_t DrmConnector::SetDpmsState(uint64_t dmps)
     int ret = drmModeConnectorSetProperty(mDrmFdPtr->GetFd(), mId, mPropDpmsId, dmps);
     DISPLAY_CHK_RETURN((ret != 0), DISPLAY_FAILURE, DISPLAY_LOGE("can not set dpms"));
     mDpmsState = dmps;
+    // the dpms turns the crtc and its planes off and on in the kernel, every property is committed again
+    if (mAtomicState != nullptr) {
+        mAtomicState->Clear();
+    }
     return DISPLAY_SUCCESS;
 }
 
@@ -385,6 +395,7 @@ int32_t DrmModeBlock::Init(DrmMode &mode)
     int drmFd = DrmDevice::GetDrmFd();
     DISPLAY_CHK_RETURN((drmFd < 0), DISPLAY_FAILURE, DISPLAY_LOGE("the drm fd is invalid"));
     drmModeModeInfo modeInfo = *(mode.GetModeInfoPtr());
+    HdiPerfStats::GetInstance().Count(PERF_BLOB_CREATE);
     ret = drmModeCreatePropertyBlob(drmFd, static_cast<void *>(&modeInfo), sizeof(modeInfo), &mBlockId);
     DISPLAY_CHK_RETURN((ret != 0), DISPLAY_FAILURE, DISPLAY_LOGE("create property blob failed"));
     DISPLAY_LOGD("mBlockId %{public}d", mBlockId);
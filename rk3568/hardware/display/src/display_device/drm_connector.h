@@ -15,6 +15,7 @@
 
 #ifndef DRM_CONNECTOR_H
 #define DRM_CONNECTOR_H
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -32,6 +33,7 @@ const std::string PROP_CRTCID = "CRTC_ID";
 const std::string PROP_BRIGHTNESS = "brightness";
 class DrmDevice;
 class DrmModeBlock;
+class DrmAtomicState;
 
 class DrmMode {
 public:
@@ -135,6 +137,8 @@ private:
     int32_t mPreferenceId = INVALID_MODE_ID;
 
     FdPtr mDrmFdPtr;
+    // the committed state of the device, it is not known any more after the dpms is set out of the atomic commit
+    std::shared_ptr<DrmAtomicState> mAtomicState;
 };
 } // namespace OHOS
 } // namespace HDI
@@ -21,6 +21,8 @@
 #include <drm_fourcc.h>
 #include "display_log.h"
 #include "drm_display.h"
+#include "drm_vsync_worker.h"
+#include "hdi_perf_counter.h"
 
 namespace OHOS {
 namespace HDI {
@@ -85,7 +87,8 @@ uint32_t DrmDevice::ConvertToDrmFormat(PixelFormat fmtIn)
     return fmtOut;
 }
 
-DrmDevice::DrmDevice() {}
+DrmDevice::DrmDevice()
+    : mFbCache(std::make_shared<DrmFbCache>()), mAtomicState(std::make_shared<DrmAtomicState>()) {}
 
 int32_t DrmDevice::GetCrtcProperty(const DrmCrtc &crtc, const std::string &name, DrmProperty &prop)
 {
@@ -166,6 +169,16 @@ void DrmDevice::DeInit()
 {
     mDisplays.clear();
     mCrtcs.clear();
+    mFbCache->Clear();
+    mAtomicState->Clear();
+}
+
+void DrmDevice::Dump(std::string &result)
+{
+    mFbCache->Dump(result);
+    mAtomicState->Dump(result);
+    DrmVsyncWorker::GetInstance().Dump(result);
+    HdiPerfStats::GetInstance().Dump(result);
 }
 
 void DrmDevice::FindAllCrtc(const drmModeResPtr &res)
@@ -301,6 +314,8 @@ bool DrmDevice::HandleHotplug(uint32_t dispId, bool plugIn)
             auto connector = connectorPair.second;
             if (connectorId == connector->GetId()) {
                 if (connector->HandleHotplug(mEncoders, mCrtcs, plugIn) == true) {
+                    // the crtc is committed by the connector directly
+                    mAtomicState->Clear();
                     connector->Init(*this);
                     return true;
                 }
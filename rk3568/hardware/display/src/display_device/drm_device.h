@@ -19,9 +19,11 @@
 #include <memory>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
+#include "drm_atomic_builder.h"
 #include "drm_connector.h"
 #include "drm_crtc.h"
 #include "drm_encoder.h"
+#include "drm_fb_cache.h"
 #include "drm_plane.h"
 #include "hdi_device_common.h"
 #include "hdi_device_interface.h"
@@ -77,6 +79,15 @@ public:
     int32_t Init() override;
     void DeInit() override;
     bool HandleHotplug(uint32_t dispId, bool plugIn) override;
+    void Dump(std::string &result) override;
+    std::shared_ptr<DrmFbCache> GetFbCache() const
+    {
+        return mFbCache;
+    }
+    std::shared_ptr<DrmAtomicState> GetAtomicState() const
+    {
+        return mAtomicState;
+    }
 
 private:
     static FdPtr mDrmFd;
@@ -91,6 +102,8 @@ private:
     IdMapPtr<DrmEncoder> mEncoders;
     IdMapPtr<DrmConnector> mConnectors;
     std::vector<std::shared_ptr<DrmPlane>> mPlanes;
+    std::shared_ptr<DrmFbCache> mFbCache;
+    std::shared_ptr<DrmAtomicState> mAtomicState;
     std::unordered_map<uint32_t, uint32_t> dispConnectorIdMaps_;
 };
 } // namespace OHOS
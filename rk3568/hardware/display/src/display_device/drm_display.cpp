@@ -26,6 +26,7 @@
 #include "drm_vsync_worker.h"
 #include "hdi_drm_composition.h"
 #include "hdi_gfx_composition.h"
+#include "hdi_perf_counter.h"
 #include "idisplay_buffer_vdi.h"
 
 namespace OHOS {
@@ -65,6 +66,7 @@ int32_t DrmDisplay::Init()
     ret = postComp->Init();
     DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("can not init HdiDrmComposition"));
     mComposer = std::make_unique<HdiComposer>(std::move(preComp), std::move(postComp));
+    mComposer->SetFrameTrace(&mFrameTrace);
     ret = mCrtc->BindToDisplay(GetId());
     DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("bind crtc failed"));
 
@@ -94,7 +96,10 @@ int32_t DrmDisplay::GetDisplayMode(uint32_t *modeId)
 
 int32_t DrmDisplay::SetDisplayMode(uint32_t modeId)
 {
-    return mCrtc->SetActivieMode(modeId);
+    int32_t ret = mCrtc->SetActivieMode(modeId);
+    // the vsync period may be changed by the new mode
+    DrmVsyncWorker::GetInstance().ResetModel(mCrtc->GetPipe());
+    return ret;
 }
 
 int32_t DrmDisplay::GetDisplayPowerStatus(DispPowerStatus *status)
@@ -136,6 +141,12 @@ int32_t DrmDisplay::SetDisplayPowerStatus(DispPowerStatus status)
         DISPLAY_LOGE("ioctl fb0 failed\n");
         return DISPLAY_FAILURE;
     }
+    // the blank of the fbdev disables the crtc behind the atomic state
+    mDrmDevice->GetAtomicState()->Clear();
+    if (status != POWER_STATUS_ON) {
+        // no commit ages the fb cache while the screen is off, the buffers still on the planes are kept by the layers
+        mDrmDevice->GetFbCache()->Clear();
+    }
 
     return DISPLAY_SUCCESS;
 }
@@ -191,7 +202,7 @@ int32_t DrmDisplay::ConvertToDrmPowerState(DispPowerStatus hdiPowerState, uint32
 std::unique_ptr<HdiLayer> DrmDisplay::CreateHdiLayer(LayerType type)
 {
     DISPLAY_LOGD();
-    return std::make_unique<HdiDrmLayer>(type);
+    return std::make_unique<HdiDrmLayer>(type, mDrmDevice->GetFbCache());
 }
 
 int32_t DrmDisplay::WaitForVBlank(uint64_t *ns)
@@ -205,6 +216,7 @@ int32_t DrmDisplay::WaitForVBlank(uint64_t *ns)
         .request.signal = 0,
     };
     DISPLAY_CHK_RETURN((ns == nullptr), DISPLAY_NULL_PTR, DISPLAY_LOGE("in ns is nullptr"));
+    HdiPerfStats::GetInstance().Count(PERF_VBLANK);
     ret = drmWaitVBlank(mDrmDevice->GetDrmFd(), &vbl);
     DISPLAY_CHK_RETURN((ret != 0), DISPLAY_FAILURE, DISPLAY_LOGE("wait vblank failed errno %{public}d", errno));
     *ns = static_cast<uint64_t>(vbl.reply.tval_sec * nPerS + vbl.reply.tval_usec * nPerUS);
@@ -271,7 +283,7 @@ int32_t DrmDisplay::RegDisplayVBlankCallback(VBlankCallback cb, void *data)
 int32_t DrmDisplay::SetDisplayVsyncEnabled(bool enabled)
 {
     DISPLAY_LOGD("enable %{public}d", enabled);
-    DrmVsyncWorker::GetInstance().EnableVsync(enabled);
+    DrmVsyncWorker::GetInstance().EnableVsync(mCrtc->GetPipe(), enabled);
     return DISPLAY_SUCCESS;
 }
 
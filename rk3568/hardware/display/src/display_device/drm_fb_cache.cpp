@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "drm_fb_cache.h"
+#include <cerrno>
+#include <cinttypes>
+#include <sstream>
+#include <sys/stat.h>
+#include "display_log.h"
+#include "hdi_drm_layer.h"
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+bool DrmFbCache::GetKey(const HdiLayerBuffer &hdl, DrmFbKey &key)
+{
+    struct stat st;
+    DISPLAY_CHK_RETURN((hdl.GetFb() < 0), false, DISPLAY_LOGE("the buffer fd is invalid"));
+    DISPLAY_CHK_RETURN((fstat(hdl.GetFb(), &st) != 0), false,
+        DISPLAY_LOGE("can not stat fd %{public}d errno %{public}d", hdl.GetFb(), errno));
+    key.dev = st.st_dev;
+    key.ino = st.st_ino;
+    key.format = hdl.GetFormat();
+    key.stride = hdl.GetStride();
+    key.width = hdl.GetWight();
+    key.height = hdl.GetHeight();
+    return true;
+}
+
+std::shared_ptr<DrmGemBuffer> DrmFbCache::GetGemBuffer(int drmFd, HdiLayerBuffer &hdl)
+{
+    DrmFbKey key;
+    if (!GetKey(hdl, key)) {
+        // can not identify the buffer, import it without caching
+        mMisses++;
+        return std::make_shared<DrmGemBuffer>(drmFd, hdl);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end()) {
+        mLruList.splice(mLruList.begin(), mLruList, iter->second);
+        mHits++;
+        return iter->second->buffer;
+    }
+
+    mMisses++;
+    std::shared_ptr<DrmGemBuffer> buffer = std::make_shared<DrmGemBuffer>(drmFd, hdl);
+    if (!buffer->IsValid()) {
+        DISPLAY_LOGE("import the buffer ino %{public}" PRIu64 " failed", static_cast<uint64_t>(key.ino));
+        return buffer;
+    }
+    mLruList.push_front(Entry { key, buffer });
+    mEntries.emplace(key, mLruList.begin());
+    EvictLocked();
+    DISPLAY_LOGD("fb cache add ino %{public}" PRIu64 " fbId %{public}d entries %{public}zu",
+        static_cast<uint64_t>(key.ino), buffer->GetFbId(), mEntries.size());
+    return buffer;
+}
+
+void DrmFbCache::EvictLocked()
+{
+    while (mLruList.size() > mCapacity) {
+        auto &entry = mLruList.back();
+        DISPLAY_LOGD("fb cache evict fbId %{public}d", entry.buffer->GetFbId());
+        mEntries.erase(entry.key);
+        mLruList.pop_back();
+        mEvictions++;
+    }
+}
+
+void DrmFbCache::ReleaseUnusedLocked()
+{
+    for (auto iter = mLruList.begin(); iter != mLruList.end();) {
+        // only the cache keeps the buffer, no layer presents it any more
+        if (iter->buffer.use_count() == 1) {
+            DISPLAY_LOGD("fb cache release fbId %{public}d", iter->buffer->GetFbId());
+            mEntries.erase(iter->key);
+            iter = mLruList.erase(iter);
+            mInvalidations++;
+        } else {
+            iter++;
+        }
+    }
+}
+
+void DrmFbCache::ReleaseUnused()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    ReleaseUnusedLocked();
+}
+
+void DrmFbCache::AdvanceFrame()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    // the layers of the frame have taken their buffers, the ones they dropped are released here
+    ReleaseUnusedLocked();
+}
+
+void DrmFbCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mLruList.clear();
+}
+
+DrmFbCacheStats DrmFbCache::GetStats()
+{
+    DrmFbCacheStats stats;
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+    stats.invalidations = mInvalidations;
+    std::lock_guard<std::mutex> lock(mMutex);
+    stats.entries = static_cast<uint32_t>(mEntries.size());
+    return stats;
+}
+
+void DrmFbCache::Dump(std::string &result)
+{
+    DrmFbCacheStats stats = GetStats();
+    std::ostringstream oss;
+    oss << "fb cache: entries " << stats.entries << "/" << mCapacity << " hits " << stats.hits << " misses " <<
+        stats.misses << " evictions " << stats.evictions << " invalidations " << stats.invalidations << "\n";
+    result += oss.str();
+}
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
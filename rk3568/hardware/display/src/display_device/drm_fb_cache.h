@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DRM_FB_CACHE_H
+#define DRM_FB_CACHE_H
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+#include "hdi_layer.h"
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+class DrmGemBuffer;
+
+const uint32_t FB_CACHE_MAX_ENTRIES = 32;
+/*
+ * The buffer a layer has not presented again for this many buffer changes is treated as freed by the producer,
+ * it is more than the buffers of a queue. The entry is dropped once no layer keeps its buffer.
+ */
+const uint64_t FB_CACHE_LAYER_BUFFERS = 8;
+
+struct DrmFbKey {
+    dev_t dev = 0;
+    ino_t ino = 0;
+    int32_t format = 0;
+    int32_t stride = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    bool operator == (const DrmFbKey &right) const
+    {
+        return (dev == right.dev) && (ino == right.ino) && (format == right.format) && (stride == right.stride) &&
+            (width == right.width) && (height == right.height);
+    }
+};
+
+struct DrmFbKeyHash {
+    size_t operator () (const DrmFbKey &key) const
+    {
+        size_t hash = std::hash<uint64_t>()(static_cast<uint64_t>(key.ino));
+        hash ^= std::hash<uint64_t>()(static_cast<uint64_t>(key.dev)) + (hash << 6) + (hash >> 2); // 6, 2: hash mix
+        hash ^= std::hash<int64_t>()((static_cast<int64_t>(key.format) << 32) | static_cast<uint32_t>(key.stride)) +
+            (hash << 6) + (hash >> 2); // 32: high word, 6, 2: hash mix
+        hash ^= std::hash<int64_t>()((static_cast<int64_t>(key.width) << 32) | static_cast<uint32_t>(key.height)) +
+            (hash << 6) + (hash >> 2); // 32: high word, 6, 2: hash mix
+        return hash;
+    }
+};
+
+struct DrmFbCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+    uint32_t entries = 0;
+};
+
+/*
+ * Cache of the framebuffers imported into the drm device, keyed by the dma-buf identity.
+ * The imported gem handle holds a reference of the dma-buf, so the inode can not be reused
+ * while the entry is alive. The producer frees its buffers without telling the composer, so an entry
+ * lives as long as a layer keeps its buffer, see HdiDrmLayer.
+ */
+class DrmFbCache {
+public:
+    explicit DrmFbCache(uint32_t capacity = FB_CACHE_MAX_ENTRIES) : mCapacity(capacity) {}
+    virtual ~DrmFbCache() {}
+    std::shared_ptr<DrmGemBuffer> GetGemBuffer(int drmFd, HdiLayerBuffer &hdl);
+    // drop the entries whose buffers are not kept by any layer
+    void ReleaseUnused();
+    void AdvanceFrame();
+    void Clear();
+    DrmFbCacheStats GetStats();
+    void Dump(std::string &result);
+
+private:
+    struct Entry {
+        DrmFbKey key;
+        std::shared_ptr<DrmGemBuffer> buffer;
+    };
+    static bool GetKey(const HdiLayerBuffer &hdl, DrmFbKey &key);
+    void EvictLocked();
+    void ReleaseUnusedLocked();
+
+    uint32_t mCapacity;
+    std::mutex mMutex;
+    // the front of the list is the most recently used entry
+    std::list<Entry> mLruList;
+    std::unordered_map<DrmFbKey, std::list<Entry>::iterator, DrmFbKeyHash> mEntries;
+    std::atomic<uint64_t> mHits {0};
+    std::atomic<uint64_t> mMisses {0};
+    std::atomic<uint64_t> mEvictions {0};
+    std::atomic<uint64_t> mInvalidations {0};
+};
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
+
+#endif // DRM_FB_CACHE_H
@@ -14,6 +14,8 @@
  */
 
 #include "drm_plane.h"
+#include <algorithm>
+#include <cinttypes>
 #include "drm_device.h"
 
 namespace OHOS {
@@ -143,6 +145,11 @@ int32_t DrmPlane::Init(DrmDevice &drmDevice)
     ret = drmDevice.GetPlaneProperty(*this, PROP_ZPOS_ID, prop);
     DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("cat not get pane crtc prop id"));
     mPropZposId = prop.propId;
+    if (prop.values.size() >= 2) { // 2: the range property has min and max
+        mZposMin = prop.values[0];
+        mZposMax = prop.values[1];
+    }
+    InitFeatures(drmDevice);
 
     ret = drmDevice.GetPlaneProperty(*this, "NAME", prop);
     DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("cat not get pane crtc prop id"));
@@ -180,6 +187,49 @@ int32_t DrmPlane::Init(DrmDevice &drmDevice)
     }
     return DISPLAY_SUCCESS;
 }
+void DrmPlane::InitFeatures(DrmDevice &drmDevice)
+{
+    DrmProperty rotationProp;
+    if (drmDevice.GetPlaneProperty(*this, PROP_ROTATION, rotationProp) == DISPLAY_SUCCESS) {
+        mPropRotationId = rotationProp.propId;
+        mSupportedRotations = 0;
+        // the enum value of the bitmask property is the bit index
+        for (auto &drmEnum : rotationProp.enums) {
+            mSupportedRotations |= (1ULL << drmEnum.value);
+        }
+    }
+
+    DrmProperty featureProp;
+    if (drmDevice.GetPlaneProperty(*this, PROP_FEATURE, featureProp) == DISPLAY_SUCCESS) {
+        for (auto &drmEnum : featureProp.enums) {
+            if ((featureProp.value & (1ULL << drmEnum.value)) == 0) {
+                continue;
+            }
+            if (drmEnum.name == FEATURE_SCALE) {
+                mCanScale = true;
+            } else if (drmEnum.name == FEATURE_ALPHA) {
+                mHasAlpha = true;
+            }
+        }
+    }
+    // the standard alpha property is 16 bits, the GLOBAL_ALPHA of the older vop is 8 bits
+    DrmProperty alphaProp;
+    if ((drmDevice.GetPlaneProperty(*this, PROP_ALPHA, alphaProp) == DISPLAY_SUCCESS) ||
+        (drmDevice.GetPlaneProperty(*this, PROP_GLOBAL_ALPHA, alphaProp) == DISPLAY_SUCCESS)) {
+        if ((alphaProp.values.size() >= 2) && (alphaProp.values[1] > 0)) { // 2: the range property has min and max
+            mPropAlphaId = alphaProp.propId;
+            mAlphaMax = alphaProp.values[1];
+        }
+    }
+    DISPLAY_LOGI("plane %{public}d rotations 0x%{public}" PRIx64 " scale %{public}d alpha %{public}d zpos "
+        "%{public}" PRIu64 "-%{public}" PRIu64 "", GetId(), mSupportedRotations, mCanScale, HasAlpha(),
+        mZposMin, mZposMax);
+}
+
+bool DrmPlane::IsFormatSupported(uint32_t format) const
+{
+    return std::find(mFormats.begin(), mFormats.end(), format) != mFormats.end();
+}
 } // namespace OHOS
 } // namespace HDI
 } // namespace DISPLAY
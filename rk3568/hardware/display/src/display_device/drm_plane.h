@@ -96,6 +96,12 @@ const std::string PROP_SRC_W_ID = "SRC_W";
 const std::string PROP_SRC_H_ID = "SRC_H";
 
 const std::string PROP_ZPOS_ID = "zpos";
+const std::string PROP_ROTATION = "rotation";
+const std::string PROP_FEATURE = "FEATURE";
+const std::string FEATURE_SCALE = "scale";
+const std::string FEATURE_ALPHA = "alpha";
+const std::string PROP_ALPHA = "alpha";
+const std::string PROP_GLOBAL_ALPHA = "GLOBAL_ALPHA";
 
 class DrmDevice;
 
@@ -158,6 +164,42 @@ public:
     {
         return mPropCrtcId;
     }
+    uint32_t GetPropRotationId() const
+    {
+        return mPropRotationId;
+    }
+    // the supported DRM_MODE_ROTATE_* and DRM_MODE_REFLECT_* bits
+    uint64_t GetSupportedRotations() const
+    {
+        return mSupportedRotations;
+    }
+    bool CanScale() const
+    {
+        return mCanScale;
+    }
+    // the plane blends with the global alpha only when the alpha property can be set
+    bool HasAlpha() const
+    {
+        return mHasAlpha && (mPropAlphaId != 0);
+    }
+    uint32_t GetPropAlphaId() const
+    {
+        return mPropAlphaId;
+    }
+    // the value of the alpha property for an opaque plane
+    uint64_t GetAlphaMax() const
+    {
+        return mAlphaMax;
+    }
+    uint64_t GetZposMin() const
+    {
+        return mZposMin;
+    }
+    uint64_t GetZposMax() const
+    {
+        return mZposMax;
+    }
+    bool IsFormatSupported(uint32_t format) const;
     uint32_t GetPossibleCrtcs() const
     {
         return mPossibleCrtcs;
@@ -195,6 +237,7 @@ public:
         return mName;
     }
 private:
+    void InitFeatures(DrmDevice &drmDevice);
     uint32_t mId = 0;
     uint32_t mPossibleCrtcs = 0;
     uint32_t mCrtcId = 0;
@@ -215,6 +258,15 @@ private:
     uint32_t mPropSrc_hId = 0;
 
     uint32_t mPropZposId = 0;
+    uint64_t mZposMin = 0;
+    uint64_t mZposMax = 0;
+
+    uint32_t mPropRotationId = 0;
+    uint64_t mSupportedRotations = DRM_MODE_ROTATE_0;
+    bool mCanScale = false;
+    bool mHasAlpha = false;
+    uint32_t mPropAlphaId = 0;
+    uint64_t mAlphaMax = 0;
 
     uint32_t mPipe = 0;
     uint32_t mType = 0;
@@ -14,13 +14,101 @@
  */
 
 #include "drm_vsync_worker.h"
-#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <climits>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <poll.h>
+#include <sstream>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include "display_log.h"
 #include "drm_device.h"
+#include "hdi_perf_counter.h"
+#include "hdi_display.h"
 
 namespace OHOS {
 namespace HDI {
 namespace DISPLAY {
+constexpr int64_t SEC_TO_NSEC = 1000 * 1000 * 1000;
+constexpr int64_t USEC_TO_NSEC = 1000;
+constexpr int64_t MSEC_TO_NSEC = 1000 * 1000;
+const char *VBLANK_OFFDELAY_PATH = "/sys/module/drm/parameters/vblank_offdelay";
+// the worker handling the drm events on this thread, the vblank handler has no other context
+thread_local DrmVsyncWorker *g_handlingWorker = nullptr;
+
+void DrmVsyncModel::AddSample(uint64_t sequence, int64_t ns)
+{
+    if (!mSamples.empty() && (sequence <= mSamples.back().first)) {
+        // the sequence goes back after the crtc is reset
+        mSamples.clear();
+    }
+    mSamples.emplace_back(sequence, ns);
+    if (mSamples.size() > VSYNC_MODEL_MAX_SAMPLES) {
+        mSamples.pop_front();
+    }
+    Fit();
+}
+
+void DrmVsyncModel::Reset()
+{
+    mSamples.clear();
+    mValid = false;
+}
+
+void DrmVsyncModel::Fit()
+{
+    mValid = false;
+    if (mSamples.size() < VSYNC_MODEL_MIN_SAMPLES) {
+        return;
+    }
+    // use the values relative to the first sample to keep the precision
+    uint64_t baseSequence = mSamples.front().first;
+    int64_t baseNs = mSamples.front().second;
+    double n = static_cast<double>(mSamples.size());
+    double sumX = 0;
+    double sumY = 0;
+    double sumXX = 0;
+    double sumXY = 0;
+    for (auto &sample : mSamples) {
+        double x = static_cast<double>(sample.first - baseSequence);
+        double y = static_cast<double>(sample.second - baseNs);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+    double denominator = n * sumXX - sumX * sumX;
+    if (denominator <= 0) {
+        return;
+    }
+    double period = (n * sumXY - sumX * sumY) / denominator;
+    double intercept = (sumY - period * sumX) / n;
+    int64_t error = 0;
+    for (auto &sample : mSamples) {
+        double x = static_cast<double>(sample.first - baseSequence);
+        double y = static_cast<double>(sample.second - baseNs);
+        error = std::max(error, static_cast<int64_t>(std::fabs(y - (intercept + period * x))));
+    }
+    mPeriod = static_cast<int64_t>(period);
+    mRefSequence = baseSequence;
+    mRefNs = baseNs + static_cast<int64_t>(intercept);
+    mError = error;
+    mValid = (mPeriod >= VSYNC_MIN_PERIOD_NS) && (mPeriod <= VSYNC_MAX_PERIOD_NS) &&
+        (mError <= VSYNC_MODEL_MAX_ERROR_NS);
+}
+
+void DrmVsyncModel::PredictNext(int64_t ns, uint64_t &sequence, int64_t &vsyncNs) const
+{
+    int64_t count = (ns - mRefNs) / mPeriod + 1;
+    count = (count < 1) ? 1 : count;
+    sequence = mRefSequence + static_cast<uint64_t>(count);
+    vsyncNs = mRefNs + count * mPeriod;
+}
+
 DrmVsyncWorker::DrmVsyncWorker() {}
 
 int32_t DrmVsyncWorker::Init(int fd)
@@ -28,9 +116,18 @@ int32_t DrmVsyncWorker::Init(int fd)
     DISPLAY_CHK_RETURN((fd < 0), DISPLAY_FAILURE, DISPLAY_LOGE("the fd is invalid"));
     mDrmFd = fd;
     DISPLAY_LOGD("the drm fd is %{public}d", fd);
+    mEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    DISPLAY_CHK_RETURN((mEventFd < 0), DISPLAY_FAILURE, DISPLAY_LOGE("can not create eventfd errno %{public}d", errno));
+    mVblankOffdelayMs = GetVblankOffdelayMs();
+    // 0: the kernel never turns the vblank irq off, the predicted vsync would save nothing
+    mSoftwareVsync = (access("/data/hdi_hw_vsync", F_OK) == -1) && (mVblankOffdelayMs != 0);
+    mResyncNs = std::max(VSYNC_RESYNC_MIN_NS,
+        std::max<int64_t>(mVblankOffdelayMs, 0) * MSEC_TO_NSEC * VSYNC_RESYNC_OFFDELAY_TIMES);
+    DISPLAY_LOGI("vblank offdelay %{public}" PRId64 "ms resync %{public}" PRId64 "ns software vsync %{public}d",
+        mVblankOffdelayMs, mResyncNs, mSoftwareVsync);
+    mRunning = true;
     mThread = std::make_unique<std::thread>([this]() { WorkThread(); });
     DISPLAY_CHK_RETURN((mThread == nullptr), DISPLAY_FAILURE, DISPLAY_LOGE("can not create thread"));
-    mRunning = true;
     return DISPLAY_SUCCESS;
 }
 
@@ -54,75 +151,251 @@ DrmVsyncWorker::~DrmVsyncWorker()
         std::lock_guard<std::mutex> lg(mMutex);
         mRunning = false;
     }
-    DISPLAY_LOGD();
-    mCondition.notify_one();
+    Wakeup();
     if (mThread != nullptr) {
         mThread->join();
     }
+    if (mEventFd >= 0) {
+        close(mEventFd);
+    }
     DISPLAY_LOGD();
 }
 
-bool DrmVsyncWorker::WaitSignalAndCheckRuning()
+int64_t DrmVsyncWorker::GetNowNs()
 {
-    std::unique_lock<std::mutex> ul(mMutex);
-    mCondition.wait(ul, [this]() { return (mEnable || !mRunning); });
-    return mRunning;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * SEC_TO_NSEC + ts.tv_nsec;
 }
 
+int64_t DrmVsyncWorker::GetVblankOffdelayMs()
+{
+    std::ifstream file(VBLANK_OFFDELAY_PATH);
+    int64_t offdelay = VSYNC_DEFAULT_OFFDELAY_MS;
+    if (!(file >> offdelay)) {
+        DISPLAY_LOGW("can not read %{public}s, use the default", VBLANK_OFFDELAY_PATH);
+        return VSYNC_DEFAULT_OFFDELAY_MS;
+    }
+    return offdelay;
+}
 
-uint64_t DrmVsyncWorker::WaitNextVBlank(unsigned int &sq)
+void DrmVsyncWorker::Wakeup()
+{
+    uint64_t value = 1;
+    if ((mEventFd >= 0) && (write(mEventFd, &value, sizeof(value)) < 0)) {
+        DISPLAY_LOGE("wakeup the vsync worker failed errno %{public}d", errno);
+    }
+}
+
+void DrmVsyncWorker::RequestEventLocked(uint32_t pipe, PipeState &state)
 {
-    constexpr uint64_t SEC_TO_NSEC = 1000 * 1000 * 1000;
-    constexpr uint64_t USEC_TO_NSEC = 1000;
     drmVBlank vblank = {
         .request =
             drmVBlankReq {
-                .type = DRM_VBLANK_RELATIVE,
+                .type = static_cast<drmVBlankSeqType>(DRM_VBLANK_RELATIVE | DRM_VBLANK_EVENT),
                 .sequence = 1,
-                .signal = 0,
+                .signal = static_cast<unsigned long>(pipe),
             }
     };
     /* The drmWaitVBlank need set the crtc pipe when there are multi crtcs in the system. */
-    if (mCallBack->GetPipe() == 1)
+    if (pipe == 1) {
         vblank.request.type = drmVBlankSeqType((int)(vblank.request.type) | (int)DRM_VBLANK_SECONDARY);
+    } else if (pipe > 1) {
+        vblank.request.type = drmVBlankSeqType((int)(vblank.request.type) |
+            (int)((pipe << DRM_VBLANK_HIGH_CRTC_SHIFT) & DRM_VBLANK_HIGH_CRTC_MASK));
+    }
+    HdiPerfStats::GetInstance().Count(PERF_VBLANK);
     int ret = drmWaitVBlank(mDrmFd, &vblank);
-    DISPLAY_CHK_RETURN((ret < 0), 0,
-        DISPLAY_LOGE("wait vblank failed ret :　%{public}d　errno %{public}d", ret, errno));
-    sq = vblank.reply.sequence;
-    return (uint64_t)(vblank.reply.tval_sec * SEC_TO_NSEC + vblank.reply.tval_usec * USEC_TO_NSEC);
+    DISPLAY_CHK_RETURN_NOT_VALUE((ret < 0),
+        DISPLAY_LOGE("request vblank of pipe %{public}u failed errno %{public}d", pipe, errno));
+    state.eventPending = true;
 }
 
+void DrmVsyncWorker::VBlankHandler(int fd, unsigned int sequence, unsigned int tvSec, unsigned int tvUsec,
+    void *data)
+{
+    (void)fd;
+    DrmVsyncWorker *worker = g_handlingWorker;
+    DISPLAY_CHK_RETURN_NOT_VALUE((worker == nullptr), DISPLAY_LOGE("no worker handles the event"));
+    // the user data of the vblank event is the pipe of the crtc
+    uint32_t pipe = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(data));
+    int64_t ns = static_cast<int64_t>(tvSec) * SEC_TO_NSEC + static_cast<int64_t>(tvUsec) * USEC_TO_NSEC;
+    worker->OnVBlank(pipe, sequence, ns, worker->mEvents);
+}
 
-void DrmVsyncWorker::EnableVsync(bool enable)
+void DrmVsyncWorker::OnVBlank(uint32_t pipe, unsigned int sequence, int64_t ns, std::vector<VsyncEvent> &events)
 {
-    DISPLAY_LOGD();
-    {
-        std::lock_guard<std::mutex> lg(mMutex);
-        mEnable = enable;
+    auto iter = mPipes.find(pipe);
+    DISPLAY_CHK_RETURN_NOT_VALUE((iter == mPipes.end()), DISPLAY_LOGE("no vsync state of pipe %{public}u", pipe));
+    PipeState &state = iter->second;
+    state.eventPending = false;
+    state.model.AddSample(sequence, ns);
+    if (!state.enable) {
+        // do not request the next event, so the vblank irq can be turned off
+        return;
+    }
+    state.hardwareEvents++;
+    if (state.callBack != nullptr) {
+        events.push_back({ state.callBack, { sequence, static_cast<uint64_t>(ns) } });
+    }
+    if (mSoftwareVsync && state.model.IsValid()) {
+        DISPLAY_LOGD("pipe %{public}u use the software vsync period %{public}" PRId64, pipe,
+            state.model.GetPeriod());
+        state.software = true;
+        state.softwareStartNs = ns;
+        state.model.PredictNext(ns, state.nextSequence, state.nextNs);
     }
-    mCondition.notify_one();
+}
+
+void DrmVsyncWorker::ProcessLocked(int64_t nowNs, std::vector<VsyncEvent> &events)
+{
+    for (auto &iter : mPipes) {
+        PipeState &state = iter.second;
+        if (!state.enable) {
+            state.software = false;
+            continue;
+        }
+        if (state.software && (nowNs >= state.nextNs)) {
+            state.softwareEvents++;
+            if (state.callBack != nullptr) {
+                events.push_back({ state.callBack, { static_cast<unsigned int>(state.nextSequence),
+                    static_cast<uint64_t>(state.nextNs) } });
+            }
+            state.model.PredictNext(state.nextNs, state.nextSequence, state.nextNs);
+            if (state.nextNs - state.softwareStartNs >= mResyncNs) {
+                // check the model with the hardware timestamps again
+                state.software = false;
+            }
+        }
+        if (!state.software && !state.eventPending) {
+            RequestEventLocked(iter.first, state);
+        }
+    }
+}
+
+int64_t DrmVsyncWorker::GetTimeoutLocked(int64_t nowNs)
+{
+    int64_t timeout = -1;
+    for (auto &iter : mPipes) {
+        PipeState &state = iter.second;
+        if (!state.enable || !state.software) {
+            continue;
+        }
+        int64_t wait = std::max<int64_t>(state.nextNs - nowNs, 0);
+        timeout = (timeout < 0) ? wait : std::min(timeout, wait);
+    }
+    return timeout;
 }
 
 void DrmVsyncWorker::WorkThread()
 {
     DISPLAY_LOGD();
-    unsigned int seq = 0;
-    while (WaitSignalAndCheckRuning()) {
-        // wait the vblank
-        uint64_t time = WaitNextVBlank(seq);
-        if (mCallBack != nullptr) {
-            mCallBack->Vsync(seq, time);
-        } else {
-            DISPLAY_LOGE("the callbac is nullptr");
+    struct pollfd fds[] = {
+        { .fd = mDrmFd, .events = POLLIN, .revents = 0 },
+        { .fd = mEventFd, .events = POLLIN, .revents = 0 },
+    };
+    g_handlingWorker = this;
+    while (true) {
+        int64_t timeout;
+        {
+            std::lock_guard<std::mutex> lg(mMutex);
+            if (!mRunning) {
+                break;
+            }
+            timeout = GetTimeoutLocked(GetNowNs());
+        }
+        struct timespec ts = { timeout / SEC_TO_NSEC, timeout % SEC_TO_NSEC };
+        int ret = ppoll(fds, sizeof(fds) / sizeof(fds[0]), (timeout < 0) ? nullptr : &ts, nullptr);
+        if ((ret < 0) && (errno != EINTR)) {
+            DISPLAY_LOGE("poll the vsync failed errno %{public}d", errno);
+            continue;
+        }
+        if ((fds[1].revents & POLLIN) != 0) {
+            uint64_t value;
+            (void)read(mEventFd, &value, sizeof(value));
+        }
+
+        mEvents.clear();
+        {
+            std::lock_guard<std::mutex> lg(mMutex);
+            if ((fds[0].revents & POLLIN) != 0) {
+                drmEventContext evctx = {};
+                evctx.version = 2; // 2: the version with vblank_handler
+                evctx.vblank_handler = VBlankHandler;
+                drmHandleEvent(mDrmFd, &evctx);
+            }
+            ProcessLocked(GetNowNs(), mEvents);
+        }
+        // call back outside the lock, the callback may enable or disable the vsync
+        for (auto &event : mEvents) {
+            event.first->Vsync(event.second.first, event.second.second);
         }
     }
 }
 
+void DrmVsyncWorker::EnableVsync(uint32_t pipe, bool enable)
+{
+    DISPLAY_LOGD("pipe %{public}u enable %{public}d", pipe, enable);
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        PipeState &state = mPipes[pipe];
+        if (enable && !state.enable) {
+            // the phase may drift while the vsync is disabled, fit it again
+            state.model.Reset();
+            state.software = false;
+        }
+        state.enable = enable;
+    }
+    Wakeup();
+}
+
 void DrmVsyncWorker::ReqesterVBlankCb(std::shared_ptr<VsyncCallBack> &cb)
 {
     DISPLAY_LOGD();
     DISPLAY_CHK_RETURN_NOT_VALUE((cb == nullptr), DISPLAY_LOGE("the VBlankCallback is nullptr "));
-    mCallBack = cb;
+    std::lock_guard<std::mutex> lg(mMutex);
+    mPipes[cb->GetPipe()].callBack = cb;
+}
+
+void DrmVsyncWorker::ResetModel(uint32_t pipe)
+{
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        auto iter = mPipes.find(pipe);
+        if (iter == mPipes.end()) {
+            return;
+        }
+        iter->second.model.Reset();
+        iter->second.software = false;
+    }
+    Wakeup();
+}
+
+void DrmVsyncWorker::Dump(std::string &result)
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    std::ostringstream oss;
+    for (auto &iter : mPipes) {
+        PipeState &state = iter.second;
+        oss << "vsync pipe " << iter.first << ": enable " << state.enable << " software " << state.software <<
+            " period " << (state.model.IsValid() ? state.model.GetPeriod() : 0) << "ns hardware events " <<
+            state.hardwareEvents << " software events " << state.softwareEvents << "\n";
+    }
+    oss << "vsync vblank offdelay " << mVblankOffdelayMs << "ms resync " << mResyncNs << "ns\n";
+    DumpVblankIrq(oss);
+    result += oss.str();
+}
+
+void DrmVsyncWorker::DumpVblankIrq(std::ostringstream &oss)
+{
+    // the irq count of the vop, it stops growing while the vsync is predicted and the irq is off
+    std::ifstream file("/proc/interrupts");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.find("vop") != std::string::npos) {
+            oss << "vsync irq:" << line << "\n";
+        }
+    }
 }
 } // namespace OHOS
 } // namespace HDI
@@ -15,15 +15,68 @@
 
 #ifndef DRM_VSYNC_WORKER_H
 #define DRM_VSYNC_WORKER_H
+#include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <sstream>
+#include <string>
 #include <thread>
-#include <condition_variable>
+#include <vector>
 #include "hdi_device_common.h"
 
 namespace OHOS {
 namespace HDI {
 namespace DISPLAY {
+const uint32_t VSYNC_MODEL_MAX_SAMPLES = 16;
+const uint32_t VSYNC_MODEL_MIN_SAMPLES = 6;
+// the max distance of a hardware timestamp from the fitted line
+const int64_t VSYNC_MODEL_MAX_ERROR_NS = 500000;
+const int64_t VSYNC_MIN_PERIOD_NS = 4000000;
+const int64_t VSYNC_MAX_PERIOD_NS = 50000000;
+/*
+ * The predicted vsyncs are checked against the hardware after some times of the vblank off delay of the kernel,
+ * the vblank irq stays on for the off delay after the check, so it is off for most of the time between the checks.
+ */
+const int64_t VSYNC_RESYNC_OFFDELAY_TIMES = 4;
+const int64_t VSYNC_RESYNC_MIN_NS = 2000000000;
+// the drm_vblank_offdelay of the kernel when the parameter can not be read
+const int64_t VSYNC_DEFAULT_OFFDELAY_MS = 5000;
+
+/*
+ * Fits the phase and the period of the vsync from the hardware timestamps with the least squares,
+ * the vblank sequence is used as the x axis so the missed events do not break the fitting.
+ */
+class DrmVsyncModel {
+public:
+    void AddSample(uint64_t sequence, int64_t ns);
+    void Reset();
+    bool IsValid() const
+    {
+        return mValid;
+    }
+    int64_t GetPeriod() const
+    {
+        return mPeriod;
+    }
+    // get the first vsync after the time
+    void PredictNext(int64_t ns, uint64_t &sequence, int64_t &vsyncNs) const;
+
+private:
+    void Fit();
+    std::deque<std::pair<uint64_t, int64_t>> mSamples;
+    bool mValid = false;
+    uint64_t mRefSequence = 0;
+    int64_t mRefNs = 0;
+    int64_t mPeriod = 0;
+    int64_t mError = 0;
+};
+
+/*
+ * The vsync service of all crtcs. The vblank events of the drm are handled in one poll loop, when
+ * the model of a crtc is stable the vsync is predicted by the model and no vblank event is requested,
+ * so the vblank irq of the crtc can be turned off by the kernel.
+ */
 class DrmVsyncWorker {
 public:
     DrmVsyncWorker();
@@ -31,19 +84,47 @@ public:
     int32_t Init(int fd);
     static DrmVsyncWorker &GetInstance();
 
-    void EnableVsync(bool enable);
-    void WorkThread();
-    uint64_t WaitNextVBlank(unsigned int &sq);
-    bool WaitSignalAndCheckRuning();
+    void EnableVsync(uint32_t pipe, bool enable);
     void ReqesterVBlankCb(std::shared_ptr<VsyncCallBack> &cb);
+    // drop the model of the crtc, such as the mode of the crtc is changed
+    void ResetModel(uint32_t pipe);
+    void Dump(std::string &result);
 
 private:
-    int mDrmFd = 0;
+    struct PipeState {
+        std::shared_ptr<VsyncCallBack> callBack;
+        bool enable = false;
+        bool eventPending = false;
+        bool software = false;
+        int64_t softwareStartNs = 0;
+        uint64_t nextSequence = 0;
+        int64_t nextNs = 0;
+        uint64_t hardwareEvents = 0;
+        uint64_t softwareEvents = 0;
+        DrmVsyncModel model;
+    };
+    using VsyncEvent = std::pair<std::shared_ptr<VsyncCallBack>, std::pair<unsigned int, uint64_t>>;
+    static void VBlankHandler(int fd, unsigned int sequence, unsigned int tvSec, unsigned int tvUsec, void *data);
+    static int64_t GetNowNs();
+    static int64_t GetVblankOffdelayMs();
+    static void DumpVblankIrq(std::ostringstream &oss);
+    void WorkThread();
+    void Wakeup();
+    int64_t GetTimeoutLocked(int64_t nowNs);
+    void RequestEventLocked(uint32_t pipe, PipeState &state);
+    void OnVBlank(uint32_t pipe, unsigned int sequence, int64_t ns, std::vector<VsyncEvent> &events);
+    void ProcessLocked(int64_t nowNs, std::vector<VsyncEvent> &events);
+
+    int mDrmFd = -1;
+    int mEventFd = -1;
+    bool mSoftwareVsync = true;
+    int64_t mVblankOffdelayMs = VSYNC_DEFAULT_OFFDELAY_MS;
+    int64_t mResyncNs = VSYNC_RESYNC_MIN_NS;
     std::unique_ptr<std::thread> mThread;
-    bool mEnable = false;
     std::mutex mMutex;
-    std::condition_variable mCondition;
-    std::shared_ptr<VsyncCallBack> mCallBack;
+    std::map<uint32_t, PipeState> mPipes;
+    // the vsync events to call back, only used by the work thread
+    std::vector<VsyncEvent> mEvents;
     bool mRunning = false;
 };
 } // namespace OHOS
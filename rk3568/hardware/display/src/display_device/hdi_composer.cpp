@@ -26,10 +26,11 @@ HdiComposer::HdiComposer(std::unique_ptr<HdiComposition> pre, std::unique_ptr<Hd
 
 int32_t HdiComposer::Prepare(std::vector<HdiLayer *> &layers, HdiLayer &clientLayer)
 {
-    int ret = mPreComp->SetLayers(layers, clientLayer);
-    DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("pre composition prepare failed"));
-    ret = mPostComp->SetLayers(layers, clientLayer);
+    // the post composition picks the layers scanned out by the planes first, the pre composition takes the rest
+    int ret = mPostComp->SetLayers(layers, clientLayer);
     DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("post composition prepare failed"));
+    ret = mPreComp->SetLayers(layers, clientLayer);
+    DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("pre composition prepare failed"));
     return DISPLAY_SUCCESS;
 }
 
@@ -42,6 +43,12 @@ int32_t HdiComposer::Commit(bool modeSet)
     DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("post composition apply failed"));
     return DISPLAY_SUCCESS;
 }
+
+void HdiComposer::SetFrameTrace(HdiFrameTrace *frameTrace)
+{
+    mPreComp->SetFrameTrace(frameTrace);
+    mPostComp->SetFrameTrace(frameTrace);
+}
 } // OHOS
 } // HDI
 } // DISPLAY
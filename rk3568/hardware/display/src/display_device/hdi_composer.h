@@ -17,6 +17,7 @@
 #define HDI_COMPOSER_H
 #include <vector>
 #include <memory>
+#include "hdi_frame_trace.h"
 #include "hdi_layer.h"
 
 namespace OHOS {
@@ -38,9 +39,14 @@ public:
         return DISPLAY_SUCCESS;
     }
     virtual ~HdiComposition() {}
+    void SetFrameTrace(HdiFrameTrace *frameTrace)
+    {
+        mFrameTrace = frameTrace;
+    }
 
 protected:
     std::vector<HdiLayer *> mCompLayers;
+    HdiFrameTrace *mFrameTrace = nullptr;
 };
 
 class HdiComposer {
@@ -49,6 +55,7 @@ public:
     virtual ~HdiComposer() {};
     int32_t Prepare(std::vector<HdiLayer *> &layers, HdiLayer &clientLayer);
     int32_t Commit(bool modeSet);
+    void SetFrameTrace(HdiFrameTrace *frameTrace);
     HdiComposition *GetPreCompostion()
     {
         return mPreComp.get();
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hdi_damage_tracker.h"
+#include <algorithm>
+#include <cinttypes>
+#include <sys/stat.h>
+#include "display_log.h"
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+bool IsRectEmpty(const IRect &rect)
+{
+    return (rect.w <= 0) || (rect.h <= 0);
+}
+
+bool IsRectEqual(const IRect &lhs, const IRect &rhs)
+{
+    return (lhs.x == rhs.x) && (lhs.y == rhs.y) && (lhs.w == rhs.w) && (lhs.h == rhs.h);
+}
+
+IRect UnionRect(const IRect &lhs, const IRect &rhs)
+{
+    if (IsRectEmpty(lhs)) {
+        return rhs;
+    }
+    if (IsRectEmpty(rhs)) {
+        return lhs;
+    }
+    int32_t left = std::min(lhs.x, rhs.x);
+    int32_t top = std::min(lhs.y, rhs.y);
+    int32_t right = std::max(lhs.x + lhs.w, rhs.x + rhs.w);
+    int32_t bottom = std::max(lhs.y + lhs.h, rhs.y + rhs.h);
+    return { left, top, right - left, bottom - top };
+}
+
+IRect IntersectRect(const IRect &lhs, const IRect &rhs)
+{
+    int32_t left = std::max(lhs.x, rhs.x);
+    int32_t top = std::max(lhs.y, rhs.y);
+    int32_t right = std::min(lhs.x + lhs.w, rhs.x + rhs.w);
+    int32_t bottom = std::min(lhs.y + lhs.h, rhs.y + rhs.h);
+    if ((right <= left) || (bottom <= top)) {
+        return { 0, 0, 0, 0 };
+    }
+    return { left, top, right - left, bottom - top };
+}
+
+IRect HdiDamageTracker::GetLayerCrop(HdiLayer &layer)
+{
+    IRect crop = layer.GetLayerCrop();
+    HdiLayerBuffer *buffer = layer.GetCurrentBuffer();
+    if (IsRectEmpty(crop) && (buffer != nullptr)) {
+        crop = { 0, 0, buffer->GetWight(), buffer->GetHeight() };
+    }
+    return crop;
+}
+
+bool HdiDamageTracker::IsLayerTransformed(HdiLayer &layer)
+{
+    TransformType transform = layer.GetTransFormType();
+    if ((transform != ROTATE_NONE) && (transform != ROTATE_BUTT)) {
+        return true;
+    }
+    IRect crop = GetLayerCrop(layer);
+    const IRect &displayRect = layer.GetLayerDisplayRect();
+    return (crop.w != displayRect.w) || (crop.h != displayRect.h);
+}
+
+HdiDamageTracker::LayerState HdiDamageTracker::GetLayerState(HdiLayer &layer)
+{
+    LayerState state;
+    state.displayRect = layer.GetLayerDisplayRect();
+    state.crop = layer.GetLayerCrop();
+    state.transform = layer.GetTransFormType();
+    state.compositionType = layer.GetCompositionType();
+    state.blendType = layer.GetLayerBlenType();
+    state.enGlobalAlpha = layer.GetAlpha().enGlobalAlpha;
+    state.gAlpha = layer.GetAlpha().gAlpha;
+    state.zorder = layer.GetZorder();
+    return state;
+}
+
+bool HdiDamageTracker::IsStateEqual(const LayerState &lhs, const LayerState &rhs)
+{
+    return IsRectEqual(lhs.displayRect, rhs.displayRect) && IsRectEqual(lhs.crop, rhs.crop) &&
+        (lhs.transform == rhs.transform) && (lhs.compositionType == rhs.compositionType) &&
+        (lhs.blendType == rhs.blendType) && (lhs.enGlobalAlpha == rhs.enGlobalAlpha) &&
+        (lhs.gAlpha == rhs.gAlpha) && (lhs.zorder == rhs.zorder);
+}
+
+IRect HdiDamageTracker::GetLayerDamage(HdiLayer &layer)
+{
+    const IRect &displayRect = layer.GetLayerDisplayRect();
+    // the content of the video layer is not in the client buffer
+    if (!layer.IsBufferChanged() || (layer.GetCompositionType() == COMPOSITION_VIDEO)) {
+        return { 0, 0, 0, 0 };
+    }
+    IRect dirty;
+    // the dirty region is in the buffer coordinate, only map it when the layer is not scaled or rotated
+    if (!layer.GetLayerDirtyRegion(dirty) || IsLayerTransformed(layer)) {
+        return displayRect;
+    }
+    IRect crop = GetLayerCrop(layer);
+    dirty = IntersectRect(dirty, crop);
+    IRect damage = { dirty.x - crop.x + displayRect.x, dirty.y - crop.y + displayRect.y, dirty.w, dirty.h };
+    return IntersectRect(damage, displayRect);
+}
+
+IRect HdiDamageTracker::CollectFrameDamage(const std::vector<HdiLayer *> &layers, const IRect &screen)
+{
+    IRect damage = { 0, 0, 0, 0 };
+    std::unordered_map<uint32_t, LayerState> states;
+    for (auto &layer : layers) {
+        LayerState state = GetLayerState(*layer);
+        auto iter = mLayerStates.find(layer->GetId());
+        if (iter == mLayerStates.end()) {
+            damage = UnionRect(damage, state.displayRect);
+        } else if (!IsStateEqual(iter->second, state)) {
+            damage = UnionRect(damage, UnionRect(iter->second.displayRect, state.displayRect));
+            mLayerStates.erase(iter);
+        } else {
+            damage = UnionRect(damage, GetLayerDamage(*layer));
+            mLayerStates.erase(iter);
+        }
+        states.emplace(layer->GetId(), state);
+    }
+    // the layers left are removed or not composed by the gfx any more
+    for (auto &iter : mLayerStates) {
+        damage = UnionRect(damage, iter.second.displayRect);
+    }
+    mLayerStates = std::move(states);
+    return IntersectRect(damage, screen);
+}
+
+IRect HdiDamageTracker::GetBufferDamage(const HdiLayerBuffer &clientBuffer, const IRect &frameDamage,
+    const IRect &screen)
+{
+    mFrame++;
+    IRect damage = screen;
+    struct stat st;
+    bool known = (clientBuffer.GetFb() >= 0) && (fstat(clientBuffer.GetFb(), &st) == 0);
+    if (known) {
+        uint64_t ino = static_cast<uint64_t>(st.st_ino);
+        auto iter = mBufferFrames.find(ino);
+        uint64_t age = (iter == mBufferFrames.end()) ? 0 : (mFrame - iter->second);
+        if ((age > 0) && (age <= mHistory.size() + 1)) {
+            damage = frameDamage;
+            for (uint64_t i = 0; i + 1 < age; i++) {
+                damage = UnionRect(damage, mHistory[i]);
+            }
+        }
+        DISPLAY_LOGD("client buffer age %{public}" PRIu64 "", age);
+        mBufferFrames[ino] = mFrame;
+    }
+
+    mHistory.push_front(frameDamage);
+    if (mHistory.size() >= DAMAGE_MAX_BUFFER_AGE) {
+        mHistory.pop_back();
+    }
+    // forget the buffers which are too old to reuse the history
+    for (auto iter = mBufferFrames.begin(); iter != mBufferFrames.end();) {
+        if (mFrame - iter->second > DAMAGE_MAX_BUFFER_AGE) {
+            iter = mBufferFrames.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+    return damage;
+}
+
+IRect HdiDamageTracker::ExpandDamage(const std::vector<HdiLayer *> &layers, const IRect &damage)
+{
+    // the scaled or rotated layers can not be blit partially, redraw them in full
+    IRect expanded = damage;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &layer : layers) {
+            const IRect &displayRect = layer->GetLayerDisplayRect();
+            if (IsRectEmpty(IntersectRect(displayRect, expanded)) || !IsLayerTransformed(*layer)) {
+                continue;
+            }
+            IRect merged = UnionRect(expanded, displayRect);
+            if (!IsRectEqual(merged, expanded)) {
+                expanded = merged;
+                changed = true;
+            }
+        }
+    }
+    return expanded;
+}
+
+void HdiDamageTracker::Reset()
+{
+    mLayerStates.clear();
+    mHistory.clear();
+    mBufferFrames.clear();
+}
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HDI_DAMAGE_TRACKER_H
+#define HDI_DAMAGE_TRACKER_H
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "hdi_layer.h"
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+// the client buffer older than this many frames is redrawn in full
+const uint32_t DAMAGE_MAX_BUFFER_AGE = 4;
+
+bool IsRectEmpty(const IRect &rect);
+bool IsRectEqual(const IRect &lhs, const IRect &rhs);
+IRect UnionRect(const IRect &lhs, const IRect &rhs);
+IRect IntersectRect(const IRect &lhs, const IRect &rhs);
+
+/*
+ * Tracks the damage of the layers composed into the client layer. The damage of a frame is the bounding
+ * rect of the dirty regions of the updated layers and the old and new rects of the changed layers. The
+ * region to redraw in a client buffer is the damage of all frames since the buffer was drawn last time.
+ */
+class HdiDamageTracker {
+public:
+    IRect CollectFrameDamage(const std::vector<HdiLayer *> &layers, const IRect &screen);
+    IRect GetBufferDamage(const HdiLayerBuffer &clientBuffer, const IRect &frameDamage, const IRect &screen);
+    static IRect ExpandDamage(const std::vector<HdiLayer *> &layers, const IRect &damage);
+    static bool IsLayerTransformed(HdiLayer &layer);
+    static IRect GetLayerCrop(HdiLayer &layer);
+    void Reset();
+
+private:
+    struct LayerState {
+        IRect displayRect;
+        IRect crop;
+        TransformType transform;
+        CompositionType compositionType;
+        BlendType blendType;
+        bool enGlobalAlpha;
+        uint8_t gAlpha;
+        uint32_t zorder;
+    };
+    static LayerState GetLayerState(HdiLayer &layer);
+    static bool IsStateEqual(const LayerState &lhs, const LayerState &rhs);
+    static IRect GetLayerDamage(HdiLayer &layer);
+
+    std::unordered_map<uint32_t, LayerState> mLayerStates;
+    // the damage of the previous frames, the front is the last frame
+    std::deque<IRect> mHistory;
+    // the inode of the client buffer to the frame it was drawn
+    std::unordered_map<uint64_t, uint64_t> mBufferFrames;
+    uint64_t mFrame = 0;
+};
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
+
+#endif // HDI_DAMAGE_TRACKER_H
@@ -15,6 +15,7 @@
 
 #ifndef HDI_DEVICE_INTERFACE_H
 #define HDI_DEVICE_INTERFACE_H
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include <memory>
@@ -30,6 +31,7 @@ public:
     virtual bool HandleHotplug(uint32_t dispId, bool plugIn) = 0;
     virtual int32_t Init() = 0;
     virtual void DeInit() = 0;
+    virtual void Dump(std::string &result) {}
     virtual ~HdiDeviceInterface() {};
 };
 } // namespace OHOS
@@ -16,6 +16,7 @@
 #include "hdi_display.h"
 #include <vector>
 #include "display_log.h"
+#include "hdi_perf_counter.h"
 
 namespace OHOS {
 namespace HDI {
@@ -167,6 +168,9 @@ int32_t HdiDisplay::GetDisplayReleaseFence(uint32_t *num, uint32_t *layers, int3
 int32_t HdiDisplay::PrepareDisplayLayers(bool *needFlushFb)
 {
     DISPLAY_LOGD();
+    HdiPerfScope perfScope(PERF_STAGE_PREPARE);
+    mFrameTrace.BeginFrame();
+    int64_t beginNs = HdiFrameTrace::GetNowNs();
     mChangeLayers.clear();
     std::vector<HdiLayer *> layers;
     uint32_t topZpos = 3;
@@ -189,6 +193,8 @@ int32_t HdiDisplay::PrepareDisplayLayers(bool *needFlushFb)
         }
         mChangeLayers.push_back(layer);
     }
+    mFrameTrace.SetLayers(layers);
+    mFrameTrace.AddStage(FRAME_STAGE_PREPARE, beginNs, HdiFrameTrace::GetNowNs());
     *needFlushFb = true;
     return DISPLAY_SUCCESS;
 }
@@ -196,7 +202,9 @@ int32_t HdiDisplay::PrepareDisplayLayers(bool *needFlushFb)
 int32_t HdiDisplay::Commit(int32_t *fence)
 {
     DISPLAY_LOGD();
+    HdiPerfScope perfScope(PERF_STAGE_COMMIT);
     mComposer->Commit(false);
+    mFrameTrace.EndFrame();
     *fence = dup(mClientLayer->GetReleaseFenceFd());
     DISPLAY_LOGD("the release fence is %{public}d", *fence);
     return DISPLAY_SUCCESS;
@@ -220,6 +228,12 @@ HdiLayer *HdiDisplay::GetHdiLayer(uint32_t id)
     return iter->second.get();
 }
 
+void HdiDisplay::Dump(std::string &result)
+{
+    result += "display " + std::to_string(mId) + " ";
+    mFrameTrace.Dump(result);
+}
+
 VsyncCallBack::VsyncCallBack(VBlankCallback cb, void *data, uint32_t displayId) : mVBlankCb(cb),
     mData(data), mPipe(displayId)
 {
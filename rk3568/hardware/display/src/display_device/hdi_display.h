@@ -16,6 +16,7 @@
 #ifndef HDI_DISPLAY_H
 #define HDI_DISPLAY_H
 #include <set>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory.h>
@@ -112,6 +113,7 @@ public:
         return DISPLAY_NOT_SUPPORT;
     }
     HdiLayer *GetHdiLayer(uint32_t id);
+    virtual void Dump(std::string &result);
 
 protected:
     virtual std::unique_ptr<HdiLayer> CreateHdiLayer(LayerType type);
@@ -125,6 +127,7 @@ protected:
     std::multiset<HdiLayer *, SortLayersByZ> mLayers;
     std::unique_ptr<HdiLayer> mClientLayer;
     std::vector<HdiLayer *> mChangeLayers;
+    HdiFrameTrace mFrameTrace;
 };
 } // namespace OHOS
 } // namespace HDI
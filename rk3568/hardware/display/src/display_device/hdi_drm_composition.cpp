@@ -14,7 +14,10 @@
  */
 
 #include "hdi_drm_composition.h"
+#include <algorithm>
 #include <cerrno>
+#include <cinttypes>
+#include <unistd.h>
 #include "hdi_drm_layer.h"
 
 namespace OHOS {
@@ -44,125 +47,334 @@ int32_t HdiDrmComposition::Init()
     return DISPLAY_SUCCESS;
 }
 
-int32_t HdiDrmComposition::SetLayers(std::vector<HdiLayer *> &layers, HdiLayer &clientLayer)
+uint64_t HdiDrmComposition::ConvertToDrmRotation(TransformType type)
 {
-    // now we do not surpport present direct
-    DISPLAY_LOGD();
-    mCompLayers.clear();
-    mCompLayers.push_back(&clientLayer);
-    return DISPLAY_SUCCESS;
+    switch (type) {
+        case ROTATE_90:
+            return DRM_MODE_ROTATE_90;
+        case ROTATE_180:
+            return DRM_MODE_ROTATE_180;
+        case ROTATE_270:
+            return DRM_MODE_ROTATE_270;
+        case MIRROR_H:
+            return DRM_MODE_ROTATE_0 | DRM_MODE_REFLECT_X;
+        case MIRROR_V:
+            return DRM_MODE_ROTATE_0 | DRM_MODE_REFLECT_Y;
+        case MIRROR_H_ROTATE_90:
+            return DRM_MODE_ROTATE_90 | DRM_MODE_REFLECT_X;
+        case MIRROR_V_ROTATE_90:
+            return DRM_MODE_ROTATE_90 | DRM_MODE_REFLECT_Y;
+        default:
+            return DRM_MODE_ROTATE_0;
+    }
+}
+
+void HdiDrmComposition::GetLayerSrcRect(HdiLayer &layer, IRect &src)
+{
+    HdiLayerBuffer *buffer = layer.GetCurrentBuffer();
+    src = layer.GetLayerCrop();
+    if ((src.w <= 0) || (src.h <= 0)) {
+        src = { 0, 0, buffer->GetWight(), buffer->GetHeight() };
+    }
 }
 
-int32_t HdiDrmComposition::SetCrtcProperty(DrmPlane &drmPlane,
-                                           drmModeAtomicReqPtr pset,
-                                           int32_t bufferW,
-                                           int32_t bufferH)
+bool HdiDrmComposition::IsPlaneAvailable(DrmPlane &drmPlane) const
 {
-    int ret;
+    if (drmPlane.GetPipe() != 0 && drmPlane.GetPipe() != (1 << mCrtc->GetPipe())) {
+        DISPLAY_LOGD("plane %{public}d used pipe %{public}d crtc pipe %{public}d", drmPlane.GetId(),
+            drmPlane.GetPipe(), mCrtc->GetPipe());
+        return false;
+    }
+    /* Check whether the plane belond to the crtc */
+    if (!(static_cast<int>(drmPlane.GetWinType()) & mCrtc->GetPlaneMask())) {
+        return false;
+    }
+    return (drmPlane.GetCrtcId() == mCrtc->GetId()) || (drmPlane.GetCrtcId() == 0);
+}
 
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropCrtc_xId(), 0);
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropCrtc_xId %{public}d, crop.x %{public}d", drmPlane.GetId(),
-        drmPlane.GetPropCrtc_xId(), 0);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the fb planeid fialed errno : %{public}d", errno));
+bool HdiDrmComposition::CanPlaneShowLayer(DrmPlane &drmPlane, HdiLayer &layer, uint64_t &rotation) const
+{
+    HdiLayerBuffer *buffer = layer.GetCurrentBuffer();
+    if (buffer == nullptr) {
+        return false;
+    }
+    uint32_t format = DrmDevice::ConvertToDrmFormat(static_cast<PixelFormat>(buffer->GetFormat()));
+    if ((format == DRM_FORMAT_INVALID) || !drmPlane.IsFormatSupported(format)) {
+        return false;
+    }
 
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropCrtc_yId(), 0);
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropCrtc_yId %{public}d, crop.y %{public}d", drmPlane.GetId(),
-        drmPlane.GetPropCrtc_yId(), 0);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the fb planeid fialed errno : %{public}d", errno));
+    rotation = ConvertToDrmRotation(layer.GetTransFormType());
+    if ((rotation & drmPlane.GetSupportedRotations()) != rotation) {
+        return false;
+    }
 
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropCrtc_wId(), bufferW);
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropCrtc_wId %{public}d, crop.w %{public}d", drmPlane.GetId(),
-        drmPlane.GetPropCrtc_wId(), bufferW);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the fb planeid fialed errno : %{public}d", errno));
+    // the plane can not blend with the global alpha without the alpha feature
+    if (layer.GetAlpha().enGlobalAlpha && (layer.GetAlpha().gAlpha != 0xff) && !drmPlane.HasAlpha()) {
+        return false;
+    }
 
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropCrtc_hId(), bufferH);
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropCrtc_hId %{public}d, crop.h %{public}d", drmPlane.GetId(),
-        drmPlane.GetPropCrtc_xId(), bufferH);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the fb planeid fialed errno : %{public}d", errno));
+    IRect src;
+    GetLayerSrcRect(layer, src);
+    const IRect &dst = layer.GetLayerDisplayRect();
+    if ((src.x < 0) || (src.y < 0) || (src.x + src.w > buffer->GetWight()) ||
+        (src.y + src.h > buffer->GetHeight()) || (dst.x < 0) || (dst.y < 0) || (dst.w <= 0) || (dst.h <= 0)) {
+        return false;
+    }
+    DrmMode mode;
+    if (mConnector->GetModeFromId(mCrtc->GetActiveModeId(), mode) == DISPLAY_SUCCESS) {
+        drmModeModeInfoPtr modeInfo = mode.GetModeInfoPtr();
+        if ((dst.x + dst.w > modeInfo->hdisplay) || (dst.y + dst.h > modeInfo->vdisplay)) {
+            return false;
+        }
+    }
 
-    return DISPLAY_SUCCESS;
+    // the width and height are swapped by the 90 and 270 degree rotation
+    bool swapped = (rotation & (DRM_MODE_ROTATE_90 | DRM_MODE_ROTATE_270)) != 0;
+    int32_t srcW = swapped ? src.h : src.w;
+    int32_t srcH = swapped ? src.w : src.h;
+    if ((srcW == dst.w) && (srcH == dst.h)) {
+        return true;
+    }
+    if (!drmPlane.CanScale()) {
+        return false;
+    }
+    return (srcW <= dst.w * PLANE_MAX_SCALE) && (dst.w <= srcW * PLANE_MAX_SCALE) &&
+        (srcH <= dst.h * PLANE_MAX_SCALE) && (dst.h <= srcH * PLANE_MAX_SCALE);
 }
 
-int32_t HdiDrmComposition::SetSrcProperty(DrmPlane &drmPlane,
-                                          drmModeAtomicReqPtr pset,
-                                          int32_t bufferW,
-                                          int32_t bufferH)
+bool HdiDrmComposition::AssignPlane(HdiLayer &layer, std::vector<std::shared_ptr<DrmPlane>> &freePlanes,
+    std::vector<DrmPlaneAssignment> &assignments)
 {
-    int ret;
-
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropSrc_xId(), 0 << 16); // 16:shift left 16 bits
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropSrc_xId %{public}d, displayRect.x %{public}d",
-        drmPlane.GetId(), drmPlane.GetPropSrc_xId(), 0);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the fb planeid fialed errno : %{public}d", errno));
-
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropSrc_yId(), 0 << 16); // 16:shift left 16 bits
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropSrc_yId %{public}d, displayRect.y %{public}d",
-        drmPlane.GetId(), drmPlane.GetPropSrc_yId(), 0);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the fb planeid fialed errno : %{public}d", errno));
-
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropSrc_wId(),
-                                   bufferW << 16); // 16:shift left 16 bits
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropCrtc_wId %{public}d, displayRect.w %{public}d",
-        drmPlane.GetId(), drmPlane.GetPropSrc_wId(), bufferW);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the fb planeid fialed errno : %{public}d", errno));
-
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropSrc_hId(),
-        bufferH << 16); // 16:shift left 16 bits
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropSrc_hId %{public}d, displayRect.h %{public}d",
-        drmPlane.GetId(), drmPlane.GetPropSrc_hId(), bufferH);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the fb planeid fialed errno : %{public}d", errno));
+    for (auto iter = freePlanes.begin(); iter != freePlanes.end(); iter++) {
+        uint64_t rotation = DRM_MODE_ROTATE_0;
+        if (!CanPlaneShowLayer(**iter, layer, rotation)) {
+            continue;
+        }
+        DISPLAY_LOGD("layer %{public}d on plane %{public}d", layer.GetId(), (*iter)->GetId());
+        DrmPlaneAssignment assignment;
+        assignment.layer = &layer;
+        assignment.plane = *iter;
+        assignment.rotation = rotation;
+        assignments.push_back(assignment);
+        layer.SetPlaneSelect(true);
+        freePlanes.erase(iter);
+        return true;
+    }
+    return false;
+}
+
+void HdiDrmComposition::AssignPlanes(std::vector<HdiLayer *> &layers, HdiLayer &clientLayer,
+    std::vector<std::shared_ptr<DrmPlane>> freePlanes, PlaneAssignLevel level)
+{
+    mAssignments.clear();
+    for (auto &layer : layers) {
+        layer->SetPlaneSelect(false);
+    }
+
+    // the client layer keeps a plane, the primary planes are in the front
+    std::shared_ptr<DrmPlane> clientPlane = freePlanes.front();
+    freePlanes.erase(freePlanes.begin());
+
+    // the video layers are below the client layer, the gfx composition clears the rect of them
+    std::vector<DrmPlaneAssignment> belowClient;
+    for (auto &layer : layers) {
+        if ((level >= PLANE_ASSIGN_VIDEO) && (layer->GetCompositionType() == COMPOSITION_VIDEO)) {
+            AssignPlane(*layer, freePlanes, belowClient);
+        }
+    }
+
+    // the top most layers are above the client layer, stop at the first one which can not be scanned out
+    std::vector<DrmPlaneAssignment> aboveClient;
+    for (auto iter = layers.rbegin(); (level >= PLANE_ASSIGN_ALL) && (iter != layers.rend()); iter++) {
+        CompositionType type = (*iter)->GetCompositionType();
+        if ((type != COMPOSITION_DEVICE) && (type != COMPOSITION_CURSOR)) {
+            break;
+        }
+        if (!AssignPlane(**iter, freePlanes, aboveClient)) {
+            break;
+        }
+    }
+
+    auto onPlane = [](const HdiLayer *layer) { return layer->GetPlaneSelect(); };
+    bool needClient = layers.empty() || !std::all_of(layers.begin(), layers.end(), onPlane);
+    uint64_t zpos = 0;
+    for (auto &assignment : belowClient) {
+        assignment.zpos = zpos++;
+        mAssignments.push_back(assignment);
+    }
+    if (needClient) {
+        DrmPlaneAssignment assignment;
+        assignment.layer = &clientLayer;
+        assignment.plane = clientPlane;
+        assignment.zpos = zpos++;
+        assignment.isClient = true;
+        mAssignments.push_back(assignment);
+    }
+    for (auto iter = aboveClient.rbegin(); iter != aboveClient.rend(); iter++) {
+        iter->zpos = zpos++;
+        mAssignments.push_back(*iter);
+    }
+    DISPLAY_LOGD("level %{public}d planes %{public}zu below client %{public}zu above client %{public}zu", level,
+        mAssignments.size(), belowClient.size(), aboveClient.size());
+}
+
+bool HdiDrmComposition::TestAssignments(const std::vector<DrmPlaneAssignment> &assignments)
+{
+    // the mode is not committed yet, the planes are checked with the new mode in the next frame
+    if (mCrtc->NeedModeSet()) {
+        return true;
+    }
+    for (auto &assignment : assignments) {
+        // the client buffer is not set before the first frame
+        if (assignment.layer->GetCurrentBuffer() == nullptr) {
+            return true;
+        }
+    }
+    DrmAtomicBuilder builder(mDrmDevice->GetAtomicState());
+    for (auto &assignment : assignments) {
+        if (ApplyPlane(assignment, builder, false) != DISPLAY_SUCCESS) {
+            return false;
+        }
+    }
+    RemoveUnusePlane(builder, assignments);
+    SetConnectorProperty(builder);
+    return builder.Test(mDrmDevice->GetDrmFd(), DRM_MODE_ATOMIC_NONBLOCK) == DISPLAY_SUCCESS;
+}
 
+int32_t HdiDrmComposition::SetLayers(std::vector<HdiLayer *> &layers, HdiLayer &clientLayer)
+{
+    DISPLAY_LOGD("layers size %{public}zu", layers.size());
+    mCompLayers.clear();
+    mAssignments.clear();
+    std::vector<std::shared_ptr<DrmPlane>> freePlanes;
+    for (auto &drmPlane : mPlanes) {
+        if (IsPlaneAvailable(*drmPlane)) {
+            freePlanes.push_back(drmPlane);
+        }
+    }
+    for (auto &layer : layers) {
+        layer->SetPlaneSelect(false);
+    }
+    DISPLAY_CHK_RETURN((freePlanes.empty()), DISPLAY_FAILURE, DISPLAY_LOGE("no plane for the crtc"));
+
+    // the drm may reject the combination of the planes, such as the bandwidth or the scaler is not enough
+    size_t rejectedCount = 0;
+    for (int level = PLANE_ASSIGN_ALL; level >= PLANE_ASSIGN_CLIENT; level--) {
+        AssignPlanes(layers, clientLayer, freePlanes, static_cast<PlaneAssignLevel>(level));
+        // only the client layer is on the plane, the same as the lower candidates
+        if ((level == PLANE_ASSIGN_CLIENT) || ((mAssignments.size() == 1) && mAssignments[0].isClient)) {
+            break;
+        }
+        // the candidates are nested, the same count is the same rejected candidate
+        if (mAssignments.size() == rejectedCount) {
+            continue;
+        }
+        if (TestAssignments(mAssignments)) {
+            break;
+        }
+        rejectedCount = mAssignments.size();
+        DISPLAY_LOGI("the planes of level %{public}d are rejected by the drm", level);
+    }
+    for (auto &assignment : mAssignments) {
+        mCompLayers.push_back(assignment.layer);
+    }
     return DISPLAY_SUCCESS;
 }
 
-int32_t HdiDrmComposition::ApplyPlane(HdiDrmLayer &layer,
-                                      HdiLayer &hlayer,
-                                      DrmPlane &drmPlane,
-                                      drmModeAtomicReqPtr pset)
+void HdiDrmComposition::SetCrtcProperty(DrmPlane &drmPlane, DrmAtomicBuilder &builder, const IRect &dst)
+{
+    DISPLAY_LOGD("set the crtc rect of plane %{public}d, x %{public}d y %{public}d w %{public}d h %{public}d",
+        drmPlane.GetId(), dst.x, dst.y, dst.w, dst.h);
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropCrtc_xId(), dst.x);
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropCrtc_yId(), dst.y);
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropCrtc_wId(), dst.w);
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropCrtc_hId(), dst.h);
+}
+
+void HdiDrmComposition::SetSrcProperty(DrmPlane &drmPlane, DrmAtomicBuilder &builder, const IRect &src)
 {
-    int ret;
+    DISPLAY_LOGD("set the src rect of plane %{public}d, x %{public}d y %{public}d w %{public}d h %{public}d",
+        drmPlane.GetId(), src.x, src.y, src.w, src.h);
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropSrc_xId(),
+        static_cast<uint64_t>(src.x) << 16); // 16:shift left 16 bits
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropSrc_yId(),
+        static_cast<uint64_t>(src.y) << 16); // 16:shift left 16 bits
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropSrc_wId(),
+        static_cast<uint64_t>(src.w) << 16); // 16:shift left 16 bits
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropSrc_hId(),
+        static_cast<uint64_t>(src.h) << 16); // 16:shift left 16 bits
+}
+
+void HdiDrmComposition::SetConnectorProperty(DrmAtomicBuilder &builder)
+{
+    DISPLAY_LOGD("set the connector id: %{public}d, propId %{public}d, crtcId %{public}d", mConnector->GetId(),
+        mConnector->GetPropCrtcId(), mCrtc->GetId());
+    builder.AddProperty(mConnector->GetId(), mConnector->GetPropCrtcId(), mCrtc->GetId());
+    // set to active
+    builder.AddProperty(mCrtc->GetId(), mCrtc->GetActivePropId(), 1);
+}
+
+int32_t HdiDrmComposition::ApplyPlane(const DrmPlaneAssignment &assignment, DrmAtomicBuilder &builder,
+    bool withFence)
+{
+    HdiDrmLayer &layer = *static_cast<HdiDrmLayer *>(assignment.layer);
+    DrmPlane &drmPlane = *assignment.plane;
     int fenceFd = layer.GetAcquireFenceFd();
     int propId = drmPlane.GetPropFenceInId();
-    HdiLayerBuffer *layerBuffer = hlayer.GetCurrentBuffer();
-    int32_t bufferW = layerBuffer->GetWight();
-    int32_t bufferH = layerBuffer->GetHeight();
+    HdiLayerBuffer *layerBuffer = layer.GetCurrentBuffer();
+    DISPLAY_CHK_RETURN((layerBuffer == nullptr), DISPLAY_NULL_PTR, DISPLAY_LOGE("the layer buffer is nullptr"));
+    IRect src;
+    IRect dst;
+    if (assignment.isClient) {
+        // the client layer covers the whole display
+        src = { 0, 0, layerBuffer->GetWight(), layerBuffer->GetHeight() };
+        dst = src;
+    } else {
+        GetLayerSrcRect(layer, src);
+        dst = layer.GetLayerDisplayRect();
+    }
 
     DISPLAY_LOGD();
-    if (propId != 0) {
-        DISPLAY_LOGD("set the fence in prop");
-        if (fenceFd >= 0) {
-            ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), propId, fenceFd);
-            DISPLAY_LOGD("set the IfenceProp plane id %{public}d, propId %{public}d, fenceFd %{public}d",
-                drmPlane.GetId(), propId, fenceFd);
-            DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set IN_FENCE_FD failed"));
-        }
+    if (withFence && (propId != 0) && (fenceFd >= 0)) {
+        DISPLAY_LOGD("set the IfenceProp plane id %{public}d, propId %{public}d, fenceFd %{public}d",
+            drmPlane.GetId(), propId, fenceFd);
+        builder.AddVolatileProperty(drmPlane.GetId(), propId, fenceFd);
     }
 
-    ret = SetCrtcProperty(drmPlane, pset, bufferW, bufferH);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set Crtc fialed errno : %{public}d", errno));
+    SetCrtcProperty(drmPlane, builder, dst);
+    SetSrcProperty(drmPlane, builder, src);
+
+    uint64_t zpos = std::min(std::max(assignment.zpos, drmPlane.GetZposMin()), drmPlane.GetZposMax());
+    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropZposId %{public}d, zpos %{public}" PRIu64,
+        drmPlane.GetId(), drmPlane.GetPropZposId(), zpos);
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropZposId(), zpos);
 
-    ret = SetSrcProperty(drmPlane, pset, bufferW, bufferH);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set Src fialed errno : %{public}d", errno));
+    if (drmPlane.GetPropRotationId() != 0) {
+        builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropRotationId(), assignment.rotation);
+    }
 
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropZposId(), layer.GetZorder());
-    DISPLAY_LOGD("set the fb planeid %{public}d, GetPropZposId %{public}d, zpos %{public}d",
-        drmPlane.GetId(), drmPlane.GetPropZposId(), layer.GetZorder());
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the zpos fialed errno : %{public}d", errno));
+    // the plane keeps the alpha of the last layer on it, so an opaque layer sets it back
+    if (drmPlane.GetPropAlphaId() != 0) {
+        uint64_t alpha = drmPlane.GetAlphaMax();
+        const LayerAlpha &layerAlpha = layer.GetAlpha();
+        if (!assignment.isClient && layerAlpha.enGlobalAlpha) {
+            alpha = alpha * layerAlpha.gAlpha / 0xff; // 0xff: the max of gAlpha
+        }
+        builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropAlphaId(), alpha);
+    }
 
-    // set fb id
+    // set fb id, the id of a removed fb may be reused by the drm so it is always emitted
     DrmGemBuffer *gemBuffer = layer.GetGemBuffer();
     DISPLAY_CHK_RETURN((gemBuffer == nullptr), DISPLAY_FAILURE, DISPLAY_LOGE("current gemBuffer is nullptr"));
     DISPLAY_CHK_RETURN((!gemBuffer->IsValid()), DISPLAY_FAILURE, DISPLAY_LOGE("the DrmGemBuffer is invalid"));
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropFbId(), gemBuffer->GetFbId());
     DISPLAY_LOGD("set the fb planeid %{public}d, propId %{public}d, fbId %{public}d",
         drmPlane.GetId(), drmPlane.GetPropFbId(), gemBuffer->GetFbId());
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set fb id fialed errno : %{public}d", errno));
+    builder.AddVolatileProperty(drmPlane.GetId(), drmPlane.GetPropFbId(), gemBuffer->GetFbId());
 
     // set crtc id
-    ret = drmModeAtomicAddProperty(pset, drmPlane.GetId(), drmPlane.GetPropCrtcId(), mCrtc->GetId());
     DISPLAY_LOGD("set the crtc planeId %{public}d, propId %{public}d, crtcId %{public}d",
         drmPlane.GetId(), drmPlane.GetPropCrtcId(), mCrtc->GetId());
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set crtc id fialed errno : %{public}d", errno));
+    builder.AddProperty(drmPlane.GetId(), drmPlane.GetPropCrtcId(), mCrtc->GetId());
     return DISPLAY_SUCCESS;
 }
 
@@ -172,85 +384,72 @@ int32_t HdiDrmComposition::UpdateMode(std::unique_ptr<DrmModeBlock> &modeBlock)
     DISPLAY_LOGD();
     if (mCrtc->NeedModeSet()) {
         int drmFd = mDrmDevice->GetDrmFd();
-        drmModeAtomicReqPtr pset = drmModeAtomicAlloc();
+        DrmAtomicBuilder builder(mDrmDevice->GetAtomicState());
         modeBlock = mConnector->GetModeBlockFromId(mCrtc->GetActiveModeId());
         if ((modeBlock != nullptr) && (modeBlock->GetBlockId() != DRM_INVALID_ID)) {
             // set to active
             DISPLAY_LOGD("set crtc to active");
-            int ret = drmModeAtomicAddProperty(pset, mCrtc->GetId(), mCrtc->GetActivePropId(), 1);
-            DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE,
-                DISPLAY_LOGE("can not add the active prop errno %{public}d", errno));
+            builder.AddProperty(mCrtc->GetId(), mCrtc->GetActivePropId(), 1);
 
-            // set the mode id
-            DISPLAY_LOGD("set the mode");
-            ret = drmModeAtomicAddProperty(pset, mCrtc->GetId(), mCrtc->GetModePropId(), modeBlock->GetBlockId());
+            // set the mode id, the blob is created for every mode set
             DISPLAY_LOGD("set the mode planeId %{public}d, propId %{public}d, GetBlockId: %{public}d",
                 mCrtc->GetId(), mCrtc->GetModePropId(), modeBlock->GetBlockId());
-            DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE,
-                DISPLAY_LOGE("can not add the mode prop errno %{public}d", errno));
-            ret = drmModeAtomicAddProperty(pset, mConnector->GetId(), mConnector->GetPropCrtcId(), mCrtc->GetId());
-            DISPLAY_LOGD("set the connector id: %{public}d, propId %{public}d, crtcId %{public}d",
-                mConnector->GetId(), mConnector->GetPropCrtcId(), mCrtc->GetId());
-            DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE,
-                DISPLAY_LOGE("can not add the crtc id prop %{public}d", errno));
+            builder.AddVolatileProperty(mCrtc->GetId(), mCrtc->GetModePropId(), modeBlock->GetBlockId());
+            builder.AddProperty(mConnector->GetId(), mConnector->GetPropCrtcId(), mCrtc->GetId());
 
             uint32_t flags = DRM_MODE_ATOMIC_ALLOW_MODESET;
-            ret = drmModeAtomicCommit(drmFd, pset, flags, nullptr);
-            DISPLAY_CHK_RETURN((ret != 0), DISPLAY_FAILURE,
-                DISPLAY_LOGE("drmModeAtomicCommit failed %{public}d errno %{public}d", ret, errno));
+            int32_t ret = builder.Commit(drmFd, flags);
+            DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("commit the mode failed"));
             mCrtc->ClearModeSet();
+            // the planes of the crtc may be reset by the mode set, the next frame sets all of them
+            mDrmDevice->GetAtomicState()->Clear();
         }
     }
     return DISPLAY_SUCCESS;
 }
 
-int32_t HdiDrmComposition::RemoveUnusePlane(drmModeAtomicReqPtr pset)
+void HdiDrmComposition::RemoveUnusePlane(DrmAtomicBuilder &builder,
+    const std::vector<DrmPlaneAssignment> &assignments)
 {
-    int ret = 0;
     /* Remove useless planes from the drm */
-    for (uint32_t j = 0; j < mPlanes.size(); j++) {
-        auto &drmPlane = mPlanes[j];
-        if ((static_cast<int>(drmPlane->GetWinType()) & mCrtc->GetPlaneMask()) &&  drmPlane->GetPipe() == 0) {
-            DISPLAY_LOGD("no used plane %{public}s id %{public}d", drmPlane->GetName().c_str(), drmPlane->GetId());
-            ret = drmModeAtomicAddProperty(pset, drmPlane->GetId(), drmPlane->GetPropFbId(), 0);
-            ret = drmModeAtomicAddProperty(pset, drmPlane->GetId(), drmPlane->GetPropFbId(), 0);
-            drmPlane->UnBindPipe();
+    for (auto &drmPlane : mPlanes) {
+        if (!(static_cast<int>(drmPlane->GetWinType()) & mCrtc->GetPlaneMask())) {
+            continue;
+        }
+        if ((drmPlane->GetPipe() != 0) && (drmPlane->GetPipe() != (1 << mCrtc->GetPipe()))) {
+            continue;
+        }
+        auto isAssigned = [&drmPlane](const DrmPlaneAssignment &assignment) {
+            return assignment.plane == drmPlane;
+        };
+        if (std::any_of(assignments.begin(), assignments.end(), isAssigned)) {
+            continue;
         }
+        DISPLAY_LOGD("no used plane %{public}s id %{public}d", drmPlane->GetName().c_str(), drmPlane->GetId());
+        // the drm rejects a plane with the crtc but without the fb, so both of them are cleared
+        builder.AddProperty(drmPlane->GetId(), drmPlane->GetPropFbId(), 0);
+        builder.AddProperty(drmPlane->GetId(), drmPlane->GetPropCrtcId(), 0);
     }
-    return DISPLAY_SUCCESS;
 }
 
-int32_t HdiDrmComposition::FindPlaneAndApply(drmModeAtomicReqPtr pset)
+int32_t HdiDrmComposition::FindPlaneAndApply(DrmAtomicBuilder &builder)
 {
-    int32_t ret = 0;
-    for (uint32_t i = 0; i < mCompLayers.size(); i++) {
-        HdiDrmLayer *layer = static_cast<HdiDrmLayer *>(mCompLayers[i]);
-        HdiLayer *hlayer = mCompLayers[i];
-        for (uint32_t j = 0; j < mPlanes.size(); j++) {
-            auto &drmPlane = mPlanes[j];
-            if (drmPlane->GetPipe() != 0 && drmPlane->GetPipe() != (1 << mCrtc->GetPipe())) {
-                DISPLAY_LOGD("plane %{public}d used pipe %{public}d crtc pipe %{public}d", drmPlane->GetId(),
-                    drmPlane->GetPipe(), mCrtc->GetPipe());
-                continue;
-            }
-            /* Check whether the plane belond to the crtc */
-            if (!(static_cast<int>(drmPlane->GetWinType()) & mCrtc->GetPlaneMask())) {
-                continue;
-            }
-            DISPLAY_LOGD("use plane %{public}d WinType %{public}x crtc %{public}d PlaneMask %{public}x",
-                drmPlane->GetId(), drmPlane->GetWinType(), mCrtc->GetId(), mCrtc->GetPlaneMask());
-
-            if (drmPlane->GetCrtcId() == mCrtc->GetId() || drmPlane->GetCrtcId() == 0) {
-                ret = ApplyPlane(*layer, *hlayer, *drmPlane, pset);
-                if (ret != DISPLAY_SUCCESS) {
-                    DISPLAY_LOGE("apply plane failed");
-                    break;
-                }
-                /* mark the plane is used by crtc */
-                drmPlane->BindToPipe(1 << mCrtc->GetPipe());
-                break;
-            }
+    // release the planes of the last frame, the unused ones are disabled by RemoveUnusePlane
+    for (auto &drmPlane : mUsedPlanes) {
+        drmPlane->UnBindPipe();
+    }
+    mUsedPlanes.clear();
+    for (auto &assignment : mAssignments) {
+        DISPLAY_LOGD("use plane %{public}d WinType %{public}x crtc %{public}d PlaneMask %{public}x",
+            assignment.plane->GetId(), assignment.plane->GetWinType(), mCrtc->GetId(), mCrtc->GetPlaneMask());
+        int32_t ret = ApplyPlane(assignment, builder, true);
+        if (ret != DISPLAY_SUCCESS) {
+            DISPLAY_LOGE("apply plane %{public}d failed", assignment.plane->GetId());
+            continue;
         }
+        /* mark the plane is used by crtc */
+        assignment.plane->BindToPipe(1 << mCrtc->GetPipe());
+        mUsedPlanes.push_back(assignment.plane);
     }
     return DISPLAY_SUCCESS;
 }
@@ -267,18 +466,12 @@ int32_t HdiDrmComposition::Apply(bool modeSet)
 
     DISPLAY_LOGD("mPlane size: %{public}zd mCompLayers size: %{public}zd", mPlanes.size(), mCompLayers.size());
     DISPLAY_CHK_RETURN((mPlanes.size() < mCompLayers.size()), DISPLAY_FAILURE, DISPLAY_LOGE("plane not enough"));
-    drmModeAtomicReqPtr pset = drmModeAtomicAlloc();
-    DISPLAY_CHK_RETURN((pset == nullptr), DISPLAY_NULL_PTR,
-        DISPLAY_LOGE("drm atomic alloc failed errno %{public}d", errno));
-    AtomicReqPtr atomicReqPtr = AtomicReqPtr(pset);
+    DrmAtomicBuilder builder(mDrmDevice->GetAtomicState());
 
     // set the outFence property
-    ret = drmModeAtomicAddProperty(atomicReqPtr.Get(), mCrtc->GetId(), mCrtc->GetOutFencePropId(),
-        (uint64_t)&crtcOutFence);
-
     DISPLAY_LOGD("Apply Set OutFence crtc id: %{public}d, fencePropId %{public}d", mCrtc->GetId(),
         mCrtc->GetOutFencePropId());
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE, DISPLAY_LOGE("set the outfence property of crtc failed "));
+    builder.AddVolatileProperty(mCrtc->GetId(), mCrtc->GetOutFencePropId(), (uint64_t)&crtcOutFence);
 
     // set the plane info.
     DISPLAY_LOGD("mCompLayers size %{public}zd", mCompLayers.size());
@@ -286,30 +479,25 @@ int32_t HdiDrmComposition::Apply(bool modeSet)
         mConnector->GetId(), mConnector->GetEncoderId());
 
     /*  Bind the plane not used by other crtcs to the crtc. */
-    FindPlaneAndApply(atomicReqPtr.Get());
+    FindPlaneAndApply(builder);
     /* Remove useless planes from the drm */
-    RemoveUnusePlane(atomicReqPtr.Get());
-
-    ret = drmModeAtomicAddProperty(pset, mConnector->GetId(), mConnector->GetPropCrtcId(), mCrtc->GetId());
-    DISPLAY_LOGD("set the connector id: %{public}d, propId %{public}d, crtcId %{public}d", mConnector->GetId(),
-        mConnector->GetPropCrtcId(), mCrtc->GetId());
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE,
-        DISPLAY_LOGE("can not add the crtc id prop %{public}d", errno));
-
-    // set to active
-    DISPLAY_LOGD("set crtc to active");
-    ret = drmModeAtomicAddProperty(pset, mCrtc->GetId(), mCrtc->GetActivePropId(), 1);
-    DISPLAY_CHK_RETURN((ret < 0), DISPLAY_FAILURE,
-        DISPLAY_LOGE("can not add the active prop errno %{public}d", errno));
+    RemoveUnusePlane(builder, mAssignments);
+    SetConnectorProperty(builder);
 
     uint32_t flags = DRM_MODE_ATOMIC_NONBLOCK;
 
-    ret = drmModeAtomicCommit(drmFd, atomicReqPtr.Get(), flags, nullptr);
-    DISPLAY_CHK_RETURN((ret != 0), DISPLAY_FAILURE,
-        DISPLAY_LOGE("drmModeAtomicCommit failed %{public}d errno %{public}d", ret, errno));
-    // set the release fence
-    for (auto layer : mCompLayers) {
-        layer->SetReleaseFence(static_cast<int>(crtcOutFence));
+    int64_t commitNs = HdiFrameTrace::GetNowNs();
+    ret = builder.Commit(drmFd, flags);
+    DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("commit the frame failed"));
+    if (mFrameTrace != nullptr) {
+        mFrameTrace->AddStage(FRAME_STAGE_COMMIT, commitNs, HdiFrameTrace::GetNowNs());
+        mFrameTrace->SetOutFence(static_cast<int>(crtcOutFence));
+    }
+    mDrmDevice->GetFbCache()->AdvanceFrame();
+    // set the release fence, every layer owns its own fd
+    for (uint32_t i = 0; i < mCompLayers.size(); i++) {
+        int fence = static_cast<int>(crtcOutFence);
+        mCompLayers[i]->SetReleaseFence((i == 0) ? fence : dup(fence));
     }
 
     return DISPLAY_SUCCESS;
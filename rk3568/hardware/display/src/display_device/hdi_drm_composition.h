@@ -19,6 +19,7 @@
 #include <memory>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
+#include "drm_atomic_builder.h"
 #include "drm_device.h"
 #include "hdi_composer.h"
 #include "hdi_device_common.h"
@@ -27,21 +28,22 @@
 namespace OHOS {
 namespace HDI {
 namespace DISPLAY {
-class AtomicReqPtr {
-public:
-    explicit AtomicReqPtr(drmModeAtomicReqPtr ptr) : mPtr(ptr) {}
-    virtual ~AtomicReqPtr()
-    {
-        if (mPtr != nullptr)
-            drmModeAtomicFree(mPtr);
-    }
-    drmModeAtomicReqPtr Get() const
-    {
-        return mPtr;
-    }
+// the scale ratio limit of the planes with the scale feature
+const int32_t PLANE_MAX_SCALE = 8;
 
-private:
-    drmModeAtomicReqPtr mPtr;
+// the candidates of the plane assignment, a rejected candidate falls back to the lower one
+enum PlaneAssignLevel {
+    PLANE_ASSIGN_CLIENT = 0,
+    PLANE_ASSIGN_VIDEO,
+    PLANE_ASSIGN_ALL,
+};
+
+struct DrmPlaneAssignment {
+    HdiLayer *layer = nullptr;
+    std::shared_ptr<DrmPlane> plane;
+    uint64_t rotation = DRM_MODE_ROTATE_0;
+    uint64_t zpos = 0;
+    bool isClient = false;
 };
 
 class HdiDrmComposition : public HdiComposition {
@@ -56,11 +58,23 @@ public:
     int32_t UpdateMode(std::unique_ptr<DrmModeBlock> &modeBlock);
 
 private:
-    int32_t ApplyPlane(HdiDrmLayer &layer, HdiLayer &hlayer, DrmPlane &drmPlane, drmModeAtomicReqPtr pset);
-    int32_t SetSrcProperty(DrmPlane &drmPlane, drmModeAtomicReqPtr pset, int32_t bufferW, int32_t bufferH);
-    int32_t SetCrtcProperty(DrmPlane &drmPlane, drmModeAtomicReqPtr pset, int32_t bufferW, int32_t bufferH);
-    int32_t RemoveUnusePlane(drmModeAtomicReqPtr pset);
-    int32_t FindPlaneAndApply(drmModeAtomicReqPtr pset);
+    int32_t ApplyPlane(const DrmPlaneAssignment &assignment, DrmAtomicBuilder &builder, bool withFence);
+    void SetSrcProperty(DrmPlane &drmPlane, DrmAtomicBuilder &builder, const IRect &src);
+    void SetCrtcProperty(DrmPlane &drmPlane, DrmAtomicBuilder &builder, const IRect &dst);
+    void SetConnectorProperty(DrmAtomicBuilder &builder);
+    void RemoveUnusePlane(DrmAtomicBuilder &builder, const std::vector<DrmPlaneAssignment> &assignments);
+    int32_t FindPlaneAndApply(DrmAtomicBuilder &builder);
+    bool TestAssignments(const std::vector<DrmPlaneAssignment> &assignments);
+    bool IsPlaneAvailable(DrmPlane &drmPlane) const;
+    bool CanPlaneShowLayer(DrmPlane &drmPlane, HdiLayer &layer, uint64_t &rotation) const;
+    bool AssignPlane(HdiLayer &layer, std::vector<std::shared_ptr<DrmPlane>> &freePlanes,
+        std::vector<DrmPlaneAssignment> &assignments);
+    void AssignPlanes(std::vector<HdiLayer *> &layers, HdiLayer &clientLayer,
+        std::vector<std::shared_ptr<DrmPlane>> freePlanes, PlaneAssignLevel level);
+    static uint64_t ConvertToDrmRotation(TransformType type);
+    static void GetLayerSrcRect(HdiLayer &layer, IRect &src);
+    std::vector<DrmPlaneAssignment> mAssignments;
+    std::vector<std::shared_ptr<DrmPlane>> mUsedPlanes;
     std::shared_ptr<DrmDevice> mDrmDevice;
     std::shared_ptr<DrmConnector> mConnector;
     std::shared_ptr<DrmCrtc> mCrtc;
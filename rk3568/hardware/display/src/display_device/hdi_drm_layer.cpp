@@ -18,6 +18,7 @@
 #include <cerrno>
 #include "display_log.h"
 #include "drm_device.h"
+#include "hdi_perf_counter.h"
 
 namespace OHOS {
 namespace HDI {
@@ -38,12 +39,15 @@ void DrmGemBuffer::Init(int drmFd, HdiLayerBuffer &hdl)
     DISPLAY_LOGD("hdl %{public}" PRIx64 "", hdl.GetPhysicalAddr());
     DISPLAY_CHK_RETURN_NOT_VALUE((drmFd < 0), DISPLAY_LOGE("can not init drmfd %{public}d", drmFd));
     mDrmFormat = DrmDevice::ConvertToDrmFormat(static_cast<PixelFormat>(hdl.GetFormat()));
+    HdiPerfStats::GetInstance().Count(PERF_PRIME_IMPORT);
     ret = drmPrimeFDToHandle(drmFd, hdl.GetFb(), &mGemHandle);
     DISPLAY_CHK_RETURN_NOT_VALUE((ret != 0), DISPLAY_LOGE("can not get handle errno %{public}d", errno));
 
     pitches[0] = hdl.GetStride();
     gemHandles[0] = mGemHandle;
     offsets[0] = 0;
+    SetChromaPlanes(hdl, gemHandles, pitches, offsets);
+    HdiPerfStats::GetInstance().Count(PERF_FB_ADD);
     ret = drmModeAddFB2(drmFd, hdl.GetWight(), hdl.GetHeight(), mDrmFormat, gemHandles, pitches, offsets, &mFdId, 0);
     DISPLAY_LOGD("mGemHandle %{public}d  mFdId %{public}d", mGemHandle, mFdId);
     DISPLAY_LOGD("w: %{public}d  h: %{public}d mDrmFormat : %{public}d gemHandles: %{public}d pitches: %{public}d "
@@ -52,10 +56,47 @@ void DrmGemBuffer::Init(int drmFd, HdiLayerBuffer &hdl)
     DISPLAY_CHK_RETURN_NOT_VALUE((ret != 0), DISPLAY_LOGE("can not add fb errno %{public}d", errno));
 }
 
+void DrmGemBuffer::SetChromaPlanes(HdiLayerBuffer &hdl, uint32_t *gemHandles, uint32_t *pitches, uint32_t *offsets)
+{
+    // the chroma planes follow the luma plane in the same buffer, the stride is the pitch of the luma plane
+    uint32_t lumaSize = static_cast<uint32_t>(hdl.GetStride()) * static_cast<uint32_t>(hdl.GetHeight());
+    switch (mDrmFormat) {
+        case DRM_FORMAT_NV12:
+        case DRM_FORMAT_NV21:
+        case DRM_FORMAT_NV16:
+        case DRM_FORMAT_NV61:
+            gemHandles[1] = mGemHandle;
+            pitches[1] = pitches[0];
+            offsets[1] = lumaSize;
+            break;
+        case DRM_FORMAT_YUV420:
+        case DRM_FORMAT_YVU420:
+            gemHandles[1] = mGemHandle;
+            gemHandles[2] = mGemHandle;
+            pitches[1] = pitches[0] / 2; // 2: the chroma width is half of the luma
+            pitches[2] = pitches[1];
+            offsets[1] = lumaSize;
+            offsets[2] = lumaSize + lumaSize / 4; // 4: the chroma plane is a quarter of the luma
+            break;
+        case DRM_FORMAT_YUV422:
+        case DRM_FORMAT_YVU422:
+            gemHandles[1] = mGemHandle;
+            gemHandles[2] = mGemHandle;
+            pitches[1] = pitches[0] / 2; // 2: the chroma width is half of the luma
+            pitches[2] = pitches[1];
+            offsets[1] = lumaSize;
+            offsets[2] = lumaSize + lumaSize / 2; // 2: the chroma plane is half of the luma
+            break;
+        default:
+            break;
+    }
+}
+
 DrmGemBuffer::~DrmGemBuffer()
 {
     DISPLAY_LOGD();
     if (mFdId) {
+        HdiPerfStats::GetInstance().Count(PERF_FB_REMOVE);
         if (drmModeRmFB(mDrmFd, mFdId)) {
             DISPLAY_LOGE("can not free fdid %{public}d errno %{public}d", mFdId, errno);
         }
@@ -64,6 +105,7 @@ DrmGemBuffer::~DrmGemBuffer()
     if (mGemHandle) {
         struct drm_gem_close gemClose = { 0 };
         gemClose.handle = mGemHandle;
+        HdiPerfStats::GetInstance().Count(PERF_GEM_CLOSE);
         if (drmIoctl(mDrmFd, DRM_IOCTL_GEM_CLOSE, &gemClose)) {
             DISPLAY_LOGD("can not free gem handle %{public}d errno : %{public}d", mGemHandle, errno);
         }
@@ -76,10 +118,54 @@ bool DrmGemBuffer::IsValid()
     return (mGemHandle != INVALID_DRM_ID) && (mFdId != INVALID_DRM_ID);
 }
 
+HdiDrmLayer::~HdiDrmLayer()
+{
+    // the buffers of the destroyed layer will not be presented again
+    if (mFbCache != nullptr) {
+        mRecentBuffers.clear();
+        mCurrentBuffer = nullptr;
+        mLastBuffer = nullptr;
+        mFbCache->ReleaseUnused();
+    }
+}
+
+void HdiDrmLayer::KeepRecentBuffer(const std::shared_ptr<DrmGemBuffer> &buffer)
+{
+    mBufferSeq++;
+    bool found = false;
+    for (auto iter = mRecentBuffers.begin(); iter != mRecentBuffers.end();) {
+        if (iter->buffer == buffer) {
+            iter->seq = mBufferSeq;
+            found = true;
+        }
+        // not presented through a whole cycle of the queue, the producer has freed or reallocated it
+        if (mBufferSeq - iter->seq > FB_CACHE_LAYER_BUFFERS) {
+            iter = mRecentBuffers.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+    if (!found && buffer->IsValid()) {
+        mRecentBuffers.push_back({ buffer, mBufferSeq });
+    }
+}
+
 DrmGemBuffer *HdiDrmLayer::GetGemBuffer()
 {
     DISPLAY_LOGD();
-    std::unique_ptr<DrmGemBuffer> ptr = std::make_unique<DrmGemBuffer>(DrmDevice::GetDrmFd(), *GetCurrentBuffer());
+    HdiLayerBuffer *layerBuffer = GetCurrentBuffer();
+    DISPLAY_CHK_RETURN((layerBuffer == nullptr), nullptr, DISPLAY_LOGE("the layer buffer is null"));
+    std::shared_ptr<DrmGemBuffer> ptr;
+    if (mFbCache != nullptr) {
+        ptr = mFbCache->GetGemBuffer(DrmDevice::GetDrmFd(), *layerBuffer);
+        // the buffer is already got for the test commit of this frame, keep the last buffer
+        if (ptr == mCurrentBuffer) {
+            return mCurrentBuffer.get();
+        }
+        KeepRecentBuffer(ptr);
+    } else {
+        ptr = std::make_shared<DrmGemBuffer>(DrmDevice::GetDrmFd(), *layerBuffer);
+    }
     mLastBuffer = std::move(mCurrentBuffer);
     mCurrentBuffer = std::move(ptr);
     return mCurrentBuffer.get();
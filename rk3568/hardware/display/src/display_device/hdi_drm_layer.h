@@ -15,9 +15,11 @@
 
 #ifndef HDI_DRM_LAYER_H
 #define HDI_DRM_LAYER_H
+#include <vector>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 #include "buffer_handle.h"
+#include "drm_fb_cache.h"
 #include "drm_fourcc.h"
 #include "hdi_layer.h"
 #include "hdi_device_common.h"
@@ -38,6 +40,7 @@ public:
 
 private:
     void Init(int drmFd, HdiLayerBuffer &hdl);
+    void SetChromaPlanes(HdiLayerBuffer &hdl, uint32_t *gemHandles, uint32_t *pitches, uint32_t *offsets);
     uint32_t mGemHandle = 0;
     uint32_t mFdId = 0;
     int mDrmFd = -1; // the fd can not close. the other module will close it.
@@ -46,14 +49,25 @@ private:
 
 class HdiDrmLayer : public HdiLayer {
 public:
-    explicit HdiDrmLayer(LayerType type) : HdiLayer(type) {}
-    ~HdiDrmLayer() override {}
+    explicit HdiDrmLayer(LayerType type, std::shared_ptr<DrmFbCache> fbCache = nullptr)
+        : HdiLayer(type), mFbCache(fbCache) {}
+    ~HdiDrmLayer() override;
     // Return value optimization
     DrmGemBuffer *GetGemBuffer();
 
 private:
-    std::unique_ptr<DrmGemBuffer> mCurrentBuffer;
-    std::unique_ptr<DrmGemBuffer> mLastBuffer;
+    struct RecentBuffer {
+        std::shared_ptr<DrmGemBuffer> buffer;
+        uint64_t seq;
+    };
+    void KeepRecentBuffer(const std::shared_ptr<DrmGemBuffer> &buffer);
+
+    std::shared_ptr<DrmFbCache> mFbCache;
+    std::shared_ptr<DrmGemBuffer> mCurrentBuffer;
+    std::shared_ptr<DrmGemBuffer> mLastBuffer;
+    // the buffers of the queue of the producer, they keep their entries in the fb cache
+    std::vector<RecentBuffer> mRecentBuffers;
+    uint64_t mBufferSeq = 0;
 };
 } // namespace OHOS
 } // namespace HDI
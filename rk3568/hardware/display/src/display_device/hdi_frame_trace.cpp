@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hdi_frame_trace.h"
+#include <algorithm>
+#include <ctime>
+#include <sstream>
+#include <unistd.h>
+#include <linux/sync_file.h>
+#include <sys/ioctl.h>
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+namespace {
+const int64_t NS_PER_SECOND = 1000000000;
+const int64_t NS_PER_US = 1000;
+const uint32_t READ_RETRY = 4;
+const uint32_t PERCENT = 100;
+const uint32_t PERCENTILES[] = { 50, 90, 99 };
+
+int64_t GetPercentile(std::vector<int64_t> &values, uint32_t percent)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = (values.size() - 1) * percent / PERCENT;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void DumpPercentiles(std::ostringstream &oss, const char *name, std::vector<int64_t> &values)
+{
+    if (values.empty()) {
+        return;
+    }
+    oss << "  " << name << ":";
+    for (auto percent : PERCENTILES) {
+        oss << " p" << percent << " " << (GetPercentile(values, percent) / NS_PER_US) << "us";
+    }
+    oss << " max " << (*std::max_element(values.begin(), values.end()) / NS_PER_US) << "us\n";
+}
+}
+
+HdiFrameTrace::~HdiFrameTrace()
+{
+    if (mOutFence >= 0) {
+        close(mOutFence);
+    }
+    for (auto &pending : mPendingFences) {
+        close(pending.fd);
+    }
+}
+
+int64_t HdiFrameTrace::GetNowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * NS_PER_SECOND + ts.tv_nsec;
+}
+
+int64_t HdiFrameTrace::GetSignalNs(int fd)
+{
+    struct sync_fence_info fenceInfo = {};
+    struct sync_file_info fileInfo = {};
+    // the out fence of the crtc has only one fence
+    fileInfo.num_fences = 1;
+    fileInfo.sync_fence_info = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&fenceInfo));
+    if ((ioctl(fd, SYNC_IOC_FILE_INFO, &fileInfo) != 0) || (fileInfo.status < 0)) {
+        return -1;
+    }
+    // the timestamp of the fence is in the monotonic clock
+    return (fileInfo.status == 0) ? 0 : static_cast<int64_t>(fenceInfo.timestamp_ns);
+}
+
+void HdiFrameTrace::BeginFrame()
+{
+    ResolveFences();
+    if (mOutFence >= 0) {
+        close(mOutFence);
+        mOutFence = -1;
+    }
+    // the frame prepared again without the commit is started over
+    mCurrent = HdiFrameRecord();
+    mCurrent.beginNs = GetNowNs();
+    mInFrame = true;
+}
+
+void HdiFrameTrace::SetLayers(const std::vector<HdiLayer *> &layers)
+{
+    if (!mInFrame) {
+        return;
+    }
+    mCurrent.layerCount = static_cast<uint32_t>(layers.size());
+    uint32_t count = std::min(mCurrent.layerCount, FRAME_TRACE_MAX_LAYERS);
+    for (uint32_t i = 0; i < count; i++) {
+        mCurrent.layerTypes[i] = static_cast<uint8_t>(layers[i]->GetCompositionType());
+    }
+}
+
+void HdiFrameTrace::AddStage(HdiFrameStage stage, int64_t beginNs, int64_t endNs)
+{
+    if (!mInFrame) {
+        return;
+    }
+    mCurrent.stageNs[stage] += endNs - beginNs;
+}
+
+void HdiFrameTrace::SetOutFence(int fd)
+{
+    if (!mInFrame || (fd < 0)) {
+        return;
+    }
+    if (mOutFence >= 0) {
+        close(mOutFence);
+    }
+    mOutFence = dup(fd);
+}
+
+void HdiFrameTrace::EndFrame()
+{
+    if (!mInFrame) {
+        return;
+    }
+    mInFrame = false;
+    mCurrent.commitNs = GetNowNs();
+    mCurrent.frame = mFrames.load(std::memory_order_relaxed) + 1;
+    Publish(mCurrent);
+    mFrames.store(mCurrent.frame, std::memory_order_release);
+    if (mOutFence >= 0) {
+        mPendingFences.push_back({ mCurrent.frame, mOutFence });
+        mOutFence = -1;
+    }
+    // the frame is not presented for long, such as the display is off
+    while (mPendingFences.size() > FRAME_TRACE_MAX_PENDING) {
+        close(mPendingFences.front().fd);
+        mPendingFences.pop_front();
+    }
+}
+
+void HdiFrameTrace::Publish(const HdiFrameRecord &record)
+{
+    Slot &slot = mSlots[(record.frame - 1) % FRAME_TRACE_SIZE];
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    // the odd sequence tells the reader the slot is being written
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record = record;
+    slot.sequence.store(sequence + 2, std::memory_order_release); // 2: the next even sequence
+}
+
+bool HdiFrameTrace::Read(uint32_t index, HdiFrameRecord &record)
+{
+    Slot &slot = mSlots[index];
+    for (uint32_t i = 0; i < READ_RETRY; i++) {
+        uint32_t begin = slot.sequence.load(std::memory_order_acquire);
+        if ((begin & 1) != 0) {
+            continue;
+        }
+        record = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == begin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HdiFrameTrace::ResolveFences()
+{
+    // the out fences of a crtc are signaled in order
+    while (!mPendingFences.empty()) {
+        PendingFence &pending = mPendingFences.front();
+        int64_t signalNs = GetSignalNs(pending.fd);
+        if (signalNs == 0) {
+            break;
+        }
+        Slot &slot = mSlots[(pending.frame - 1) % FRAME_TRACE_SIZE];
+        if ((signalNs > 0) && (slot.record.frame == pending.frame)) {
+            HdiFrameRecord record = slot.record;
+            record.presentNs = signalNs;
+            Publish(record);
+        }
+        close(pending.fd);
+        mPendingFences.pop_front();
+    }
+}
+
+void HdiFrameTrace::Dump(std::string &result)
+{
+    static const char *typeNames[COMPOSITION_BUTT] = { "client", "device", "cursor", "video", "device_clear",
+        "client_clear", "tunnel" };
+    uint64_t frames = mFrames.load(std::memory_order_acquire);
+    uint64_t count = std::min(frames, static_cast<uint64_t>(FRAME_TRACE_SIZE));
+    std::vector<HdiFrameRecord> records;
+    for (uint64_t frame = frames - count + 1; frame <= frames; frame++) {
+        HdiFrameRecord record;
+        // skip the slot overwritten by a newer frame while reading
+        if (Read((frame - 1) % FRAME_TRACE_SIZE, record) && (record.frame == frame)) {
+            records.push_back(record);
+        }
+    }
+    std::ostringstream oss;
+    oss << "frame trace: frames " << frames << " recorded " << records.size() << "\n";
+    if (records.empty()) {
+        result += oss.str();
+        return;
+    }
+
+    std::vector<int64_t> stages[FRAME_STAGE_BUTT];
+    std::vector<int64_t> latency;
+    std::vector<int64_t> intervals;
+    uint64_t types[COMPOSITION_BUTT] = {};
+    uint64_t layers = 0;
+    const HdiFrameRecord *last = nullptr;
+    for (auto &record : records) {
+        for (uint32_t stage = 0; stage < FRAME_STAGE_BUTT; stage++) {
+            stages[stage].push_back(record.stageNs[stage]);
+        }
+        uint32_t typeCount = std::min(record.layerCount, FRAME_TRACE_MAX_LAYERS);
+        for (uint32_t i = 0; i < typeCount; i++) {
+            types[std::min(static_cast<uint32_t>(record.layerTypes[i]), COMPOSITION_BUTT - 1U)]++;
+        }
+        layers += record.layerCount;
+        if (record.presentNs == 0) {
+            continue;
+        }
+        latency.push_back(record.presentNs - record.beginNs);
+        if ((last != nullptr) && (last->frame + 1 == record.frame)) {
+            intervals.push_back(record.presentNs - last->presentNs);
+        }
+        last = &record;
+    }
+
+    static const char *stageNames[FRAME_STAGE_BUTT] = { "prepare", "fence wait", "blit", "commit" };
+    for (uint32_t stage = 0; stage < FRAME_STAGE_BUTT; stage++) {
+        DumpPercentiles(oss, stageNames[stage], stages[stage]);
+    }
+    DumpPercentiles(oss, "prepare to present", latency);
+
+    // the frames are presented at the vsync when they keep up, the short intervals tell the period
+    std::vector<int64_t> sorted = intervals;
+    int64_t period = GetPercentile(sorted, 10); // 10: the interval of the frames in a row
+    uint64_t jank = 0;
+    uint64_t missed = 0;
+    uint64_t slow = 0;
+    for (auto &record : records) {
+        if (period <= 0) {
+            break;
+        }
+        if (record.commitNs - record.beginNs > period) {
+            slow++;
+        }
+        // the commit is expected to be scanned out at the next vsync
+        int64_t presentLatency = record.presentNs - record.commitNs;
+        if ((record.presentNs != 0) && (presentLatency * 2 > period * 3)) { // 2, 3: 1.5 times of the period
+            jank++;
+            missed += static_cast<uint64_t>((presentLatency + period / 2) / period - 1); // 2: round to the vsync
+        }
+    }
+    oss << "  vsync period " << (period / NS_PER_US) << "us jank " << jank << " missed vsyncs " << missed <<
+        " slow frames " << slow << "\n  layers avg " << (layers / records.size()) << ":";
+    for (uint32_t type = 0; type < COMPOSITION_BUTT; type++) {
+        if (types[type] != 0) {
+            oss << " " << typeNames[type] << " " << types[type];
+        }
+    }
+    oss << "\n";
+
+    size_t first = records.size() - std::min(records.size(), static_cast<size_t>(FRAME_TRACE_DUMP_FRAMES));
+    for (size_t i = first; i < records.size(); i++) {
+        const HdiFrameRecord &record = records[i];
+        oss << "  frame " << record.frame << " layers " << record.layerCount << " [";
+        uint32_t typeCount = std::min(record.layerCount, FRAME_TRACE_MAX_LAYERS);
+        for (uint32_t layer = 0; layer < typeCount; layer++) {
+            uint32_t type = std::min(static_cast<uint32_t>(record.layerTypes[layer]), COMPOSITION_BUTT - 1U);
+            oss << ((layer == 0) ? "" : " ") << typeNames[type];
+        }
+        oss << "]";
+        for (uint32_t stage = 0; stage < FRAME_STAGE_BUTT; stage++) {
+            oss << " " << stageNames[stage] << " " << (record.stageNs[stage] / NS_PER_US) << "us";
+        }
+        oss << " commit +" << ((record.commitNs - record.beginNs) / NS_PER_US) << "us";
+        if (record.presentNs != 0) {
+            oss << " present +" << ((record.presentNs - record.beginNs) / NS_PER_US) << "us";
+        }
+        oss << "\n";
+    }
+    result += oss.str();
+}
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
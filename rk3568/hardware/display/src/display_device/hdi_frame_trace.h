@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HDI_FRAME_TRACE_H
+#define HDI_FRAME_TRACE_H
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "hdi_layer.h"
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+const uint32_t FRAME_TRACE_SIZE = 256;
+const uint32_t FRAME_TRACE_MAX_LAYERS = 16;
+// the out fences of the committed frames which are not signaled yet
+const uint32_t FRAME_TRACE_MAX_PENDING = 4;
+// the frames printed one by one in the dump
+const uint32_t FRAME_TRACE_DUMP_FRAMES = 8;
+
+enum HdiFrameStage {
+    FRAME_STAGE_PREPARE = 0,
+    FRAME_STAGE_FENCE_WAIT,
+    FRAME_STAGE_BLIT,
+    FRAME_STAGE_COMMIT,
+    FRAME_STAGE_BUTT,
+};
+
+struct HdiFrameRecord {
+    uint64_t frame = 0;
+    int64_t beginNs = 0;
+    int64_t commitNs = 0;
+    // the time the out fence of the crtc is signaled, it is the vblank the frame is scanned out and
+    // the release of the buffers of the previous frame, 0 if it is not known yet
+    int64_t presentNs = 0;
+    int64_t stageNs[FRAME_STAGE_BUTT] = {};
+    uint32_t layerCount = 0;
+    uint8_t layerTypes[FRAME_TRACE_MAX_LAYERS] = {};
+};
+
+/*
+ * The timing of the last frames of a display. The frames are written by the composer thread only and
+ * published to a ring with a sequence per slot, so the dump reads the ring without blocking the frames.
+ */
+class HdiFrameTrace {
+public:
+    HdiFrameTrace() {}
+    virtual ~HdiFrameTrace();
+    static int64_t GetNowNs();
+    void BeginFrame();
+    void SetLayers(const std::vector<HdiLayer *> &layers);
+    void AddStage(HdiFrameStage stage, int64_t beginNs, int64_t endNs);
+    // the fd is duplicated, the caller still owns it
+    void SetOutFence(int fd);
+    void EndFrame();
+    void Dump(std::string &result);
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence { 0 };
+        HdiFrameRecord record;
+    };
+    struct PendingFence {
+        uint64_t frame;
+        int fd;
+    };
+    static int64_t GetSignalNs(int fd);
+    void Publish(const HdiFrameRecord &record);
+    bool Read(uint32_t index, HdiFrameRecord &record);
+    void ResolveFences();
+
+    Slot mSlots[FRAME_TRACE_SIZE];
+    std::atomic<uint64_t> mFrames { 0 };
+    // only used by the composer thread
+    HdiFrameRecord mCurrent;
+    bool mInFrame = false;
+    int mOutFence = -1;
+    std::deque<PendingFence> mPendingFences;
+};
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
+#endif // HDI_FRAME_TRACE_H
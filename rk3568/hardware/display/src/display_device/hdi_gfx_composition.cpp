@@ -14,9 +14,11 @@
  */
 
 #include "hdi_gfx_composition.h"
+#include <algorithm>
 #include <cinttypes>
 #include <dlfcn.h>
 #include <cerrno>
+#include <unistd.h>
 #include "display_log.h"
 #include "display_gfx.h"
 #include "hitrace_meter.h"
@@ -35,6 +37,8 @@ int32_t HdiGfxComposition::Init(void)
         DISPLAY_LOGE("GfxModuleInit failed"));
     ret = mGfxFuncs->InitGfx();
     DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE, DISPLAY_LOGE("gfx init failed"));
+    mDamageTracking = (access("/data/hdi_gfx_full_composition", F_OK) == -1);
+    DISPLAY_LOGI("damage tracking %{public}d", mDamageTracking);
     return DISPLAY_SUCCESS;
 }
 
@@ -83,8 +87,8 @@ int32_t HdiGfxComposition::GfxModuleDeinit(void)
 bool HdiGfxComposition::CanHandle(HdiLayer &hdiLayer)
 {
     DISPLAY_LOGD();
-    (void)hdiLayer;
-    return true;
+    // the video layer on a plane still needs a hole in the client layer
+    return !hdiLayer.GetPlaneSelect() || (hdiLayer.GetCompositionType() == COMPOSITION_VIDEO);
 }
 
 bool HdiGfxComposition::UseCompositionClient(std::vector<HdiLayer *> &layers)
@@ -98,7 +102,8 @@ bool HdiGfxComposition::UseCompositionClient(std::vector<HdiLayer *> &layers)
         }
         CompositionType type = layer->GetCompositionType();
         layerCount += (type != COMPOSITION_VIDEO) && (type != COMPOSITION_CURSOR);
-        hasCompositionClient = hasCompositionClient || (type == COMPOSITION_CLIENT);
+        hasCompositionClient = hasCompositionClient || (type == COMPOSITION_CLIENT) ||
+            (((type == COMPOSITION_VIDEO) || (type == COMPOSITION_CURSOR)) && !layer->GetPlaneSelect());
     }
     return hasCompositionClient || (layerCount > 4);
 }
@@ -109,14 +114,25 @@ int32_t HdiGfxComposition::SetLayers(std::vector<HdiLayer *> &layers, HdiLayer &
     CompositionType defaultCompType = UseCompositionClient(layers) ? COMPOSITION_CLIENT : COMPOSITION_DEVICE;
     mClientLayer = &clientLayer;
     mCompLayers.clear();
+    auto onPlane = [](const HdiLayer *layer) { return layer->GetPlaneSelect(); };
+    if (!layers.empty() && std::all_of(layers.begin(), layers.end(), onPlane)) {
+        DISPLAY_LOGD("all layers are scanned out by the planes");
+        for (auto &layer : layers) {
+            layer->SetDeviceSelect(layer->GetCompositionType());
+        }
+        return DISPLAY_SUCCESS;
+    }
     for (auto &layer : layers) {
         if (!CanHandle(*layer)) {
             continue;
         }
 
-        if ((layer->GetCompositionType() == COMPOSITION_VIDEO) ||
-            (layer->GetCompositionType() == COMPOSITION_CURSOR)) {
+        if (layer->GetPlaneSelect()) {
             layer->SetDeviceSelect(layer->GetCompositionType());
+        } else if ((layer->GetCompositionType() == COMPOSITION_VIDEO) ||
+            (layer->GetCompositionType() == COMPOSITION_CURSOR)) {
+            // no plane can scan out the layer, fall back to the client composition
+            layer->SetDeviceSelect(COMPOSITION_CLIENT);
         } else {
             layer->SetDeviceSelect(defaultCompType);
         }
@@ -145,13 +161,17 @@ void HdiGfxComposition::InitGfxSurface(ISurface &iSurface, HdiLayerBuffer &buffe
 }
 
 // now not handle the alpha of layer
-int32_t HdiGfxComposition::BlitLayer(HdiLayer &src, HdiLayer &dst)
+int32_t HdiGfxComposition::BlitLayer(HdiLayer &src, HdiLayer &dst, const IRect &damage)
 {
     ISurface srcSurface = { 0 };
     ISurface dstSurface = { 0 };
     GfxOpt opt = { 0 };
     StartTrace(HITRACE_TAG_HDF, "HDI:DISP:WaitAcquireFence");
+    int64_t waitNs = HdiFrameTrace::GetNowNs();
     src.WaitAcquireFence();
+    if (mFrameTrace != nullptr) {
+        mFrameTrace->AddStage(FRAME_STAGE_FENCE_WAIT, waitNs, HdiFrameTrace::GetNowNs());
+    }
     FinishTrace(HITRACE_TAG_HDF);
     DISPLAY_LOGD();
     HdiLayerBuffer *srcBuffer = src.GetCurrentBuffer();
@@ -178,6 +198,13 @@ int32_t HdiGfxComposition::BlitLayer(HdiLayer &src, HdiLayer &dst)
     DISPLAY_LOGD(" the roate type is %{public}d", opt.rotateType);
     IRect crop = src.GetLayerCrop();
     IRect displayRect = src.GetLayerDisplayRect();
+    if (!HdiDamageTracker::IsLayerTransformed(src)) {
+        // only blit the damaged part of the layer, the layer is not scaled here
+        IRect clipped = IntersectRect(displayRect, damage);
+        crop = HdiDamageTracker::GetLayerCrop(src);
+        crop = { crop.x + clipped.x - displayRect.x, crop.y + clipped.y - displayRect.y, clipped.w, clipped.h };
+        displayRect = clipped;
+    }
     DISPLAY_LOGD("crop x: %{public}d y : %{public}d w : %{public}d h: %{public}d", crop.x, crop.y, crop.w, crop.h);
     DISPLAY_LOGD("displayRect x: %{public}d y : %{public}d w : %{public}d h : %{public}d",
         displayRect.x, displayRect.y, displayRect.w, displayRect.h);
@@ -185,50 +212,59 @@ int32_t HdiGfxComposition::BlitLayer(HdiLayer &src, HdiLayer &dst)
     return mGfxFuncs->Blit(&srcSurface, &crop, &dstSurface, &displayRect, &opt);
 }
 
-int32_t HdiGfxComposition::ClearRect(HdiLayer &src, HdiLayer &dst)
+int32_t HdiGfxComposition::ClearRect(const IRect &rect, HdiLayer &dst)
 {
     ISurface dstSurface = { 0 };
     GfxOpt opt = { 0 };
     DISPLAY_LOGD();
+    if (IsRectEmpty(rect)) {
+        return DISPLAY_SUCCESS;
+    }
     HdiLayerBuffer *dstBuffer = dst.GetCurrentBuffer();
     DISPLAY_CHK_RETURN((dstBuffer == nullptr), DISPLAY_FAILURE, DISPLAY_LOGE("can not get client layer buffer"));
     InitGfxSurface(dstSurface, *dstBuffer);
-    IRect rect = src.GetLayerDisplayRect();
     DISPLAY_CHK_RETURN(mGfxFuncs == nullptr, DISPLAY_FAILURE, DISPLAY_LOGE("Rect: mGfxFuncs is null"));
-    return mGfxFuncs->FillRect(&dstSurface, &rect, 0, &opt);
+    return mGfxFuncs->FillRect(&dstSurface, const_cast<IRect *>(&rect), 0, &opt);
 }
 
-int32_t HdiGfxComposition::Apply(bool modeSet)
+IRect HdiGfxComposition::GetDamage(HdiLayer &clientLayer, bool hasDeviceLayer)
 {
-    StartTrace(HITRACE_TAG_HDF, "HDI:DISP:Apply");
-    int32_t ret;
-    DISPLAY_LOGD("composer layers size %{public}zd", mCompLayers.size());
-	
-    bool needClear = false;
-    for (uint32_t i = 0; i < mCompLayers.size(); i++) {
-        HdiLayer *layer = mCompLayers[i];
-        CompositionType compType = layer->GetCompositionType();
-        if (compType == COMPOSITION_DEVICE) {
-            needClear = true;
-            break;
-        }
+    HdiLayerBuffer *clientBuffer = clientLayer.GetCurrentBuffer();
+    if (clientBuffer == nullptr) {
+        return { 0, 0, 0, 0 };
     }
-
-    if (needClear) {
-        ClearRect(*mClientLayer, *mClientLayer);
+    IRect screen = { 0, 0, clientBuffer->GetWight(), clientBuffer->GetHeight() };
+    if (!mDamageTracking || !hasDeviceLayer) {
+        // the client buffer drawn by the client composition has no history
+        mDamageTracker.Reset();
+        return screen;
     }
+    IRect frameDamage = mDamageTracker.CollectFrameDamage(mCompLayers, screen);
+    IRect damage = mDamageTracker.GetBufferDamage(*clientBuffer, frameDamage, screen);
+    damage = IntersectRect(HdiDamageTracker::ExpandDamage(mCompLayers, damage), screen);
+    DISPLAY_LOGD("frame damage x: %{public}d y: %{public}d w: %{public}d h: %{public}d, buffer damage x: %{public}d "
+        "y: %{public}d w: %{public}d h: %{public}d", frameDamage.x, frameDamage.y, frameDamage.w, frameDamage.h,
+        damage.x, damage.y, damage.w, damage.h);
+    return damage;
+}
 
+int32_t HdiGfxComposition::ComposeLayers(const IRect &damage)
+{
+    int32_t ret;
     for (uint32_t i = 0; i < mCompLayers.size(); i++) {
         HdiLayer *layer = mCompLayers[i];
         CompositionType compType = layer->GetCompositionType();
+        if (IsRectEmpty(IntersectRect(layer->GetLayerDisplayRect(), damage))) {
+            continue;
+        }
         switch (compType) {
             case COMPOSITION_VIDEO:
-                ret = ClearRect(*layer, *mClientLayer);
+                ret = ClearRect(IntersectRect(layer->GetLayerDisplayRect(), damage), *mClientLayer);
                 DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE,
                     DISPLAY_LOGE("clear layer %{public}d failed", i));
                 break;
             case COMPOSITION_DEVICE:
-                ret = BlitLayer(*layer, *mClientLayer);
+                ret = BlitLayer(*layer, *mClientLayer, damage);
                 DISPLAY_CHK_RETURN((ret != DISPLAY_SUCCESS), DISPLAY_FAILURE,
                     DISPLAY_LOGE("blit layer %{public}d failed ", i));
                 break;
@@ -237,9 +273,51 @@ int32_t HdiGfxComposition::Apply(bool modeSet)
                 break;
         }
     }
-    FinishTrace(HITRACE_TAG_HDF);
     return DISPLAY_SUCCESS;
 }
+
+int32_t HdiGfxComposition::Apply(bool modeSet)
+{
+    StartTrace(HITRACE_TAG_HDF, "HDI:DISP:Apply");
+    int64_t beginNs = HdiFrameTrace::GetNowNs();
+    DISPLAY_LOGD("composer layers size %{public}zd", mCompLayers.size());
+
+    bool needClear = false;
+    for (uint32_t i = 0; i < mCompLayers.size(); i++) {
+        HdiLayer *layer = mCompLayers[i];
+        CompositionType compType = layer->GetCompositionType();
+        if (compType == COMPOSITION_DEVICE) {
+            needClear = true;
+            break;
+        }
+    }
+
+    IRect damage = GetDamage(*mClientLayer, needClear);
+    for (auto &layer : mCompLayers) {
+        layer->ClearDamage();
+    }
+    if (needClear) {
+        ClearRect(damage, *mClientLayer);
+    }
+
+    int32_t ret = ComposeLayers(damage);
+    // every gfx job is done before the client buffer is committed or reused, also when a layer failed
+    if (mGfxFuncs != nullptr) {
+        StartTrace(HITRACE_TAG_HDF, "HDI:DISP:GfxSync");
+        int32_t syncRet = mGfxFuncs->Sync(FENCE_TIMEOUT);
+        FinishTrace(HITRACE_TAG_HDF);
+        if (syncRet != DISPLAY_SUCCESS) {
+            DISPLAY_LOGE("gfx sync failed");
+            ret = DISPLAY_FAILURE;
+        }
+    }
+    if (mFrameTrace != nullptr) {
+        // the blit stage is the whole gfx composition including the fence waits of the layers
+        mFrameTrace->AddStage(FRAME_STAGE_BLIT, beginNs, HdiFrameTrace::GetNowNs());
+    }
+    FinishTrace(HITRACE_TAG_HDF);
+    return ret;
+}
 } // namespace OHOS
 } // namespace HDI
 } // namespace DISPLAY
@@ -17,6 +17,7 @@
 #define HDI_GFX_COMPOSITION_H
 #include "display_gfx.h"
 #include "hdi_composer.h"
+#include "hdi_damage_tracker.h"
 namespace OHOS {
 namespace HDI {
 namespace DISPLAY {
@@ -34,13 +35,18 @@ private:
     bool CanHandle(HdiLayer &hdiLayer);
     bool UseCompositionClient(std::vector<HdiLayer *> &layers);
     void InitGfxSurface(ISurface &iSurface, HdiLayerBuffer &buffer);
-    int32_t BlitLayer(HdiLayer &src, HdiLayer &dst);
-    int32_t ClearRect(HdiLayer &src, HdiLayer &dst);
+    int32_t BlitLayer(HdiLayer &src, HdiLayer &dst, const IRect &damage);
+    int32_t ClearRect(const IRect &rect, HdiLayer &dst);
+    int32_t ComposeLayers(const IRect &damage);
+    IRect GetDamage(HdiLayer &clientLayer, bool hasDeviceLayer);
     int32_t GfxModuleInit(void);
     int32_t GfxModuleDeinit(void);
     void *mGfxModule = nullptr;
     GfxFuncs *mGfxFuncs = nullptr;
     HdiLayer *mClientLayer;
+    // only redraw the damaged region of the client buffer, disabled by /data/hdi_gfx_full_composition
+    bool mDamageTracking = true;
+    HdiDamageTracker mDamageTracker;
 };
 } // namespace OHOS
 } // namespace HDI
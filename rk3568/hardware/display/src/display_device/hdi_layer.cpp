@@ -149,6 +149,8 @@ int32_t HdiLayer::SetLayerDirtyRegion(IRect *region)
     DISPLAY_CHK_RETURN((region == nullptr), DISPLAY_FAILURE, DISPLAY_LOGE("the in rect is null"));
     DISPLAY_LOGD("id : %{public}d DirtyRegion x: %{public}d y : %{public}d w : %{public}d h : %{public}d", mId,
         region->x, region->y, region->w, region->h);
+    mDirtyRegion = *region;
+    mDirtyValid = true;
     return DISPLAY_SUCCESS;
 }
 
@@ -215,6 +217,7 @@ int32_t HdiLayer::SetLayerBuffer(const BufferHandle *buffer, int32_t fence)
     std::unique_ptr<HdiLayerBuffer> layerbuffer = std::make_unique<HdiLayerBuffer>(*buffer);
     mHdiBuffer = std::move(layerbuffer);
     mAcquireFence = dup(fence);
+    mBufferChanged = true;
     if (access("/data/hdi_dump_layer", F_OK) != -1) {
         if (DumpLayerBuffer(const_cast<BufferHandle *>(buffer)) != DISPLAY_SUCCESS) {
             DISPLAY_LOGE("dump layer buffer failed");
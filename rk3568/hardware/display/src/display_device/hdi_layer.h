@@ -121,6 +121,30 @@ public:
     {
         return mDeviceSelect;
     }
+    bool IsBufferChanged() const
+    {
+        return mBufferChanged;
+    }
+    bool GetLayerDirtyRegion(IRect &region) const
+    {
+        region = mDirtyRegion;
+        return mDirtyValid;
+    }
+    // called after the damage of the layer is consumed by the composition
+    void ClearDamage()
+    {
+        mBufferChanged = false;
+        mDirtyValid = false;
+    }
+    // the layer is scanned out by a hardware plane directly
+    void SetPlaneSelect(bool planeSelect)
+    {
+        mPlaneSelect = planeSelect;
+    }
+    bool GetPlaneSelect() const
+    {
+        return mPlaneSelect;
+    }
 
     int GetAcquireFenceFd()
     {
@@ -171,6 +195,9 @@ private:
 
     IRect mDisplayRect;
     IRect mCrop;
+    IRect mDirtyRegion = { 0, 0, 0, 0 };
+    bool mDirtyValid = false;
+    bool mBufferChanged = false;
     uint32_t mZorder = -1;
     bool mPreMul = false;
     LayerAlpha mAlpha;
@@ -178,6 +205,7 @@ private:
     TransformType mTransformType = ROTATE_BUTT;
     CompositionType mCompositionType = COMPOSITION_CLIENT;
     CompositionType mDeviceSelect = COMPOSITION_CLIENT;
+    bool mPlaneSelect = false;
     BlendType mBlendType;
     std::unique_ptr<HdiLayerBuffer> mHdiBuffer;
 };
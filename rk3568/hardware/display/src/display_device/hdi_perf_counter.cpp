@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hdi_perf_counter.h"
+#include <ctime>
+#include <sstream>
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+namespace {
+const int64_t NS_PER_SECOND = 1000000000;
+const int64_t NS_PER_US = 1000;
+
+int64_t GetClockNs(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return static_cast<int64_t>(ts.tv_sec) * NS_PER_SECOND + ts.tv_nsec;
+}
+}
+
+HdiPerfStats &HdiPerfStats::GetInstance()
+{
+    static HdiPerfStats instance;
+    return instance;
+}
+
+int64_t HdiPerfStats::GetThreadCpuNs()
+{
+    return GetClockNs(CLOCK_THREAD_CPUTIME_ID);
+}
+
+int64_t HdiPerfStats::GetMonotonicNs()
+{
+    return GetClockNs(CLOCK_MONOTONIC);
+}
+
+void HdiPerfStats::UpdateMax(std::atomic<int64_t> &max, int64_t value)
+{
+    int64_t old = max.load(std::memory_order_relaxed);
+    while ((value > old) && !max.compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+    }
+}
+
+void HdiPerfStats::AddStage(HdiPerfStage stage, int64_t cpuNs, int64_t wallNs)
+{
+    mStageCount[stage].fetch_add(1, std::memory_order_relaxed);
+    mStageCpuNs[stage].fetch_add(cpuNs, std::memory_order_relaxed);
+    mStageWallNs[stage].fetch_add(wallNs, std::memory_order_relaxed);
+    UpdateMax(mStageMaxCpuNs[stage], cpuNs);
+    UpdateMax(mStageMaxWallNs[stage], wallNs);
+}
+
+HdiPerfStageStats HdiPerfStats::GetStage(HdiPerfStage stage) const
+{
+    HdiPerfStageStats stats;
+    stats.count = mStageCount[stage].load(std::memory_order_relaxed);
+    stats.cpuNs = mStageCpuNs[stage].load(std::memory_order_relaxed);
+    stats.maxCpuNs = mStageMaxCpuNs[stage].load(std::memory_order_relaxed);
+    stats.wallNs = mStageWallNs[stage].load(std::memory_order_relaxed);
+    stats.maxWallNs = mStageMaxWallNs[stage].load(std::memory_order_relaxed);
+    return stats;
+}
+
+void HdiPerfStats::Dump(std::string &result) const
+{
+    static const char *stageNames[PERF_STAGE_BUTT] = { "prepare", "commit" };
+    static const char *counterNames[PERF_COUNTER_BUTT] = { "atomic_commit", "atomic_test", "atomic_alloc",
+        "prime_import", "fb_add", "fb_remove", "gem_close", "blob_create", "vblank" };
+    std::ostringstream oss;
+    oss << std::fixed;
+    oss.precision(2); // 2: the digits of the average per frame
+    for (uint32_t stage = 0; stage < PERF_STAGE_BUTT; stage++) {
+        HdiPerfStageStats stats = GetStage(static_cast<HdiPerfStage>(stage));
+        if (stats.count == 0) {
+            continue;
+        }
+        int64_t count = static_cast<int64_t>(stats.count);
+        oss << "perf " << stageNames[stage] << ": count " << stats.count << " cpu avg " <<
+            (stats.cpuNs / count / NS_PER_US) << "us max " << (stats.maxCpuNs / NS_PER_US) << "us wall avg " <<
+            (stats.wallNs / count / NS_PER_US) << "us max " << (stats.maxWallNs / NS_PER_US) << "us\n";
+    }
+    // the ioctls of a frame are averaged by the commits
+    uint64_t frames = GetStage(PERF_STAGE_COMMIT).count;
+    oss << "perf ioctls:";
+    for (uint32_t counter = 0; counter < PERF_COUNTER_BUTT; counter++) {
+        uint64_t count = GetCount(static_cast<HdiPerfCounter>(counter));
+        oss << " " << counterNames[counter] << " " << count;
+        if (frames > 0) {
+            oss << "(" << (static_cast<double>(count) / frames) << "/frame)";
+        }
+    }
+    oss << "\n";
+    result += oss.str();
+}
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
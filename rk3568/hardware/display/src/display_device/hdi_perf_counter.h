@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HDI_PERF_COUNTER_H
+#define HDI_PERF_COUNTER_H
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+enum HdiPerfCounter {
+    PERF_ATOMIC_COMMIT = 0,
+    PERF_ATOMIC_TEST,
+    PERF_ATOMIC_ALLOC,
+    PERF_PRIME_IMPORT,
+    PERF_FB_ADD,
+    PERF_FB_REMOVE,
+    PERF_GEM_CLOSE,
+    PERF_BLOB_CREATE,
+    PERF_VBLANK,
+    PERF_COUNTER_BUTT,
+};
+
+enum HdiPerfStage {
+    PERF_STAGE_PREPARE = 0,
+    PERF_STAGE_COMMIT,
+    PERF_STAGE_BUTT,
+};
+
+struct HdiPerfStageStats {
+    uint64_t count = 0;
+    int64_t cpuNs = 0;
+    int64_t maxCpuNs = 0;
+    int64_t wallNs = 0;
+    int64_t maxWallNs = 0;
+};
+
+/*
+ * The counters of the drm ioctls and the cpu time of the composition stages, they are read from the dump
+ * to compare the cost of a frame between the builds on the same scene.
+ */
+class HdiPerfStats {
+public:
+    static HdiPerfStats &GetInstance();
+    static int64_t GetThreadCpuNs();
+    static int64_t GetMonotonicNs();
+    void Count(HdiPerfCounter counter)
+    {
+        mCounters[counter].fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64_t GetCount(HdiPerfCounter counter) const
+    {
+        return mCounters[counter].load(std::memory_order_relaxed);
+    }
+    void AddStage(HdiPerfStage stage, int64_t cpuNs, int64_t wallNs);
+    HdiPerfStageStats GetStage(HdiPerfStage stage) const;
+    void Dump(std::string &result) const;
+
+private:
+    static void UpdateMax(std::atomic<int64_t> &max, int64_t value);
+    std::atomic<uint64_t> mCounters[PERF_COUNTER_BUTT] = {};
+    std::atomic<uint64_t> mStageCount[PERF_STAGE_BUTT] = {};
+    std::atomic<int64_t> mStageCpuNs[PERF_STAGE_BUTT] = {};
+    std::atomic<int64_t> mStageMaxCpuNs[PERF_STAGE_BUTT] = {};
+    std::atomic<int64_t> mStageWallNs[PERF_STAGE_BUTT] = {};
+    std::atomic<int64_t> mStageMaxWallNs[PERF_STAGE_BUTT] = {};
+};
+
+// measure the cpu time of the calling thread and the elapsed time in the scope
+class HdiPerfScope {
+public:
+    explicit HdiPerfScope(HdiPerfStage stage)
+        : mStage(stage), mCpuStart(HdiPerfStats::GetThreadCpuNs()), mWallStart(HdiPerfStats::GetMonotonicNs())
+    {
+    }
+    ~HdiPerfScope()
+    {
+        HdiPerfStats::GetInstance().AddStage(mStage, HdiPerfStats::GetThreadCpuNs() - mCpuStart,
+            HdiPerfStats::GetMonotonicNs() - mWallStart);
+    }
+
+private:
+    HdiPerfStage mStage;
+    int64_t mCpuStart;
+    int64_t mWallStart;
+};
+} // namespace OHOS
+} // namespace HDI
+} // namespace DISPLAY
+#endif // HDI_PERF_COUNTER_H
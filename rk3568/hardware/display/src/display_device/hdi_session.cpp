@@ -81,6 +81,17 @@ int32_t HdiSession::RegHotPlugCallback(HotPlugCallback callback, void *data)
     return DISPLAY_SUCCESS;
 }
 
+void HdiSession::Dump(std::string &result)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto device : mHdiDevices) {
+        device->Dump(result);
+    }
+    for (auto &displayMap : mHdiDisplays) {
+        displayMap.second->Dump(result);
+    }
+}
+
 void HdiSession::DoHotPlugCallback(uint32_t devId, bool connect)
 {
     DISPLAY_LOGD();
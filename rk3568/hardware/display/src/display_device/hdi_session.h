@@ -66,6 +66,7 @@ public:
     int32_t RegHotPlugCallback(HotPlugCallback callback, void *data);
     void DoHotPlugCallback(uint32_t devId, bool connect);
     void HandleHotplug(bool plugIn);
+    void Dump(std::string &result);
 
 private:
     std::shared_ptr<HdiNetLinkMonitor> mNetLinkMonitor;
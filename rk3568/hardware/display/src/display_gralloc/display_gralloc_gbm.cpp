@@ -14,6 +14,7 @@
  */
 
 #include "display_gralloc_gbm.h"
+#include <algorithm>
 #include <cstdio>
 #include <unistd.h>
 #include <cerrno>
@@ -27,10 +28,17 @@
 #include <xf86drm.h>
 #include <securec.h>
 #include <linux/dma-buf.h>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <xf86drmMode.h>
 #include "drm_fourcc.h"
 #include "hisilicon_drm.h"
 #include "hi_gbm.h"
 #include "hdf_dlist.h"
+#include "display_gralloc_map_cache.h"
+#include "display_gralloc_pool.h"
 #include "display_gralloc_private.h"
 #include "display_log.h"
 #include "v1_0/display_composer_type.h"
@@ -42,6 +50,10 @@ using namespace OHOS::HDI::Display::Composer::V1_0;
 using namespace OHOS::HDI::Display::Buffer::V1_0;
 
 const char *g_drmFileNode = "/dev/dri/renderD128";
+const char *g_drmCardNode = "/dev/dri/card0";
+// the usage of the client buffers of the display, only the cpu access takes effect in the gbm
+const uint64_t PREWARM_USAGE = HBM_USE_CPU_READ | HBM_USE_CPU_WRITE | HBM_USE_MEM_DMA;
+const int DMA_BUF_SYNC_RETRY = 6;
 static GrallocManager *g_grallocManager = nullptr;
 static pthread_mutex_t g_lock;
 
@@ -227,6 +239,17 @@ static void DeInitGbmDevice(GrallocManager *grallocManager)
     grallocManager->gbmDevice = nullptr;
 }
 
+static int DmaBufferSyncIoctl(int fd, unsigned long request, void *arg)
+{
+    int retry = DMA_BUF_SYNC_RETRY;
+    int ret;
+    // the sync can be interrupted or the buffer is busy, retry only for them
+    do {
+        ret = ioctl(fd, request, arg);
+    } while ((ret < 0) && ((errno == EAGAIN) || (errno == EINTR)) && (retry-- > 0));
+    return ret;
+}
+
 static int32_t DmaBufferSync(const BufferHandle *handle, bool start)
 {
     DISPLAY_LOGD();
@@ -247,14 +270,9 @@ static int32_t DmaBufferSync(const BufferHandle *handle, bool start)
     } else {
         syncPrm.flags |= DMA_BUF_SYNC_END;
     }
-    int retry = 6;
-    int ret;
-    do {
-        ret = ioctl(handle->fd, DMA_BUF_IOCTL_SYNC, &syncPrm);
-    } while ((retry--) && (ret != -EAGAIN) && (ret != -EINTR));
-
+    int ret = DmaBufferSyncIoctl(handle->fd, DMA_BUF_IOCTL_SYNC, &syncPrm);
     if (ret < 0) {
-        DISPLAY_LOGE("sync failed");
+        DISPLAY_LOGE("sync failed errno %{public}d", errno);
         return HDF_ERR_DEVICE_BUSY;
     }
     return HDF_SUCCESS;
@@ -275,6 +293,126 @@ static void InitBufferHandle(struct gbm_bo *bo, int fd, const AllocInfo *info, P
     bufferHandle->size = hdi_gbm_bo_get_size(bo);
 }
 
+// the recycled buffer keeps the pixels of its last owner, which may be another process
+static bool ClearPoolBuffer(const GbmPoolBuffer &pooled)
+{
+    void *addr = mmap(nullptr, pooled.size, PROT_READ | PROT_WRITE, MAP_SHARED, pooled.fd, 0);
+    DISPLAY_CHK_RETURN((addr == MAP_FAILED), false, DISPLAY_LOGE("mmap the pool buffer failed %{public}d", errno));
+    struct dma_buf_sync syncPrm = { DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE };
+    (void)DmaBufferSyncIoctl(pooled.fd, DMA_BUF_IOCTL_SYNC, &syncPrm);
+    bool cleared = (memset_s(addr, pooled.size, 0, pooled.size) == EOK);
+    syncPrm.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE;
+    (void)DmaBufferSyncIoctl(pooled.fd, DMA_BUF_IOCTL_SYNC, &syncPrm);
+    munmap(addr, pooled.size);
+    return cleared;
+}
+
+static bool AllocFromPool(const GbmPoolKey &key, const AllocInfo *info, BufferHandle **buffer)
+{
+    GbmPoolBuffer pooled;
+    if (!GbmBufferPool::GetInstance().Acquire(key, pooled)) {
+        return false;
+    }
+    if (!pooled.clean && !ClearPoolBuffer(pooled)) {
+        GbmBufferPool::GetInstance().Discard(pooled);
+        return false;
+    }
+    PriBufferHandle *priBuffer = (PriBufferHandle *)malloc(sizeof(PriBufferHandle));
+    if ((priBuffer == nullptr) ||
+        (memset_s(priBuffer, sizeof(PriBufferHandle), 0, sizeof(PriBufferHandle)) != EOK)) {
+        DISPLAY_LOGE("bufferhandle malloc failed");
+        free(priBuffer);
+        if (!GbmBufferPool::GetInstance().Release(key, pooled)) {
+            close(pooled.fd);
+        }
+        return false;
+    }
+    BufferHandle *bufferHandle = &(priBuffer->hdl);
+    bufferHandle->fd = pooled.fd;
+    bufferHandle->reserveFds = 0;
+    bufferHandle->reserveInts = 0;
+    bufferHandle->stride = pooled.stride;
+    bufferHandle->width = info->width;
+    bufferHandle->height = info->height;
+    bufferHandle->usage = info->usage;
+    bufferHandle->format = info->format;
+    bufferHandle->virAddr = nullptr;
+    bufferHandle->size = pooled.size;
+    *buffer = bufferHandle;
+    return true;
+}
+
+static int32_t CreatePoolBuffer(const GbmPoolKey &key, GbmPoolBuffer &pooled)
+{
+    GRALLOC_LOCK();
+    // the prewarm thread may run after the gralloc is uninitialized
+    GrallocManager *grallocManager = g_grallocManager;
+    DISPLAY_CHK_RETURN(((grallocManager == nullptr) || (grallocManager->gbmDevice == nullptr)),
+        HDF_ERR_INVALID_PARAM, DISPLAY_LOGE("gralloc manager failed"); GRALLOC_UNLOCK());
+    struct gbm_bo *bo = hdi_gbm_bo_create(grallocManager->gbmDevice, key.width, key.height, key.format, key.usage);
+    DISPLAY_CHK_RETURN((bo == nullptr), HDF_DEV_ERR_NO_MEMORY, DISPLAY_LOGE("gbm create bo failed"); \
+        GRALLOC_UNLOCK());
+    pooled.fd = hdi_gbm_bo_get_fd(bo);
+    pooled.stride = hdi_gbm_bo_get_stride(bo);
+    pooled.size = hdi_gbm_bo_get_size(bo);
+    hdi_gbm_bo_destroy(bo);
+    GRALLOC_UNLOCK();
+    DISPLAY_CHK_RETURN((pooled.fd < 0), HDF_ERR_BAD_FD, DISPLAY_LOGE("gbm can not get fd"));
+    return HDF_SUCCESS;
+}
+
+static void GetDisplayModes(std::vector<std::pair<uint32_t, uint32_t>> &modes)
+{
+    int fd = open(g_drmCardNode, O_RDWR | O_CLOEXEC);
+    DISPLAY_CHK_RETURN_NOT_VALUE((fd < 0), DISPLAY_LOGE("open %{public}s failed", g_drmCardNode));
+    drmModeResPtr res = drmModeGetResources(fd);
+    for (int i = 0; (res != nullptr) && (i < res->count_connectors); i++) {
+        // do not probe the connector, only the current state is needed
+        drmModeConnectorPtr connector = drmModeGetConnectorCurrent(fd, res->connectors[i]);
+        if (connector == nullptr) {
+            continue;
+        }
+        if ((connector->connection == DRM_MODE_CONNECTED) && (connector->count_modes > 0)) {
+            std::pair<uint32_t, uint32_t> mode(connector->modes[0].hdisplay, connector->modes[0].vdisplay);
+            if (std::find(modes.begin(), modes.end(), mode) == modes.end()) {
+                modes.push_back(mode);
+            }
+        }
+        drmModeFreeConnector(connector);
+    }
+    if (res != nullptr) {
+        drmModeFreeResources(res);
+    }
+    close(fd);
+}
+
+static void PrewarmPool(void)
+{
+    GbmBufferPool &pool = GbmBufferPool::GetInstance();
+    uint32_t count = pool.GetPrewarmCount();
+    if (!pool.IsEnabled() || (count == 0)) {
+        return;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> modes;
+    GetDisplayModes(modes);
+    for (auto &mode : modes) {
+        GbmPoolKey key = { DRM_FORMAT_RGBA8888, mode.first, mode.second, ConvertUsageToGbm(PREWARM_USAGE) };
+        pool.SetReserve(key, count);
+        for (uint32_t i = 0; i < count; i++) {
+            // the new dma-buf is zeroed by the kernel
+            GbmPoolBuffer pooled = { -1, 0, 0, 0, true };
+            if (CreatePoolBuffer(key, pooled) != HDF_SUCCESS) {
+                break;
+            }
+            pool.OnAllocated(pooled.fd);
+            if (!pool.Release(key, pooled)) {
+                close(pooled.fd);
+            }
+        }
+        DISPLAY_LOGI("prewarm %{public}u buffers of %{public}ux%{public}u", count, mode.first, mode.second);
+    }
+}
+
 int32_t GbmAllocMem(const AllocInfo *info, BufferHandle **buffer)
 {
     DISPLAY_CHK_RETURN((info == nullptr), HDF_FAILURE, DISPLAY_LOGE("info is null"));
@@ -286,6 +424,14 @@ int32_t GbmAllocMem(const AllocInfo *info, BufferHandle **buffer)
     DISPLAY_LOGD("requeset width %{public}d, heigt %{public}d, format %{public}d",
         info->width, info->height, drmFmt);
 
+    int64_t startNs = GbmBufferPool::GetNowNs();
+    GbmPoolKey key = { drmFmt, info->width, info->height, ConvertUsageToGbm(info->usage) };
+    bool poolable = (info->usage & HBM_USE_PROTECTED) == 0;
+    if (poolable && AllocFromPool(key, info, buffer)) {
+        GbmBufferPool::GetInstance().RecordLatency(GBM_LATENCY_POOL_HIT, GbmBufferPool::GetNowNs() - startNs);
+        return HDF_SUCCESS;
+    }
+
         GRALLOC_LOCK();
     GrallocManager *grallocManager = GetGrallocManager();
     DISPLAY_CHK_RETURN((grallocManager == nullptr), HDF_ERR_INVALID_PARAM, DISPLAY_LOGE("gralloc manager failed");
@@ -319,6 +465,17 @@ int32_t GbmAllocMem(const AllocInfo *info, BufferHandle **buffer)
     *buffer = &priBuffer->hdl;
     hdi_gbm_bo_destroy(bo);
     GRALLOC_UNLOCK();
+    if (poolable) {
+        // the gem handle holds the dma-buf until the bo is destroyed
+        GbmBufferPool::GetInstance().OnAllocated(fd);
+    }
+    GbmBufferPool::GetInstance().RecordLatency(GBM_LATENCY_POOL_MISS, GbmBufferPool::GetNowNs() - startNs);
+    {
+        // only the process which allocates the buffers keeps the buffers of the display modes, the prewarm
+        // runs in the background so that the first allocation does not wait for it
+        static std::once_flag prewarmFlag;
+        std::call_once(prewarmFlag, []() { std::thread(PrewarmPool).detach(); });
+    }
     return HDF_SUCCESS;
 error:
     close(fd);
@@ -350,11 +507,27 @@ void GbmFreeMem(BufferHandle *buffer)
 {
     DISPLAY_LOGD();
     DISPLAY_CHK_RETURN_NOT_VALUE((buffer == nullptr), DISPLAY_LOGE("buffer is null"));
+    int64_t startNs = GbmBufferPool::GetNowNs();
     if ((buffer->virAddr != nullptr) && (GbmUnmap(buffer) != HDF_SUCCESS)) {
         DISPLAY_LOGE("freeMem unmap buffer failed");
     }
+    if (buffer->fd >= 0) {
+        GbmMapCache::GetInstance().Evict(buffer->fd);
+    }
+    if ((buffer->fd >= 0) && (buffer->reserveFds == 0) && ((buffer->usage & HBM_USE_PROTECTED) == 0)) {
+        GbmPoolKey key = { ConvertFormatToDrm(static_cast<PixelFormat>(buffer->format)),
+            static_cast<uint32_t>(buffer->width), static_cast<uint32_t>(buffer->height),
+            ConvertUsageToGbm(buffer->usage) };
+        GbmPoolBuffer pooled = { buffer->fd, static_cast<uint32_t>(buffer->stride),
+            static_cast<uint32_t>(buffer->size), 0, false };
+        // the pool owns the fd of the buffer allocated by this process
+        if (GbmBufferPool::GetInstance().Release(key, pooled)) {
+            buffer->fd = -1;
+        }
+    }
     CloseBufferHandle(buffer);
     free(buffer);
+    GbmBufferPool::GetInstance().RecordLatency(GBM_LATENCY_FREE, GbmBufferPool::GetNowNs() - startNs);
 }
 
 void *GbmMmap(BufferHandle *buffer)
@@ -369,10 +542,7 @@ void *GbmMmap(BufferHandle *buffer)
         DISPLAY_LOGD("the buffer has virtual addr");
         return buffer->virAddr;
     }
-    virAddr = mmap(nullptr, buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED, buffer->fd, 0);
-    if (virAddr == reinterpret_cast<void *>(MAP_FAILED)) {
-        DISPLAY_LOGE("mmap failed errno %{public}s, fd : %{public}d", strerror(errno), buffer->fd);
-    }
+    virAddr = GbmMapCache::GetInstance().Map(buffer->fd, buffer->size);
     buffer->virAddr = virAddr;
     return virAddr;
 }
@@ -389,11 +559,8 @@ int32_t GbmUnmap(BufferHandle *buffer)
         DISPLAY_LOGE("virAddr is nullptr , has not map the buffer");
         return HDF_ERR_INVALID_PARAM;
     }
-    int ret = munmap(buffer->virAddr, buffer->size);
-    if (ret != 0) {
-        DISPLAY_LOGE("munmap failed err: %{public}s", strerror(errno));
-        return HDF_FAILURE;
-    }
+    int32_t ret = GbmMapCache::GetInstance().Unmap(buffer->virAddr, buffer->size);
+    DISPLAY_CHK_RETURN((ret != HDF_SUCCESS), ret, DISPLAY_LOGE("unmap the buffer failed"));
     buffer->virAddr = nullptr;
     return HDF_SUCCESS;
 }
@@ -401,12 +568,14 @@ int32_t GbmUnmap(BufferHandle *buffer)
 int32_t GbmInvalidateCache(BufferHandle *buffer)
 {
     DISPLAY_LOGD();
+    DISPLAY_CHK_RETURN((buffer == nullptr), HDF_FAILURE, DISPLAY_LOGE("buffer is null"));
     return DmaBufferSync(buffer, true);
 }
 
 int32_t GbmFlushCache(BufferHandle *buffer)
 {
     DISPLAY_LOGD();
+    DISPLAY_CHK_RETURN((buffer == nullptr), HDF_FAILURE, DISPLAY_LOGE("buffer is null"));
     return DmaBufferSync(buffer, false);
 }
 
@@ -419,6 +588,7 @@ int32_t GbmGrallocUninitialize(void)
         GRALLOC_UNLOCK());
     grallocManager->referCount--;
     if (grallocManager->referCount < 0) {
+        GbmBufferPool::GetInstance().Clear();
         DeInitGbmDevice(grallocManager);
         free(g_grallocManager);
         g_grallocManager = nullptr;
@@ -437,6 +607,9 @@ int32_t GbmGrallocInitialize(void)
     int ret = InitGbmDevice(g_drmFileNode, grallocManager);
     DISPLAY_CHK_RETURN((ret != HDF_SUCCESS), ret, DISPLAY_LOGE("gralloc manager failed"); \
         GRALLOC_UNLOCK());
+    if (grallocManager->referCount == 0) {
+        GbmBufferPool::GetInstance().Init();
+    }
     grallocManager->referCount++;
     GRALLOC_UNLOCK();
     return HDF_SUCCESS;
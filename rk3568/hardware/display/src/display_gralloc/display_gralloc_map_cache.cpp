@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "display_gralloc_map_cache.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "display_log.h"
+#include "hdf_base.h"
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+GbmMapCache &GbmMapCache::GetInstance()
+{
+    static GbmMapCache instance;
+    return instance;
+}
+
+bool GbmMapCache::GetInode(int fd, uint64_t &ino)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    ino = static_cast<uint64_t>(st.st_ino);
+    return true;
+}
+
+void *GbmMapCache::Map(int fd, uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t ino = 0;
+    bool known = GetInode(fd, ino);
+    if (known) {
+        auto iter = mMappings.find(ino);
+        if ((iter != mMappings.end()) && (iter->second.size == size)) {
+            Mapping &mapping = iter->second;
+            if (mapping.refs == 0) {
+                mIdleCount--;
+                mIdleBytes -= mapping.size;
+            }
+            mapping.refs++;
+            mapping.lastUse = ++mSequence;
+            DISPLAY_LOGD("reuse the mapping of fd %{public}d", fd);
+            return mapping.addr;
+        }
+    }
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    DISPLAY_CHK_RETURN((addr == MAP_FAILED), nullptr,
+        DISPLAY_LOGE("mmap failed errno %{public}s, fd : %{public}d", strerror(errno), fd));
+    // the dma-buf is mapped with another size, it is not cached
+    if (known && (mMappings.find(ino) == mMappings.end())) {
+        mMappings[ino] = { addr, size, 1, ++mSequence };
+        mInodes[addr] = ino;
+    }
+    return addr;
+}
+
+int32_t GbmMapCache::Unmap(void *addr, uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto inode = mInodes.find(addr);
+    if (inode != mInodes.end()) {
+        Mapping &mapping = mMappings[inode->second];
+        if (mapping.refs > 0) {
+            mapping.refs--;
+        }
+        if (mapping.refs == 0) {
+            mIdleCount++;
+            mIdleBytes += mapping.size;
+            TrimLocked();
+        }
+        return HDF_SUCCESS;
+    }
+    int ret = munmap(addr, size);
+    DISPLAY_CHK_RETURN((ret != 0), HDF_FAILURE, DISPLAY_LOGE("munmap failed err: %{public}s", strerror(errno)));
+    return HDF_SUCCESS;
+}
+
+void GbmMapCache::Evict(int fd)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t ino = 0;
+    if (!GetInode(fd, ino)) {
+        return;
+    }
+    auto iter = mMappings.find(ino);
+    // the other handles of the dma-buf still use the mapping
+    if ((iter == mMappings.end()) || (iter->second.refs > 0)) {
+        return;
+    }
+    munmap(iter->second.addr, iter->second.size);
+    mIdleCount--;
+    mIdleBytes -= iter->second.size;
+    mInodes.erase(iter->second.addr);
+    mMappings.erase(iter);
+}
+
+void GbmMapCache::TrimLocked()
+{
+    while ((mIdleCount > MAP_CACHE_MAX_IDLE) || (mIdleBytes > MAP_CACHE_MAX_IDLE_BYTES)) {
+        auto oldest = mMappings.end();
+        for (auto iter = mMappings.begin(); iter != mMappings.end(); iter++) {
+            if ((iter->second.refs == 0) && ((oldest == mMappings.end()) ||
+                (iter->second.lastUse < oldest->second.lastUse))) {
+                oldest = iter;
+            }
+        }
+        if (oldest == mMappings.end()) {
+            break;
+        }
+        munmap(oldest->second.addr, oldest->second.size);
+        mIdleCount--;
+        mIdleBytes -= oldest->second.size;
+        mInodes.erase(oldest->second.addr);
+        mMappings.erase(oldest);
+    }
+}
+} // namespace DISPLAY
+} // namespace HDI
+} // namespace OHOS
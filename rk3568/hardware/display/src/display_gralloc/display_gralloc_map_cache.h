@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISPLAY_GRALLOC_MAP_CACHE_H
+#define DISPLAY_GRALLOC_MAP_CACHE_H
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+const uint32_t MAP_CACHE_MAX_IDLE = 16;
+const uint64_t MAP_CACHE_MAX_IDLE_BYTES = 64 * 1024 * 1024;
+
+/*
+ * The cpu mappings of the dma-bufs in this process. A mapping is shared by the handles of the same
+ * dma-buf and is kept after the last unmap, so the buffer locked every frame is only mapped once.
+ */
+class GbmMapCache {
+public:
+    static GbmMapCache &GetInstance();
+    void *Map(int fd, uint32_t size);
+    int32_t Unmap(void *addr, uint32_t size);
+    // the handle is freed, drop the idle mapping of the dma-buf
+    void Evict(int fd);
+
+private:
+    struct Mapping {
+        void *addr;
+        uint32_t size;
+        uint32_t refs;
+        uint64_t lastUse;
+    };
+    static bool GetInode(int fd, uint64_t &ino);
+    void TrimLocked();
+    std::mutex mMutex;
+    std::unordered_map<uint64_t, Mapping> mMappings;
+    std::unordered_map<void *, uint64_t> mInodes;
+    uint32_t mIdleCount = 0;
+    uint64_t mIdleBytes = 0;
+    uint64_t mSequence = 0;
+};
+} // namespace DISPLAY
+} // namespace HDI
+} // namespace OHOS
+#endif // DISPLAY_GRALLOC_MAP_CACHE_H
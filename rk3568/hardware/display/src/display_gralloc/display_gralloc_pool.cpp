@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "display_gralloc_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "display_log.h"
+#include "parameter.h"
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+namespace {
+const int64_t NS_PER_MS = 1000000;
+const int64_t NS_PER_US = 1000;
+const int64_t PSI_CHECK_INTERVAL_NS = 1000000000;
+const uint64_t BYTES_PER_MB = 1024 * 1024;
+const uint32_t PARAM_VALUE_LEN = 16;
+const uint32_t PROC_LINE_LEN = 128;
+
+uint32_t GetPoolParameter(const char *key, uint32_t def)
+{
+    char value[PARAM_VALUE_LEN] = {0};
+    if (GetParameter(key, "", value, sizeof(value)) <= 0) {
+        return def;
+    }
+    char *end = nullptr;
+    unsigned long ret = strtoul(value, &end, 10); // 10: decimal
+    return (end == value) ? def : static_cast<uint32_t>(ret);
+}
+}
+
+GbmBufferPool &GbmBufferPool::GetInstance()
+{
+    static GbmBufferPool instance;
+    return instance;
+}
+
+int64_t GbmBufferPool::GetNowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * NS_PER_MS * 1000 + ts.tv_nsec; // 1000: ms per second
+}
+
+void GbmBufferPool::Init()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMaxBytes = static_cast<uint64_t>(GetPoolParameter(GRALLOC_POOL_MAX_MB, GRALLOC_POOL_DEFAULT_MAX_MB)) *
+        BYTES_PER_MB;
+    mMaxPerBucket = GetPoolParameter(GRALLOC_POOL_MAX_PER_BUCKET, GRALLOC_POOL_DEFAULT_MAX_PER_BUCKET);
+    mIdleNs = static_cast<int64_t>(GetPoolParameter(GRALLOC_POOL_IDLE_MS, GRALLOC_POOL_DEFAULT_IDLE_MS)) * NS_PER_MS;
+    mPrewarm = GetPoolParameter(GRALLOC_POOL_PREWARM, GRALLOC_POOL_DEFAULT_PREWARM);
+    mPsiLimit = GetPoolParameter(GRALLOC_POOL_PSI_LIMIT, GRALLOC_POOL_DEFAULT_PSI_LIMIT);
+    DISPLAY_LOGI("gralloc pool max %{public}" PRIu64 " bytes %{public}u per bucket idle %{public}" PRId64
+        " ms prewarm %{public}u", mMaxBytes, mMaxPerBucket, mIdleNs / NS_PER_MS, mPrewarm);
+}
+
+void GbmBufferPool::Clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto &bucket : mBuckets) {
+        for (auto &buffer : bucket.second.buffers) {
+            close(buffer.fd);
+        }
+    }
+    mBuckets.clear();
+    mOwned.clear();
+    mBytes = 0;
+}
+
+bool GbmBufferPool::GetInode(int fd, uint64_t &ino)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    ino = static_cast<uint64_t>(st.st_ino);
+    return true;
+}
+
+bool GbmBufferPool::IsExclusive(int fd)
+{
+    // the count of the dma-buf file is the fds and the mappings of all the processes and the importers
+    char path[PROC_LINE_LEN] = {0};
+    if (snprintf(path, sizeof(path), "/proc/self/fdinfo/%d", fd) <= 0) {
+        return false;
+    }
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    long count = -1;
+    char line[PROC_LINE_LEN] = {0};
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        if (sscanf(line, "count: %ld", &count) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return count == 1;
+}
+
+bool GbmBufferPool::IsMemoryPressure(uint32_t limit)
+{
+    FILE *file = fopen("/proc/pressure/memory", "r");
+    if (file == nullptr) {
+        return false;
+    }
+    float avg10 = 0;
+    int ret = fscanf(file, "some avg10=%f", &avg10);
+    fclose(file);
+    return (ret == 1) && (avg10 > static_cast<float>(limit));
+}
+
+void GbmBufferPool::SetReserve(const GbmPoolKey &key, uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBuckets[key].reserve = count;
+}
+
+void GbmBufferPool::OnAllocated(int fd)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t ino = 0;
+    if ((mMaxBytes == 0) || !GetInode(fd, ino)) {
+        return;
+    }
+    if (mOwned.empty() && !IsExclusive(fd)) {
+        // the kernel does not show the count of the dma-buf, the buffer can not be recycled safely
+        DISPLAY_LOGW("the dma-buf fdinfo has no count, disable the gralloc pool");
+        mMaxBytes = 0;
+        return;
+    }
+    mOwned.insert(ino);
+}
+
+bool GbmBufferPool::Acquire(const GbmPoolKey &key, GbmPoolBuffer &buffer)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mMaxBytes == 0) {
+        return false;
+    }
+    TrimLocked(GetNowNs());
+    auto bucket = mBuckets.find(key);
+    if (bucket != mBuckets.end()) {
+        auto &buffers = bucket->second.buffers;
+        for (auto iter = buffers.begin(); iter != buffers.end(); iter++) {
+            // the buffer may still be used by the process it is sent to
+            if (!IsExclusive(iter->fd)) {
+                continue;
+            }
+            buffer = *iter;
+            mBytes -= iter->size;
+            buffers.erase(iter);
+            mHits++;
+            return true;
+        }
+    }
+    mMisses++;
+    return false;
+}
+
+bool GbmBufferPool::Release(const GbmPoolKey &key, const GbmPoolBuffer &buffer)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t ino = 0;
+    if (!GetInode(buffer.fd, ino) || (mOwned.find(ino) == mOwned.end())) {
+        return false;
+    }
+    if (mMaxBytes == 0) {
+        mOwned.erase(ino);
+        return false;
+    }
+    GbmPoolBuffer pooled = buffer;
+    pooled.releaseNs = GetNowNs();
+    mBuckets[key].buffers.push_front(pooled);
+    mBytes += pooled.size;
+    TrimLocked(pooled.releaseNs);
+    return true;
+}
+
+void GbmBufferPool::Discard(const GbmPoolBuffer &buffer)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t ino = 0;
+    if (GetInode(buffer.fd, ino)) {
+        mOwned.erase(ino);
+    }
+    close(buffer.fd);
+    mDrops++;
+}
+
+void GbmBufferPool::DropLocked(Bucket &bucket, std::list<GbmPoolBuffer>::iterator iter)
+{
+    uint64_t ino = 0;
+    if (GetInode(iter->fd, ino)) {
+        mOwned.erase(ino);
+    }
+    close(iter->fd);
+    mBytes -= iter->size;
+    mDrops++;
+    bucket.buffers.erase(iter);
+}
+
+void GbmBufferPool::TrimLocked(int64_t nowNs)
+{
+    bool pressure = false;
+    if ((mBytes > 0) && (nowNs - mLastPsiNs > PSI_CHECK_INTERVAL_NS)) {
+        mLastPsiNs = nowNs;
+        pressure = IsMemoryPressure(mPsiLimit);
+        if (pressure) {
+            DISPLAY_LOGI("memory pressure, drop the gralloc pool %{public}" PRIu64 " bytes", mBytes);
+        }
+    }
+    for (auto bucket = mBuckets.begin(); bucket != mBuckets.end();) {
+        auto &buffers = bucket->second.buffers;
+        uint32_t keep = pressure ? 0 : bucket->second.reserve;
+        // the oldest buffers are at the back
+        while (buffers.size() > keep) {
+            auto oldest = std::prev(buffers.end());
+            bool overCount = buffers.size() > std::max(mMaxPerBucket, keep);
+            if (!pressure && !overCount && (nowNs - oldest->releaseNs <= mIdleNs)) {
+                break;
+            }
+            DropLocked(bucket->second, oldest);
+        }
+        if (buffers.empty() && (bucket->second.reserve == 0)) {
+            bucket = mBuckets.erase(bucket);
+        } else {
+            bucket++;
+        }
+    }
+    while (mBytes > mMaxBytes) {
+        Bucket *victim = nullptr;
+        for (auto &bucket : mBuckets) {
+            auto &buffers = bucket.second.buffers;
+            if (!buffers.empty() && ((victim == nullptr) ||
+                (buffers.back().releaseNs < victim->buffers.back().releaseNs))) {
+                victim = &bucket.second;
+            }
+        }
+        if (victim == nullptr) {
+            break;
+        }
+        DropLocked(*victim, std::prev(victim->buffers.end()));
+    }
+}
+
+void GbmBufferPool::RecordLatency(GbmLatencyType type, int64_t ns)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t us = static_cast<uint64_t>((ns > 0) ? ns / NS_PER_US : 0);
+    uint32_t index = 0;
+    while ((us > 0) && (index < GRALLOC_LATENCY_BUCKETS - 1)) {
+        us >>= 1;
+        index++;
+    }
+    mLatency[type][index]++;
+    mLatencySumNs[type] += ns;
+    uint64_t total = mHits + mMisses;
+    // 256: the interval of the allocations to dump the statistics
+    if ((type != GBM_LATENCY_FREE) && (total % 256 == 0) && (access("/data/hdi_gralloc_pool_dump", F_OK) != -1)) {
+        std::string result;
+        DumpLocked(result);
+        DISPLAY_LOGI("%{public}s", result.c_str());
+    }
+}
+
+void GbmBufferPool::Dump(std::string &result)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    DumpLocked(result);
+}
+
+void GbmBufferPool::DumpLocked(std::string &result)
+{
+    static const char *latencyNames[GBM_LATENCY_BUTT] = { "alloc hit", "alloc miss", "free" };
+    std::ostringstream oss;
+    oss << "gralloc pool: bytes " << mBytes << "/" << mMaxBytes << " owned " << mOwned.size() << " hits " << mHits <<
+        " misses " << mMisses << " drops " << mDrops << "\n";
+    for (auto &bucket : mBuckets) {
+        oss << "  format 0x" << std::hex << bucket.first.format << " usage 0x" << bucket.first.usage << std::dec <<
+            " " << bucket.first.width << "x" << bucket.first.height << " buffers " <<
+            bucket.second.buffers.size() << " reserve " << bucket.second.reserve << "\n";
+    }
+    for (uint32_t type = 0; type < GBM_LATENCY_BUTT; type++) {
+        uint64_t count = 0;
+        for (uint32_t i = 0; i < GRALLOC_LATENCY_BUCKETS; i++) {
+            count += mLatency[type][i];
+        }
+        if (count == 0) {
+            continue;
+        }
+        oss << "  " << latencyNames[type] << " count " << count << " avg " <<
+            (mLatencySumNs[type] / static_cast<int64_t>(count) / NS_PER_US) << "us:";
+        for (uint32_t i = 0; i < GRALLOC_LATENCY_BUCKETS; i++) {
+            if (mLatency[type][i] != 0) {
+                oss << " <" << (1ULL << i) << "us " << mLatency[type][i];
+            }
+        }
+        oss << "\n";
+    }
+    result += oss.str();
+}
+} // namespace DISPLAY
+} // namespace HDI
+} // namespace OHOS
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISPLAY_GRALLOC_POOL_H
+#define DISPLAY_GRALLOC_POOL_H
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+
+namespace OHOS {
+namespace HDI {
+namespace DISPLAY {
+const char * const GRALLOC_POOL_MAX_MB = "persist.display.gralloc.pool_max_mb";
+const char * const GRALLOC_POOL_MAX_PER_BUCKET = "persist.display.gralloc.pool_max_per_bucket";
+const char * const GRALLOC_POOL_IDLE_MS = "persist.display.gralloc.pool_idle_ms";
+const char * const GRALLOC_POOL_PREWARM = "persist.display.gralloc.pool_prewarm";
+const char * const GRALLOC_POOL_PSI_LIMIT = "persist.display.gralloc.pool_psi_limit";
+
+const uint32_t GRALLOC_POOL_DEFAULT_MAX_MB = 64;
+const uint32_t GRALLOC_POOL_DEFAULT_MAX_PER_BUCKET = 4;
+const uint32_t GRALLOC_POOL_DEFAULT_IDLE_MS = 5000;
+const uint32_t GRALLOC_POOL_DEFAULT_PREWARM = 2;
+// the percent of the time some tasks stall on the memory in the last 10 seconds
+const uint32_t GRALLOC_POOL_DEFAULT_PSI_LIMIT = 10;
+// the buckets of the latency histogram are the power of 2 in microseconds
+const uint32_t GRALLOC_LATENCY_BUCKETS = 16;
+
+struct GbmPoolKey {
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint64_t usage;
+    bool operator<(const GbmPoolKey &other) const
+    {
+        return std::tie(format, width, height, usage) < std::tie(other.format, other.width, other.height, other.usage);
+    }
+};
+
+struct GbmPoolBuffer {
+    int fd;
+    uint32_t stride;
+    uint32_t size;
+    int64_t releaseNs;
+    // the buffer has never been handed out, the pixels of the last owner have not to be cleared
+    bool clean;
+};
+
+enum GbmLatencyType {
+    GBM_LATENCY_POOL_HIT = 0,
+    GBM_LATENCY_POOL_MISS,
+    GBM_LATENCY_FREE,
+    GBM_LATENCY_BUTT,
+};
+
+/*
+ * The dma-bufs released by this process are kept by the size class, a buffer is only handed out
+ * again when no other process or mapping holds it. The content of a recycled buffer is undefined.
+ */
+class GbmBufferPool {
+public:
+    static GbmBufferPool &GetInstance();
+    static int64_t GetNowNs();
+    void Init();
+    void Clear();
+    bool IsEnabled() const
+    {
+        return mMaxBytes > 0;
+    }
+    uint32_t GetPrewarmCount() const
+    {
+        return mPrewarm;
+    }
+    // the buffers of the active display modes are kept even if they are idle
+    void SetReserve(const GbmPoolKey &key, uint32_t count);
+    // the buffer allocated by this process can be recycled when it is freed
+    void OnAllocated(int fd);
+    bool Acquire(const GbmPoolKey &key, GbmPoolBuffer &buffer);
+    // the pool owns the fd if it returns true
+    bool Release(const GbmPoolKey &key, const GbmPoolBuffer &buffer);
+    // close the acquired buffer which can not be handed out
+    void Discard(const GbmPoolBuffer &buffer);
+    void RecordLatency(GbmLatencyType type, int64_t ns);
+    void Dump(std::string &result);
+
+private:
+    struct Bucket {
+        std::list<GbmPoolBuffer> buffers;
+        uint32_t reserve = 0;
+    };
+    static bool GetInode(int fd, uint64_t &ino);
+    static bool IsExclusive(int fd);
+    static bool IsMemoryPressure(uint32_t limit);
+    void DropLocked(Bucket &bucket, std::list<GbmPoolBuffer>::iterator iter);
+    void TrimLocked(int64_t nowNs);
+    void DumpLocked(std::string &result);
+
+    std::mutex mMutex;
+    std::map<GbmPoolKey, Bucket> mBuckets;
+    std::set<uint64_t> mOwned;
+    uint64_t mMaxBytes = 0;
+    uint32_t mMaxPerBucket = GRALLOC_POOL_DEFAULT_MAX_PER_BUCKET;
+    int64_t mIdleNs = 0;
+    uint32_t mPrewarm = 0;
+    uint32_t mPsiLimit = GRALLOC_POOL_DEFAULT_PSI_LIMIT;
+    uint64_t mBytes = 0;
+    int64_t mLastPsiNs = 0;
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+    uint64_t mDrops = 0;
+    uint64_t mLatency[GBM_LATENCY_BUTT][GRALLOC_LATENCY_BUCKETS] = {};
+    int64_t mLatencySumNs[GBM_LATENCY_BUTT] = {};
+};
+} // namespace DISPLAY
+} // namespace HDI
+} // namespace OHOS
+#endif // DISPLAY_GRALLOC_POOL_H
@@ -114,8 +114,60 @@ typedef enum VPU_API_CMD {
     VPU_API_ENC_SET_USE_LTR,
     VPU_API_ENC_SET_FRAME_QP,
     VPU_API_ENC_SET_BASE_LAYER_PID,
+    VPU_API_ENC_QUEUE_DY_CFG,               /* queue a VpuMlvecDirectiveBatch for the coming frames */
+    VPU_API_ENC_GET_DY_CFG_RESULT,          /* take the VpuMlvecDirectiveResult of the applied directives */
+    VPU_API_ENC_CLEAR_DY_CFG,               /* drop the directives not applied yet */
+
+    /*
+     * encoder output stream pool, the stream data of encoder_getstream is held until it is returned
+     * by VPU_API_ENC_PUT_STREAM instead of being freed by the client
+     */
+    VPU_API_ENC_STREAM_POOL = 0x5000,
+    VPU_API_ENC_SET_STREAM_POOL,
+    VPU_API_ENC_PUT_STREAM,
 } VPU_API_CMD;
 
+/*
+ * queued mlvec dynamic configure, a directive is applied to the first frame whose index, counted from 0
+ * since the mlvec configure, or pts with VPU_MLVEC_DIRECTIVE_BY_PTS reaches its frame
+ */
+#define VPU_MLVEC_DIRECTIVE_MAX_TID     (0x00000001)
+#define VPU_MLVEC_DIRECTIVE_MARK_LTR    (0x00000002)
+#define VPU_MLVEC_DIRECTIVE_USE_LTR     (0x00000004)
+#define VPU_MLVEC_DIRECTIVE_FRAME_QP    (0x00000008)
+#define VPU_MLVEC_DIRECTIVE_BASE_PID    (0x00000010)
+#define VPU_MLVEC_DIRECTIVE_FORCE_IDR   (0x00000020)
+#define VPU_MLVEC_DIRECTIVE_BY_PTS      (0x80000000)
+
+typedef struct VpuMlvecDirective {
+    RK_S64  frame;                  /* frame index or pts */
+    RK_U32  flags;                  /* VPU_MLVEC_DIRECTIVE_* of the fields to apply */
+    RK_U32  id;                     /* given by the client and reported back in the result */
+    RK_S32  max_tid;
+    RK_S32  mark_ltr;
+    RK_S32  use_ltr;
+    RK_S32  frame_qp;
+    RK_S32  base_layer_pid;
+} VpuMlvecDirective;
+
+typedef struct VpuMlvecDirectiveBatch {
+    VpuMlvecDirective   *directives;
+    RK_S32              count;      /* in: directives to queue, out: directives queued */
+} VpuMlvecDirectiveBatch;
+
+typedef struct VpuMlvecDirectiveResult {
+    RK_U32  id;
+    RK_U32  applied;                /* VPU_MLVEC_DIRECTIVE_* taking effect */
+    RK_U32  late;                   /* the frame had passed when the directive was queued */
+    RK_S64  frame;                  /* index of the frame taking the directive */
+    RK_S64  pts;
+} VpuMlvecDirectiveResult;
+
+typedef struct VpuMlvecDirectiveResults {
+    VpuMlvecDirectiveResult *results;
+    RK_S32                  count;  /* in: size of results, out: results taken */
+} VpuMlvecDirectiveResults;
+
 typedef struct {
     RK_U32   TimeLow;
     RK_U32   TimeHigh;
@@ -19,6 +19,7 @@
 #include "rk_list.h"
 #include <mpp_log.h>
 #include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include "hdf_log.h"
 #include "securec.h"
@@ -31,11 +32,19 @@
 #endif
 
 
+#define RK_LIST_KEY_INDEX_BITS  16
+#define RK_LIST_KEY_INDEX_MASK  ((1U << RK_LIST_KEY_INDEX_BITS) - 1)
+#define RK_LIST_MAX_NODES       (1U << RK_LIST_KEY_INDEX_BITS)
+#define RK_LIST_ALIGN(x)        (((x) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
 typedef struct rk_list_node {
     rk_list_node*   prev;
     rk_list_node*   next;
+    // the index of the node in the low bits and the times it is reused in the high bits
     RK_U32        key;
     RK_S32         size;
+    // the payload, stored after the node or allocated outside for the larger one
+    void           *data;
 } rk_list_node;
 
 static inline void list_node_init(rk_list_node *node)
@@ -50,19 +59,9 @@ static inline void list_node_init_with_key_and_size(rk_list_node *node, RK_U32 k
     node->size  = size;
 }
 
-static rk_list_node* create_list(void *data, RK_S32 size, RK_U32 key)
+static inline RK_U8 *list_node_inline_data(rk_list_node *node)
 {
-    rk_list_node *node = (rk_list_node*)malloc(sizeof(rk_list_node) + size);
-    if (node) {
-        void *dst = (void*)(node + 1);
-        list_node_init_with_key_and_size(node, key, size);
-        if (memcpy_s(dst, size, data, size) != EOK) {
-            HDF_LOGE("memcpy_s no");
-        }
-    } else {
-        HDF_LOGE("failed to allocate list node");
-    }
-    return node;
+    return (RK_U8 *)(node + 1);
 }
 
 static inline void _rk_list_add(rk_list_node * _new, rk_list_node * prev, rk_list_node * next)
@@ -83,12 +82,176 @@ static inline void rk_list_add_tail(rk_list_node *_new, rk_list_node *head)
     _rk_list_add(_new, head->prev, head);
 }
 
+static inline void _rk_list_del(rk_list_node *prev, rk_list_node *next)
+{
+    next->prev = prev;
+    prev->next = next;
+}
+
+static inline void rk_list_del_init(rk_list_node *node)
+{
+    _rk_list_del(node->prev, node->next);
+    list_node_init(node);
+}
+
+static void copy_node_data(void *data, RK_S32 size, void *src, RK_S32 src_size)
+{
+    if (data == nullptr)
+        return;
+    if (src_size != size) {
+        HDF_LOGE("node size check failed when deleting node");
+        size = (size < src_size) ? (size) : (src_size);
+    }
+    if (memcpy_s(data, size, src, size) != EOK) {
+        HDF_LOGE("memcpy_s no");
+    }
+}
+
+RK_S32 rk_list::grow_nodes()
+{
+    size_t stride = RK_LIST_ALIGN(sizeof(rk_list_node) + data_size);
+    RK_U32 total = nodes_size + node_count;
+    RK_U8 *slab = nullptr;
+    rk_list_node **new_nodes = nullptr;
+    void **new_slabs = nullptr;
+    RK_S32 i;
+
+    if (total > RK_LIST_MAX_NODES) {
+        HDF_LOGE("too many list nodes %d", total);
+        return -ENOMEM;
+    }
+    slab = (RK_U8 *)malloc(stride * node_count);
+    new_nodes = (rk_list_node **)realloc(nodes, sizeof(rk_list_node *) * total);
+    if (new_nodes)
+        nodes = new_nodes;
+    new_slabs = (void **)realloc(slabs, sizeof(void *) * (slabs_size + 1));
+    if (new_slabs)
+        slabs = new_slabs;
+    if (slab == nullptr || new_nodes == nullptr || new_slabs == nullptr) {
+        HDF_LOGE("failed to allocate list node");
+        free(slab);
+        return -ENOMEM;
+    }
+
+    slabs[slabs_size++] = slab;
+    for (i = node_count - 1; i >= 0; i--) {
+        rk_list_node *node = (rk_list_node *)(slab + stride * i);
+        list_node_init_with_key_and_size(node, nodes_size + i, 0);
+        node->data = list_node_inline_data(node);
+        node->next = free_nodes;
+        free_nodes = node;
+        nodes[nodes_size + i] = node;
+    }
+    nodes_size = total;
+    return 0;
+}
+
+rk_list_node *rk_list::get_node(void *data, RK_S32 size)
+{
+    rk_list_node *node = nullptr;
+
+    if (size < 0 || (free_nodes == nullptr && grow_nodes()))
+        return nullptr;
+
+    node = free_nodes;
+    if (size > data_size) {
+        node->data = malloc(size);
+        if (node->data == nullptr) {
+            HDF_LOGE("failed to allocate list node");
+            node->data = list_node_inline_data(node);
+            return nullptr;
+        }
+    }
+    free_nodes = node->next;
+    list_node_init(node);
+    node->size = size;
+    if (size && memcpy_s(node->data, size, data, size) != EOK) {
+        HDF_LOGE("memcpy_s no");
+    }
+    return node;
+}
+
+void rk_list::put_node(rk_list_node *node)
+{
+    if (node->data != list_node_inline_data(node)) {
+        free(node->data);
+        node->data = list_node_inline_data(node);
+    }
+    // the key of the deleted node is not found any more
+    node->key += 1U << RK_LIST_KEY_INDEX_BITS;
+    node->size = 0;
+    node->next = free_nodes;
+    free_nodes = node;
+}
+
+RK_S32 rk_list::del_node(rk_list_node *node, void *data, RK_S32 size)
+{
+    rk_list_del_init(node);
+    copy_node_data(data, size, node->data, node->size);
+    put_node(node);
+    count--;
+    return 0;
+}
+
+rk_list_node *rk_list::find_node(RK_U32 key)
+{
+    RK_U32 index = key & RK_LIST_KEY_INDEX_MASK;
+    rk_list_node *node = nullptr;
+
+    if (index >= nodes_size)
+        return nullptr;
+    node = nodes[index];
+    // the node is in the list and not reused since the key is given
+    if (node->key != key || node->prev == node)
+        return nullptr;
+    return node;
+}
+
+RK_S32 rk_list::ring_add(void *data, RK_S32 size)
+{
+    size_t stride = RK_LIST_ALIGN(sizeof(RK_S32) + data_size);
+    RK_U32 tail = ring_tail;
+    RK_U32 ring_head_now = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    RK_U8 *slot = nullptr;
+
+    if (size < 0 || size > data_size || ring == nullptr)
+        return -EINVAL;
+    if (tail - ring_head_now >= (RK_U32)node_count)
+        return -ENOMEM;
+
+    slot = ring + stride * (tail & (node_count - 1));
+    *(RK_S32 *)slot = size;
+    if (size && memcpy_s(slot + sizeof(RK_S32), size, data, size) != EOK) {
+        HDF_LOGE("memcpy_s no");
+    }
+    __atomic_store_n(&ring_tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+RK_S32 rk_list::ring_del(void *data, RK_S32 size)
+{
+    size_t stride = RK_LIST_ALIGN(sizeof(RK_S32) + data_size);
+    RK_U32 ring_head_now = ring_head;
+    RK_U32 tail = __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE);
+    RK_U8 *slot = nullptr;
+
+    if (tail == ring_head_now)
+        return -EINVAL;
+
+    slot = ring + stride * (ring_head_now & (node_count - 1));
+    copy_node_data(data, size, slot + sizeof(RK_S32), *(RK_S32 *)slot);
+    __atomic_store_n(&ring_head, ring_head_now + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
 RK_S32 rk_list::add_at_head(void *data, RK_S32 size)
 {
     RK_S32 ret = -EINVAL;
+    if (flags & RK_LIST_FLAG_SPSC)
+        return ret;
     pthread_mutex_lock(&mutex);
     if (head) {
-        rk_list_node *node = create_list(data, size, 0);
+        rk_list_node *node = get_node(data, size);
         if (node) {
             rk_list_add(node, head);
             count++;
@@ -104,9 +267,11 @@ RK_S32 rk_list::add_at_head(void *data, RK_S32 size)
 RK_S32 rk_list::add_at_tail(void *data, RK_S32 size)
 {
     RK_S32 ret = -EINVAL;
+    if (flags & RK_LIST_FLAG_SPSC)
+        return ring_add(data, size);
     pthread_mutex_lock(&mutex);
     if (head) {
-        rk_list_node *node = create_list(data, size, 0);
+        rk_list_node *node = get_node(data, size);
         if (node) {
             rk_list_add_tail(node, head);
             count++;
@@ -119,49 +284,14 @@ RK_S32 rk_list::add_at_tail(void *data, RK_S32 size)
     return ret;
 }
 
-static void release_list(rk_list_node*node, void *data, RK_S32 size)
-{
-    void *src = (void*)(node + 1);
-    if (node->size == size) {
-        if (memcpy_s(data, size, src, size) != EOK) {
-            HDF_LOGE("memcpy_s no");
-        }
-    } else {
-        HDF_LOGE("node size check failed when release_list");
-        size = (size < node->size) ? (size) : (node->size);
-        if (memcpy_s(data, size, src, size) != EOK) {
-            HDF_LOGE("memcpy_s no");
-        }
-    }
-    free(node);
-}
-
-static inline void _rk_list_del(rk_list_node *prev, rk_list_node *next)
-{
-    next->prev = prev;
-    prev->next = next;
-}
-
-static inline void rk_list_del_init(rk_list_node *node)
-{
-    _rk_list_del(node->prev, node->next);
-    list_node_init(node);
-}
-
-static inline void _list_del_node_no_lock(rk_list_node *node, void *data, RK_S32 size)
-{
-    rk_list_del_init(node);
-    release_list(node, data, size);
-}
-
 RK_S32 rk_list::del_at_head(void *data, RK_S32 size)
 {
     RK_S32 ret = -EINVAL;
+    if (flags & RK_LIST_FLAG_SPSC)
+        return ring_del(data, size);
     pthread_mutex_lock(&mutex);
     if (head && count) {
-        _list_del_node_no_lock(head->next, data, size);
-        count--;
-        ret = 0;
+        ret = del_node(head->next, data, size);
     }
     pthread_mutex_unlock(&mutex);
     return ret;
@@ -170,11 +300,11 @@ RK_S32 rk_list::del_at_head(void *data, RK_S32 size)
 RK_S32 rk_list::del_at_tail(void *data, RK_S32 size)
 {
     RK_S32 ret = -EINVAL;
+    if (flags & RK_LIST_FLAG_SPSC)
+        return ret;
     pthread_mutex_lock(&mutex);
     if (head && count) {
-        _list_del_node_no_lock(head->prev, data, size);
-        count--;
-        ret = 0;
+        ret = del_node(head->prev, data, size);
     }
     pthread_mutex_unlock(&mutex);
     return ret;
@@ -182,14 +312,15 @@ RK_S32 rk_list::del_at_tail(void *data, RK_S32 size)
 
 RK_S32 rk_list::list_is_empty()
 {
-    pthread_mutex_lock(&mutex);
-    RK_S32 ret = (count == 0);
-    pthread_mutex_unlock(&mutex);
-    return ret;
+    return (list_size() == 0);
 }
 
 RK_S32 rk_list::list_size()
 {
+    if (flags & RK_LIST_FLAG_SPSC) {
+        RK_U32 ring_head_now = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        return (RK_S32)(__atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE) - ring_head_now);
+    }
     pthread_mutex_lock(&mutex);
     RK_S32 ret = count;
     pthread_mutex_unlock(&mutex);
@@ -198,42 +329,78 @@ RK_S32 rk_list::list_size()
 
 RK_S32 rk_list::add_by_key(void *data, RK_S32 size, RK_U32 *key)
 {
-    RK_S32 ret = 0;
-    (void)data;
-    (void)size;
-    (void)key;
+    RK_S32 ret = -EINVAL;
+    if ((flags & RK_LIST_FLAG_SPSC) || key == nullptr)
+        return ret;
+    pthread_mutex_lock(&mutex);
+    if (head) {
+        rk_list_node *node = get_node(data, size);
+        if (node) {
+            rk_list_add_tail(node, head);
+            count++;
+            *key = node->key;
+            ret = 0;
+        } else {
+            ret = -ENOMEM;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
     return ret;
 }
 
 RK_S32 rk_list::del_by_key(void *data, RK_S32 size, RK_U32 key)
 {
-    RK_S32 ret = 0;
-    (void)data;
-    (void)size;
-    (void)key;
+    RK_S32 ret = -EINVAL;
+    if (flags & RK_LIST_FLAG_SPSC)
+        return ret;
+    pthread_mutex_lock(&mutex);
+    rk_list_node *node = find_node(key);
+    if (node) {
+        ret = del_node(node, data, size);
+    }
+    pthread_mutex_unlock(&mutex);
     return ret;
 }
 
 
 RK_S32 rk_list::show_by_key(void *data, RK_U32 key)
 {
-    RK_S32 ret = 0;
-    (void)data;
-    (void)key;
+    RK_S32 ret = -EINVAL;
+    if ((flags & RK_LIST_FLAG_SPSC) || data == nullptr)
+        return ret;
+    pthread_mutex_lock(&mutex);
+    rk_list_node *node = find_node(key);
+    if (node) {
+        copy_node_data(data, node->size, node->data, node->size);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&mutex);
     return ret;
 }
 
 RK_S32 rk_list::flush()
 {
+    if (flags & RK_LIST_FLAG_SPSC) {
+        // called by the consumer or after both sides stop
+        size_t stride = RK_LIST_ALIGN(sizeof(RK_S32) + data_size);
+        while (ring && ring_head != __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE)) {
+            RK_U8 *slot = ring + stride * (ring_head & (node_count - 1));
+            if (destroy) {
+                destroy((void*)(slot + sizeof(RK_S32)));
+            }
+            __atomic_store_n(&ring_head, ring_head + 1, __ATOMIC_RELEASE);
+        }
+        return 0;
+    }
     pthread_mutex_lock(&mutex);
     if (head) {
         while (count) {
             rk_list_node* node = head->next;
             rk_list_del_init(node);
             if (destroy) {
-                destroy((void*)(node + 1));
+                destroy(node->data);
             }
-            free(node);
+            put_node(node);
             count--;
         }
     }
@@ -241,10 +408,7 @@ RK_S32 rk_list::flush()
     return 0;
 }
 
-rk_list::rk_list(node_destructor func)
-    : destroy(nullptr),
-      head(nullptr),
-      count(0)
+void rk_list::init(node_destructor func, RK_U32 list_flags, RK_S32 size, RK_S32 nodes_per_slab)
 {
     pthread_mutexattr_t attr;
     pthread_mutexattr_init(&attr);
@@ -252,153 +416,259 @@ rk_list::rk_list(node_destructor func)
     pthread_mutex_init(&mutex, &attr);
     pthread_mutexattr_destroy(&attr);
     destroy = func;
+    flags = list_flags;
+    data_size = (size > 0) ? size : RK_LIST_DEFAULT_DATA_SIZE;
+    node_count = (nodes_per_slab > 0) ? nodes_per_slab : RK_LIST_DEFAULT_NODE_COUNT;
+
+    if (flags & RK_LIST_FLAG_SPSC) {
+        // the ring index wraps around by the power of 2 capacity
+        RK_S32 capacity = 1;
+        while (capacity < node_count)
+            capacity <<= 1;
+        node_count = capacity;
+        ring = (RK_U8 *)malloc(RK_LIST_ALIGN(sizeof(RK_S32) + data_size) * node_count);
+        if (nullptr == ring) {
+            HDF_LOGE("failed to allocate list ring");
+        }
+    }
     head = (rk_list_node*)malloc(sizeof(rk_list_node));
     if (nullptr == head) {
         HDF_LOGE("failed to allocate list header");
     } else {
         list_node_init_with_key_and_size(head, 0, 0);
+        head->data = nullptr;
     }
 }
 
+rk_list::rk_list(node_destructor func)
+    : destroy(nullptr),
+      head(nullptr),
+      count(0),
+      flags(0),
+      data_size(0),
+      node_count(0),
+      free_nodes(nullptr),
+      nodes(nullptr),
+      nodes_size(0),
+      slabs(nullptr),
+      slabs_size(0),
+      ring(nullptr),
+      ring_tail(0),
+      ring_head(0)
+{
+    init(func, 0, RK_LIST_DEFAULT_DATA_SIZE, RK_LIST_DEFAULT_NODE_COUNT);
+}
+
+rk_list::rk_list(node_destructor func, RK_U32 list_flags, RK_S32 size, RK_S32 nodes_per_slab)
+    : destroy(nullptr),
+      head(nullptr),
+      count(0),
+      flags(0),
+      data_size(0),
+      node_count(0),
+      free_nodes(nullptr),
+      nodes(nullptr),
+      nodes_size(0),
+      slabs(nullptr),
+      slabs_size(0),
+      ring(nullptr),
+      ring_tail(0),
+      ring_head(0)
+{
+    init(func, list_flags, size, nodes_per_slab);
+}
+
 rk_list::~rk_list()
 {
+    RK_U32 i;
+
     flush();
     if (head) free(head);
     head = nullptr;
+    for (i = 0; i < slabs_size; i++) {
+        free(slabs[i]);
+    }
+    free(slabs);
+    free(nodes);
+    free(ring);
+    slabs = nullptr;
+    nodes = nullptr;
+    ring = nullptr;
+    free_nodes = nullptr;
     destroy = nullptr;
     pthread_mutex_destroy(&mutex);
 }
 
 #if BUILD_RK_LIST_TEST
-#include "vpu_mem.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#define LOOP_RK_LIST        200000
+#define MAX_TEST_THREADS    8
 
-#define LOOP_RK_LIST    600
+// the payload of the size of VPUMemLinear_t stored by the decoder lists
+typedef struct RkListTestData_t {
+    RK_U32  id;
+    RK_U32  thread;
+    RK_U32  pad[4];
+} RkListTestData;
 
-#define COUNT_ADD       100
-#define COUNT_DEL       99
+typedef struct RkListTestCtx_t {
+    rk_list    *list;
+    RK_U32      thread;
+    int         err;
+} RkListTestCtx;
 
-static volatile int err = 0;
+typedef void *(*RK_LIST_TEST_LOOP)(void *);
 
-static int rk_list_fifo_test(rk_list *list_0)
+static double rk_list_test_now(void)
 {
-    int count;
-    VPUMemLinear_t m;
-    for (count = 0; count < COUNT_ADD; count++) {
-        err |= VPUMallocLinear(&m, 100); // 100 size
-        if (err) {
-            printf("VPUMallocLinear in rk_list_fifo_test\n");
-            break;
-        }
-        err |= list_0->add_at_head(&m, sizeof(m));
-        if (err) {
-            printf("add_at_head in rk_list_fifo_test\n");
-            break;
-        }
-    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9; // 1e9: ns per second
+}
 
-    if (!err) {
-        for (count = 0; count < COUNT_DEL; count++) {
-            err |= list_0->del_at_tail(&m, sizeof(m));
-            if (err) {
-                printf("del_at_tail in rk_list_fifo_test\n");
-                break;
-            }
-            err |= VPUFreeLinear(&m);
-            if (err) {
-                printf("VPUFreeLinear in rk_list_fifo_test\n");
-                break;
-            }
-        }
+// FIFO by add_at_tail and del_at_head, every thread gets a node back for each it adds
+static void *rk_list_test_loop_fifo(void *pdata)
+{
+    RkListTestCtx *ctx = (RkListTestCtx *)pdata;
+    RkListTestData m = { 0, ctx->thread, { 0 } };
+    int i;
+
+    for (i = 0; i < LOOP_RK_LIST && !ctx->err; i++) {
+        m.id = i;
+        ctx->err |= ctx->list->add_at_tail(&m, sizeof(m));
+        ctx->err |= ctx->list->del_at_head(&m, sizeof(m));
     }
-    return err;
+    return nullptr;
 }
 
-static int rk_list_filo_test(rk_list *list_0)
+// the key mode, the node of the key stays the same until it is deleted
+static void *rk_list_test_loop_key(void *pdata)
 {
-    int count;
-    VPUMemLinear_t m;
-    for (count = 0; count < COUNT_ADD + COUNT_DEL; count++) {
-        if (count & 1) {
-            err |= list_0->del_at_head(&m, sizeof(m));
-            if (err) {
-                printf("del_at_head in rk_list_filo_test\n");
-                break;
-            }
-            err |= VPUFreeLinear(&m);
-            if (err) {
-                printf("VPUFreeLinear in rk_list_fifo_test\n");
-                break;
-            }
-        } else {
-            err |= VPUMallocLinear(&m, 100); // 100 size
-            if (err) {
-                printf("VPUMallocLinear in rk_list_filo_test\n");
-                break;
-            }
-            err |= list_0->add_at_head(&m, sizeof(m));
-            if (err) {
-                printf("add_at_head in rk_list_fifo_test\n");
-                break;
-            }
+    RkListTestCtx *ctx = (RkListTestCtx *)pdata;
+    RkListTestData m = { 0, ctx->thread, { 0 } };
+    RkListTestData show;
+    RK_U32 key = 0;
+    int i;
+
+    for (i = 0; i < LOOP_RK_LIST && !ctx->err; i++) {
+        m.id = i;
+        ctx->err |= ctx->list->add_by_key(&m, sizeof(m), &key);
+        ctx->err |= ctx->list->show_by_key(&show, key);
+        if (show.id != m.id || show.thread != m.thread) {
+            printf("thread %d: key %x shows the wrong node\n", ctx->thread, key);
+            ctx->err = -1;
+        }
+        ctx->err |= ctx->list->del_by_key(&m, sizeof(m), key);
+        // the deleted key is not found any more
+        if (ctx->list->show_by_key(&show, key) == 0) {
+            printf("thread %d: key %x is found after deleted\n", ctx->thread, key);
+            ctx->err = -1;
         }
     }
-
-    return err;
+    return nullptr;
 }
 
-
-void *rk_list_test_loop_0(void *pdata)
+static int rk_list_test_threads(const char *name, RK_LIST_TEST_LOOP loop, int threads, int ops_per_loop)
 {
+    rk_list *list_0 = new rk_list(nullptr);
+    pthread_t thread[MAX_TEST_THREADS];
+    RkListTestCtx ctx[MAX_TEST_THREADS];
+    double start = rk_list_test_now();
+    double used = 0;
+    int err = 0;
     int i;
-    rk_list *list_0 = (rk_list *)pdata;
 
-    printf("rk_list test 0 loop start\n");
-    for (i = 0; i < LOOP_RK_LIST; i++) {
-        err |= rk_list_filo_test(list_0);
-        if (err) break;
+    for (i = 0; i < threads; i++) {
+        ctx[i].list = list_0;
+        ctx[i].thread = i;
+        ctx[i].err = 0;
+        pthread_create(&thread[i], nullptr, loop, &ctx[i]);
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(thread[i], nullptr);
+        err |= ctx[i].err;
     }
+    used = rk_list_test_now() - start;
 
-    if (err) {
-        printf("thread: found vpu mem operation err %d\n", err);
-    } else {
-        printf("thread: test done and found no err\n");
+    if (!list_0->list_is_empty()) {
+        printf("%s: %d nodes left\n", name, list_0->list_size());
+        err = -1;
     }
-    return nullptr;
+    printf("%-5s threads %d: %10.0f ops/s%s\n", name, threads,
+           (double)LOOP_RK_LIST * ops_per_loop * threads / used, err ? " failed" : "");
+    delete list_0;
+    return err;
 }
 
-int rk_list_test_0()
+static void *rk_list_test_loop_producer(void *pdata)
 {
-    int i, err = 0;
-    printf("rk_list test 0 FIFO start\n");
+    RkListTestCtx *ctx = (RkListTestCtx *)pdata;
+    RkListTestData m = { 0, ctx->thread, { 0 } };
+    int i = 0;
+
+    while (i < LOOP_RK_LIST) {
+        m.id = i;
+        if (ctx->list->add_at_tail(&m, sizeof(m)) == 0)
+            i++;
+        else
+            sched_yield();
+    }
+    return nullptr;
+}
 
-    rk_list *list_0 = new rk_list((node_destructor)VPUFreeLinear);
+// one producer and one consumer on the lock-free ring, the nodes are taken in order
+static int rk_list_test_spsc(void)
+{
+    rk_list *list_0 = new rk_list(nullptr, RK_LIST_FLAG_SPSC, sizeof(RkListTestData), 256); // 256: ring size
+    RkListTestCtx ctx = { list_0, 0, 0 };
+    RkListTestData m;
+    pthread_t producer;
+    double start = rk_list_test_now();
+    double used = 0;
+    int err = 0;
+    int i = 0;
+
+    pthread_create(&producer, nullptr, rk_list_test_loop_producer, &ctx);
+    while (i < LOOP_RK_LIST) {
+        if (list_0->del_at_head(&m, sizeof(m))) {
+            sched_yield();
+            continue;
+        }
+        if (m.id != (RK_U32)i) {
+            printf("spsc: got node %d while expecting %d\n", m.id, i);
+            err = -1;
+        }
+        i++;
+    }
+    pthread_join(producer, nullptr);
+    used = rk_list_test_now() - start;
 
-    pthread_t mThread;
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    printf("spsc  threads 2: %10.0f ops/s%s\n", (double)LOOP_RK_LIST * 2 / used, // 2: add and del
+           err ? " failed" : "");
+    delete list_0;
+    return err;
+}
 
-    pthread_create(&mThread, &attr, rk_list_test_loop_0, (void*)list_0);
-    pthread_attr_destroy(&attr);
+// throughput of the list with 1 to 8 threads sharing it
+int rk_list_test_0()
+{
+    int threads, err = 0;
+    printf("rk_list test 0 throughput start\n");
 
-    for (i = 0; i < LOOP_RK_LIST; i++) {
-        err |= rk_list_fifo_test(list_0);
-        if (err) break;
+    for (threads = 1; threads <= MAX_TEST_THREADS; threads <<= 1) {
+        err |= rk_list_test_threads("fifo", rk_list_test_loop_fifo, threads, 2); // 2: add and del
     }
-    if (err) {
-        printf("main  : found rk_list operation err %d\n", err);
-    } else {
-        printf("main  : test done and found no err\n");
+    for (threads = 1; threads <= MAX_TEST_THREADS; threads <<= 1) {
+        err |= rk_list_test_threads("key", rk_list_test_loop_key, threads, 4); // 4: add show del show
     }
+    err |= rk_list_test_spsc();
 
-    void *dummy;
-    pthread_join(mThread, &dummy);
-
-    printf("rk_list test 0 end size %d\n", list_0->list_size());
-    delete list_0;
+    printf("rk_list test 0 end err %d\n", err);
     return err;
 }
 
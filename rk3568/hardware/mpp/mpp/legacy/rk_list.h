@@ -23,10 +23,20 @@
 // desctructor of list node
 typedef void *(*node_destructor)(void *);
 
+// the list is shared by a single producer adding at tail and a single consumer deleting at head,
+// it is a lock-free ring then and the other functions are not supported
+#define RK_LIST_FLAG_SPSC           (0x00000001)
+
+// the payload stored in the node itself, the larger payload is allocated outside the node
+#define RK_LIST_DEFAULT_DATA_SIZE   64
+// the nodes preallocated together, and the capacity of the ring for RK_LIST_FLAG_SPSC
+#define RK_LIST_DEFAULT_NODE_COUNT  32
+
 struct rk_list_node;
 class rk_list {
 public:
     rk_list(node_destructor func);
+    rk_list(node_destructor func, RK_U32 list_flags, RK_S32 size, RK_S32 nodes_per_slab);
     ~rk_list();
 
     // for FIFO or FILO implement
@@ -43,10 +53,12 @@ public:
     RK_S32 list_is_empty();
     RK_S32 list_size();
 
-    // for vector implement - not implemented yet
-    // adding function will return a key
+    // for vector implement
+    // adding function will return a key, the node is added at tail and found by the key in O(1)
+    // the key is not valid any more once the node is deleted in any way
     RK_S32 add_by_key(void *data, RK_S32 size, RK_U32 *key);
     RK_S32 del_by_key(void *data, RK_S32 size, RK_U32 key);
+    // copy the stored data of the key without deleting it
     RK_S32 show_by_key(void *data, RK_U32 key);
 
     RK_S32 flush();
@@ -57,6 +69,31 @@ private:
     struct rk_list_node    *head;
     RK_S32                 count;
 
+    RK_U32                  flags;
+    RK_S32                  data_size;
+    RK_S32                  node_count;
+
+    // the nodes are taken from the slabs and indexed by the low bits of their keys
+    struct rk_list_node    *free_nodes;
+    struct rk_list_node   **nodes;
+    RK_U32                  nodes_size;
+    void                  **slabs;
+    RK_U32                  slabs_size;
+
+    // the ring for RK_LIST_FLAG_SPSC, ring_tail is written by the producer and ring_head by the consumer
+    RK_U8                  *ring;
+    RK_U32                  ring_tail;
+    RK_U32                  ring_head;
+
+    void init(node_destructor func, RK_U32 list_flags, RK_S32 size, RK_S32 nodes_per_slab);
+    struct rk_list_node *get_node(void *data, RK_S32 size);
+    void put_node(struct rk_list_node *node);
+    RK_S32 grow_nodes();
+    RK_S32 del_node(struct rk_list_node *node, void *data, RK_S32 size);
+    struct rk_list_node *find_node(RK_U32 key);
+    RK_S32 ring_add(void *data, RK_S32 size);
+    RK_S32 ring_del(void *data, RK_S32 size);
+
     rk_list();
     rk_list(const rk_list &);
     rk_list &operator=(const rk_list &);
@@ -29,6 +29,7 @@
 #include "mpp_buffer_impl.h"
 #include "mpp_frame.h"
 #include "vpu_mem_legacy.h"
+#include "vpu_api_pack.h"
 #include "securec.h"
 
 #define VPU_API_ENC_INPUT_TIMEOUT 100
@@ -210,75 +211,6 @@ static int is_valid_dma_fd(int fd)
     return ret;
 }
 
-static int copy_align_raw_buffer_to_dest(RK_U8 *dst, RK_U8 *src, RK_U32 width,
-                                         RK_U32 height, MppFrameFormat fmt)
-{
-    int ret = 1;
-    RK_U32 index = 0;
-    RK_U8 *dst_buf = dst;
-    RK_U8 *src_buf = src;
-    RK_U32 row = 0;
-    RK_U32 hor_stride = MPP_ALIGN(width, 16); // width 16
-    RK_U32 ver_stride = MPP_ALIGN(height, 8); // height 8
-    RK_U8 *dst_u = dst_buf + hor_stride * ver_stride;
-    RK_U8 *dst_v = dst_u + hor_stride * ver_stride / 4;
-
-    switch (fmt) {
-        case MPP_FMT_YUV420SP : {
-            for (row = 0; row < height; row++) {
-                if (memcpy_s(dst_buf + row * hor_stride, width, src_buf + index, width) != EOK) {
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-                index += width;
-            }
-            for (row = 0; row < height / 2; row++) { // height : / 2
-                if (memcpy_s(dst_u + row * hor_stride, width, src_buf + index, width) != EOK) {
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-                index += width;
-            }
-            } break;
-        case MPP_FMT_YUV420P : {
-            for (row = 0; row < height; row++) {
-                if (memcpy_s(dst_buf + row * hor_stride, width, src_buf + index, width) != EOK) {
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-                index += width;
-            }
-            for (row = 0; row < height / 2; row++) { // height : / 2
-                if (memcpy_s(dst_u + row * hor_stride / 2, // height : / 2
-                    width / 2, src_buf + index, width / 2) != EOK) { // height : / 2
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-                index += width / 2; // width / 2
-            }
-            for (row = 0; row < height / 2; row++) { // height : / 2
-                if (memcpy_s(dst_v + row * hor_stride / 2, // height : / 2
-                    width / 2, src_buf + index, width / 2) != EOK) { // height : / 2
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-                index += width / 2; // width / 2
-            }
-            } break;
-        case MPP_FMT_RGBA8888 :
-        case MPP_FMT_BGRA8888 :
-        case MPP_FMT_ABGR8888 :
-        case MPP_FMT_ARGB8888 : {
-            for (row = 0; row < height; row++) {
-                if (memcpy_s(dst_buf + row * hor_stride * 4, // width 4
-                    width * 4, src_buf + row * width * 4, width * 4) != EOK) { // width 4
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-                }
-            } break;
-        default : {
-            HDF_LOGE("%s unsupport align fmt:%d now", __func__, fmt);
-            } break;
-        }
-
-    return ret;
-}
-
 VpuApiLegacy::VpuApiLegacy() : mpp_ctx(nullptr),
     mpi(nullptr),
     init_ok(0),
@@ -292,10 +224,14 @@ VpuApiLegacy::VpuApiLegacy() : mpp_ctx(nullptr),
     enc_cfg(nullptr),
     enc_hdr_pkt(nullptr),
     enc_hdr_buf(nullptr),
-    enc_hdr_buf_size(0)
+    enc_hdr_buf_size(0),
+    enc_stream_pool(0)
 {
     HDF_LOGD("enter");
 
+    memset_s(enc_streams, sizeof(enc_streams), 0, sizeof(enc_streams));
+    pthread_mutex_init(&enc_stream_lock, nullptr);
+
     (*(mRKMppApi.HdiMppCreate))(&mpp_ctx, &mpi);
 
     memset_s(&enc_param, sizeof(enc_param), 0, sizeof(enc_param));
@@ -310,6 +246,13 @@ VpuApiLegacy::~VpuApiLegacy()
 {
     HDF_LOGD("enter");
 
+    /* the streams still held by the client are not usable after the context is closed */
+    for (RK_U32 i = 0; i < VPU_API_ENC_STREAM_POOL_SIZE; i++) {
+        if (enc_streams[i].packet)
+            (*(mRKMppApi.HdiMppPacketDeinit))(&enc_streams[i].packet);
+    }
+    pthread_mutex_destroy(&enc_stream_lock);
+
     (*(mRKMppApi.HdiMppDestroy))(mpp_ctx);
 
     if (memGroup) {
@@ -727,6 +670,12 @@ RK_S32 VpuApiLegacy::decode(VpuCodecContext *ctx, VideoPacket_t *pkt, DecoderOut
                 goto DECODE_OUT;
             }
         } else {
+            /* without an output fd the frame is exported in the VPU_FRAME given by aDecOut->data */
+            if (aDecOut->data == nullptr) {
+                HDF_LOGE("%s no output fd nor VPU_FRAME", __func__);
+                ret = MPP_ERR_NULL_PTR;
+                goto DECODE_OUT;
+            }
             ret = (*(mRKMppApi.HdiMppBufferGetWithTag))
                 (memGroup, &pic_buf, hor_stride * ver_stride * 3 / 2, MODULE_TAG, __FUNCTION__); // size 3 / 2 bit
             if (ret) {
@@ -793,21 +742,28 @@ RK_S32 VpuApiLegacy::decode(VpuCodecContext *ctx, VideoPacket_t *pkt, DecoderOut
             task = nullptr;
         }
 
-        // copy decoded frame into output buffer, and set outpub frame size
+        /*
+         * The frame is decoded into the output fd in place. Otherwise the buffer is handed to the client
+         * in the VPU_FRAME with a reference held until the client releases it by VPUFreeLinear(&vpumem).
+         */
         if (mframe != nullptr) {
             MppBuffer buf_out = (*(mRKMppApi.HdiMppFrameGetBuffer))(mframe);
             size_t len  = (*(mRKMppApi.Hdimpp_buffer_get_size_with_caller))(buf_out, __FUNCTION__);
             aDecOut->size = len;
 
-            if (fd_output) {
-                HDF_LOGE("%s fd for output is invalid!", __func__);
-                aDecOut->data = (RK_U8*)(*(mRKMppApi.Hdimpp_osal_malloc))
-                    (__FUNCTION__, sizeof(RK_U8) * (width * height * 3 / 2)); // size 3 / 2 bit
-                if ( memcpy_s(aDecOut->data,  aDecOut->size, \
-                    (RK_U8*) (*(mRKMppApi.HdiMppBufferGetPtrWithCaller))(pic_buf, __FUNCTION__), \
-                    aDecOut->size) != EOK) {
-                    HDF_LOGE("%s memcpy_s no", __func__);
+            if (!fd_output) {
+                VPU_FRAME *vframe = (VPU_FRAME *)aDecOut->data;
+
+                memset_s(vframe, sizeof(VPU_FRAME), 0, sizeof(VPU_FRAME));
+                setup_VPU_FRAME_from_mpp_frame(vframe, mframe);
+                if (vframe->DisplayWidth == 0 || vframe->DisplayHeight == 0) {
+                    vframe->DisplayWidth = width;
+                    vframe->DisplayHeight = height;
+                    vframe->FrameWidth = hor_stride;
+                    vframe->FrameHeight = ver_stride;
+                    vframe->vpumem.size = hor_stride * ver_stride * 3 / 2; // size 3 / 2 bit
                 }
+                aDecOut->size = sizeof(VPU_FRAME);
             }
 
             HDF_LOGI("get frame %p size %d", mframe, len);
@@ -1185,7 +1141,7 @@ RK_S32 VpuApiLegacy::encode(VpuCodecContext *ctx, EncInputStream_t *aEncInStrm,
         task = nullptr;
     }
 
-    // copy encoded stream into output buffer, and set output stream size
+    // hand the encoded stream out, and set output stream size
     if (packet) {
         RK_U32 eos = (*(mRKMppApi.HdiMppPacketGetEos))(packet);
         RK_S64 pts = (*(mRKMppApi.HdiMppPacketGetPts))(packet);
@@ -1193,25 +1149,6 @@ RK_S32 VpuApiLegacy::encode(VpuCodecContext *ctx, EncInputStream_t *aEncInStrm,
         MppMeta meta = (*(mRKMppApi.Hdimpp_packet_get_meta))(packet);
         RK_S32 is_intra = 0;
 
-        if (!fd_output) {
-            RK_U8 *src = (RK_U8 *)(*(mRKMppApi.Hdimpp_packet_get_data))(packet);
-            size_t buffer = MPP_ALIGN(length, SZ_4K);
-
-            aEncOut->data = (RK_U8*)(*(mRKMppApi.Hdimpp_osal_malloc))(__FUNCTION__, sizeof(RK_U8)*buffer);
-
-            if (ctx->videoCoding == OMX_RK_VIDEO_CodingAVC) {
-                // remove first 00 00 00 01
-                length -= 4; // length -= 4
-                if (memcpy_s(aEncOut->data, length, src + 4, length) != EOK) { // length -= 4
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-            } else {
-                if (memcpy_s(aEncOut->data, length, src, length) != EOK) {
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-            }
-        }
-
         (*(mRKMppApi.Hdimpp_meta_get_s32))(meta, KEY_OUTPUT_INTRA, &is_intra);
 
         aEncOut->size = (RK_S32)length;
@@ -1221,7 +1158,11 @@ RK_S32 VpuApiLegacy::encode(VpuCodecContext *ctx, EncInputStream_t *aEncInStrm,
         HDF_LOGD("get packet %p size %d pts %lld keyframe %d eos %d", \
             packet, length, pts, aEncOut->keyFrame, eos);
 
-        (*(mRKMppApi.HdiMppPacketDeinit))(&packet);
+        if (!fd_output && export_stream(ctx, packet, aEncOut) == MPP_OK)
+            packet = nullptr;
+
+        if (packet)
+            (*(mRKMppApi.HdiMppPacketDeinit))(&packet);
     } else {
         HDF_LOGE("%s outputPacket is nullptr!", __func__);
     }
@@ -1335,8 +1276,10 @@ RK_S32 VpuApiLegacy::encoder_sendframe(VpuCodecContext *ctx, EncInputStream_t *a
                 HDF_LOGE("%s allocate input picture buffer failed", __func__);
                 goto FUNC_RET;
             }
-            copy_align_raw_buffer_to_dest((RK_U8 *)(*(mRKMppApi.HdiMppBufferGetPtrWithCaller))(buffer, __FUNCTION__),
-                aEncInStrm->buf, width, height, format);
+            if (!vpu_api_pack_raw_picture((RK_U8 *)(*(mRKMppApi.HdiMppBufferGetPtrWithCaller))(buffer, __FUNCTION__),
+                aEncInStrm->buf, width, height, format)) {
+                HDF_LOGE("%s pack input picture failed", __func__);
+            }
             (*(mRKMppApi.HdiMppFrameSetBuffer))(frame, buffer);
             (*(mRKMppApi.HdiMppBufferPutWithCaller))(buffer, __FUNCTION__);
             buffer = nullptr;
@@ -1350,7 +1293,7 @@ PUT_FRAME:
     if (mlvec) {
         MppMeta meta = (*(mRKMppApi.HdiMppFrameGetMeta))(frame);
 
-        vpu_api_mlvec_set_dy_cfg(mlvec, &mlvec_dy_cfg, meta);
+        vpu_api_mlvec_set_dy_cfg(mlvec, &mlvec_dy_cfg, meta, aEncInStrm->timeUs);
     }
 
     ret = mpi->encode_put_frame(mpp_ctx, frame);
@@ -1367,6 +1310,82 @@ FUNC_RET:
     return ret;
 }
 
+/*
+ * Hand the encoded stream out in aEncOut without the avc start code. In the stream pool mode the packet
+ * is held and its data is given to the client, who returns it by VPU_API_ENC_PUT_STREAM. Otherwise or
+ * when the pool is full the stream is copied into a heap buffer. Returns MPP_OK when the packet is held.
+ */
+MPP_RET VpuApiLegacy::export_stream(VpuCodecContext *ctx, MppPacket packet, EncoderOut_t *aEncOut)
+{
+    RK_U8 *src = (RK_U8 *)(*(mRKMppApi.Hdimpp_packet_get_data))(packet);
+    size_t length = (*(mRKMppApi.HdiMppPacketGetLength))(packet);
+    MPP_RET ret = MPP_NOK;
+    RK_U32 offset = 0;
+    RK_U32 i = 0;
+
+    if (ctx->videoCoding == OMX_RK_VIDEO_CodingAVC) {
+        offset = 4; // remove first 00 00 00 01
+        length = (length > offset) ? (length - offset) : 0;
+    }
+    aEncOut->data = nullptr;
+    aEncOut->size = (RK_S32)length;
+    if (length == 0)
+        return MPP_NOK;
+
+    if (enc_stream_pool) {
+        pthread_mutex_lock(&enc_stream_lock);
+        for (i = 0; i < VPU_API_ENC_STREAM_POOL_SIZE; i++) {
+            if (enc_streams[i].packet == nullptr) {
+                enc_streams[i].packet = packet;
+                enc_streams[i].data = src + offset;
+                aEncOut->data = src + offset;
+                ret = MPP_OK;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&enc_stream_lock);
+        if (ret == MPP_OK)
+            return ret;
+        HDF_LOGW("%s stream pool is full, copy the stream", __func__);
+    }
+
+    aEncOut->data = (RK_U8*)(*(mRKMppApi.Hdimpp_osal_calloc)) \
+        (__FUNCTION__, sizeof(RK_U8)*MPP_ALIGN(length + 16, SZ_4K)); // length + 16
+    if (aEncOut->data) {
+        if (memcpy_s(aEncOut->data, length, src + offset, length) != EOK) {
+            HDF_LOGE("%s memcpy_s no", __func__);
+        }
+    }
+    return MPP_NOK;
+}
+
+/* release the packet of the stream held in the pool, the copied stream is freed */
+RK_S32 VpuApiLegacy::put_stream(RK_U8 *data)
+{
+    MppPacket packet = nullptr;
+    RK_U32 i = 0;
+
+    if (data == nullptr)
+        return 0;
+
+    pthread_mutex_lock(&enc_stream_lock);
+    for (i = 0; i < VPU_API_ENC_STREAM_POOL_SIZE; i++) {
+        if (enc_streams[i].packet && enc_streams[i].data == data) {
+            packet = enc_streams[i].packet;
+            enc_streams[i].packet = nullptr;
+            enc_streams[i].data = nullptr;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&enc_stream_lock);
+
+    if (packet)
+        (*(mRKMppApi.HdiMppPacketDeinit))(&packet);
+    else
+        (*(mRKMppApi.Hdimpp_osal_free))(__FUNCTION__, data);
+    return 0;
+}
+
 RK_S32 VpuApiLegacy::encoder_getstream(VpuCodecContext *ctx, EncoderOut_t *aEncOut)
 {
     RK_S32 ret = 0;
@@ -1379,40 +1398,24 @@ RK_S32 VpuApiLegacy::encoder_getstream(VpuCodecContext *ctx, EncoderOut_t *aEncO
         goto FUNC_RET;
     }
     if (packet) {
-        RK_U8 *src = (RK_U8 *)(*(mRKMppApi.Hdimpp_packet_get_data))(packet);
         RK_U32 eos = (*(mRKMppApi.HdiMppPacketGetEos))(packet);
         RK_S64 pts = (*(mRKMppApi.HdiMppPacketGetPts))(packet);
-        size_t length = (*(mRKMppApi.HdiMppPacketGetLength))(packet);
         MppMeta meta = (*(mRKMppApi.Hdimpp_packet_get_meta))(packet);
         RK_S32 is_intra = 0;
 
-        RK_U32 offset = 0;
-        if (ctx->videoCoding == OMX_RK_VIDEO_CodingAVC) {
-            offset = 4; //  offset = 4
-            length = (length > offset) ? (length - offset) : 0;
-        }
-        aEncOut->data = nullptr;
-        if (length > 0) {
-            aEncOut->data = (RK_U8*)(*(mRKMppApi.Hdimpp_osal_calloc)) \
-                (__FUNCTION__, sizeof(RK_U8)*MPP_ALIGN(length + 16, SZ_4K)); // length + 16
-            if (aEncOut->data) {
-                if (memcpy_s(aEncOut->data, length, src + offset, length) != EOK) {
-                    HDF_LOGE("%s memcpy_s no", __func__);
-                }
-            }
-        }
-
         (*(mRKMppApi.Hdimpp_meta_get_s32))(meta, KEY_OUTPUT_INTRA, &is_intra);
 
-        aEncOut->size = (RK_S32)length;
         aEncOut->timeUs = pts;
         aEncOut->keyFrame = is_intra;
 
         HDF_LOGD("get packet %p size %d pts %lld keyframe %d eos %d", \
-            packet, length, pts, aEncOut->keyFrame, eos);
+            packet, (*(mRKMppApi.HdiMppPacketGetLength))(packet), pts, aEncOut->keyFrame, eos);
 
         mEosSet = eos;
-        (*(mRKMppApi.HdiMppPacketDeinit))(&packet);
+        if (export_stream(ctx, packet, aEncOut) == MPP_OK)
+            packet = nullptr;
+        if (packet)
+            (*(mRKMppApi.HdiMppPacketDeinit))(&packet);
     } else {
         aEncOut->size = 0;
         HDF_LOGE("%s get nullptr packet, eos %d", __func__, mEosSet);
@@ -1589,6 +1592,39 @@ RK_S32 VpuApiLegacy::control(VpuCodecContext *ctx, VPU_API_CMD cmd, void *param)
 
             return 0;
             } break;
+        case VPU_API_ENC_QUEUE_DY_CFG: {
+            VpuMlvecDirectiveBatch *batch = (VpuMlvecDirectiveBatch *)param;
+
+            if (mlvec == nullptr || batch == nullptr) {
+                HDF_LOGE("%s queue directives without mlvec configure", __func__);
+                return -1;
+            }
+
+            HDF_LOGI("VPU_API_ENC_QUEUE_DY_CFG %d", batch->count);
+            return (vpu_api_mlvec_queue_dy_cfg(mlvec, batch->directives, &batch->count) == MPP_OK) ? 0 : -1;
+            } break;
+        case VPU_API_ENC_GET_DY_CFG_RESULT: {
+            VpuMlvecDirectiveResults *results = (VpuMlvecDirectiveResults *)param;
+
+            if (mlvec == nullptr || results == nullptr) {
+                HDF_LOGE("%s get directive results without mlvec configure", __func__);
+                return -1;
+            }
+
+            return (vpu_api_mlvec_get_dy_result(mlvec, results->results, &results->count) == MPP_OK) ? 0 : -1;
+            } break;
+        case VPU_API_ENC_CLEAR_DY_CFG: {
+            HDF_LOGI("VPU_API_ENC_CLEAR_DY_CFG");
+            return (mlvec && vpu_api_mlvec_clear_dy_cfg(mlvec) == MPP_OK) ? 0 : -1;
+            } break;
+        case VPU_API_ENC_SET_STREAM_POOL: {
+            enc_stream_pool = (param != nullptr) ? *((RK_U32 *)param) : 0;
+            HDF_LOGI("VPU_API_ENC_SET_STREAM_POOL %d", enc_stream_pool);
+            return 0;
+            } break;
+        case VPU_API_ENC_PUT_STREAM: {
+            return put_stream((RK_U8 *)param);
+            } break;
         case VPU_API_GET_EXTRA_INFO: {
             EncoderOut_t *out = (EncoderOut_t *)param;
 
@@ -19,6 +19,7 @@
 #define __VPU_API_LEGACY_H__
 
 #include <cstdio>
+#include <pthread.h>
 
 #include "vpu_api.h"
 #include "rk_mpi.h"
@@ -41,8 +42,15 @@
 #define vpu_api_dbg_output(fmt, ...)    vpu_api_dbg_f(VPU_API_DBG_OUTPUT, fmt, ## __VA_ARGS__)
 #define vpu_api_dbg_ctrl(fmt, ...)      vpu_api_dbg_f(VPU_API_DBG_CONTROL, fmt, ## __VA_ARGS__)
 
+#define VPU_API_ENC_STREAM_POOL_SIZE    4
+
 extern RK_U32 vpu_api_debug;
 
+typedef struct VpuApiEncStream_t {
+    RK_U8      *data;
+    MppPacket   packet;
+} VpuApiEncStream;
+
 typedef enum {
     INPUT_FORMAT_MAP,
 } PerformCmd;
@@ -68,6 +76,9 @@ public:
     RK_S32 control(VpuCodecContext *ctx, VPU_API_CMD cmd, void *param);
 
 private:
+    MPP_RET export_stream(VpuCodecContext *ctx, MppPacket packet, EncoderOut_t *aEncOut);
+    RK_S32 put_stream(RK_U8 *data);
+
     VPU_GENERIC vpug;
     MppCtx mpp_ctx;
     MppApi *mpi;
@@ -90,6 +101,11 @@ private:
     void *enc_hdr_buf;
     RK_S32 enc_hdr_buf_size;
 
+    /* encoder streams held by the client in the stream pool mode */
+    RK_U32 enc_stream_pool;
+    VpuApiEncStream enc_streams[VPU_API_ENC_STREAM_POOL_SIZE];
+    pthread_mutex_t enc_stream_lock;
+
     /* for mlvec */
     VpuApiMlvec mlvec;
     VpuApiMlvecDynamicCfg mlvec_dy_cfg;
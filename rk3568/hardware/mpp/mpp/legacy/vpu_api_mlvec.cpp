@@ -19,6 +19,7 @@
 
 #include "vpu_api_mlvec.h"
 #include <fcntl.h>
+#include <pthread.h>
 #include "cstring"
 #include "hdf_log.h"
 #include "mpp_log.h"
@@ -31,6 +32,11 @@
 #define VPU_API_DBG_MLVEC_FUNC      (0x00010000)
 #define VPU_API_DBG_MLVEC_FLOW      (0x00020000)
 
+typedef struct VpuApiMlvecPending_t {
+    VpuMlvecDirective       directive;
+    RK_U32                  late;
+} VpuApiMlvecPending;
+
 typedef struct VpuApiMlvecImpl_t {
     MppCtx      mpp;
     MppApi      *mpi;
@@ -38,6 +44,19 @@ typedef struct VpuApiMlvecImpl_t {
 
     VpuApiMlvecStaticCfg    st_cfg;
     VpuApiMlvecDynamicCfg   dy_cfg;
+
+    /* the queued directives are taken by the encoding thread */
+    pthread_mutex_t         lock;
+    /* directives in the queued order */
+    VpuApiMlvecPending      pending[VPU_API_MLVEC_DIRECTIVE_COUNT];
+    RK_S32                  pending_cnt;
+    /* ring of the results, the oldest is overwritten when the client does not take them */
+    VpuMlvecDirectiveResult results[VPU_API_MLVEC_RESULT_COUNT];
+    RK_S32                  result_pos;
+    RK_S32                  result_cnt;
+    /* index of the next frame and pts of the last frame */
+    RK_S64                  frame_idx;
+    RK_S64                  last_pts;
 } VpuApiMlvecImpl;
 
 MPP_RET vpu_api_mlvec_init(VpuApiMlvec *ctx)
@@ -50,22 +69,27 @@ MPP_RET vpu_api_mlvec_init(VpuApiMlvec *ctx)
     HDF_LOGD("enter %p", ctx);
 
     VpuApiMlvecImpl *impl = (VpuApiMlvecImpl*)(*(mRKMppApi.Hdimpp_osal_calloc))(__FUNCTION__, sizeof(VpuApiMlvecImpl));
-    if (impl == nullptr)
+    if (impl == nullptr) {
         HDF_LOGE("%s failed to create MLVEC context", __func__);
+        *ctx = nullptr;
+        return MPP_NOK;
+    }
 
     /* default disable frame_qp setup */
     impl->dy_cfg.frame_qp = -1;
+    pthread_mutex_init(&impl->lock, nullptr);
 
     *ctx = impl;
 
     HDF_LOGD("leave %p %p", ctx, impl);
-    return (impl) ? (MPP_OK) : (MPP_NOK);
+    return MPP_OK;
 }
 
 MPP_RET vpu_api_mlvec_deinit(VpuApiMlvec ctx)
 {
     HDF_LOGD("enter %p", ctx);
     if (ctx) {
+        pthread_mutex_destroy(&((VpuApiMlvecImpl *)ctx)->lock);
         (*(mRKMppApi.Hdimpp_osal_free))(__FUNCTION__, ctx);
     }
     ctx = nullptr;
@@ -169,7 +193,97 @@ MPP_RET vpu_api_mlvec_set_st_cfg(VpuApiMlvec ctx, VpuApiMlvecStaticCfg *cfg)
     return ret;
 }
 
-MPP_RET vpu_api_mlvec_set_dy_cfg(VpuApiMlvec ctx, VpuApiMlvecDynamicCfg *cfg, MppMeta meta)
+static void vpu_api_mlvec_push_result(VpuApiMlvecImpl *impl, const VpuMlvecDirectiveResult *result)
+{
+    if (impl->result_cnt == VPU_API_MLVEC_RESULT_COUNT) {
+        HDF_LOGW("%s drop result of directive %u", __func__, impl->results[impl->result_pos].id);
+        impl->result_pos = (impl->result_pos + 1) % VPU_API_MLVEC_RESULT_COUNT;
+        impl->result_cnt--;
+    }
+
+    impl->results[(impl->result_pos + impl->result_cnt) % VPU_API_MLVEC_RESULT_COUNT] = *result;
+    impl->result_cnt++;
+}
+
+/* apply a due directive on top of the dynamic configure of the frame, a later directive wins */
+static void vpu_api_mlvec_apply_directive(VpuApiMlvecImpl *impl, const VpuApiMlvecPending *pending,
+    RK_S64 frame_idx, RK_S64 pts)
+{
+    const VpuMlvecDirective *directive = &pending->directive;
+    VpuApiMlvecDynamicCfg *dst = &impl->dy_cfg;
+    RK_U32 flags = directive->flags;
+    VpuMlvecDirectiveResult result;
+
+    result.id = directive->id;
+    result.applied = 0;
+    result.late = pending->late;
+    result.frame = frame_idx;
+    result.pts = pts;
+
+    /* 3: the deepest temporal layer of the ref structs */
+    if ((flags & VPU_MLVEC_DIRECTIVE_MAX_TID) && directive->max_tid >= 0 && directive->max_tid <= 3 &&
+        vpu_api_mlvec_set_dy_max_tid(impl, directive->max_tid) == MPP_OK) {
+        dst->max_tid = directive->max_tid;
+        result.applied |= VPU_MLVEC_DIRECTIVE_MAX_TID;
+    }
+
+    if ((flags & VPU_MLVEC_DIRECTIVE_MARK_LTR) && directive->mark_ltr >= 0) {
+        dst->mark_ltr = directive->mark_ltr;
+        result.applied |= VPU_MLVEC_DIRECTIVE_MARK_LTR;
+    }
+
+    if ((flags & VPU_MLVEC_DIRECTIVE_USE_LTR) && directive->use_ltr >= 0) {
+        dst->use_ltr = directive->use_ltr;
+        result.applied |= VPU_MLVEC_DIRECTIVE_USE_LTR;
+    }
+
+    /* negative frame qp and base layer pid disable the sticky setup */
+    if (flags & VPU_MLVEC_DIRECTIVE_FRAME_QP) {
+        dst->frame_qp = directive->frame_qp;
+        result.applied |= VPU_MLVEC_DIRECTIVE_FRAME_QP;
+    }
+
+    if (flags & VPU_MLVEC_DIRECTIVE_BASE_PID) {
+        dst->base_layer_pid = directive->base_layer_pid;
+        result.applied |= VPU_MLVEC_DIRECTIVE_BASE_PID;
+    }
+
+    if ((flags & VPU_MLVEC_DIRECTIVE_FORCE_IDR) &&
+        impl->mpi->control(impl->mpp, MPP_ENC_SET_IDR_FRAME, nullptr) == MPP_OK)
+        result.applied |= VPU_MLVEC_DIRECTIVE_FORCE_IDR;
+
+    HDF_LOGD("directive %u flags %08x applied %08x late %d frame %lld pts %lld", directive->id,
+        flags, result.applied, result.late, frame_idx, pts);
+
+    vpu_api_mlvec_push_result(impl, &result);
+}
+
+static void vpu_api_mlvec_apply_queued(VpuApiMlvecImpl *impl, RK_S64 pts)
+{
+    pthread_mutex_lock(&impl->lock);
+
+    RK_S64 frame_idx = impl->frame_idx++;
+    RK_S32 kept = 0;
+    RK_S32 i;
+
+    impl->last_pts = pts;
+    for (i = 0; i < impl->pending_cnt; i++) {
+        VpuApiMlvecPending *pending = &impl->pending[i];
+        RK_S64 now = (pending->directive.flags & VPU_MLVEC_DIRECTIVE_BY_PTS) ? pts : frame_idx;
+
+        if (pending->directive.frame > now) {
+            impl->pending[kept++] = *pending;
+            continue;
+        }
+
+        vpu_api_mlvec_apply_directive(impl, pending, frame_idx, pts);
+    }
+    impl->pending_cnt = kept;
+
+    pthread_mutex_unlock(&impl->lock);
+}
+
+MPP_RET vpu_api_mlvec_set_dy_cfg(VpuApiMlvec ctx, VpuApiMlvecDynamicCfg *cfg, MppMeta meta, RK_S64 pts)
 {
     if (ctx == nullptr || cfg == nullptr || meta == nullptr) {
         HDF_LOGE("%s invalid nullptr input ctx %p cfg %p meta %p",
@@ -206,6 +320,9 @@ MPP_RET vpu_api_mlvec_set_dy_cfg(VpuApiMlvec ctx, VpuApiMlvecDynamicCfg *cfg, Mp
         cfg->updated = 0;
     }
 
+    /* the queued directives of this frame are written with the same meta */
+    vpu_api_mlvec_apply_queued(impl, pts);
+
     HDF_LOGD("ltr mark %2d use %2d frm qp %2d blpid %d", dst->mark_ltr,
         dst->use_ltr, dst->frame_qp, dst->base_layer_pid);
 
@@ -429,3 +546,78 @@ MPP_RET vpu_api_mlvec_set_dy_max_tid(VpuApiMlvec ctx, RK_S32 max_tid)
 
     return ret;
 }
+
+MPP_RET vpu_api_mlvec_queue_dy_cfg(VpuApiMlvec ctx, const VpuMlvecDirective *directives, RK_S32 *count)
+{
+    if (ctx == nullptr || directives == nullptr || count == nullptr) {
+        HDF_LOGE("%s invalid nullptr input ctx %p directives %p count %p",
+            __func__, ctx, directives, count);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    VpuApiMlvecImpl *impl = (VpuApiMlvecImpl *)ctx;
+    RK_S32 queued = 0;
+
+    pthread_mutex_lock(&impl->lock);
+    while (queued < *count && impl->pending_cnt < VPU_API_MLVEC_DIRECTIVE_COUNT) {
+        const VpuMlvecDirective *directive = &directives[queued];
+        VpuApiMlvecPending *pending = &impl->pending[impl->pending_cnt++];
+
+        pending->directive = *directive;
+        /* the late directive is still applied to the next frame */
+        if (directive->flags & VPU_MLVEC_DIRECTIVE_BY_PTS)
+            pending->late = impl->frame_idx && directive->frame <= impl->last_pts;
+        else
+            pending->late = directive->frame < impl->frame_idx;
+        queued++;
+    }
+    pthread_mutex_unlock(&impl->lock);
+
+    if (queued < *count)
+        HDF_LOGW("%s queue full, %d of %d directives queued", __func__, queued, *count);
+
+    *count = queued;
+
+    return (queued) ? (MPP_OK) : (MPP_NOK);
+}
+
+MPP_RET vpu_api_mlvec_get_dy_result(VpuApiMlvec ctx, VpuMlvecDirectiveResult *results, RK_S32 *count)
+{
+    if (ctx == nullptr || results == nullptr || count == nullptr) {
+        HDF_LOGE("%s invalid nullptr input ctx %p results %p count %p",
+            __func__, ctx, results, count);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    VpuApiMlvecImpl *impl = (VpuApiMlvecImpl *)ctx;
+    RK_S32 taken = 0;
+
+    pthread_mutex_lock(&impl->lock);
+    while (taken < *count && impl->result_cnt) {
+        results[taken++] = impl->results[impl->result_pos];
+        impl->result_pos = (impl->result_pos + 1) % VPU_API_MLVEC_RESULT_COUNT;
+        impl->result_cnt--;
+    }
+    pthread_mutex_unlock(&impl->lock);
+
+    *count = taken;
+
+    return MPP_OK;
+}
+
+MPP_RET vpu_api_mlvec_clear_dy_cfg(VpuApiMlvec ctx)
+{
+    if (ctx == nullptr) {
+        HDF_LOGE("%s invalid nullptr input", __func__);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    VpuApiMlvecImpl *impl = (VpuApiMlvecImpl *)ctx;
+
+    pthread_mutex_lock(&impl->lock);
+    HDF_LOGD("drop %d queued directives", impl->pending_cnt);
+    impl->pending_cnt = 0;
+    pthread_mutex_unlock(&impl->lock);
+
+    return MPP_OK;
+}
@@ -19,6 +19,7 @@
 #define __VPU_API_MLVEC_H__
 
 #include "rk_mpi.h"
+#include "vpu_api.h"
 
 #define MLVEC_MAGIC                     'M'
 #define MLVEC_VERSION                   '0'
@@ -28,6 +29,11 @@
 #define VPU_API_ENC_USE_LTR_UPDATED     (0x00000004)
 #define VPU_API_ENC_FRAME_QP_UPDATED    (0x00000008)
 #define VPU_API_ENC_BASE_PID_UPDATED    (0x00000010)
+#define VPU_API_ENC_FORCE_IDR_UPDATED   (0x00000020)
+
+/* the queued directives waiting for their frames and the results waiting for the client */
+#define VPU_API_MLVEC_DIRECTIVE_COUNT   64
+#define VPU_API_MLVEC_RESULT_COUNT      64
 
 typedef struct VpuApiMlvecStaticCfg_t {
     RK_S16 width;
@@ -82,10 +88,19 @@ MPP_RET vpu_api_mlvec_check_cfg(void *p);
 
 /* setup mlvec static configure */
 MPP_RET vpu_api_mlvec_set_st_cfg(VpuApiMlvec ctx, VpuApiMlvecStaticCfg *cfg);
-/* setup mlvec dynamic configure and setup MppMeta in MppFrame */
-MPP_RET vpu_api_mlvec_set_dy_cfg(VpuApiMlvec ctx, VpuApiMlvecDynamicCfg *cfg, MppMeta meta);
+/*
+ * setup mlvec dynamic configure and the queued directives due at the frame of pts, then setup MppMeta
+ * in MppFrame, each call is the next frame
+ */
+MPP_RET vpu_api_mlvec_set_dy_cfg(VpuApiMlvec ctx, VpuApiMlvecDynamicCfg *cfg, MppMeta meta, RK_S64 pts);
 /* setup mlvec max temporal layer count dynamic configure */
 MPP_RET vpu_api_mlvec_set_dy_max_tid(VpuApiMlvec ctx, RK_S32 max_tid);
+/* queue the directives for the coming frames, count returns the directives queued */
+MPP_RET vpu_api_mlvec_queue_dy_cfg(VpuApiMlvec ctx, const VpuMlvecDirective *directives, RK_S32 *count);
+/* take the results of the applied directives in order, count is the size of results in and taken out */
+MPP_RET vpu_api_mlvec_get_dy_result(VpuApiMlvec ctx, VpuMlvecDirectiveResult *results, RK_S32 *count);
+/* drop the directives not applied yet */
+MPP_RET vpu_api_mlvec_clear_dy_cfg(VpuApiMlvec ctx);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2024 Rockchip Electronics Co., LTD.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "vpu_api_pack"
+
+#include "vpu_api_pack.h"
+#include "hdf_log.h"
+#include "mpp_common.h"
+#include "securec.h"
+
+MPP_RET vpu_api_copy_plane(RK_U8 *dst, RK_U32 dst_stride, const RK_U8 *src, RK_U32 src_stride,
+                           RK_U32 width, RK_U32 rows)
+{
+    RK_U32 row = 0;
+
+    /* the rows are contiguous on both sides */
+    if (dst_stride == width && src_stride == width) {
+        if (memcpy_s(dst, (size_t)width * rows, src, (size_t)width * rows) != EOK) {
+            HDF_LOGE("%s memcpy_s no", __func__);
+            return MPP_NOK;
+        }
+        return MPP_OK;
+    }
+
+    for (row = 0; row < rows; row++) {
+        if (memcpy_s(dst + (size_t)row * dst_stride, dst_stride,
+                     src + (size_t)row * src_stride, width) != EOK) {
+            HDF_LOGE("%s memcpy_s no", __func__);
+            return MPP_NOK;
+        }
+    }
+    return MPP_OK;
+}
+
+RK_S32 vpu_api_pack_raw_picture(RK_U8 *dst, const RK_U8 *src, RK_U32 width, RK_U32 height, MppFrameFormat fmt)
+{
+    RK_U32 hor_stride = MPP_ALIGN(width, 16); // width 16
+    RK_U32 ver_stride = MPP_ALIGN(height, 8); // height 8
+    RK_U8 *dst_u = dst + hor_stride * ver_stride;
+    RK_U8 *dst_v = dst_u + hor_stride * ver_stride / 4; // 4: quarter size chroma plane
+    const RK_U8 *src_u = src + width * height;
+    MPP_RET ret = MPP_OK;
+
+    switch (fmt) {
+        case MPP_FMT_YUV420SP : {
+            ret = vpu_api_copy_plane(dst, hor_stride, src, width, width, height);
+            if (ret == MPP_OK)
+                ret = vpu_api_copy_plane(dst_u, hor_stride, src_u, width, width, height / 2); // height : / 2
+            } break;
+        case MPP_FMT_YUV420P : {
+            const RK_U8 *src_v = src_u + (width / 2) * (height / 2); // 2: half size chroma
+
+            ret = vpu_api_copy_plane(dst, hor_stride, src, width, width, height);
+            if (ret == MPP_OK)
+                ret = vpu_api_copy_plane(dst_u, hor_stride / 2, src_u, width / 2, width / 2, height / 2); // 2: half
+            if (ret == MPP_OK)
+                ret = vpu_api_copy_plane(dst_v, hor_stride / 2, src_v, width / 2, width / 2, height / 2); // 2: half
+            } break;
+        case MPP_FMT_RGBA8888 :
+        case MPP_FMT_BGRA8888 :
+        case MPP_FMT_ABGR8888 :
+        case MPP_FMT_ARGB8888 : {
+            ret = vpu_api_copy_plane(dst, hor_stride * 4, src, width * 4, width * 4, height); // 4: bytes per pixel
+            } break;
+        default : {
+            return 0;
+            } break;
+        }
+
+    return (ret == MPP_OK) ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2024 Rockchip Electronics Co., LTD.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __VPU_API_PACK_H__
+#define __VPU_API_PACK_H__
+
+#include "rk_type.h"
+#include "mpp_err.h"
+#include "mpp_frame.h"
+
+/* copy rows of width bytes between the buffers of different strides */
+MPP_RET vpu_api_copy_plane(RK_U8 *dst, RK_U32 dst_stride, const RK_U8 *src, RK_U32 src_stride,
+                           RK_U32 width, RK_U32 rows);
+
+/*
+ * pack the tightly packed raw picture into the encoder input layout, 16 aligned horizontal
+ * stride and 8 aligned vertical stride, returns 0 for the unsupported format or a failed copy
+ */
+RK_S32 vpu_api_pack_raw_picture(RK_U8 *dst, const RK_U8 *src, RK_U32 width, RK_U32 height, MppFrameFormat fmt);
+
+#endif /* __VPU_API_PACK_H__ */
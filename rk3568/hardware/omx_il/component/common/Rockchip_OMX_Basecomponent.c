@@ -496,6 +496,10 @@ OMX_ERRORTYPE Rockchip_OMX_ComponentStateSet(OMX_COMPONENTTYPE *pOMXComponent, O
                     ret = OMX_ErrorIncorrectStateTransition;
                     break;
                 case OMX_StateIdle:
+                    ret = Rockchip_OMX_Check_Preempted(pOMXComponent);
+                    if (ret != OMX_ErrorNone) {
+                        goto EXIT;
+                    }
                     omx_trace("rockchip_codec_componentInit");
                     ret = pRockchipComponent->rockchip_codec_componentInit(pOMXComponent);
                     if (ret != OMX_ErrorNone) {
@@ -30,55 +30,112 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "Rockchip_OMX_Macros.h"
 #include "Rockchip_OMX_Basecomponent.h"
 #include "Rockchip_OSAL_Memory.h"
 #include "Rockchip_OSAL_Mutex.h"
 #include "Rockchip_OSAL_Log.h"
+#include "Rockchip_OSAL_Env.h"
 
 #define MAX_RESOURCE_VIDEO_DEC 6
 #define MAX_RESOURCE_VIDEO_ENC 4
 
-/* Max allowable video scheduler component instance */
-static ROCKCHIP_OMX_RM_COMPONENT_LIST *gpVideoDecRMComponentList = NULL;
-static ROCKCHIP_OMX_RM_COMPONENT_LIST *gpVideoDecRMWaitingList = NULL;
-static ROCKCHIP_OMX_RM_COMPONENT_LIST *gpVideoEncRMComponentList = NULL;
-static ROCKCHIP_OMX_RM_COMPONENT_LIST *gpVideoEncRMWaitingList = NULL;
+#define RM_MB_SIZE          16
+#define RM_DEFAULT_FPS      30
+#define RM_DEFAULT_WIDTH    1920
+#define RM_DEFAULT_HEIGHT   1080
+#define RM_SOC_NAME_SIZE    64
+
+/* macroblocks per second the hardware codecs of a soc keep up with */
+typedef struct _ROCKCHIP_OMX_RM_CAPACITY {
+    const char *soc;
+    OMX_U64     nDecCapacity;
+    OMX_U64     nEncCapacity;
+} ROCKCHIP_OMX_RM_CAPACITY;
+
+static const ROCKCHIP_OMX_RM_CAPACITY gRMCapacityTable[] = {
+    { "rk3568", 2211840, 489600 },  /* 4096x2304@60 decoding, 1920x1088@60 encoding */
+    { "rk3566", 2211840, 489600 },
+    { "rk3588", 7776000, 3888000 }, /* 7680x4320@60 decoding, 7680x4320@30 encoding */
+};
+
+/* the components holding and waiting for the decoder or the encoder */
+typedef struct _ROCKCHIP_OMX_RM_POOL {
+    const char                     *name;
+    ROCKCHIP_OMX_RM_COMPONENT_LIST *pComponentList;
+    ROCKCHIP_OMX_RM_COMPONENT_LIST *pWaitingList;
+    OMX_U32                         nMaxInstance;
+    OMX_U64                         nCapacity;
+} ROCKCHIP_OMX_RM_POOL;
+
+static ROCKCHIP_OMX_RM_POOL gVideoDecRMPool = { "decoder", NULL, NULL, MAX_RESOURCE_VIDEO_DEC, 0 };
+static ROCKCHIP_OMX_RM_POOL gVideoEncRMPool = { "encoder", NULL, NULL, MAX_RESOURCE_VIDEO_ENC, 0 };
 static OMX_HANDLETYPE ghVideoRMComponentListMutex = NULL;
 
+static ROCKCHIP_OMX_RM_POOL *getPool(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent)
+{
+    if (pRockchipComponent->codecType == HW_VIDEO_DEC_CODEC)
+        return &gVideoDecRMPool;
+    if (pRockchipComponent->codecType == HW_VIDEO_ENC_CODEC)
+        return &gVideoEncRMPool;
+    return NULL;
+}
+
+/* the load of a component is its macroblocks per second, the unknown size and rate count as 1080p30 */
+static OMX_U64 calcComponentLoad(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent)
+{
+    OMX_U32 width = 0;
+    OMX_U32 height = 0;
+    OMX_U32 fps = 0;
+    OMX_U32 i = 0;
+
+    for (i = 0; (pRockchipComponent->pRockchipPort != NULL) && (i < ALL_PORT_NUM); i++) {
+        OMX_VIDEO_PORTDEFINITIONTYPE *video = &pRockchipComponent->pRockchipPort[i].portDefinition.format.video;
+        if ((width == 0) || (height == 0)) {
+            width = video->nFrameWidth;
+            height = video->nFrameHeight;
+        }
+        if (fps == 0)
+            fps = video->xFramerate >> 16; // 16:Q16
+    }
+    if ((width == 0) || (height == 0)) {
+        width = RM_DEFAULT_WIDTH;
+        height = RM_DEFAULT_HEIGHT;
+    }
+    if (fps == 0)
+        fps = RM_DEFAULT_FPS;
+
+    return (OMX_U64)((width + RM_MB_SIZE - 1) / RM_MB_SIZE) * ((height + RM_MB_SIZE - 1) / RM_MB_SIZE) * fps;
+}
 
-OMX_ERRORTYPE addElementList(ROCKCHIP_OMX_RM_COMPONENT_LIST **ppList, OMX_COMPONENTTYPE *pOMXComponent)
+OMX_ERRORTYPE addElementList(ROCKCHIP_OMX_RM_COMPONENT_LIST **ppList, OMX_COMPONENTTYPE *pOMXComponent,
+    OMX_U64 nLoad)
 {
     OMX_ERRORTYPE                 ret = OMX_ErrorNone;
     ROCKCHIP_OMX_RM_COMPONENT_LIST *pTempComp = NULL;
+    ROCKCHIP_OMX_RM_COMPONENT_LIST *pNewComp = NULL;
     ROCKCHIP_OMX_BASECOMPONENT     *pRockchipComponent = NULL;
 
     pRockchipComponent = (ROCKCHIP_OMX_BASECOMPONENT *)pOMXComponent->pComponentPrivate;
+    pNewComp = (ROCKCHIP_OMX_RM_COMPONENT_LIST *)Rockchip_OSAL_Malloc(sizeof(ROCKCHIP_OMX_RM_COMPONENT_LIST));
+    if (pNewComp == NULL) {
+        ret = OMX_ErrorInsufficientResources;
+        goto EXIT;
+    }
+    pNewComp->pNext = NULL;
+    pNewComp->pOMXStandComp = pOMXComponent;
+    pNewComp->groupPriority = pRockchipComponent->compPriority.nGroupPriority;
+    pNewComp->nLoad = nLoad;
+    pNewComp->bPreempted = OMX_FALSE;
+
     if (*ppList != NULL) {
         pTempComp = *ppList;
         while (pTempComp->pNext != NULL) {
             pTempComp = pTempComp->pNext;
         }
-        pTempComp->pNext =
-            (ROCKCHIP_OMX_RM_COMPONENT_LIST *)Rockchip_OSAL_Malloc(sizeof(ROCKCHIP_OMX_RM_COMPONENT_LIST));
-        if (pTempComp->pNext == NULL) {
-            ret = OMX_ErrorInsufficientResources;
-            goto EXIT;
-        }
-        ((ROCKCHIP_OMX_RM_COMPONENT_LIST *)(pTempComp->pNext))->pNext = NULL;
-        ((ROCKCHIP_OMX_RM_COMPONENT_LIST *)(pTempComp->pNext))->pOMXStandComp = pOMXComponent;
-        ((ROCKCHIP_OMX_RM_COMPONENT_LIST *)(pTempComp->pNext))->groupPriority =
-            pRockchipComponent->compPriority.nGroupPriority;
-        goto EXIT;
+        pTempComp->pNext = pNewComp;
     } else {
-        *ppList = (ROCKCHIP_OMX_RM_COMPONENT_LIST *)Rockchip_OSAL_Malloc(sizeof(ROCKCHIP_OMX_RM_COMPONENT_LIST));
-        if (*ppList == NULL) {
-            ret = OMX_ErrorInsufficientResources;
-            goto EXIT;
-        }
-        pTempComp = *ppList;
-        pTempComp->pNext = NULL;
-        pTempComp->pOMXStandComp = pOMXComponent;
-        pTempComp->groupPriority = pRockchipComponent->compPriority.nGroupPriority;
+        *ppList = pNewComp;
     }
 
 EXIT:
@@ -126,6 +183,41 @@ EXIT:
     return ret;
 }
 
+static void freeElementList(ROCKCHIP_OMX_RM_COMPONENT_LIST **ppList)
+{
+    ROCKCHIP_OMX_RM_COMPONENT_LIST *pCurrComponent = *ppList;
+    ROCKCHIP_OMX_RM_COMPONENT_LIST *pNextComponent = NULL;
+
+    while (pCurrComponent != NULL) {
+        pNextComponent = pCurrComponent->pNext;
+        Rockchip_OSAL_Free(pCurrComponent);
+        pCurrComponent = pNextComponent;
+    }
+    *ppList = NULL;
+}
+
+/*
+ * the number and the load of the components not preempted, only the ones of lower priority than
+ * inComp_priority if bLowOnly
+ */
+static OMX_U32 sumElementList(ROCKCHIP_OMX_RM_COMPONENT_LIST *pList, OMX_BOOL bLowOnly,
+    OMX_U32 inComp_priority, OMX_U64 *pLoad)
+{
+    OMX_U32 numElem = 0;
+
+    *pLoad = 0;
+    for (; pList != NULL; pList = pList->pNext) {
+        if (pList->bPreempted == OMX_TRUE)
+            continue;
+        if ((bLowOnly == OMX_TRUE) && (pList->groupPriority <= inComp_priority))
+            continue;
+        numElem++;
+        *pLoad += pList->nLoad;
+    }
+    return numElem;
+}
+
+/* the lowest priority component below inComp_priority not preempted yet, the heaviest one among the equals */
 int searchLowPriority(ROCKCHIP_OMX_RM_COMPONENT_LIST *RMComp_list,
     OMX_U32 inComp_priority, ROCKCHIP_OMX_RM_COMPONENT_LIST **outLowComp)
 {
@@ -143,11 +235,11 @@ int searchLowPriority(ROCKCHIP_OMX_RM_COMPONENT_LIST *RMComp_list,
     *outLowComp = 0;
 
     while (pTempComp != NULL) {
-        if (pTempComp->groupPriority > inComp_priority) {
-            if (pCandidateComp != NULL) {
-                if (pCandidateComp->groupPriority < pTempComp->groupPriority)
-                    pCandidateComp = pTempComp;
-            } else {
+        if ((pTempComp->bPreempted == OMX_FALSE) && (pTempComp->groupPriority > inComp_priority)) {
+            if ((pCandidateComp == NULL) ||
+                (pCandidateComp->groupPriority < pTempComp->groupPriority) ||
+                ((pCandidateComp->groupPriority == pTempComp->groupPriority) &&
+                (pCandidateComp->nLoad < pTempComp->nLoad))) {
                 pCandidateComp = pTempComp;
             }
         }
@@ -166,6 +258,7 @@ EXIT:
     return ret;
 }
 
+/* take the codec from the component, the executing one gives it up by going idle */
 OMX_ERRORTYPE removeComponent(OMX_COMPONENTTYPE *pOMXComponent)
 {
     OMX_ERRORTYPE             ret = OMX_ErrorNone;
@@ -183,7 +276,14 @@ OMX_ERRORTYPE removeComponent(OMX_COMPONENTTYPE *pOMXComponent)
         }
     } else if ((pRockchipComponent->currentState == OMX_StateExecuting) ||
         (pRockchipComponent->currentState == OMX_StatePause)) {
-        /* Todo */
+        (*(pRockchipComponent->pCallbacks->EventHandler))
+        (pOMXComponent, pRockchipComponent->callbackData,
+         OMX_EventError, OMX_ErrorResourcesPreempted, 0, NULL);
+        ret = OMX_SendCommand(pOMXComponent, OMX_CommandStateSet, OMX_StateIdle, NULL);
+        if (ret != OMX_ErrorNone) {
+            ret = OMX_ErrorUndefined;
+            goto EXIT;
+        }
     }
 
     ret = OMX_ErrorNone;
@@ -192,14 +292,70 @@ EXIT:
     return ret;
 }
 
+/*
+ * Check whether the pool takes nLoad more, preempting the components of lower priority when bPreempt.
+ * Nothing is preempted unless it makes room for the new component. The component alone in the pool is
+ * always admitted, the codec still runs it below the real time. The preempted component stays in the
+ * pool until it is loaded and releases the codec, it is not executed again before that.
+ */
+static OMX_ERRORTYPE admitComponent(ROCKCHIP_OMX_RM_POOL *pPool, OMX_U32 priority, OMX_U64 nLoad,
+    OMX_BOOL bPreempt)
+{
+    ROCKCHIP_OMX_RM_COMPONENT_LIST *pCandidate = NULL;
+    OMX_U64 usedLoad = 0;
+    OMX_U64 lowLoad = 0;
+    OMX_U32 numElem = sumElementList(pPool->pComponentList, OMX_FALSE, 0, &usedLoad);
+    OMX_U32 numLow = sumElementList(pPool->pComponentList, OMX_TRUE, priority, &lowLoad);
+
+    omx_info("%s load %llu used %llu of %llu by %d components", pPool->name, (unsigned long long)nLoad,
+        (unsigned long long)usedLoad, (unsigned long long)pPool->nCapacity, numElem);
+    if ((numElem < pPool->nMaxInstance) && ((numElem == 0) || (usedLoad + nLoad <= pPool->nCapacity)))
+        return OMX_ErrorNone;
+    if ((numElem - numLow >= pPool->nMaxInstance) ||
+        ((numElem - numLow > 0) && (usedLoad - lowLoad + nLoad > pPool->nCapacity))) {
+        omx_err("%s is overloaded, no lower priority component to preempt", pPool->name);
+        return OMX_ErrorInsufficientResources;
+    }
+    if (bPreempt == OMX_FALSE)
+        return OMX_ErrorNone;
+
+    while ((numElem >= pPool->nMaxInstance) || ((numElem > 0) && (usedLoad + nLoad > pPool->nCapacity))) {
+        if (searchLowPriority(pPool->pComponentList, priority, &pCandidate) <= 0)
+            return OMX_ErrorInsufficientResources;
+        omx_info("%s preempts component %p of priority %d load %llu", pPool->name,
+            pCandidate->pOMXStandComp, pCandidate->groupPriority, (unsigned long long)pCandidate->nLoad);
+        if (removeComponent(pCandidate->pOMXStandComp) != OMX_ErrorNone)
+            return OMX_ErrorInsufficientResources;
+        usedLoad -= pCandidate->nLoad;
+        numElem--;
+        pCandidate->bPreempted = OMX_TRUE;
+    }
+    return OMX_ErrorNone;
+}
 
 OMX_ERRORTYPE Rockchip_OMX_ResourceManager_Init()
 {
     OMX_ERRORTYPE ret = OMX_ErrorNone;
+    char soc[RM_SOC_NAME_SIZE] = { 0 };
+    const ROCKCHIP_OMX_RM_CAPACITY *capacity = &gRMCapacityTable[0];
+    OMX_U32 i = 0;
 
     FunctionIn();
     ret = Rockchip_OSAL_MutexCreate(&ghVideoRMComponentListMutex);
     omx_trace("Rockchip_OSAL_MutexCreate ghVideoRMComponentListMutex %p", ghVideoRMComponentListMutex);
+
+    if (Rockchip_OSAL_GetEnvStr("ro.board.platform", soc, sizeof(soc), (char *)capacity->soc) == OMX_ErrorNone) {
+        for (i = 0; i < ARRAY_SIZE(gRMCapacityTable); i++) {
+            if (strncmp(soc, gRMCapacityTable[i].soc, sizeof(soc)) == 0) {
+                capacity = &gRMCapacityTable[i];
+                break;
+            }
+        }
+    }
+    gVideoDecRMPool.nCapacity = capacity->nDecCapacity;
+    gVideoEncRMPool.nCapacity = capacity->nEncCapacity;
+    omx_info("%s decoder capacity %llu encoder capacity %llu mb/s", capacity->soc,
+        (unsigned long long)capacity->nDecCapacity, (unsigned long long)capacity->nEncCapacity);
     FunctionOut();
 
     return ret;
@@ -208,51 +364,16 @@ OMX_ERRORTYPE Rockchip_OMX_ResourceManager_Init()
 OMX_ERRORTYPE Rockchip_OMX_ResourceManager_Deinit()
 {
     OMX_ERRORTYPE ret = OMX_ErrorNone;
-    ROCKCHIP_OMX_RM_COMPONENT_LIST *pCurrComponent;
-    ROCKCHIP_OMX_RM_COMPONENT_LIST *pNextComponent;
 
     FunctionIn();
 
     omx_trace("ghVideoRMComponentListMutex lock in %p", ghVideoRMComponentListMutex);
     Rockchip_OSAL_MutexLock(ghVideoRMComponentListMutex);
 
-    if (gpVideoDecRMComponentList) {
-        pCurrComponent = gpVideoDecRMComponentList;
-        while (pCurrComponent != NULL) {
-            pNextComponent = pCurrComponent->pNext;
-            Rockchip_OSAL_Free(pCurrComponent);
-            pCurrComponent = pNextComponent;
-        }
-        gpVideoDecRMComponentList = NULL;
-    }
-    if (gpVideoDecRMWaitingList) {
-        pCurrComponent = gpVideoDecRMWaitingList;
-        while (pCurrComponent != NULL) {
-            pNextComponent = pCurrComponent->pNext;
-            Rockchip_OSAL_Free(pCurrComponent);
-            pCurrComponent = pNextComponent;
-        }
-        gpVideoDecRMWaitingList = NULL;
-    }
-
-    if (gpVideoEncRMComponentList) {
-        pCurrComponent = gpVideoEncRMComponentList;
-        while (pCurrComponent != NULL) {
-            pNextComponent = pCurrComponent->pNext;
-            Rockchip_OSAL_Free(pCurrComponent);
-            pCurrComponent = pNextComponent;
-        }
-        gpVideoEncRMComponentList = NULL;
-    }
-    if (gpVideoEncRMWaitingList) {
-        pCurrComponent = gpVideoEncRMWaitingList;
-        while (pCurrComponent != NULL) {
-            pNextComponent = pCurrComponent->pNext;
-            Rockchip_OSAL_Free(pCurrComponent);
-            pCurrComponent = pNextComponent;
-        }
-        gpVideoEncRMWaitingList = NULL;
-    }
+    freeElementList(&gVideoDecRMPool.pComponentList);
+    freeElementList(&gVideoDecRMPool.pWaitingList);
+    freeElementList(&gVideoEncRMPool.pComponentList);
+    freeElementList(&gVideoEncRMPool.pWaitingList);
 
     Rockchip_OSAL_MutexUnlock(ghVideoRMComponentListMutex);
 
@@ -267,57 +388,62 @@ EXIT:
 
     return ret;
 }
+
+/* the size and the rate are unknown when the component is loaded, only the number of components counts */
 OMX_ERRORTYPE Rockchip_OMX_Check_Resource(OMX_COMPONENTTYPE *pOMXComponent)
 {
     OMX_ERRORTYPE                 ret = OMX_ErrorNone;
     ROCKCHIP_OMX_BASECOMPONENT     *pRockchipComponent = NULL;
-    ROCKCHIP_OMX_RM_COMPONENT_LIST *pComponentTemp = NULL;
-    ROCKCHIP_OMX_RM_COMPONENT_LIST *pComponentCandidate = NULL;
-    int numElem = 0;
-    int lowCompDetect = 0;
+    ROCKCHIP_OMX_RM_POOL           *pPool = NULL;
+    OMX_U64                        lowLoad = 0;
+    OMX_U32                        numElem = 0;
+    OMX_U32                        numLow = 0;
 
     FunctionIn();
 
     Rockchip_OSAL_MutexLock(ghVideoRMComponentListMutex);
 
     pRockchipComponent = (ROCKCHIP_OMX_BASECOMPONENT *)pOMXComponent->pComponentPrivate;
-
-    if (pRockchipComponent->codecType == HW_VIDEO_DEC_CODEC) {
-        pComponentTemp = gpVideoDecRMComponentList;
-        if (pComponentTemp != NULL) {
-            while (pComponentTemp) {
-                numElem++;
-                pComponentTemp = pComponentTemp->pNext;
-            }
-        } else {
-            numElem = 0;
-        }
-        if (numElem >= MAX_RESOURCE_VIDEO_DEC) {
-            lowCompDetect = searchLowPriority(gpVideoDecRMComponentList,
-                pRockchipComponent->compPriority.nGroupPriority, &pComponentCandidate);
-            if (lowCompDetect <= 0) {
-                ret = OMX_ErrorInsufficientResources;
-            }
-        }
-    } else if (pRockchipComponent->codecType == HW_VIDEO_ENC_CODEC) {
-        pComponentTemp = gpVideoEncRMComponentList;
-        if (pComponentTemp != NULL) {
-            while (pComponentTemp) {
-                numElem++;
-                pComponentTemp = pComponentTemp->pNext;
-            }
-        } else {
-            numElem = 0;
+    pPool = getPool(pRockchipComponent);
+    if (pPool != NULL) {
+        numElem = sumElementList(pPool->pComponentList, OMX_FALSE, 0, &lowLoad);
+        numLow = sumElementList(pPool->pComponentList, OMX_TRUE,
+            pRockchipComponent->compPriority.nGroupPriority, &lowLoad);
+        if ((numElem >= pPool->nMaxInstance) && (numLow == 0)) {
+            ret = OMX_ErrorInsufficientResources;
         }
-        if (numElem >= MAX_RESOURCE_VIDEO_ENC) {
-            lowCompDetect = searchLowPriority(gpVideoEncRMComponentList,
-                pRockchipComponent->compPriority.nGroupPriority, &pComponentCandidate);
-            if (lowCompDetect <= 0) {
-                ret = OMX_ErrorInsufficientResources;
+    }
+    Rockchip_OSAL_MutexUnlock(ghVideoRMComponentListMutex);
+    FunctionOut();
+    return ret;
+}
+
+/* the preempted component has to be loaded and take the resource again before executing */
+OMX_ERRORTYPE Rockchip_OMX_Check_Preempted(OMX_COMPONENTTYPE *pOMXComponent)
+{
+    OMX_ERRORTYPE                 ret = OMX_ErrorNone;
+    ROCKCHIP_OMX_BASECOMPONENT     *pRockchipComponent = NULL;
+    ROCKCHIP_OMX_RM_POOL           *pPool = NULL;
+    ROCKCHIP_OMX_RM_COMPONENT_LIST *pList = NULL;
+
+    FunctionIn();
+
+    Rockchip_OSAL_MutexLock(ghVideoRMComponentListMutex);
+
+    pRockchipComponent = (ROCKCHIP_OMX_BASECOMPONENT *)pOMXComponent->pComponentPrivate;
+    pPool = getPool(pRockchipComponent);
+    for (pList = (pPool != NULL) ? pPool->pComponentList : NULL; pList != NULL; pList = pList->pNext) {
+        if (pList->pOMXStandComp == pOMXComponent) {
+            if (pList->bPreempted == OMX_TRUE) {
+                omx_err("%s component %p is preempted", pPool->name, pOMXComponent);
+                ret = OMX_ErrorResourcesLost;
             }
+            break;
         }
     }
+
     Rockchip_OSAL_MutexUnlock(ghVideoRMComponentListMutex);
+    FunctionOut();
     return ret;
 }
 
@@ -325,91 +451,29 @@ OMX_ERRORTYPE Rockchip_OMX_Get_Resource(OMX_COMPONENTTYPE *pOMXComponent)
 {
     OMX_ERRORTYPE                 ret = OMX_ErrorNone;
     ROCKCHIP_OMX_BASECOMPONENT     *pRockchipComponent = NULL;
-    ROCKCHIP_OMX_RM_COMPONENT_LIST *pComponentTemp = NULL;
-    ROCKCHIP_OMX_RM_COMPONENT_LIST *pComponentCandidate = NULL;
-    int numElem = 0;
-    int lowCompDetect = 0;
+    ROCKCHIP_OMX_RM_POOL           *pPool = NULL;
+    OMX_U64                        nLoad = 0;
 
     FunctionIn();
 
     Rockchip_OSAL_MutexLock(ghVideoRMComponentListMutex);
 
     pRockchipComponent = (ROCKCHIP_OMX_BASECOMPONENT *)pOMXComponent->pComponentPrivate;
+    pPool = getPool(pRockchipComponent);
+    if (pPool == NULL) {
+        ret = OMX_ErrorNone;
+        goto EXIT;
+    }
 
-    if (pRockchipComponent->codecType == HW_VIDEO_DEC_CODEC) {
-        pComponentTemp = gpVideoDecRMComponentList;
-        if (pComponentTemp != NULL) {
-            while (pComponentTemp) {
-                numElem++;
-                pComponentTemp = pComponentTemp->pNext;
-            }
-        } else {
-            numElem = 0;
-        }
-        if (numElem >= MAX_RESOURCE_VIDEO_DEC) {
-            lowCompDetect = searchLowPriority(gpVideoDecRMComponentList,
-                pRockchipComponent->compPriority.nGroupPriority, &pComponentCandidate);
-            if (lowCompDetect <= 0) {
-                ret = OMX_ErrorInsufficientResources;
-                goto EXIT;
-            } else {
-                ret = removeComponent(pComponentCandidate->pOMXStandComp);
-                if (ret != OMX_ErrorNone) {
-                    ret = OMX_ErrorInsufficientResources;
-                    goto EXIT;
-                } else {
-                    ret = removeElementList(&gpVideoDecRMComponentList, pComponentCandidate->pOMXStandComp);
-                    ret = addElementList(&gpVideoDecRMComponentList, pOMXComponent);
-                    if (ret != OMX_ErrorNone) {
-                        ret = OMX_ErrorInsufficientResources;
-                        goto EXIT;
-                    }
-                }
-            }
-        } else {
-            ret = addElementList(&gpVideoDecRMComponentList, pOMXComponent);
-            if (ret != OMX_ErrorNone) {
-                ret = OMX_ErrorInsufficientResources;
-                goto EXIT;
-            }
-        }
-    } else if (pRockchipComponent->codecType == HW_VIDEO_ENC_CODEC) {
-        pComponentTemp = gpVideoEncRMComponentList;
-        if (pComponentTemp != NULL) {
-            while (pComponentTemp) {
-                numElem++;
-                pComponentTemp = pComponentTemp->pNext;
-            }
-        } else {
-            numElem = 0;
-        }
-        if (numElem >= MAX_RESOURCE_VIDEO_ENC) {
-            lowCompDetect = searchLowPriority(gpVideoEncRMComponentList,
-                pRockchipComponent->compPriority.nGroupPriority, &pComponentCandidate);
-            if (lowCompDetect <= 0) {
-                ret = OMX_ErrorInsufficientResources;
-                goto EXIT;
-            } else {
-                ret = removeComponent(pComponentCandidate->pOMXStandComp);
-                if (ret != OMX_ErrorNone) {
-                    ret = OMX_ErrorInsufficientResources;
-                    goto EXIT;
-                } else {
-                    ret = removeElementList(&gpVideoEncRMComponentList, pComponentCandidate->pOMXStandComp);
-                    ret = addElementList(&gpVideoEncRMComponentList, pOMXComponent);
-                    if (ret != OMX_ErrorNone) {
-                        ret = OMX_ErrorInsufficientResources;
-                        goto EXIT;
-                    }
-                }
-            }
-        } else {
-            ret = addElementList(&gpVideoEncRMComponentList, pOMXComponent);
-            if (ret != OMX_ErrorNone) {
-                ret = OMX_ErrorInsufficientResources;
-                goto EXIT;
-            }
-        }
+    nLoad = calcComponentLoad(pRockchipComponent);
+    ret = admitComponent(pPool, pRockchipComponent->compPriority.nGroupPriority, nLoad, OMX_TRUE);
+    if (ret != OMX_ErrorNone) {
+        goto EXIT;
+    }
+    ret = addElementList(&pPool->pComponentList, pOMXComponent, nLoad);
+    if (ret != OMX_ErrorNone) {
+        ret = OMX_ErrorInsufficientResources;
+        goto EXIT;
     }
     ret = OMX_ErrorNone;
 
@@ -426,64 +490,35 @@ OMX_ERRORTYPE Rockchip_OMX_Release_Resource(OMX_COMPONENTTYPE *pOMXComponent)
 {
     OMX_ERRORTYPE                 ret = OMX_ErrorNone;
     ROCKCHIP_OMX_BASECOMPONENT     *pRockchipComponent = NULL;
-    ROCKCHIP_OMX_RM_COMPONENT_LIST *pComponentTemp = NULL;
+    ROCKCHIP_OMX_RM_POOL           *pPool = NULL;
     OMX_COMPONENTTYPE            *pOMXWaitComponent = NULL;
-    int numElem = 0;
 
     FunctionIn();
 
     Rockchip_OSAL_MutexLock(ghVideoRMComponentListMutex);
 
     pRockchipComponent = (ROCKCHIP_OMX_BASECOMPONENT *)pOMXComponent->pComponentPrivate;
+    pPool = getPool(pRockchipComponent);
+    if (pPool == NULL) {
+        goto EXIT;
+    }
+    if (pPool->pComponentList == NULL) {
+        ret = OMX_ErrorUndefined;
+        goto EXIT;
+    }
 
-    if (pRockchipComponent->codecType == HW_VIDEO_DEC_CODEC) {
-        pComponentTemp = gpVideoDecRMWaitingList;
-        if (gpVideoDecRMComponentList == NULL) {
-            ret = OMX_ErrorUndefined;
-            goto EXIT;
-        }
-
-        ret = removeElementList(&gpVideoDecRMComponentList, pOMXComponent);
-        if (ret != OMX_ErrorNone) {
-            ret = OMX_ErrorUndefined;
-            goto EXIT;
-        }
-        while (pComponentTemp) {
-            numElem++;
-            pComponentTemp = pComponentTemp->pNext;
-        }
-        if (numElem > 0) {
-            pOMXWaitComponent = gpVideoDecRMWaitingList->pOMXStandComp;
-            removeElementList(&gpVideoDecRMWaitingList, pOMXWaitComponent);
-            ret = OMX_SendCommand(pOMXWaitComponent, OMX_CommandStateSet, OMX_StateIdle, NULL);
-            if (ret != OMX_ErrorNone) {
-                goto EXIT;
-            }
-        }
-    } else if (pRockchipComponent->codecType == HW_VIDEO_ENC_CODEC) {
-        pComponentTemp = gpVideoEncRMWaitingList;
-        if (gpVideoEncRMComponentList == NULL) {
-            ret = OMX_ErrorUndefined;
-            goto EXIT;
-        }
-
-        ret = removeElementList(&gpVideoEncRMComponentList, pOMXComponent);
+    ret = removeElementList(&pPool->pComponentList, pOMXComponent);
+    if (ret != OMX_ErrorNone) {
+        ret = OMX_ErrorUndefined;
+        goto EXIT;
+    }
+    if (pPool->pWaitingList != NULL) {
+        pOMXWaitComponent = pPool->pWaitingList->pOMXStandComp;
+        removeElementList(&pPool->pWaitingList, pOMXWaitComponent);
+        ret = OMX_SendCommand(pOMXWaitComponent, OMX_CommandStateSet, OMX_StateIdle, NULL);
         if (ret != OMX_ErrorNone) {
-            ret = OMX_ErrorUndefined;
             goto EXIT;
         }
-        while (pComponentTemp) {
-            numElem++;
-            pComponentTemp = pComponentTemp->pNext;
-        }
-        if (numElem > 0) {
-            pOMXWaitComponent = gpVideoEncRMWaitingList->pOMXStandComp;
-            removeElementList(&gpVideoEncRMWaitingList, pOMXWaitComponent);
-            ret = OMX_SendCommand(pOMXWaitComponent, OMX_CommandStateSet, OMX_StateIdle, NULL);
-            if (ret != OMX_ErrorNone) {
-                goto EXIT;
-            }
-        }
     }
 
 EXIT:
@@ -499,16 +534,16 @@ OMX_ERRORTYPE Rockchip_OMX_In_WaitForResource(OMX_COMPONENTTYPE *pOMXComponent)
 {
     OMX_ERRORTYPE             ret = OMX_ErrorNone;
     ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent = NULL;
+    ROCKCHIP_OMX_RM_POOL       *pPool = NULL;
 
     FunctionIn();
 
     Rockchip_OSAL_MutexLock(ghVideoRMComponentListMutex);
 
     pRockchipComponent = (ROCKCHIP_OMX_BASECOMPONENT *)pOMXComponent->pComponentPrivate;
-    if (pRockchipComponent->codecType == HW_VIDEO_DEC_CODEC)
-        ret = addElementList(&gpVideoDecRMWaitingList, pOMXComponent);
-    else if (pRockchipComponent->codecType == HW_VIDEO_ENC_CODEC)
-        ret = addElementList(&gpVideoEncRMWaitingList, pOMXComponent);
+    pPool = getPool(pRockchipComponent);
+    if (pPool != NULL)
+        ret = addElementList(&pPool->pWaitingList, pOMXComponent, calcComponentLoad(pRockchipComponent));
 
     Rockchip_OSAL_MutexUnlock(ghVideoRMComponentListMutex);
 
@@ -521,20 +556,20 @@ OMX_ERRORTYPE Rockchip_OMX_Out_WaitForResource(OMX_COMPONENTTYPE *pOMXComponent)
 {
     OMX_ERRORTYPE             ret = OMX_ErrorNone;
     ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent = NULL;
+    ROCKCHIP_OMX_RM_POOL       *pPool = NULL;
 
     FunctionIn();
 
     Rockchip_OSAL_MutexLock(ghVideoRMComponentListMutex);
 
     pRockchipComponent = (ROCKCHIP_OMX_BASECOMPONENT *)pOMXComponent->pComponentPrivate;
-    if (pRockchipComponent->codecType == HW_VIDEO_DEC_CODEC)
-        ret = removeElementList(&gpVideoDecRMWaitingList, pOMXComponent);
-    else if (pRockchipComponent->codecType == HW_VIDEO_ENC_CODEC)
-        ret = removeElementList(&gpVideoEncRMWaitingList, pOMXComponent);
+    pPool = getPool(pRockchipComponent);
+    if (pPool != NULL)
+        ret = removeElementList(&pPool->pWaitingList, pOMXComponent);
 
     Rockchip_OSAL_MutexUnlock(ghVideoRMComponentListMutex);
 
     FunctionOut();
 
     return ret;
-}
\ No newline at end of file
+}
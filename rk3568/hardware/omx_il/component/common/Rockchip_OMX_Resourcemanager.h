@@ -34,6 +34,8 @@ struct ROCKCHIP_OMX_RM_COMPONENT_LIST;
 typedef struct _ROCKCHIP_OMX_RM_COMPONENT_LIST {
     OMX_COMPONENTTYPE         *pOMXStandComp;
     OMX_U32                    groupPriority;
+    OMX_U64                    nLoad;          /* macroblocks per second */
+    OMX_BOOL                   bPreempted;     /* keeps the codec until it is loaded, not counted any more */
     struct _ROCKCHIP_OMX_RM_COMPONENT_LIST *pNext;
 } ROCKCHIP_OMX_RM_COMPONENT_LIST;
 
@@ -45,6 +47,7 @@ OMX_ERRORTYPE Rockchip_OMX_ResourceManager_Init();
 OMX_ERRORTYPE Rockchip_OMX_ResourceManager_Deinit();
 OMX_ERRORTYPE Rockchip_OMX_Get_Resource(OMX_COMPONENTTYPE *pOMXComponent);
 OMX_ERRORTYPE Rockchip_OMX_Check_Resource(OMX_COMPONENTTYPE *pOMXComponent);
+OMX_ERRORTYPE Rockchip_OMX_Check_Preempted(OMX_COMPONENTTYPE *pOMXComponent);
 OMX_ERRORTYPE Rockchip_OMX_Release_Resource(OMX_COMPONENTTYPE *pOMXComponent);
 OMX_ERRORTYPE Rockchip_OMX_In_WaitForResource(OMX_COMPONENTTYPE *pOMXComponent);
 OMX_ERRORTYPE Rockchip_OMX_Out_WaitForResource(OMX_COMPONENTTYPE *pOMXComponent);
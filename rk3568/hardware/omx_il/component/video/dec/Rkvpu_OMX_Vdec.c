@@ -101,51 +101,158 @@ int calc_plane(int width, int height)
     return (mbX * 16) * (mbY * 16); // 16:byte alignment
 }
 
-static void controlFPS(OMX_BOOL isInput)
+/* the frame rate is averaged over a second at least */
+#define RKVPU_STATS_RATE_US 1000000
+
+static void Rkvpu_Stats_Reset(RKVPU_DEC_STATS *stats)
 {
-    static int inFrameCount = 0;
-    static int inLastFrameCount = 0;
-    static long inLastFpsTimeUs = 0;
-    static float inFps = 0;
-    static long inDiff = 0;
-    static long inNowUs = 0;
-    static int outFrameCount = 0;
-    static int outLastFrameCount = 0;
-    static long outLastFpsTimeUs = 0;
-    static float outFps = 0;
-    static long outDiff = 0;
-    static long outNowUs = 0;
-
-    if (isInput == OMX_TRUE) {
-        inFrameCount++;
-        if (!(inFrameCount & 0x1F)) {
-            struct timeval now;
-            gettimeofday(&now, NULL);
-            inNowUs = (long)now.tv_sec * 1000000 + (long)now.tv_usec; // 1000000:time unit conversion
-            inDiff = inNowUs - inLastFpsTimeUs;
-            inFps = ((float)(inFrameCount - inLastFrameCount) * 1.0f) * 1000.0f * 1000.0f / (float)inDiff; /* 1000:
-                                                                                            time unit conversion */
-            inLastFpsTimeUs = inNowUs;
-            inLastFrameCount = inFrameCount;
-            omx_info("decode input frameCount = %d frameRate = %f HZ", inFrameCount, inFps);
-        }
-    } else {
-        outFrameCount++;
-        if (!(outFrameCount & 0x1F)) {
-            struct timeval now;
-            gettimeofday(&now, NULL);
-            outNowUs = (long)now.tv_sec * 1000000 + (long)now.tv_usec; // 1000000:time unit conversion
-            outDiff = outNowUs - outLastFpsTimeUs;
-            outFps = ((float)(outFrameCount - outLastFrameCount) * 1.0f) * 1000.0f * 1000.0f / (float)outDiff; /* 1000:
-                                                                                            time unit conversion */
-            outLastFpsTimeUs = outNowUs;
-            outLastFrameCount = outFrameCount;
-            omx_info("decode output frameCount = %d frameRate = %f HZ", outFrameCount, outFps);
-        }
+    OMX_HANDLETYPE hLock = stats->hLock;
+
+    Rockchip_OSAL_Memset(stats, 0, sizeof(RKVPU_DEC_STATS));
+    stats->hLock = hLock;
+}
+
+static void Rkvpu_Stats_UpdateRate(RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec, OMX_U32 nPortIndex, OMX_U64 nowUs)
+{
+    RKVPU_PORT_STATS *port = &pVideoDec->stats.port[nPortIndex];
+    OMX_U64 diffUs = nowUs - port->nRateStartUs;
+
+    if (port->nRateStartUs == 0) {
+        port->nRateStartUs = nowUs;
+        port->nRateStartFrames = port->nFrames;
+        return;
     }
-    return;
+    if (diffUs < RKVPU_STATS_RATE_US)
+        return;
+
+    port->xFramerate = (OMX_U32)(((port->nFrames - port->nRateStartFrames) << 16) * 1000000 / diffUs); /* 16:Q16,
+                                                                                    1000000:time unit conversion */
+    port->nRateStartUs = nowUs;
+    port->nRateStartFrames = port->nFrames;
+    if (pVideoDec->bPrintFps == OMX_TRUE) {
+        omx_info("decode %s frameCount = %llu frameRate = %f HZ",
+            (nPortIndex == INPUT_PORT_INDEX) ? "input" : "output",
+            (unsigned long long)port->nFrames, (float)port->xFramerate / 65536.0f); // 65536.0f:Q16
+    }
+}
+
+void Rkvpu_Stats_InputTaken(RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec, OMX_BUFFERHEADERTYPE *bufferHeader,
+    OMX_U32 nQueueDepth)
+{
+    RKVPU_DEC_STATS *stats = &pVideoDec->stats;
+    RKVPU_PORT_STATS *port = &stats->port[INPUT_PORT_INDEX];
+    OMX_U64 nowUs = Rockchip_OSAL_GetMonotonicUs();
+
+    Rockchip_OSAL_MutexLock(stats->hLock);
+    port->nFrames++;
+    port->nBytes += bufferHeader->nFilledLen;
+    port->nQueueDepth = nQueueDepth;
+    if (nQueueDepth > port->nMaxQueueDepth)
+        port->nMaxQueueDepth = nQueueDepth;
+    stats->pending[stats->nPendingNext].timeStamp = bufferHeader->nTimeStamp;
+    stats->pending[stats->nPendingNext].nTakenUs = nowUs;
+    stats->pending[stats->nPendingNext].nSentUs = 0;
+    stats->nPendingNext = (stats->nPendingNext + 1) % RKVPU_STATS_PENDING_NUM;
+    Rkvpu_Stats_UpdateRate(pVideoDec, INPUT_PORT_INDEX, nowUs);
+    Rockchip_OSAL_MutexUnlock(stats->hLock);
 }
 
+/* the newest pending packet of the time stamp, the time stamps of the packets are not always unique */
+static RKVPU_PENDING_FRAME *Rkvpu_Stats_FindPending(RKVPU_DEC_STATS *stats, OMX_TICKS timeStamp)
+{
+    OMX_U32 i = 0;
+
+    for (i = 1; i <= RKVPU_STATS_PENDING_NUM; i++) {
+        RKVPU_PENDING_FRAME *pending =
+            &stats->pending[(stats->nPendingNext + RKVPU_STATS_PENDING_NUM - i) % RKVPU_STATS_PENDING_NUM];
+        if (pending->nTakenUs != 0 && pending->timeStamp == timeStamp)
+            return pending;
+    }
+    return NULL;
+}
+
+static void Rkvpu_Stats_InputSent(RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec, OMX_TICKS timeStamp)
+{
+    RKVPU_DEC_STATS *stats = &pVideoDec->stats;
+    RKVPU_PENDING_FRAME *pending = NULL;
+
+    Rockchip_OSAL_MutexLock(stats->hLock);
+    pending = Rkvpu_Stats_FindPending(stats, timeStamp);
+    if (pending != NULL && pending->nSentUs == 0)
+        pending->nSentUs = Rockchip_OSAL_GetMonotonicUs();
+    Rockchip_OSAL_MutexUnlock(stats->hLock);
+}
+
+static void Rkvpu_Stats_OutputReturned(RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec, OMX_TICKS timeStamp,
+    OMX_U32 nBytes, OMX_U32 nQueueDepth, OMX_U64 nGotUs)
+{
+    RKVPU_DEC_STATS *stats = &pVideoDec->stats;
+    RKVPU_PORT_STATS *port = &stats->port[OUTPUT_PORT_INDEX];
+    RKVPU_PENDING_FRAME *pending = NULL;
+    OMX_U64 nowUs = Rockchip_OSAL_GetMonotonicUs();
+
+    Rockchip_OSAL_MutexLock(stats->hLock);
+    port->nFrames++;
+    port->nBytes += nBytes;
+    port->nQueueDepth = nQueueDepth;
+    if (nQueueDepth > port->nMaxQueueDepth)
+        port->nMaxQueueDepth = nQueueDepth;
+    pending = Rkvpu_Stats_FindPending(stats, timeStamp);
+    if (pending != NULL) {
+        if (pending->nSentUs != 0 && nGotUs >= pending->nSentUs)
+            Rockchip_OSAL_LatencyAdd(&stats->decodeLatency, nGotUs - pending->nSentUs);
+        Rockchip_OSAL_LatencyAdd(&stats->delay, nowUs - pending->nTakenUs);
+        pending->nTakenUs = 0;
+    }
+    Rkvpu_Stats_UpdateRate(pVideoDec, OUTPUT_PORT_INDEX, nowUs);
+    Rockchip_OSAL_MutexUnlock(stats->hLock);
+}
+
+OMX_ERRORTYPE Rkvpu_Stats_Get(RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec, OMX_VIDEO_CONFIG_STATISTICSTYPE *statistics)
+{
+    RKVPU_DEC_STATS *stats = &pVideoDec->stats;
+    RKVPU_PORT_STATS *port = NULL;
+    static const OMX_U32 percents[] = { 50, 90, 99 };
+    OMX_U32 i = 0;
+
+    if (statistics->nPortIndex >= ALL_PORT_NUM)
+        return OMX_ErrorBadPortIndex;
+
+    Rockchip_OSAL_MutexLock(stats->hLock);
+    port = &stats->port[statistics->nPortIndex];
+    statistics->nFrames = port->nFrames;
+    statistics->nBytes = port->nBytes;
+    statistics->xFramerate = port->xFramerate;
+    statistics->nQueueDepth = port->nQueueDepth;
+    statistics->nMaxQueueDepth = port->nMaxQueueDepth;
+    for (i = 0; i < ARRAY_SIZE(percents); i++) {
+        statistics->nDecodeLatencyUs[i] = Rockchip_OSAL_LatencyPercentile(&stats->decodeLatency, percents[i]);
+        statistics->nDelayUs[i] = Rockchip_OSAL_LatencyPercentile(&stats->delay, percents[i]);
+    }
+    statistics->nMaxDecodeLatencyUs = stats->decodeLatency.nMax;
+    statistics->nMaxDelayUs = stats->delay.nMax;
+    Rockchip_OSAL_MutexUnlock(stats->hLock);
+    return OMX_ErrorNone;
+}
+
+static void Rkvpu_Stats_Print(RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec)
+{
+    OMX_VIDEO_CONFIG_STATISTICSTYPE statistics;
+    OMX_U32 i = 0;
+
+    for (i = 0; i < ALL_PORT_NUM; i++) {
+        Rockchip_OSAL_Memset(&statistics, 0, sizeof(statistics));
+        statistics.nPortIndex = i;
+        Rkvpu_Stats_Get(pVideoDec, &statistics);
+        omx_info("%s frames %llu bytes %llu queue %d max %d", (i == INPUT_PORT_INDEX) ? "input" : "output",
+            (unsigned long long)statistics.nFrames, (unsigned long long)statistics.nBytes,
+            statistics.nQueueDepth, statistics.nMaxQueueDepth);
+    }
+    omx_info("decode latency p50 %d p90 %d p99 %d max %d us, delay p50 %d p90 %d p99 %d max %d us",
+        statistics.nDecodeLatencyUs[0], statistics.nDecodeLatencyUs[1], statistics.nDecodeLatencyUs[2], // 2:p99
+        statistics.nMaxDecodeLatencyUs, statistics.nDelayUs[0], statistics.nDelayUs[1],
+        statistics.nDelayUs[2], statistics.nMaxDelayUs); // 2:p99
+}
 
 void UpdateFrameSize(OMX_COMPONENTTYPE *pOMXComponent)
 {
@@ -324,7 +431,7 @@ OMX_ERRORTYPE Rkvpu_ResetAllPortConfig(OMX_COMPONENTTYPE *pOMXComponent)
     pRockchipOutputPort->portDefinition.nBufferCountMin = MAX_VIDEO_OUTPUTBUFFER_NUM;
     pRockchipOutputPort->portDefinition.nBufferSize = DEFAULT_VIDEO_OUTPUT_BUFFER_SIZE;
     pRockchipOutputPort->portDefinition.bEnabled = OMX_TRUE;
-    pRockchipOutputPort->bufferProcessType = BUFFER_COPY | BUFFER_ANBSHARE;
+    Rkvpu_UpdateBufferProcessType(pRockchipComponent);
     pRockchipOutputPort->portWayType = WAY2_PORT;
 
     return ret;
@@ -425,6 +532,10 @@ OMX_BOOL Rkvpu_SendInputData(OMX_COMPONENTTYPE *pOMXComponent)
             // add by xhr
             int32_t depth = (pVideoDec->bIs10bit) ? OMX_DEPTH_BIT_10 : OMX_DEPTH_BIT_8;
             fbcMode = Rockchip_OSAL_Check_Use_FBCMode(pVideoDec->codecId, depth, rockchipOutputPort);
+            if (rockchipOutputPort->bufferProcessType == BUFFER_SHARE) {
+                /* the native buffers of the client are read as linear nv12 */
+                fbcMode = 0;
+            }
             if (fbcMode) {
                 /* fbc_Output_format: FBC_AFBC_V2 */
                 fbcOutFmt = 0x00200000;
@@ -521,10 +632,7 @@ OMX_BOOL Rkvpu_SendInputData(OMX_COMPONENTTYPE *pOMXComponent)
             goto EXIT;
         }
 
-        if (pVideoDec->bPrintFps == OMX_TRUE) {
-            OMX_BOOL isInput = OMX_TRUE;
-            controlFPS(isInput);
-        }
+        Rkvpu_Stats_InputSent(pVideoDec, inputUseBuffer->timeStamp);
 
         if (pVideoDec->bDRMPlayerMode == OMX_TRUE) {
             Rkvpu_InputBufferReturn(pOMXComponent, inputUseBuffer);
@@ -566,6 +674,7 @@ OMX_BOOL Rkvpu_Post_OutputFrame(OMX_COMPONENTTYPE *pOMXComponent)
     OMX_U32 coeffs    = 0;
     OMX_COLORASPECTS Aspects = { 0, 0, 0, 0 };
     OMX_COLORASPECTS *colorAspects = NULL;
+    OMX_U64 nGotUs = 0;
 
     FunctionIn();
     if (p_vpu_ctx == NULL ||
@@ -601,6 +710,7 @@ OMX_BOOL Rkvpu_Post_OutputFrame(OMX_COMPONENTTYPE *pOMXComponent)
         if ((numInOmxAl < limitNum) ||
             (pVideoDec->maxCount > 20)) { // 20:framecount
             dec_ret =  p_vpu_ctx->decode_getframe(p_vpu_ctx, &pOutput);
+            nGotUs = Rockchip_OSAL_GetMonotonicUs();
             omx_trace("pOutput.size %d", pOutput.size);
             pVideoDec->maxCount = 0;
         } else {
@@ -715,10 +825,6 @@ OMX_BOOL Rkvpu_Post_OutputFrame(OMX_COMPONENTTYPE *pOMXComponent)
                 goto EXIT;
             }
 
-            if (pVideoDec->bPrintFps == OMX_TRUE) {
-                OMX_BOOL isInput = OMX_FALSE;
-                controlFPS(isInput);
-            }
             if (pframe->ErrorInfo && (pVideoDec->bGtsMediaTest == OMX_FALSE) &&
                 (pVideoDec->bDRMPlayerMode == OMX_FALSE)) {   // drop frame when this frame mark error from dec
                 omx_err("this frame is Error frame!,pOutput.timeUs = %lld", pOutput.timeUs);
@@ -737,6 +843,7 @@ OMX_BOOL Rkvpu_Post_OutputFrame(OMX_COMPONENTTYPE *pOMXComponent)
                 fflush(pVideoDec->fp_out);
             }
             if (bufferHeader != NULL) {
+                pVideoDec->nOutputPathCount[RKVPU_OUTPUT_SHARE]++;
                 if (pVideoDec->bStoreMetaData == OMX_TRUE) {
                     bufferHeader->nFilledLen = bufferHeader->nAllocLen;
                     omx_trace("nfill len %d", (int)bufferHeader->nFilledLen);
@@ -768,7 +875,10 @@ OMX_BOOL Rkvpu_Post_OutputFrame(OMX_COMPONENTTYPE *pOMXComponent)
             if ((bufferHeader->nFilledLen > 0) ||
                 ((bufferHeader->nFlags & OMX_BUFFERFLAG_EOS) == OMX_BUFFERFLAG_EOS) ||
                 (CHECK_PORT_BEING_FLUSHED(pOutputPort))) {
+                OMX_TICKS timeStamp = bufferHeader->nTimeStamp;
+                OMX_U32 nFilledLen = bufferHeader->nFilledLen;
                 Rockchip_OMX_OutputBufferReturn(pOMXComponent, bufferHeader);
+                Rkvpu_Stats_OutputReturned(pVideoDec, timeStamp, nFilledLen, pOWnBycomponetNum, nGotUs);
             }
 
             ret = OMX_TRUE;
@@ -800,6 +910,7 @@ OMX_BOOL Rkvpu_Post_OutputFrame(OMX_COMPONENTTYPE *pOMXComponent)
             Rockchip_OSAL_Memset(&pframe, 0, sizeof(VPU_FRAME));
             pOutput.data = (unsigned char *)&pframe;
             ret =  p_vpu_ctx->decode_getframe(p_vpu_ctx, &pOutput);
+            nGotUs = Rockchip_OSAL_GetMonotonicUs();
             if (ret < 0) {
                 if (ret == VPU_API_EOS_STREAM_REACHED && !pframe.ErrorInfo) {
                     outputUseBuffer->dataLen = 0;
@@ -947,7 +1058,10 @@ OMX_BOOL Rkvpu_Post_OutputFrame(OMX_COMPONENTTYPE *pOMXComponent)
                 if ((outputUseBuffer->remainDataLen > 0) ||
                     ((outputUseBuffer->nFlags & OMX_BUFFERFLAG_EOS) == OMX_BUFFERFLAG_EOS) ||
                     (CHECK_PORT_BEING_FLUSHED(pOutputPort))) {
+                    OMX_TICKS timeStamp = outputUseBuffer->timeStamp;
+                    OMX_U32 nFilledLen = outputUseBuffer->remainDataLen;
                     Rkvpu_OutputBufferReturn(pOMXComponent, outputUseBuffer);
+                    Rkvpu_Stats_OutputReturned(pVideoDec, timeStamp, nFilledLen, pOWnBycomponetNum, nGotUs);
                 }
                 ret = OMX_TRUE;
             } else if (CHECK_PORT_BEING_FLUSHED(pOutputPort)) {
@@ -1019,9 +1133,13 @@ OMX_ERRORTYPE Rkvpu_OMX_InputBufferProcess(OMX_HANDLETYPE hComponent)
                 }
 
                 if (srcInputUseBuffer->dataValid == OMX_TRUE) {
+                    OMX_U32 outputSeq = Rockchip_OSAL_FutexSeq(&pVideoDec->outputProgress);
                     if (Rkvpu_SendInputData(hComponent) != OMX_TRUE) {
                         omx_trace("stream list is full");
-                        Rockchip_OSAL_SleepMillisec(5); // 5:sleep
+                        // a frame taken by the output thread makes room in the stream list
+                        Rockchip_OSAL_FutexWait(&pVideoDec->outputProgress, outputSeq, 5); // 5:max wait time
+                    } else {
+                        Rockchip_OSAL_FutexWake(&pVideoDec->inputProgress);
                     }
                 }
                 if (CHECK_PORT_BEING_FLUSHED(rockchipInputPort)) {
@@ -1043,6 +1161,22 @@ EXIT:
     return ret;
 }
 
+/*
+ * Post a decoded frame, or wait for the input thread to feed the decoder when there is none. The wait is
+ * bounded since the decoder finishes the frames in the stream list on its own.
+ */
+static void Rkvpu_OMX_PostOrWait(OMX_COMPONENTTYPE *pOMXComponent)
+{
+    ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent = (ROCKCHIP_OMX_BASECOMPONENT *)pOMXComponent->pComponentPrivate;
+    RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec = (RKVPU_OMX_VIDEODEC_COMPONENT *)pRockchipComponent->hComponentHandle;
+    OMX_U32 inputSeq = Rockchip_OSAL_FutexSeq(&pVideoDec->inputProgress);
+
+    if (Rkvpu_Post_OutputFrame(pOMXComponent) != OMX_TRUE) {
+        Rockchip_OSAL_FutexWait(&pVideoDec->inputProgress, inputSeq, 3); // 3:max wait time
+    } else {
+        Rockchip_OSAL_FutexWake(&pVideoDec->outputProgress);
+    }
+}
 
 OMX_ERRORTYPE Rkvpu_OMX_OutputBufferProcess(OMX_HANDLETYPE hComponent)
 {
@@ -1066,9 +1200,7 @@ OMX_ERRORTYPE Rkvpu_OMX_OutputBufferProcess(OMX_HANDLETYPE hComponent)
 
             Rockchip_OSAL_MutexLock(dstOutputUseBuffer->bufferMutex);
             if (rockchipOutputPort->bufferProcessType == BUFFER_SHARE) {
-                if (Rkvpu_Post_OutputFrame(pOMXComponent) != OMX_TRUE) {
-                    Rockchip_OSAL_SleepMillisec(3); // 3:sleep
-                }
+                Rkvpu_OMX_PostOrWait(pOMXComponent);
             } else {
                 if ((dstOutputUseBuffer->dataValid != OMX_TRUE) &&
                     (!CHECK_PORT_BEING_FLUSHED(rockchipOutputPort))) {
@@ -1080,9 +1212,7 @@ OMX_ERRORTYPE Rkvpu_OMX_OutputBufferProcess(OMX_HANDLETYPE hComponent)
                 }
 
                 if (dstOutputUseBuffer->dataValid == OMX_TRUE) {
-                    if (Rkvpu_Post_OutputFrame(pOMXComponent) != OMX_TRUE) {
-                        Rockchip_OSAL_SleepMillisec(3); // 3:sleep
-                    }
+                    Rkvpu_OMX_PostOrWait(pOMXComponent);
                 }
             }
             /* reset outputData */
@@ -1189,6 +1319,8 @@ OMX_ERRORTYPE Rkvpu_OMX_BufferProcess_Terminate(OMX_COMPONENTTYPE *pOMXComponent
     FunctionIn();
 
     pVideoDec->bExitBufferProcessThread = OMX_TRUE;
+    Rockchip_OSAL_FutexWake(&pVideoDec->inputProgress);
+    Rockchip_OSAL_FutexWake(&pVideoDec->outputProgress);
 
     Rockchip_OSAL_Get_SemaphoreCount(pRockchipComponent->pRockchipPort[INPUT_PORT_INDEX].bufferSemID, &countValue);
     if (countValue == 0)
@@ -1343,6 +1475,9 @@ OMX_ERRORTYPE Rkvpu_Dec_ComponentInit(OMX_COMPONENTTYPE *pOMXComponent)
     pVideoDec->bFirstFrame = OMX_TRUE;
     pVideoDec->maxCount = 0;
     pVideoDec->bInfoChange = OMX_FALSE;
+    Rockchip_OSAL_MutexLock(pVideoDec->stats.hLock);
+    Rkvpu_Stats_Reset(&pVideoDec->stats);
+    Rockchip_OSAL_MutexUnlock(pVideoDec->stats.hLock);
 
     if (pVideoDec->bDRMPlayerMode == OMX_FALSE) {
         if (Rkvpu_OMX_CheckIsNeedFastmode(pRockchipComponent) != OMX_ErrorNone) {
@@ -1365,6 +1500,12 @@ OMX_ERRORTYPE Rkvpu_Dec_ComponentInit(OMX_COMPONENTTYPE *pOMXComponent)
         pVideoDec->b4K_flags = OMX_TRUE;
     }
 
+    if ((pRockchipComponent->pRockchipPort[OUTPUT_PORT_INDEX].bufferProcessType == BUFFER_SHARE) &&
+        (pVideoDec->vpumem_handle == NULL) && (Rkvpu_OpenShareBufferPool(pRockchipComponent) != OMX_ErrorNone)) {
+        omx_warn("share the output buffers failed, copy the frames");
+        pRockchipComponent->pRockchipPort[OUTPUT_PORT_INDEX].bufferProcessType = BUFFER_COPY | BUFFER_ANBSHARE;
+    }
+
 EXIT:
     FunctionOut();
 
@@ -1387,6 +1528,15 @@ OMX_ERRORTYPE Rkvpu_Dec_Terminate(OMX_COMPONENTTYPE *pOMXComponent)
             pVideoDec->rkapi_hdl = NULL;
         }
     }
+    if (pVideoDec != NULL) {
+        omx_info("output frames share %llu rga %llu cpu %llu",
+            (unsigned long long)pVideoDec->nOutputPathCount[RKVPU_OUTPUT_SHARE],
+            (unsigned long long)pVideoDec->nOutputPathCount[RKVPU_OUTPUT_RGA],
+            (unsigned long long)pVideoDec->nOutputPathCount[RKVPU_OUTPUT_CPU]);
+        Rockchip_OSAL_Memset(pVideoDec->nOutputPathCount, 0, sizeof(pVideoDec->nOutputPathCount));
+        Rkvpu_Stats_Print(pVideoDec);
+        Rkvpu_CloseShareBufferPool(pRockchipComponent);
+    }
     Rkvpu_ResetAllPortConfig(pOMXComponent);
 
     goto EXIT;
@@ -1443,6 +1593,13 @@ OMX_ERRORTYPE Rockchip_OMX_ComponentConstructor(OMX_HANDLETYPE hComponent, OMX_S
     }
 
     Rockchip_OSAL_Memset(pVideoDec, 0, sizeof(RKVPU_OMX_VIDEODEC_COMPONENT));
+    if (Rockchip_OSAL_MutexCreate(&pVideoDec->stats.hLock) != OMX_ErrorNone) {
+        Rockchip_OSAL_Free(pVideoDec);
+        Rockchip_OMX_BaseComponent_Destructor(pOMXComponent);
+        ret = OMX_ErrorInsufficientResources;
+        omx_err("OMX_ErrorInsufficientResources, Line:%d", __LINE__);
+        goto EXIT;
+    }
     pVideoDec->hSharedMemory = Rockchip_OSAL_SharedMemory_Open();
     if (pVideoDec->hSharedMemory == NULL) {
         omx_err("Rockchip_OSAL_SharedMemory_Open open fail");
@@ -1805,6 +1962,8 @@ OMX_ERRORTYPE Rockchip_OMX_ComponentDeInit(OMX_HANDLETYPE hComponent)
         Rockchip_OSAL_GetEnvU32("ro.build.version.sdk", &version_sdk, 0);
     }
 
+    Rockchip_OSAL_MutexTerminate(pVideoDec->stats.hLock);
+    pVideoDec->stats.hLock = NULL;
     Rockchip_OSAL_Free(pVideoDec);
     pRockchipComponent->hComponentHandle = pVideoDec = NULL;
 
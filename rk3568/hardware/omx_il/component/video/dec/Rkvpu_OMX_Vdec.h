@@ -30,7 +30,9 @@
 
 #include "OMX_Component.h"
 #include "Rockchip_OMX_Def.h"
+#include "Rockchip_OSAL_Event.h"
 #include "Rockchip_OSAL_Queue.h"
+#include "Rockchip_OSAL_ETC.h"
 #include "Rockchip_OMX_Baseport.h"
 #include "Rockchip_OMX_Basecomponent.h"
 #include "OMX_Video.h"
@@ -38,6 +40,42 @@
 #include "vpu_api.h"
 #include "OtherExt.h"
 
+/* how the decoded frames reach the output buffers */
+typedef enum _RKVPU_OUTPUT_PATH {
+    RKVPU_OUTPUT_SHARE = 0,     /* decoded into the buffer of the client */
+    RKVPU_OUTPUT_RGA,           /* copied by rga */
+    RKVPU_OUTPUT_CPU,           /* copied by cpu */
+    RKVPU_OUTPUT_PATH_MAX,
+} RKVPU_OUTPUT_PATH;
+
+/* the packets sent to the codec and not got back as frames yet */
+#define RKVPU_STATS_PENDING_NUM 32
+
+typedef struct _RKVPU_PORT_STATS {
+    OMX_U64 nFrames;
+    OMX_U64 nBytes;
+    OMX_U64 nRateStartUs;
+    OMX_U64 nRateStartFrames;
+    OMX_U32 xFramerate;
+    OMX_U32 nQueueDepth;
+    OMX_U32 nMaxQueueDepth;
+} RKVPU_PORT_STATS;
+
+typedef struct _RKVPU_PENDING_FRAME {
+    OMX_TICKS timeStamp;
+    OMX_U64 nTakenUs;
+    OMX_U64 nSentUs;
+} RKVPU_PENDING_FRAME;
+
+typedef struct _RKVPU_DEC_STATS {
+    OMX_HANDLETYPE hLock;
+    RKVPU_PORT_STATS port[ALL_PORT_NUM];
+    RKVPU_PENDING_FRAME pending[RKVPU_STATS_PENDING_NUM];
+    OMX_U32 nPendingNext;
+    ROCKCHIP_OSAL_LATENCY decodeLatency;
+    ROCKCHIP_OSAL_LATENCY delay;
+} RKVPU_DEC_STATS;
+
 typedef struct _RKVPU_OMX_VIDEODEC_COMPONENT {
     OMX_HANDLETYPE hCodecHandle;
     OMX_BOOL bThumbnailMode;
@@ -48,6 +86,9 @@ typedef struct _RKVPU_OMX_VIDEODEC_COMPONENT {
     OMX_BOOL       bExitBufferProcessThread;
     OMX_HANDLETYPE hInputThread;
     OMX_HANDLETYPE hOutputThread;
+    /* bumped when the input thread sends to and the output thread takes from the codec */
+    ROCKCHIP_OSAL_FUTEX inputProgress;
+    ROCKCHIP_OSAL_FUTEX outputProgress;
 
     OMX_VIDEO_CODINGTYPE codecId;
 
@@ -101,6 +142,8 @@ typedef struct _RKVPU_OMX_VIDEODEC_COMPONENT {
     OMX_BOOL bPrintBufferPosition;
     OMX_BOOL bGtsMediaTest;
     OMX_U32 nVdecDebug;
+    OMX_U64 nOutputPathCount[RKVPU_OUTPUT_PATH_MAX];
+    RKVPU_DEC_STATS stats;
 
     // color aspects passed from the framework.
     OMX_COLORASPECTS mDefaultColorAspects;
@@ -133,6 +176,10 @@ OMX_ERRORTYPE Rkvpu_OMX_OutputBufferProcess(OMX_HANDLETYPE hComponent);
 OMX_ERRORTYPE Rkvpu_Dec_ComponentInit(OMX_COMPONENTTYPE *pOMXComponent);
 OMX_ERRORTYPE Rkvpu_Dec_Terminate(OMX_COMPONENTTYPE *pOMXComponent);
 
+void Rkvpu_Stats_InputTaken(RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec, OMX_BUFFERHEADERTYPE *bufferHeader,
+    OMX_U32 nQueueDepth);
+OMX_ERRORTYPE Rkvpu_Stats_Get(RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec, OMX_VIDEO_CONFIG_STATISTICSTYPE *statistics);
+
 OMX_ERRORTYPE Rockchip_OMX_ComponentConstructor(OMX_HANDLETYPE hComponent, OMX_STRING componentName);
 OMX_ERRORTYPE Rockchip_OMX_ComponentDeInit(OMX_HANDLETYPE hComponent);
 
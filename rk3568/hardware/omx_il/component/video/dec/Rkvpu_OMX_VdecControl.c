@@ -33,6 +33,7 @@
 #include <poll.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <linux/dma-buf.h>
 
 #include "Rockchip_OMX_Macros.h"
 #include "Rockchip_OSAL_Event.h"
@@ -47,6 +48,7 @@
 #include "Rockchip_OSAL_SharedMemory.h"
 #include "Rockchip_OSAL_ColorUtils.h"
 #include "Rockchip_OSAL_OHOS.h"
+#include "Rockchip_OSAL_Env.h"
 #include "Rkvpu_OMX_VdecControl.h"
 #ifdef OHOS_BUFFER_HANDLE
 #include <buffer_handle.h>
@@ -208,6 +210,19 @@ OMX_ERRORTYPE Rkvpu_OMX_UseBuffer(OMX_IN OMX_HANDLETYPE hComponent,
                 pBuffer,
                 nSizeBytes);
 
+#ifdef OHOS_BUFFER_HANDLE
+            RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec =
+                (RKVPU_OMX_VIDEODEC_COMPONENT *)pRockchipComponent->hComponentHandle;
+            BufferHandle *bufferHandle = (BufferHandle *)pBuffer;
+            /* the decoder writes nv12 only, copy into the buffers of the other formats */
+            if ((nPortIndex == OUTPUT_PORT_INDEX) && (pRockchipPort->bufferProcessType == BUFFER_SHARE) &&
+                (pVideoDec->vpumem_handle == NULL) && (bufferHandle != NULL) &&
+                (bufferHandle->format != PIXEL_FMT_YCBCR_420_SP)) {
+                omx_warn("buffer format %d can not be shared, copy the frames", bufferHandle->format);
+                pRockchipPort->bufferProcessType = BUFFER_COPY | BUFFER_ANBSHARE;
+            }
+#endif
+
             pRockchipPort->assignedBufferNum++;
             if (pRockchipPort->assignedBufferNum == pRockchipPort->portDefinition.nBufferCountActual) {
                 pRockchipPort->portDefinition.bPopulated = OMX_TRUE;
@@ -777,6 +792,82 @@ EXIT:
     return ret;
 }
 
+void Rkvpu_UpdateBufferProcessType(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent)
+{
+    RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec = (RKVPU_OMX_VIDEODEC_COMPONENT *)pRockchipComponent->hComponentHandle;
+    ROCKCHIP_OMX_BASEPORT *pOutputPort = &pRockchipComponent->pRockchipPort[OUTPUT_PORT_INDEX];
+    OMX_U32 bufferShare = 0;
+
+    /* the decoder writes into the buffers of the client only when they are native buffers */
+    Rockchip_OSAL_GetEnvU32("omx_dec_buffer_share", &bufferShare, 0);
+    if ((pVideoDec->bOhosBufferHandle == OMX_TRUE) && (bufferShare != 0)) {
+        pOutputPort->bufferProcessType = BUFFER_SHARE;
+    } else {
+        pOutputPort->bufferProcessType = BUFFER_COPY | BUFFER_ANBSHARE;
+    }
+    omx_trace("output buffer process type 0x%x", pOutputPort->bufferProcessType);
+}
+
+OMX_ERRORTYPE Rkvpu_OpenShareBufferPool(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent)
+{
+    RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec = (RKVPU_OMX_VIDEODEC_COMPONENT *)pRockchipComponent->hComponentHandle;
+    ROCKCHIP_OMX_BASEPORT *pOutputPort = &pRockchipComponent->pRockchipPort[OUTPUT_PORT_INDEX];
+    OMX_U32 i = 0;
+
+    Rockchip_OSAL_Openvpumempool(pRockchipComponent, OUTPUT_PORT_INDEX);
+    if (pVideoDec->vpumem_handle == NULL) {
+        omx_err("open vpu memory pool failed");
+        return OMX_ErrorInsufficientResources;
+    }
+
+    /* the buffers filled before the pool is opened are committed here, the others on FillThisBuffer */
+    for (i = 0; i < pOutputPort->portDefinition.nBufferCountActual; i++) {
+        if ((pOutputPort->extendBufferHeader[i].OMXBufferHeader == NULL) ||
+            (pOutputPort->extendBufferHeader[i].bBufferInOMX != OMX_TRUE) ||
+            (pOutputPort->extendBufferHeader[i].pRegisterFlag != 0)) {
+            continue;
+        }
+        if (Rockchip_OSAL_CommitBuffer(pRockchipComponent, i) != OMX_ErrorNone) {
+            omx_err("commit output buffer %d failed", i);
+        }
+    }
+    return OMX_ErrorNone;
+}
+
+void Rkvpu_CloseShareBufferPool(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent)
+{
+    RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec = (RKVPU_OMX_VIDEODEC_COMPONENT *)pRockchipComponent->hComponentHandle;
+    ROCKCHIP_OMX_BASEPORT *pOutputPort = &pRockchipComponent->pRockchipPort[OUTPUT_PORT_INDEX];
+    OMX_U32 i = 0;
+
+    if ((pOutputPort->bufferProcessType != BUFFER_SHARE) || (pVideoDec->vpumem_handle == NULL)) {
+        return;
+    }
+    for (i = 0; i < pOutputPort->portDefinition.nBufferCountActual; i++) {
+        pOutputPort->extendBufferHeader[i].pRegisterFlag = 0;
+        pOutputPort->extendBufferHeader[i].buf_fd[0] = 0;
+        if (pOutputPort->extendBufferHeader[i].pPrivate != NULL) {
+            Rockchip_OSAL_FreeVpumem(pOutputPort->extendBufferHeader[i].pPrivate);
+            pOutputPort->extendBufferHeader[i].pPrivate = NULL;
+        }
+    }
+    Rockchip_OSAL_Closevpumempool(pRockchipComponent);
+}
+
+static OMX_BOOL Rkvpu_RgaSucceeded(IM_STATUS status)
+{
+    return ((status == IM_STATUS_SUCCESS) || (status == IM_STATUS_NOERROR)) ? OMX_TRUE : OMX_FALSE;
+}
+
+/* copy the visible nv12 picture between the buffers of different strides on the cpu */
+static void Rkvpu_CopyNv12(OMX_U8 *dst, OMX_U32 dstStride, OMX_U32 dstSliceHeight,
+    const OMX_U8 *src, OMX_U32 srcStride, OMX_U32 srcSliceHeight, OMX_U32 width, OMX_U32 height)
+{
+    Rockchip_OSAL_CopyPlane(dst, dstStride, src, srcStride, width, height);
+    Rockchip_OSAL_CopyPlane(dst + dstStride * dstSliceHeight, dstStride,
+        src + srcStride * srcSliceHeight, srcStride, width, height / 2); // 2:chroma rows
+}
+
 OMX_ERRORTYPE Rkvpu_Frame2Outbuf(OMX_COMPONENTTYPE *pOMXComponent,
     OMX_BUFFERHEADERTYPE *pOutputBuffer, VPU_FRAME *pframe)
 {
@@ -842,7 +933,21 @@ OMX_ERRORTYPE Rkvpu_Frame2Outbuf(OMX_COMPONENTTYPE *pOMXComponent,
         rect.y = 0;
         rect.width = mWidth;
         rect.height = mHeight;
-        imcrop(src, dst, rect);
+        IM_STATUS status = imcrop(src, dst, rect);
+        if (Rkvpu_RgaSucceeded(status)) {
+            pVideoDec->nOutputPathCount[RKVPU_OUTPUT_RGA]++;
+        } else if ((dst.format == RK_FORMAT_YCbCr_420_SP) && (bufferHandle->virAddr != NULL)) {
+            omx_warn("rga crop failed %d, copy on cpu", status);
+            struct dma_buf_sync sync = { DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE };
+            ioctl(bufferHandle->fd, DMA_BUF_IOCTL_SYNC, &sync);
+            Rkvpu_CopyNv12((OMX_U8 *)bufferHandle->virAddr, bufferHandle->stride, bufferHandle->height,
+                (OMX_U8 *)pframe->vpumem.vir_addr, pframe->FrameWidth, pframe->FrameHeight, mWidth, mHeight);
+            sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE;
+            ioctl(bufferHandle->fd, DMA_BUF_IOCTL_SYNC, &sync);
+            pVideoDec->nOutputPathCount[RKVPU_OUTPUT_CPU]++;
+        } else {
+            omx_err("rga crop failed %d", status);
+        }
         VPUFreeLinear(&pframe->vpumem);
         FunctionOut();
         return ret;
@@ -878,6 +983,7 @@ OMX_ERRORTYPE Rkvpu_Frame2Outbuf(OMX_COMPONENTTYPE *pOMXComponent,
             Rockchip_OSAL_LockANB(pGrallocHandle, mWidth, mHeight, omx_format, &vplanes);
             VPUMemLink(&pframe->vpumem);
             rga_nv122rgb(&vplanes, &pframe->vpumem, mWidth, mHeight, pixel_format, pVideoDec->rga_ctx);
+            pVideoDec->nOutputPathCount[RKVPU_OUTPUT_RGA]++;
             VPUFreeLinear(&pframe->vpumem);
             Rockchip_OSAL_UnlockANB(pGrallocHandle);
         }
@@ -907,23 +1013,12 @@ OMX_ERRORTYPE Rkvpu_Frame2Outbuf(OMX_COMPONENTTYPE *pOMXComponent,
             {
                 OMX_U8 *buff_vir = (OMX_U8 *)pframe->vpumem.vir_addr;
                 pOutputBuffer->nFilledLen = mWidth * mHeight * 3 / 2; // 3:byte alignment, 2:byte alignment
-                OMX_U32 uv_offset = mStride * mSliceHeight;
-                OMX_U32 y_size = mWidth * mHeight;
-                OMX_U8 *dst_uv = (OMX_U8 *)((OMX_U8 *)vplanes.addr + y_size);
-                OMX_U8 *src_uv =  (OMX_U8 *)(buff_vir + uv_offset);
-                OMX_U32 i = 0;
 
                 omx_trace("mWidth = %d mHeight = %d mStride = %d,mSlicHeight %d",
                     mWidth, mHeight, mStride, mSliceHeight);
-                for (i = 0; i < mHeight; i++) {
-                    Rockchip_OSAL_Memcpy((char*)vplanes.addr + i * mWidth, buff_vir + i * mStride, mWidth);
-                }
-
-                for (i = 0; i < mHeight / 2; i++) { // 2:byte alignment
-                    Rockchip_OSAL_Memcpy((OMX_U8*)dst_uv, (OMX_U8*)src_uv, mWidth);
-                    dst_uv += mWidth;
-                    src_uv += mStride;
-                }
+                Rkvpu_CopyNv12((OMX_U8 *)vplanes.addr, mWidth, mHeight, buff_vir, mStride, mSliceHeight,
+                    mWidth, mHeight);
+                pVideoDec->nOutputPathCount[RKVPU_OUTPUT_CPU]++;
             }
             VPUFreeLinear(&pframe->vpumem);
         }
@@ -960,6 +1055,7 @@ OMX_ERRORTYPE Rkvpu_Frame2Outbuf(OMX_COMPONENTTYPE *pOMXComponent,
             OMX_U32 verStride = Get_Video_VerAlign(pVideoDec->codecId, pframe->DisplayHeight, pVideoDec->codecProfile);
             pOutputBuffer->nFilledLen = horStride * verStride * 3 / 2; // 3:byte alignment, 2:byte alignment
             Rockchip_OSAL_Memcpy((char *)pOutputBuffer->pBuffer, buff_vir, pOutputBuffer->nFilledLen);
+            pVideoDec->nOutputPathCount[RKVPU_OUTPUT_CPU]++;
             omx_trace("debug 10bit mWidth = %d mHeight = %d horStride = %d,verStride %d",
                 (int)mWidth, (int)mHeight, (int)horStride, (int)verStride);
         } else {
@@ -991,18 +1087,21 @@ OMX_ERRORTYPE Rkvpu_Frame2Outbuf(OMX_COMPONENTTYPE *pOMXComponent,
             rect.y = 0;
             rect.width = mWidth;
             rect.height = mHeight;
-            imcrop(src, dst, rect);
+            IM_STATUS status = imcrop(src, dst, rect);
+            if (Rkvpu_RgaSucceeded(status)) {
+                pVideoDec->nOutputPathCount[RKVPU_OUTPUT_RGA]++;
+            } else if ((dst.format == RK_FORMAT_YCbCr_420_SP) &&
+                (pOutputBuffer->nAllocLen >= mWidth * mHeight * 3 / 2)) { // 3, 2:nv12 size
+                omx_warn("rga crop failed %d, copy on cpu", status);
+                Rkvpu_CopyNv12(pOutputBuffer->pBuffer, mWidth, mHeight, buff_vir, mStride, mSliceHeight,
+                    mWidth, mHeight);
+                pVideoDec->nOutputPathCount[RKVPU_OUTPUT_CPU]++;
+            } else {
+                omx_err("rga crop failed %d", status);
+            }
         }
 #else
-        for (i = 0; i < mHeight; i++) {
-            Rockchip_OSAL_Memcpy((char*)pOutputBuffer->pBuffer + i * mWidth, buff_vir + i * mStride, mWidth);
-        }
-
-        for (i = 0; i < mHeight / 2; i++) { // 2:byte alignment
-            Rockchip_OSAL_Memcpy((OMX_U8*)dst_uv, (OMX_U8*)src_uv, mWidth);
-            dst_uv += mWidth;
-            src_uv += mStride;
-        }
+        Rkvpu_CopyNv12(pOutputBuffer->pBuffer, mWidth, mHeight, buff_vir, mStride, mSliceHeight, mWidth, mHeight);
 #endif
     }
     VPUFreeLinear(&pframe->vpumem);
@@ -1037,7 +1136,7 @@ OMX_ERRORTYPE Rkvpu_InputBufferGetQueue(ROCKCHIP_OMX_BASECOMPONENT *pRockchipCom
                 ret = OMX_ErrorCodecFlush;
                 goto EXIT;
             }
-            omx_trace("input buffer count = %d", pRockchipPort->bufferQ.numElem);
+            omx_trace("input buffer count = %d", Rockchip_OSAL_GetElemNum(&pRockchipPort->bufferQ));
             inputUseBuffer->bufferHeader  = (OMX_BUFFERHEADERTYPE *)(message->pCmdData);
             inputUseBuffer->allocSize     = inputUseBuffer->bufferHeader->nAllocLen;
             inputUseBuffer->dataLen       = inputUseBuffer->bufferHeader->nFilledLen;
@@ -1046,6 +1145,8 @@ OMX_ERRORTYPE Rkvpu_InputBufferGetQueue(ROCKCHIP_OMX_BASECOMPONENT *pRockchipCom
             inputUseBuffer->dataValid     = OMX_TRUE;
             inputUseBuffer->nFlags        = inputUseBuffer->bufferHeader->nFlags;
             inputUseBuffer->timeStamp     = inputUseBuffer->bufferHeader->nTimeStamp;
+            Rkvpu_Stats_InputTaken((RKVPU_OMX_VIDEODEC_COMPONENT *)pRockchipComponent->hComponentHandle,
+                inputUseBuffer->bufferHeader, Rockchip_OSAL_GetElemNum(&pRockchipPort->bufferQ));
 
             Rockchip_OSAL_Free(message);
 
@@ -1815,6 +1916,7 @@ OMX_ERRORTYPE Rkvpu_OMX_SetParameter(OMX_IN OMX_HANDLETYPE hComponent,
                 RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec =
                     (RKVPU_OMX_VIDEODEC_COMPONENT *)pRockchipComponent->hComponentHandle;
                 pVideoDec->bOhosBufferHandle = OMX_TRUE;
+                Rkvpu_UpdateBufferProcessType(pRockchipComponent);
             }
             break;
         }
@@ -1869,6 +1971,7 @@ OMX_ERRORTYPE Rkvpu_OMX_SetParameter(OMX_IN OMX_HANDLETYPE hComponent,
             RKVPU_OMX_VIDEODEC_COMPONENT *pVideoDec =
                     (RKVPU_OMX_VIDEODEC_COMPONENT *)pRockchipComponent->hComponentHandle;
             pVideoDec->bOhosBufferHandle = enableParam->enable ? OMX_TRUE : OMX_FALSE;
+            Rkvpu_UpdateBufferProcessType(pRockchipComponent);
             break;
         }
 #endif
@@ -2157,6 +2260,18 @@ OMX_ERRORTYPE Rkvpu_OMX_GetConfig(OMX_HANDLETYPE hComponent,
                     }
                 }
                     break;
+                case OMX_IndexConfigRkDecoderExtensionStatistics: {
+                    OMX_VIDEO_CONFIG_STATISTICSTYPE *statistics =
+                        (OMX_VIDEO_CONFIG_STATISTICSTYPE *)pComponentConfigStructure;
+
+                    ret = Rockchip_OMX_Check_SizeVersion((void *)statistics, sizeof(OMX_VIDEO_CONFIG_STATISTICSTYPE));
+                    if (ret != OMX_ErrorNone) {
+                        omx_err_f("check version ret err");
+                        goto EXIT;
+                    }
+                    ret = Rkvpu_Stats_Get(pVideoDec, statistics);
+                }
+                    break;
                 default:
                     ret = Rockchip_OMX_GetConfig(hComponent, nIndex, pComponentConfigStructure);
                     break;
@@ -2384,6 +2499,10 @@ OMX_ERRORTYPE Rkvpu_OMX_GetExtensionIndex(OMX_IN OMX_HANDLETYPE  hComponent,
         *pIndexType = (OMX_INDEXTYPE)OMX_IndexParamRkDecoderExtensionUseDts;
         goto EXIT;
     }
+    if (Rockchip_OSAL_Strcmp(cParameterName, ROCKCHIP_INDEX_CONFIG_ROCKCHIP_DEC_EXTENSION_STATISTICS) == 0) {
+        *pIndexType = (OMX_INDEXTYPE)OMX_IndexConfigRkDecoderExtensionStatistics;
+        goto EXIT;
+    }
 #ifdef USE_STOREMETADATA
     if (Rockchip_OSAL_Strcmp(cParameterName, ROCKCHIP_INDEX_PARAM_STORE_METADATA_BUFFER) == 0) {
         *pIndexType = (OMX_INDEXTYPE) NULL;
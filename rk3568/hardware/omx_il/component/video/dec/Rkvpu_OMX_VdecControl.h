@@ -114,6 +114,9 @@ OMX_ERRORTYPE Rkvpu_Frame2Outbuf(OMX_COMPONENTTYPE *pOMXComponent,
 OMX_ERRORTYPE Rkvpu_OutputBufferGetQueue(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent);
 OMX_ERRORTYPE Rkvpu_InputBufferGetQueue(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent);
 OMX_ERRORTYPE Rkvpu_ResolutionUpdate(OMX_COMPONENTTYPE *pOMXComponent);
+void Rkvpu_UpdateBufferProcessType(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent);
+OMX_ERRORTYPE Rkvpu_OpenShareBufferPool(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent);
+void Rkvpu_CloseShareBufferPool(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent);
 
 #ifdef USE_ANB
 OMX_ERRORTYPE Rkvpu_Shared_ANBBufferToData(ROCKCHIP_OMX_DATABUFFER *pUseBuffer,
@@ -267,6 +267,32 @@ void Rkvpu_Wait_ProcessPause(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent, OMX
     return;
 }
 
+/* the encoder holds the stream until it is returned instead of copying it for the client to free */
+static void Rkvpu_Enc_EnableStreamPool(RKVPU_OMX_VIDEOENC_COMPONENT *pVideoEnc, VpuCodecContext_t *p_vpu_ctx)
+{
+    OMX_U32 enable = 1;
+
+    pVideoEnc->bStreamPool = OMX_FALSE;
+    if (p_vpu_ctx->control(p_vpu_ctx, VPU_API_ENC_SET_STREAM_POOL, (void *)&enable) == 0) {
+        pVideoEnc->bStreamPool = OMX_TRUE;
+    }
+}
+
+static void Rkvpu_Enc_PutStream(RKVPU_OMX_VIDEOENC_COMPONENT *pVideoEnc, EncoderOut_t *pOutput)
+{
+    VpuCodecContext_t *p_vpu_ctx = pVideoEnc->vpu_ctx;
+
+    if (pOutput->data == NULL) {
+        return;
+    }
+    if ((pVideoEnc->bStreamPool == OMX_TRUE) && (p_vpu_ctx != NULL)) {
+        p_vpu_ctx->control(p_vpu_ctx, VPU_API_ENC_PUT_STREAM, (void *)pOutput->data);
+    } else {
+        free(pOutput->data);
+    }
+    pOutput->data = NULL;
+}
+
 OMX_ERRORTYPE Rkvpu_Enc_ReConfig(OMX_COMPONENTTYPE *pOMXComponent, OMX_U32 new_width, OMX_U32 new_height)
 {
     OMX_ERRORTYPE                  ret               = OMX_ErrorNone;
@@ -327,6 +353,7 @@ OMX_ERRORTYPE Rkvpu_Enc_ReConfig(OMX_COMPONENTTYPE *pOMXComponent, OMX_U32 new_w
     EncParam->rc_mode = 1;
     p_vpu_ctx->control(p_vpu_ctx, VPU_API_ENC_SETCFG, EncParam);
     p_vpu_ctx->control(p_vpu_ctx, VPU_API_ENC_SETFORMAT, (void *)&encType);
+    Rkvpu_Enc_EnableStreamPool(pVideoEnc, p_vpu_ctx);
     pVideoEnc->vpu_ctx = p_vpu_ctx;
     pVideoEnc->bPrependSpsPpsToIdr = OMX_TRUE;
     Rockchip_OSAL_MutexUnlock(pVideoEnc->bRecofig_Mutex);
@@ -857,10 +884,7 @@ OMX_BOOL Rkvpu_Post_OutputStream(OMX_COMPONENTTYPE *pOMXComponent)
             if (pOutput.keyFrame) {
                 outputUseBuffer->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
             }
-            if (pOutput.data) {
-                free(pOutput.data);
-                pOutput.data = NULL;
-            }
+            Rkvpu_Enc_PutStream(pVideoEnc, &pOutput);
             if ((outputUseBuffer->remainDataLen > 0) ||
                 ((outputUseBuffer->nFlags & OMX_BUFFERFLAG_EOS) == OMX_BUFFERFLAG_EOS) ||
                 (CHECK_PORT_BEING_FLUSHED(pOutputPort))) {
@@ -869,10 +893,7 @@ OMX_BOOL Rkvpu_Post_OutputStream(OMX_COMPONENTTYPE *pOMXComponent)
             }
             ret = OMX_TRUE;
         } else if (CHECK_PORT_BEING_FLUSHED(pOutputPort)) {
-            if (pOutput.data) {
-                free(pOutput.data);
-                pOutput.data = NULL;
-            }
+            Rkvpu_Enc_PutStream(pVideoEnc, &pOutput);
             outputUseBuffer->dataLen = 0;
             outputUseBuffer->remainDataLen = 0;
             outputUseBuffer->nFlags = 0;
@@ -929,8 +950,12 @@ OMX_ERRORTYPE Rkvpu_OMX_InputBufferProcess(OMX_HANDLETYPE hComponent)
                 }
 
                 if (srcInputUseBuffer->dataValid == OMX_TRUE) {
+                    OMX_U32 outputSeq = Rockchip_OSAL_FutexSeq(&pVideoEnc->outputProgress);
                     if (Rkvpu_SendInputData(hComponent) != OMX_TRUE) {
-                        Rockchip_OSAL_SleepMillisec(5); // 5:sleep
+                        // a stream taken by the output thread lets the encoder accept the frame
+                        Rockchip_OSAL_FutexWait(&pVideoEnc->outputProgress, outputSeq, 5); // 5:max wait time
+                    } else {
+                        Rockchip_OSAL_FutexWake(&pVideoEnc->inputProgress);
                     }
                 }
                 if (CHECK_PORT_BEING_FLUSHED(rockchipInputPort)) {
@@ -986,11 +1011,15 @@ OMX_ERRORTYPE Rkvpu_OMX_OutputBufferProcess(OMX_HANDLETYPE hComponent)
             }
 
             if (dstOutputUseBuffer->dataValid == OMX_TRUE) {
+                OMX_U32 inputSeq = Rockchip_OSAL_FutexSeq(&pVideoEnc->inputProgress);
                 Rockchip_OSAL_MutexLock(pVideoEnc->bRecofig_Mutex);
                 ret = Rkvpu_Post_OutputStream(pOMXComponent);
                 Rockchip_OSAL_MutexUnlock(pVideoEnc->bRecofig_Mutex);
                 if ((OMX_BOOL)ret != OMX_TRUE) {
-                    Rockchip_OSAL_SleepMillisec(5); // 5:sleep
+                    // the encoder has no stream before the input thread sends a frame
+                    Rockchip_OSAL_FutexWait(&pVideoEnc->inputProgress, inputSeq, 5); // 5:max wait time
+                } else {
+                    Rockchip_OSAL_FutexWake(&pVideoEnc->outputProgress);
                 }
             }
             Rockchip_OSAL_MutexUnlock(dstOutputUseBuffer->bufferMutex);
@@ -1102,6 +1131,8 @@ OMX_ERRORTYPE Rkvpu_OMX_BufferProcess_Terminate(OMX_COMPONENTTYPE *pOMXComponent
     FunctionIn();
 
     pVideoEnc->bExitBufferProcessThread = OMX_TRUE;
+    Rockchip_OSAL_FutexWake(&pVideoEnc->inputProgress);
+    Rockchip_OSAL_FutexWake(&pVideoEnc->outputProgress);
 
     Rockchip_OSAL_Get_SemaphoreCount(pRockchipComponent->pRockchipPort[INPUT_PORT_INDEX].bufferSemID, &countValue);
     if (countValue == 0)
@@ -1408,6 +1439,7 @@ OMX_ERRORTYPE Rkvpu_Enc_ComponentInit(OMX_COMPONENTTYPE *pOMXComponent)
             ret = OMX_ErrorInsufficientResources;
             goto EXIT;
         }
+        Rkvpu_Enc_EnableStreamPool(pVideoEnc, p_vpu_ctx);
         omx_trace("eControlRate %d ", pVideoEnc->eControlRate[OUTPUT_PORT_INDEX]);
         if (pVideoEnc->eControlRate[OUTPUT_PORT_INDEX] == OMX_Video_ControlRateConstant) {
             p_vpu_ctx->control(p_vpu_ctx, VPU_API_ENC_GETCFG, (void*)EncParam);
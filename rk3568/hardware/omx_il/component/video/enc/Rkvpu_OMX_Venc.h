@@ -34,6 +34,7 @@
 #include "Rockchip_OMX_Basecomponent.h"
 #include "Rockchip_OMX_Baseport.h"
 #include "Rockchip_OMX_Def.h"
+#include "Rockchip_OSAL_Event.h"
 #include "Rockchip_OSAL_Queue.h"
 #include "VideoExt.h"
 #include "vpu_api.h"
@@ -64,6 +65,9 @@ typedef struct _RKVPU_OMX_VIDEOENC_COMPONENT {
     OMX_BOOL       bExitBufferProcessThread;
     OMX_HANDLETYPE hInputThread;
     OMX_HANDLETYPE hOutputThread;
+    /* bumped when the input thread sends to and the output thread takes from the codec */
+    ROCKCHIP_OSAL_FUTEX inputProgress;
+    ROCKCHIP_OSAL_FUTEX outputProgress;
 
     OMX_VIDEO_CODINGTYPE codecId;
 
@@ -105,6 +109,9 @@ typedef struct _RKVPU_OMX_VIDEOENC_COMPONENT {
 
     OMX_BOOL bEncSendEos;
 
+    /* the streams of the encoder are returned to its pool instead of being freed */
+    OMX_BOOL bStreamPool;
+
     OMX_U32 bFrame_num;
     OMX_U32 bCurrent_width;
 
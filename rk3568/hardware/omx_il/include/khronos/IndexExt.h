@@ -48,6 +48,8 @@
     "OMX.rk.index.decoder.extension.useDts"
 #define ROCKCHIP_INDEX_PARAM_ROCKCHIP_DEC_EXTENSION_THUMBNAILCODECPROFILE  \
     "OMX.rk.index.decoder.extension.thumbNailcodecProfile"
+#define ROCKCHIP_INDEX_CONFIG_ROCKCHIP_DEC_EXTENSION_STATISTICS \
+    "OMX.rk.index.decoder.extension.statistics"
 #define ROCKCHIP_INDEX_PARAM_EXTENDED_VIDEO \
     "OMX.Topaz.index.param.extended_video"
 #define ROCKCHIP_INDEX_PARAM_DSECRIBECOLORASPECTS \
@@ -72,6 +74,7 @@ typedef enum OMX_INDEXEXEXTTYPE {
     OMX_IndexParamRkDecoderExtensionUseDts = 0x7F050001,
     OMX_IndexParamRkDecoderExtensionThumbNailCodecProfile  = 0x7F050002,
     OMX_IndexParamRkEncExtendedVideo = 0x7F050003,
+    OMX_IndexConfigRkDecoderExtensionStatistics = 0x7F050004,
     OMX_IndexParamRkDescribeColorAspects = 0x7F000062,
     OMX_IndexParamAllocateNativeHandle = 0x7F00005D,
     OMX_IndexParamStoreANWBuffer = 0x7F00006D,
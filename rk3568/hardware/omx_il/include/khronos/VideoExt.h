@@ -133,4 +133,20 @@ typedef struct OMX_VIDEO_SLICESEGMENTSTYPE {
     OMX_BOOL bDepedentSegments;
     OMX_BOOL bEnableLoopFilterAcrossSlices;
 } OMX_VIDEO_SLICESEGMENTSTYPE;
+
+/** Statistics of a port of the component since it went executing */
+typedef struct OMX_VIDEO_CONFIG_STATISTICSTYPE {
+    OMX_U32 nSize;                      // IN
+    OMX_VERSIONTYPE nVersion;           // IN
+    OMX_U32 nPortIndex;                 // IN
+    OMX_U64 nFrames;                    // OUT: buffers taken by the input port, frames filled by the output port
+    OMX_U64 nBytes;                     // OUT
+    OMX_U32 xFramerate;                 // OUT: Q16 frames per second of the last second
+    OMX_U32 nQueueDepth;                // OUT: buffers queued to the port and not taken yet
+    OMX_U32 nMaxQueueDepth;             // OUT
+    OMX_U32 nDecodeLatencyUs[3];        // OUT: p50, p90 and p99 from a packet sent to its frame got
+    OMX_U32 nMaxDecodeLatencyUs;        // OUT
+    OMX_U32 nDelayUs[3];                // OUT: p50, p90 and p99 from an input buffer taken to its frame returned
+    OMX_U32 nMaxDelayUs;                // OUT
+} OMX_VIDEO_CONFIG_STATISTICSTYPE;
 #endif
\ No newline at end of file
@@ -29,6 +29,10 @@
 #include <string.h>
 #include <securec.h>
 #include <sys/time.h>
+#include <time.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 #include "Rockchip_OSAL_Memory.h"
 #include "Rockchip_OSAL_Log.h"
@@ -38,6 +42,8 @@ static struct timeval perfStart[PERF_ID_MAX + 1], perfStop[PERF_ID_MAX + 1];
 static unsigned long perfTime[PERF_ID_MAX + 1], totalPerfTime[PERF_ID_MAX + 1];
 static unsigned int perfFrameCount[PERF_ID_MAX + 1], perfOver30ms[PERF_ID_MAX + 1];
 
+#define COPY_PLANE_BLOCK 64
+
 #ifndef HAVE_GETLINE
 ssize_t getline(char **ppLine, size_t *pLen, FILE *pStream)
 {
@@ -234,4 +240,86 @@ void Rockchip_OSAL_PerfPrint(OMX_STRING prefix, PERF_ID_TYPE id)
     omx_info("%s Frame Count: %d", prefix, frameCount);
     omx_info("%s Avg Time: %.2f ms, Over 30ms: %d",
         prefix, (float)perfTotal / (float)(frameCount * 1000), Rockchip_OSAL_PerfOver30ms(id)); // 1000:time shift
-}
\ No newline at end of file
+}
+
+static OMX_BOOL CopyRow(OMX_U8 *dst, const OMX_U8 *src, OMX_U32 width)
+{
+    OMX_U32 i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    // four quad registers move a cache line at a time
+    for (; i + COPY_PLANE_BLOCK <= width; i += COPY_PLANE_BLOCK) {
+        uint8x16x4_t block = vld1q_u8_x4(src + i);
+        vst1q_u8_x4(dst + i, block);
+    }
+    for (; i + 16 <= width; i += 16) { // 16:bytes of a quad register
+        vst1q_u8(dst + i, vld1q_u8(src + i));
+    }
+#endif
+    if (i < width && memcpy_s(dst + i, width - i, src + i, width - i) != EOK) {
+        omx_err("memcpy_s error.\n");
+        return OMX_FALSE;
+    }
+    return OMX_TRUE;
+}
+
+void Rockchip_OSAL_CopyPlane(OMX_U8 *dst, OMX_U32 dstStride, const OMX_U8 *src, OMX_U32 srcStride,
+    OMX_U32 width, OMX_U32 height)
+{
+    OMX_U32 i = 0;
+
+    if (dst == NULL || src == NULL || width > dstStride || width > srcStride)
+        return;
+
+    // the planes without padding are copied at once
+    if (dstStride == srcStride && width == srcStride) {
+        CopyRow(dst, src, width * height);
+        return;
+    }
+    for (i = 0; i < height; i++) {
+        if (!CopyRow(dst + (size_t)i * dstStride, src + (size_t)i * srcStride, width))
+            return;
+    }
+}
+
+OMX_U64 Rockchip_OSAL_GetMonotonicUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (OMX_U64)now.tv_sec * 1000000 + (OMX_U64)now.tv_nsec / 1000; // 1000000, 1000:time unit conversion
+}
+
+void Rockchip_OSAL_LatencyAdd(ROCKCHIP_OSAL_LATENCY *latency, OMX_U64 us)
+{
+    OMX_U32 sample = (us > 0xFFFFFFFF) ? 0xFFFFFFFF : (OMX_U32)us;
+
+    latency->samples[latency->nNext] = sample;
+    latency->nNext = (latency->nNext + 1) % ROCKCHIP_LATENCY_SAMPLES;
+    if (latency->nCount < ROCKCHIP_LATENCY_SAMPLES)
+        latency->nCount++;
+    if (sample > latency->nMax)
+        latency->nMax = sample;
+}
+
+static int CompareU32(const void *a, const void *b)
+{
+    OMX_U32 x = *(const OMX_U32 *)a;
+    OMX_U32 y = *(const OMX_U32 *)b;
+
+    return (x > y) - (x < y);
+}
+
+OMX_U32 Rockchip_OSAL_LatencyPercentile(const ROCKCHIP_OSAL_LATENCY *latency, OMX_U32 percent)
+{
+    OMX_U32 sorted[ROCKCHIP_LATENCY_SAMPLES];
+
+    if (latency->nCount == 0 || percent > 100) // 100:percent
+        return 0;
+
+    if (memcpy_s(sorted, sizeof(sorted), latency->samples, latency->nCount * sizeof(OMX_U32)) != EOK) {
+        omx_err("memcpy_s error.\n");
+        return 0;
+    }
+    qsort(sorted, latency->nCount, sizeof(OMX_U32), CompareU32);
+    return sorted[(latency->nCount - 1) * percent / 100]; // 100:percent
+}
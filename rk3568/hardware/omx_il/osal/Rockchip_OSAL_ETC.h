@@ -40,6 +40,10 @@ OMX_S32 Rockchip_OSAL_Strcat(OMX_PTR dest, OMX_PTR src);
 size_t Rockchip_OSAL_Strlen(const char *str);
 ssize_t getline(char **ppLine, size_t *pLen, FILE *pStream);
 
+/* copy height rows of width bytes between the planes of different strides */
+void Rockchip_OSAL_CopyPlane(OMX_U8 *dst, OMX_U32 dstStride, const OMX_U8 *src, OMX_U32 srcStride,
+    OMX_U32 width, OMX_U32 height);
+
 /* perf */
 typedef enum _PERF_ID_TYPE {
     PERF_ID_CSC = 0,
@@ -58,6 +62,20 @@ OMX_U32 Rockchip_OSAL_PerfFrameCount(PERF_ID_TYPE id);
 int Rockchip_OSAL_PerfOver30ms(PERF_ID_TYPE id);
 void Rockchip_OSAL_PerfPrint(OMX_STRING prefix, PERF_ID_TYPE id);
 
+/* latency of the recent ROCKCHIP_LATENCY_SAMPLES events, in us */
+#define ROCKCHIP_LATENCY_SAMPLES 128
+
+typedef struct _ROCKCHIP_OSAL_LATENCY {
+    OMX_U32 samples[ROCKCHIP_LATENCY_SAMPLES];
+    OMX_U32 nCount;
+    OMX_U32 nNext;
+    OMX_U32 nMax;
+} ROCKCHIP_OSAL_LATENCY;
+
+OMX_U64 Rockchip_OSAL_GetMonotonicUs(void);
+void Rockchip_OSAL_LatencyAdd(ROCKCHIP_OSAL_LATENCY *latency, OMX_U64 us);
+OMX_U32 Rockchip_OSAL_LatencyPercentile(const ROCKCHIP_OSAL_LATENCY *latency, OMX_U32 percent);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,7 +31,11 @@
 #include <string.h>
 #include <pthread.h>
 #include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
+#include <linux/futex.h>
 
 #include "Rockchip_OSAL_Memory.h"
 #include "Rockchip_OSAL_Mutex.h"
@@ -212,3 +216,43 @@ EXIT:
 
     return ret;
 }
+
+OMX_U32 Rockchip_OSAL_FutexSeq(ROCKCHIP_OSAL_FUTEX *futex)
+{
+    return __atomic_load_n(&futex->seq, __ATOMIC_ACQUIRE);
+}
+
+OMX_ERRORTYPE Rockchip_OSAL_FutexWait(ROCKCHIP_OSAL_FUTEX *futex, OMX_U32 seq, OMX_U32 ms)
+{
+    OMX_ERRORTYPE   ret = OMX_ErrorNone;
+    struct timespec timeout;
+
+    if (!futex)
+        return OMX_ErrorBadParameter;
+
+    timeout.tv_sec = ms / 1000; // 1000:time shift
+    timeout.tv_nsec = (long)(ms % 1000) * 1000000; // 1000:time shift, 1000000:time shift
+
+    // the waker reads the waiters after bumping the sequence, one of them sees the other
+    __atomic_add_fetch(&futex->waiters, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&futex->seq, __ATOMIC_SEQ_CST) == seq) {
+        syscall(SYS_futex, &futex->seq, FUTEX_WAIT_PRIVATE, seq,
+                (ms == DEF_MAX_WAIT_TIME) ? NULL : &timeout, NULL, 0);
+    }
+    __atomic_sub_fetch(&futex->waiters, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&futex->seq, __ATOMIC_ACQUIRE) == seq)
+        ret = OMX_ErrorTimeout;
+
+    return ret;
+}
+
+void Rockchip_OSAL_FutexWake(ROCKCHIP_OSAL_FUTEX *futex)
+{
+    if (!futex)
+        return;
+
+    __atomic_add_fetch(&futex->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&futex->waiters, __ATOMIC_SEQ_CST) > 0)
+        syscall(SYS_futex, &futex->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
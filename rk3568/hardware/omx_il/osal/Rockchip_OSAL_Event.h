@@ -41,6 +41,16 @@ typedef struct _ROCKCHIP_OSAL_THREADEVENT {
     pthread_cond_t condition;
 } ROCKCHIP_OSAL_THREADEVENT;
 
+/*
+ * A wakeup between the threads without lock, the waiter reads the sequence, checks its condition and
+ * waits only while the sequence stays the same. The waker bumps the sequence and enters the kernel
+ * only when someone is waiting.
+ */
+typedef struct _ROCKCHIP_OSAL_FUTEX {
+    OMX_U32        seq;
+    OMX_U32        waiters;
+} ROCKCHIP_OSAL_FUTEX;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,6 +62,9 @@ OMX_ERRORTYPE Rockchip_OSAL_SignalTerminate(OMX_HANDLETYPE eventHandle);
 OMX_ERRORTYPE Rockchip_OSAL_SignalReset(OMX_HANDLETYPE eventHandle);
 OMX_ERRORTYPE Rockchip_OSAL_SignalSet(OMX_HANDLETYPE eventHandle);
 OMX_ERRORTYPE Rockchip_OSAL_SignalWait(OMX_HANDLETYPE eventHandle, OMX_U32 ms);
+OMX_U32       Rockchip_OSAL_FutexSeq(ROCKCHIP_OSAL_FUTEX *futex);
+OMX_ERRORTYPE Rockchip_OSAL_FutexWait(ROCKCHIP_OSAL_FUTEX *futex, OMX_U32 seq, OMX_U32 ms);
+void          Rockchip_OSAL_FutexWake(ROCKCHIP_OSAL_FUTEX *futex);
 
 
 #ifdef __cplusplus
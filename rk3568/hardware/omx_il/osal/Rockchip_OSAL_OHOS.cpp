@@ -455,14 +455,42 @@ OMX_ERRORTYPE Rockchip_OSAL_CommitBuffer(
     struct vpu_display_mem_pool *pMem_pool = (struct vpu_display_mem_pool*)pVideoDec->vpumem_handle;
     OMX_U32 width = pRockchipPort->portDefinition.format.video.nStride;
     OMX_U32 height = pRockchipPort->portDefinition.format.video.nSliceHeight;
-#if 1 // LOW_VRESION
-    OMX_U32 nBytesize = width * height * 2;
-#else
-    OMX_U32 nBytesize = width * height * 9 / 5;
-#endif
-    OMX_S32 dupshared_fd = -1;
+    OMX_U32 nBytesize = width * height * 3 / 2; // 3, 2:nv12 size
     OMX_BUFFERHEADERTYPE* bufferHeader = pRockchipPort->extendBufferHeader[index].OMXBufferHeader;
+
+    // the buffers handed over before the pool is opened are committed when it opens
+    if (pMem_pool == nullptr) {
+        return OMX_ErrorNone;
+    }
+#ifdef OHOS_BUFFER_HANDLE
+    BufferHandle *bufferHandle = (bufferHeader != nullptr) ? (BufferHandle *)bufferHeader->pBuffer : nullptr;
+    if (pVideoDec->bOhosBufferHandle != OMX_TRUE || bufferHandle == nullptr) {
+        return OMX_ErrorBadParameter;
+    }
+    /*
+     * the decoder writes the frame with the stride and the slice height of the port, the client reads it
+     * with the stride and the height of the buffer, the chroma plane is after stride * height
+     */
+    if ((OMX_U32)bufferHandle->stride != width || (OMX_U32)bufferHandle->height != height ||
+        (OMX_U32)bufferHandle->size < nBytesize) {
+        omx_err("buffer fd %d stride %d height %d size %d does not fit the frame %d x %d",
+            bufferHandle->fd, bufferHandle->stride, bufferHandle->height, bufferHandle->size, width, height);
+        return OMX_ErrorBadParameter;
+    }
+    OMX_S32 fd = pMem_pool->commit_hdl(pMem_pool, bufferHandle->fd, bufferHandle->size);
+    if (fd < 0) {
+        omx_err("commit buffer fd %d failed", bufferHandle->fd);
+        return OMX_ErrorUndefined;
+    }
+    omx_trace("commit buffer fd %d size %d", fd, bufferHandle->size);
+    pRockchipPort->extendBufferHeader[index].buf_fd[0] = fd;
+    pRockchipPort->extendBufferHeader[index].pRegisterFlag = 1;
     return OMX_ErrorNone;
+#else
+    (void)bufferHeader;
+    (void)nBytesize;
+    return OMX_ErrorNotImplemented;
+#endif
 }
 
 OMX_ERRORTYPE Rockchip_OSAL_Fd2VpumemPool(ROCKCHIP_OMX_BASECOMPONENT *pRockchipComponent,
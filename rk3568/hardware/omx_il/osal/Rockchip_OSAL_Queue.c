@@ -29,98 +29,86 @@
 #include <string.h>
 #include "securec.h"
 #include "Rockchip_OSAL_Memory.h"
-#include "Rockchip_OSAL_Mutex.h"
 #include "Rockchip_OSAL_Queue.h"
 
 OMX_ERRORTYPE Rockchip_OSAL_QueueCreate(ROCKCHIP_QUEUE *queueHandle, int maxNumElem)
 {
-    int i = 0;
-    ROCKCHIP_QElem *newqelem = NULL;
-    ROCKCHIP_QElem *currentqelem = NULL;
+    OMX_U32 i = 0;
+    OMX_U32 size = 1;
     ROCKCHIP_QUEUE *queue = (ROCKCHIP_QUEUE *)queueHandle;
 
-    OMX_ERRORTYPE ret = OMX_ErrorNone;
-
-    if (!queue)
+    if (!queue || maxNumElem <= 0)
         return OMX_ErrorBadParameter;
 
-    ret = Rockchip_OSAL_MutexCreate(&queue->qMutex);
-    if (ret != OMX_ErrorNone)
-        return ret;
+    // the positions wrap around the ring with the mask
+    while (size < (OMX_U32)maxNumElem)
+        size <<= 1;
 
-    queue->first = (ROCKCHIP_QElem *)Rockchip_OSAL_Malloc(sizeof(ROCKCHIP_QElem));
-    if (queue->first == NULL)
+    queue->elems = (ROCKCHIP_QElem *)Rockchip_OSAL_Malloc(size * sizeof(ROCKCHIP_QElem));
+    if (queue->elems == NULL)
         return OMX_ErrorInsufficientResources;
 
-    Rockchip_OSAL_Memset(queue->first, 0, sizeof(ROCKCHIP_QElem));
-    currentqelem = queue->last = queue->first;
-    queue->numElem = 0;
-    queue->maxNumElem = maxNumElem;
-    for (i = 0; i < (queue->maxNumElem - 2); i++) { // 2:byte alignment
-        newqelem = (ROCKCHIP_QElem *)Rockchip_OSAL_Malloc(sizeof(ROCKCHIP_QElem));
-        if (newqelem == NULL) {
-            while (queue->first != NULL) {
-                currentqelem = queue->first->qNext;
-                Rockchip_OSAL_Free((OMX_PTR)queue->first);
-                queue->first = currentqelem;
-            }
-            return OMX_ErrorInsufficientResources;
-        } else {
-            Rockchip_OSAL_Memset(newqelem, 0, sizeof(ROCKCHIP_QElem));
-            currentqelem->qNext = newqelem;
-            currentqelem = newqelem;
-        }
+    for (i = 0; i < size; i++) {
+        queue->elems[i].data = NULL;
+        queue->elems[i].seq = i;
     }
-
-    currentqelem->qNext = queue->first;
+    queue->mask = size - 1;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->maxNumElem = maxNumElem;
 
     return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE Rockchip_OSAL_QueueTerminate(ROCKCHIP_QUEUE *queueHandle)
 {
-    int i = 0;
-    ROCKCHIP_QElem *currentqelem = NULL;
     ROCKCHIP_QUEUE *queue = (ROCKCHIP_QUEUE *)queueHandle;
-    OMX_ERRORTYPE ret = OMX_ErrorNone;
 
     if (!queue)
         return OMX_ErrorBadParameter;
 
-    for (i = 0; i < (queue->maxNumElem - 2); i++) { // 2:byte alignment
-        currentqelem = queue->first->qNext;
-        Rockchip_OSAL_Free(queue->first);
-        queue->first = currentqelem;
+    if (queue->elems) {
+        Rockchip_OSAL_Free(queue->elems);
+        queue->elems = NULL;
     }
 
-    if (queue->first) {
-        Rockchip_OSAL_Free(queue->first);
-        queue->first = NULL;
-    }
-
-    ret = Rockchip_OSAL_MutexTerminate(queue->qMutex);
-
-    return ret;
+    return OMX_ErrorNone;
 }
 
 int Rockchip_OSAL_Queue(ROCKCHIP_QUEUE *queueHandle, void *data)
 {
     ROCKCHIP_QUEUE *queue = (ROCKCHIP_QUEUE *)queueHandle;
-    if (queue == NULL) {
+    ROCKCHIP_QElem *elem = NULL;
+    OMX_U32 pos = 0;
+
+    if (queue == NULL || queue->elems == NULL) {
         return -1;
     }
 
-    Rockchip_OSAL_MutexLock(queue->qMutex);
-
-    if ((queue->last->data != NULL) || (queue->numElem >= queue->maxNumElem)) {
-        Rockchip_OSAL_MutexUnlock(queue->qMutex);
-        return -1;
+    pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        elem = &queue->elems[pos & queue->mask];
+        OMX_U32 seq = __atomic_load_n(&elem->seq, __ATOMIC_ACQUIRE);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            if ((int)(pos - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE)) >= queue->maxNumElem) {
+                return -1;
+            }
+            if (__atomic_compare_exchange_n(&queue->tail, &pos, pos + 1, OMX_FALSE,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the slot still holds the data of the last round
+            return -1;
+        } else {
+            pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        }
     }
-    queue->last->data = data;
-    queue->last = queue->last->qNext;
-    queue->numElem++;
 
-    Rockchip_OSAL_MutexUnlock(queue->qMutex);
+    elem->data = data;
+    // hand the slot over to the consumer of this position
+    __atomic_store_n(&elem->seq, pos + 1, __ATOMIC_RELEASE);
     return 0;
 }
 
@@ -128,22 +116,35 @@ void *Rockchip_OSAL_Dequeue(ROCKCHIP_QUEUE *queueHandle)
 {
     void *data = NULL;
     ROCKCHIP_QUEUE *queue = (ROCKCHIP_QUEUE *)queueHandle;
-    if (queue == NULL) {
+    ROCKCHIP_QElem *elem = NULL;
+    OMX_U32 pos = 0;
+
+    if (queue == NULL || queue->elems == NULL) {
         return NULL;
     }
 
-    Rockchip_OSAL_MutexLock(queue->qMutex);
-
-    if ((queue->first->data == NULL) || (queue->numElem <= 0)) {
-        Rockchip_OSAL_MutexUnlock(queue->qMutex);
-        return NULL;
+    pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    for (;;) {
+        elem = &queue->elems[pos & queue->mask];
+        OMX_U32 seq = __atomic_load_n(&elem->seq, __ATOMIC_ACQUIRE);
+        int diff = (int)(seq - (pos + 1));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->head, &pos, pos + 1, OMX_FALSE,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // empty
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
     }
-    data = queue->first->data;
-    queue->first->data = NULL;
-    queue->first = queue->first->qNext;
-    queue->numElem--;
 
-    Rockchip_OSAL_MutexUnlock(queue->qMutex);
+    data = elem->data;
+    elem->data = NULL;
+    // hand the slot over to the producer of the next round
+    __atomic_store_n(&elem->seq, pos + queue->mask + 1, __ATOMIC_RELEASE);
     return data;
 }
 
@@ -155,9 +156,11 @@ int Rockchip_OSAL_GetElemNum(ROCKCHIP_QUEUE *queueHandle)
         return -1;
     }
 
-    Rockchip_OSAL_MutexLock(queue->qMutex);
-    ElemNum = queue->numElem;
-    Rockchip_OSAL_MutexUnlock(queue->qMutex);
+    // the count is a snapshot while the other threads queue and dequeue
+    ElemNum = (int)(__atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) -
+                    __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE));
+    if (ElemNum < 0)
+        ElemNum = 0;
     return ElemNum;
 }
 
@@ -168,31 +171,25 @@ int Rockchip_OSAL_SetElemNum(ROCKCHIP_QUEUE *queueHandle, int ElemNum)
         return -1;
     }
 
-    Rockchip_OSAL_MutexLock(queue->qMutex);
-    queue->numElem = ElemNum;
-    Rockchip_OSAL_MutexUnlock(queue->qMutex);
+    // the count follows the elements in the ring, it can only be dropped to empty
+    if (ElemNum != 0) {
+        return -1;
+    }
+    Rockchip_OSAL_ResetQueue(queue);
     return ElemNum;
 }
 
 int Rockchip_OSAL_ResetQueue(ROCKCHIP_QUEUE *queueHandle)
 {
     ROCKCHIP_QUEUE *queue = (ROCKCHIP_QUEUE *)queueHandle;
-    ROCKCHIP_QElem *currentqelem = NULL;
 
     if (queue == NULL) {
         return -1;
     }
 
-    Rockchip_OSAL_MutexLock(queue->qMutex);
-    queue->first->data = NULL;
-    currentqelem = queue->first->qNext;
-    while (currentqelem != queue->first) {
-        currentqelem->data = NULL;
-        currentqelem = currentqelem->qNext;
+    // drop the elements like the consumer, the data is owned by the caller
+    while (Rockchip_OSAL_Dequeue(queue) != NULL) {
     }
-    queue->last = queue->first;
-    queue->numElem = 0x00;
-    Rockchip_OSAL_MutexUnlock(queue->qMutex);
 
     return 0;
-}
\ No newline at end of file
+}
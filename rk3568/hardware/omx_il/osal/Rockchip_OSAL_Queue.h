@@ -33,17 +33,22 @@
 #define QUEUE_ELEMENTS        10
 #define MAX_QUEUE_ELEMENTS    40
 
+/*
+ * The queue is a bounded ring of slots without lock. Each slot carries the position it is ready for,
+ * a producer claims the tail and a consumer claims the head with a compare and swap, so the client
+ * thread, the process threads and the flush paths may queue and dequeue at the same time.
+ */
 typedef struct _ROCKCHIP_QElem {
     void             *data;
-    struct _ROCKCHIP_QElem *qNext;
+    OMX_U32           seq;
 } ROCKCHIP_QElem;
 
 typedef struct _ROCKCHIP_QUEUE {
-    ROCKCHIP_QElem     *first;
-    ROCKCHIP_QElem     *last;
-    int            numElem;
+    ROCKCHIP_QElem *elems;
+    OMX_U32        mask;
+    OMX_U32        head;
+    OMX_U32        tail;
     int            maxNumElem;
-    OMX_HANDLETYPE qMutex;
 } ROCKCHIP_QUEUE;
 
 